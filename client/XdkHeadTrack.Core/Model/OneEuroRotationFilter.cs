@@ -0,0 +1,91 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Adaptive low-pass filter for orientations based on the One-Euro filter.
+	/// The cutoff frequency grows with the (smoothed) angular speed, so the
+	/// output is heavily smoothed at rest but follows fast head turns closely.
+	/// Smoothing is done by slerping on the quaternion directly.
+	/// </summary>
+	public class OneEuroRotationFilter
+	{
+		public const double DefaultMinCutoff = 0.5D;
+		public const double DefaultBeta = 2.0D;
+		public const double DefaultDerivativeCutoff = 1.0D;
+
+		/// <summary>
+		/// Cutoff frequency in Hz applied while the tracker is at rest.
+		/// </summary>
+		public double MinCutoff { get; set; }
+
+		/// <summary>
+		/// Cutoff increase in Hz per rad/s of angular speed.
+		/// </summary>
+		public double Beta { get; set; }
+
+		/// <summary>
+		/// Cutoff frequency in Hz used to smooth the angular speed estimate.
+		/// </summary>
+		public double DerivativeCutoff { get; set; }
+
+		public double AngularSpeed { get; private set; }
+
+		private bool _hasPrevious;
+		private Quaternion _previous;
+		private double _previousTimestamp;
+
+		public OneEuroRotationFilter() : this(DefaultMinCutoff, DefaultBeta, DefaultDerivativeCutoff) { }
+
+		public OneEuroRotationFilter(double minCutoff, double beta, double derivativeCutoff)
+		{
+			MinCutoff = minCutoff;
+			Beta = beta;
+			DerivativeCutoff = derivativeCutoff;
+		}
+
+		public void Reset()
+		{
+			_hasPrevious = false;
+			AngularSpeed = 0D;
+		}
+
+		/// <param name="rotation">The unfiltered rotation.</param>
+		/// <param name="timestamp">Sample time in seconds, must be monotonic.</param>
+		public Quaternion Filter(Quaternion rotation, double timestamp)
+		{
+			double dt = timestamp - _previousTimestamp;
+			if (!_hasPrevious || dt <= 0D)
+			{
+				_hasPrevious = true;
+				_previous = rotation;
+				_previousTimestamp = timestamp;
+				return rotation;
+			}
+
+			double speed = AngleBetween(_previous, rotation) / dt;
+			AngularSpeed += Alpha(dt, DerivativeCutoff) * (speed - AngularSpeed);
+
+			double cutoff = MinCutoff + Beta * AngularSpeed;
+			_previous = Quaternion.Slerp(_previous, rotation, Alpha(dt, cutoff));
+			_previousTimestamp = timestamp;
+			return _previous;
+		}
+
+		public static double AngleBetween(Quaternion a, Quaternion b)
+		{
+			double dot = a.W * b.W + a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+			double norm = Math.Sqrt((a.W * a.W + a.X * a.X + a.Y * a.Y + a.Z * a.Z) * (b.W * b.W + b.X * b.X + b.Y * b.Y + b.Z * b.Z));
+			if (norm <= 0D)
+				return 0D;
+			return 2D * Math.Acos(Math.Min(1D, Math.Abs(dot) / norm));
+		}
+
+		private static double Alpha(double dt, double cutoff)
+		{
+			double tau = 1D / (2D * Math.PI * cutoff);
+			return 1D / (1D + tau / dt);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	public class Orientation
+	{
+		/// <summary>Size of the UDP payload, see XdkWire.UdpOrientation.</summary>
+		public const int Size = XdkWire.UdpOrientation.Size;
+
+		public Point3D Translation { get; private set; }
+		public Quaternion Rotation { get; private set; }
+
+		private readonly Lazy<byte[]> _raw;
+		/// <summary>
+		/// UDP payload, converted once on first access.
+		/// </summary>
+		public byte[] Bytes => _raw.Value;
+
+		public Orientation(Point3D translation, Quaternion rotation)
+		{
+			Translation = translation;
+			Rotation = rotation;
+			_raw = new Lazy<byte[]>(Encode);
+		}
+
+		private byte[] Encode()
+		{
+			byte[] raw = new byte[Size];
+			Encode(Translation, Rotation, raw, 0);
+			return raw;
+		}
+
+		/// <summary>
+		/// Writes the UDP payload of a translation and rotation to buffer,
+		/// without allocating.
+		/// </summary>
+		public static void Encode(Point3D translation, Quaternion rotation, byte[] buffer, int offset)
+		{
+			Vector3D yawPitchRoll = ToYawPitchRoll(rotation);
+			new XdkWire.UdpOrientation
+			{
+				X = translation.X,
+				Y = translation.Y,
+				Z = translation.Z,
+				Yaw = yawPitchRoll.X,
+				Pitch = yawPitchRoll.Y,
+				Roll = yawPitchRoll.Z,
+			}.Encode(buffer, offset);
+		}
+
+		/// <summary>
+		/// Yaw, pitch and roll in degrees as sent in the UDP payload, also used
+		/// by the other outputs so that all of them report the same angles.
+		/// </summary>
+		public static Vector3D ToYawPitchRoll(Quaternion rotation)
+		{
+			Vector3D yawPitchRoll = rotation.QuatToEuler();
+
+			return new Vector3D(
+				yawPitchRoll.X * (360.0D / Math.PI),
+				yawPitchRoll.Y * (180.0D / Math.PI),
+				yawPitchRoll.Z * (180.0D / Math.PI));
+		}
+	}
+}
@@ -0,0 +1,90 @@
+﻿using System.Collections.Generic;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// A rotation on its way from the decoder to the output.
+	/// </summary>
+	public struct RotationSample
+	{
+		public Quaternion Rotation;
+		/// <summary>HostClock time of the sample.</summary>
+		public long Timestamp;
+
+		public RotationSample(Quaternion rotation, long timestamp)
+		{
+			Rotation = rotation;
+			Timestamp = timestamp;
+		}
+	}
+
+	/// <summary>
+	/// One step of the host tracking path, see RotationStages.cs.
+	/// </summary>
+	public interface IRotationStage
+	{
+		/// <summary>
+		/// Transforms the sample in place, returns false to drop it.
+		/// </summary>
+		bool Process(ref RotationSample sample);
+	}
+
+	/// <summary>
+	/// Two stages composed at compile time, nest them for longer chains:
+	/// RotationPipeline&lt;CalibrateStage, RotationPipeline&lt;FilterStage, UdpEncodeStage&gt;&gt;.
+	/// All stages are structs, so the JIT compiles one specialized Process for
+	/// the whole chain and can inline every stage, without interface calls or
+	/// allocations per sample.
+	///
+	/// Stages keep their state in themselves: store the pipeline in a field
+	/// (not a readonly one) and configure the stages through First and
+	/// Second, a copy of the pipeline is a copy of that state.
+	/// </summary>
+	public struct RotationPipeline<TFirst, TSecond> : IRotationStage
+		where TFirst : struct, IRotationStage
+		where TSecond : struct, IRotationStage
+	{
+		public TFirst First;
+		public TSecond Second;
+
+		public RotationPipeline(TFirst first, TSecond second)
+		{
+			First = first;
+			Second = second;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			return First.Process(ref sample) && Second.Process(ref sample);
+		}
+	}
+
+	/// <summary>
+	/// Chain of stages put together at run time, for ad-hoc configurations
+	/// that have no RotationPipeline type. Every stage costs an interface call
+	/// per sample, and struct stages are boxed once by Add.
+	/// </summary>
+	public class DynamicRotationPipeline : IRotationStage
+	{
+		private readonly List<IRotationStage> _stages = new List<IRotationStage>();
+
+		public IList<IRotationStage> Stages => _stages;
+
+		public DynamicRotationPipeline Add(IRotationStage stage)
+		{
+			_stages.Add(stage);
+			return this;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			for (int i = 0; i < _stages.Count; i++)
+			{
+				if (!_stages[i].Process(ref sample))
+					return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,246 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Same as XdkIO.Calibrate: removes the calibration rotation and turns the
+	/// result 180° about Z.
+	/// </summary>
+	public struct CalibrateStage : IRotationStage
+	{
+		private Quaternion _post;
+
+		public CalibrateStage(Quaternion calibrationCorrection)
+		{
+			_post = Quaternion.Identity;
+			SetCorrection(calibrationCorrection);
+		}
+
+		public void SetCorrection(Quaternion calibrationCorrection)
+		{
+			Quaternion inverse = calibrationCorrection;
+			inverse.Invert();
+			_post = inverse * new Quaternion(new Vector3D(0, 0, 1), 180);
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			sample.Rotation = sample.Rotation * _post;
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Expresses the rotation in axes turned by a fixed rotation, e.g. for a
+	/// tracker mounted sideways.
+	/// </summary>
+	public struct AxisRemapStage : IRotationStage
+	{
+		private readonly Quaternion _remap;
+		private readonly Quaternion _inverse;
+
+		public AxisRemapStage(Quaternion remap)
+		{
+			_remap = remap;
+			_inverse = remap;
+			_inverse.Invert();
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			sample.Rotation = _remap * sample.Rotation * _inverse;
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Runs the samples through a OneEuroRotationFilter while IsEnabled.
+	/// </summary>
+	public struct FilterStage : IRotationStage
+	{
+		public readonly OneEuroRotationFilter Filter;
+		public bool IsEnabled;
+
+		public FilterStage(OneEuroRotationFilter filter)
+		{
+			Filter = filter;
+			IsEnabled = true;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			if (IsEnabled)
+				sample.Rotation = Filter.Filter(sample.Rotation, HostClock.ToSeconds(sample.Timestamp));
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Extrapolates the rotation by a lead time with the angular velocity
+	/// between the last two samples, to hide part of the output latency. The
+	/// lead is capped at MaxSteps sample intervals.
+	/// </summary>
+	public struct PredictStage : IRotationStage
+	{
+		public const double MaxSteps = 4D;
+
+		private readonly long _lead;
+		private bool _hasPrevious;
+		private Quaternion _previous;
+		private long _previousTimestamp;
+
+		/// <param name="lead">Prediction horizon in HostClock ticks.</param>
+		public PredictStage(long lead)
+		{
+			_lead = lead;
+			_hasPrevious = false;
+			_previous = Quaternion.Identity;
+			_previousTimestamp = 0;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			Quaternion current = sample.Rotation;
+			long interval = sample.Timestamp - _previousTimestamp;
+			if (_hasPrevious && interval > 0)
+			{
+				// Rotation per interval in the frame of the device, the short way round.
+				Quaternion step = _previous;
+				step.Invert();
+				step = step * current;
+				if (step.W < 0D)
+					step = new Quaternion(-step.X, -step.Y, -step.Z, -step.W);
+				if (!step.IsIdentity)
+				{
+					double steps = Math.Min((double)_lead / interval, MaxSteps);
+					sample.Rotation = current * new Quaternion(step.Axis, step.Angle * steps);
+				}
+			}
+			_hasPrevious = true;
+			_previous = current;
+			_previousTimestamp = sample.Timestamp;
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Drops samples that follow the last passed one closer than the output
+	/// interval, e.g. to feed a 1 kHz device into a receiver that wants 100 Hz.
+	/// </summary>
+	public struct ResampleStage : IRotationStage
+	{
+		private readonly long _interval;
+		private bool _hasOutput;
+		private long _nextTimestamp;
+
+		/// <param name="interval">Output interval in HostClock ticks.</param>
+		public ResampleStage(long interval)
+		{
+			_interval = interval;
+			_hasOutput = false;
+			_nextTimestamp = 0;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			if (_hasOutput && sample.Timestamp < _nextTimestamp)
+				return false;
+			// Stay on the grid unless the input fell behind by a whole interval.
+			_nextTimestamp = _hasOutput && sample.Timestamp - _nextTimestamp < _interval
+				? _nextTimestamp + _interval
+				: sample.Timestamp + _interval;
+			_hasOutput = true;
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Writes the UDP payload of the sample, see Orientation.Encode, to
+	/// Payload. The payload is overwritten by the next sample.
+	/// </summary>
+	public struct UdpEncodeStage : IRotationStage
+	{
+		public readonly byte[] Payload;
+
+		public static UdpEncodeStage Create()
+		{
+			return new UdpEncodeStage(new byte[Orientation.Size]);
+		}
+
+		public UdpEncodeStage(byte[] payload)
+		{
+			Payload = payload;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			Orientation.Encode(new Point3D(), sample.Rotation, Payload, 0);
+			return true;
+		}
+	}
+	/// <summary>
+	/// Encodes the sample like UdpEncodeStage and sends it, for the UDP output
+	/// worker.
+	/// </summary>
+	public struct UdpSendStage : IRotationStage
+	{
+		private readonly UdpOrientationSender _sender;
+		private UdpEncodeStage _encode;
+
+		public UdpSendStage(UdpOrientationSender sender)
+		{
+			_sender = sender;
+			_encode = UdpEncodeStage.Create();
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			_encode.Process(ref sample);
+			_sender.Send(_encode.Payload, Orientation.Size);
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Posts the sample to the next workers, each gets its own copy and drops
+	/// it on its own if it is behind, see RotationWorker.
+	/// </summary>
+	public struct ForwardStage : IRotationStage
+	{
+		private readonly RotationWorker[] _targets;
+
+		public ForwardStage(params RotationWorker[] targets)
+		{
+			_targets = targets;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			for (int i = 0; i < _targets.Length; i++)
+				_targets[i].Post(sample);
+			return true;
+		}
+	}
+
+	/// <summary>
+	/// Makes the sample the latest value of a TripleBuffer, for readers that
+	/// only want the newest one.
+	/// </summary>
+	public struct PublishStage : IRotationStage
+	{
+		private readonly TripleBuffer<RotationSample> _latest;
+
+		public PublishStage(TripleBuffer<RotationSample> latest)
+		{
+			_latest = latest;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			_latest.Write(sample);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,175 @@
+﻿using System;
+using System.Diagnostics;
+using System.Threading;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// A thread of the host pipeline. Samples posted by the thread before it
+	/// go through a bounded SpscQueue and are run through the worker's stage
+	/// here. A ForwardStage at the end of the stage hands them on to the next
+	/// workers, a PublishStage to latest-value readers like the UI:
+	///
+	///   serial thread (XdkIO) -> processing worker -> output workers
+	///
+	/// A stage that falls behind fills its own queue and loses its own
+	/// samples, counted in Dropped, while the workers before it carry on.
+	/// </summary>
+	public abstract class RotationWorker : IDisposable
+	{
+		/// <summary>
+		/// Polls of an empty queue before the worker goes to sleep, to save the
+		/// wake-up for samples that follow each other closely.
+		/// </summary>
+		public const int SpinCount = 100;
+
+		private readonly SpscQueue<RotationSample> _input;
+		private readonly AutoResetEvent _signal = new AutoResetEvent(false);
+		private readonly Thread _thread;
+		private readonly int _processor;
+		// 1 while the worker is about to sleep, the producer then wakes it.
+		private int _isWaiting;
+		private volatile bool _isStopping;
+		private volatile bool _isRunning;
+		private long _dropped;
+
+		public string Name { get; private set; }
+
+		/// <summary>
+		/// Samples rejected by Post because the queue was full.
+		/// </summary>
+		public long Dropped => Interlocked.Read(ref _dropped);
+
+		public int Pending => _input.Count;
+
+		public bool IsRunning => _isRunning;
+
+		/// <summary>
+		/// Exception that ended the worker, null while it runs or was stopped.
+		/// </summary>
+		public Exception Fault { get; private set; }
+
+		/// <param name="processor">Logical processor to pin the thread to, -1 for none.</param>
+		protected RotationWorker(string name, int capacity, int processor)
+		{
+			Name = name;
+			_processor = processor;
+			_input = new SpscQueue<RotationSample>(capacity);
+			_thread = new Thread(Run) { Name = name, IsBackground = true };
+		}
+
+		public void Start()
+		{
+			_isRunning = true;
+			_thread.Start();
+		}
+
+		/// <summary>
+		/// Queues a sample, only called by the one thread feeding this worker.
+		/// Returns false and drops the sample if the queue is full.
+		/// </summary>
+		public bool Post(RotationSample sample)
+		{
+			if (!_input.TryEnqueue(sample))
+			{
+				Interlocked.Increment(ref _dropped);
+				return false;
+			}
+			// A full barrier between the enqueue and the check, the worker does
+			// the same between setting the flag and checking the queue.
+			if (Interlocked.CompareExchange(ref _isWaiting, 0, 1) == 1)
+				_signal.Set();
+			return true;
+		}
+
+		/// <summary>
+		/// Runs on the worker thread for every sample.
+		/// </summary>
+		protected abstract void Process(ref RotationSample sample);
+
+		private void Run()
+		{
+			if (_processor >= 0 && !ThreadAffinity.PinCurrentThread(_processor))
+				Debug.WriteLine("Worker " + Name + " not pinned to processor " + _processor);
+
+			try
+			{
+				int idle = 0;
+				while (!_isStopping)
+				{
+					RotationSample sample;
+					if (_input.TryDequeue(out sample))
+					{
+						idle = 0;
+						Process(ref sample);
+					}
+					else if (++idle < SpinCount)
+					{
+						Thread.SpinWait(20);
+					}
+					else
+					{
+						Interlocked.Exchange(ref _isWaiting, 1);
+						if (_input.IsEmpty && !_isStopping)
+							_signal.WaitOne();
+						Interlocked.Exchange(ref _isWaiting, 0);
+						idle = 0;
+					}
+				}
+			}
+			catch (Exception e)
+			{
+				Debug.WriteLine("Worker " + Name + " failed: " + e);
+				Fault = e;
+			}
+			finally
+			{
+				_isRunning = false;
+			}
+		}
+
+		/// <summary>
+		/// Stops the thread after the sample it is processing, the samples still
+		/// queued are dropped.
+		/// </summary>
+		public void Stop()
+		{
+			_isStopping = true;
+			_signal.Set();
+			if (_thread.IsAlive)
+				_thread.Join();
+		}
+
+		public void Dispose()
+		{
+			Stop();
+			_signal.Dispose();
+		}
+	}
+
+	/// <summary>
+	/// Worker running the samples through a stage struct, usually a
+	/// RotationPipeline, which the JIT specializes for this worker.
+	/// </summary>
+	public sealed class RotationWorker<TStage> : RotationWorker
+		where TStage : struct, IRotationStage
+	{
+		/// <summary>
+		/// The stage, used by the worker thread. Configure it before Start,
+		/// afterwards only through single fields like FilterStage.IsEnabled.
+		/// </summary>
+		public TStage Stage;
+
+		public RotationWorker(string name, TStage stage, int capacity = 256, int processor = -1)
+			: base(name, capacity, processor)
+		{
+			Stage = stage;
+		}
+
+		protected override void Process(ref RotationSample sample)
+		{
+			Stage.Process(ref sample);
+		}
+	}
+}
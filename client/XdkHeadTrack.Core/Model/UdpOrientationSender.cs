@@ -3,7 +3,7 @@ using System.Diagnostics;
 using System.Net;
 using System.Net.Sockets;
 using System.Threading.Tasks;
-using System.Windows.Media.Media3D;
+using XdkHeadTrack.Numerics;
 using XdkHeadTrack.Utils;
 
 namespace XdkHeadTrack.Model
@@ -64,6 +64,14 @@ namespace XdkHeadTrack.Model
 		}
 
 		public void Send(Orientation orientation)
+		{
+			Send(orientation.Bytes, orientation.Bytes.Length);
+		}
+
+		/// <summary>
+		/// Sends a payload encoded beforehand, e.g. by UdpEncodeStage.
+		/// </summary>
+		public void Send(byte[] payload, int count)
 		{
 			UdpClient c;
 			if (TargetEndpoint.AddressFamily == AddressFamily.InterNetwork)
@@ -73,8 +81,8 @@ namespace XdkHeadTrack.Model
 			else
 				throw new InvalidOperationException("IPEndPoint address-familiy not supported, use IPv4 or IPv6.");
 
-			int len = c.Send(orientation.Bytes, orientation.Bytes.Length, TargetEndpoint);
-			Debug.Assert(len == orientation.Bytes.Length);
+			int len = c.Send(payload, count, TargetEndpoint);
+			Debug.Assert(len == count);
 		}
 
 		public async Task SendAsync(Orientation orientation)
@@ -0,0 +1,115 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Ports;
+using System.Threading;
+using System.Threading.Tasks;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Manages many XDK connections on one host. Every device has a single
+	/// overlapped read outstanding at a time, so reads complete on the shared
+	/// I/O completion threads instead of one thread per device, and the bytes
+	/// are parsed right there on the completing thread. All devices are stamped
+	/// with the same HostClock base.
+	/// </summary>
+	public class XdkAggregator : IDisposable
+	{
+		public const int ReadBufferSize = 4096;
+
+		public event EventHandler<XdkDeviceRotationEventArgs> RotationReceived;
+
+		private readonly List<XdkDevice> _devices = new List<XdkDevice>();
+		private readonly List<Stream> _streams = new List<Stream>();
+		private readonly List<Task> _readers = new List<Task>();
+		private readonly object _devicesLock = new object();
+		private readonly CancellationTokenSource _cancel = new CancellationTokenSource();
+
+		public IReadOnlyList<XdkDevice> Devices
+		{
+			get { lock (_devicesLock) { return _devices.ToArray(); } }
+		}
+
+		/// <summary>
+		/// Completes once the streams of all devices added so far have ended.
+		/// </summary>
+		public Task Completion
+		{
+			get { lock (_devicesLock) { return Task.WhenAll(_readers.ToArray()); } }
+		}
+
+		/// <summary>
+		/// Adds a device reading from the given stream, which should support
+		/// asynchronous reads (serial ports, sockets, pipes opened asynchronously).
+		/// The aggregator takes ownership of the stream.
+		/// </summary>
+		public XdkDevice Add(string name, Stream stream)
+		{
+			XdkDevice device;
+			lock (_devicesLock)
+			{
+				device = new XdkDevice(_devices.Count, name);
+				device.Output = FireRotationReceived;
+				_devices.Add(device);
+				_streams.Add(stream);
+				_readers.Add(ReadAsync(device, stream, _cancel.Token));
+			}
+			return device;
+		}
+
+		public XdkDevice AddSerial(string portName)
+		{
+			SerialPort port = new SerialPort(portName, 115200);
+			port.Open();
+			return Add(portName, port.BaseStream);
+		}
+
+		private void FireRotationReceived(XdkDevice device, Quaternion rotation, long timestamp)
+		{
+			RotationReceived?.Invoke(this, new XdkDeviceRotationEventArgs(device, rotation, timestamp, device.LastSequence));
+		}
+
+		private static async Task ReadAsync(XdkDevice device, Stream stream, CancellationToken cancel)
+		{
+			byte[] buffer = new byte[ReadBufferSize];
+			try
+			{
+				int read;
+				while ((read = await stream.ReadAsync(buffer, 0, buffer.Length, cancel).ConfigureAwait(false)) > 0)
+					device.Feed(buffer, 0, read, HostClock.Now);
+			}
+			catch (OperationCanceledException) { }
+			catch (ObjectDisposedException) { }
+			catch (IOException) { }
+		}
+
+		public void Dispose()
+		{
+			_cancel.Cancel();
+			lock (_devicesLock)
+			{
+				foreach (Stream stream in _streams)
+					stream.Dispose();
+			}
+			_cancel.Dispose();
+		}
+	}
+
+	public class XdkDeviceRotationEventArgs : XdkIORotationEventArgs
+	{
+		public XdkDevice Device { get; private set; }
+
+		public XdkDeviceRotationEventArgs(XdkDevice device, Quaternion rotation, long timestamp) : this(device, rotation, timestamp, -1)
+		{
+		}
+
+		public XdkDeviceRotationEventArgs(XdkDevice device, Quaternion rotation, long timestamp, int sequence)
+			: base(rotation, timestamp, XdkSampleOrigin.Received, 0, double.NaN, sequence)
+		{
+			Device = device;
+		}
+	}
+}
@@ -0,0 +1,164 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Codec for the packed BleUi_TrackingData_T notification payload of the firmware.
+	/// Older firmware sends the payload without the trailing sequence number.
+	/// Firmware built with HEAD_TRACK_USE_COMPACT_BLE_FRAMES sends
+	/// BleUi_CompactTrackingData_T instead, see TryDecodeCompact. The layouts
+	/// are the ones of XdkWire, generated from schema/XdkWire.json.
+	/// </summary>
+	public static class XdkBleFrame
+	{
+		public const int LegacySize = XdkWire.LegacyTrackingData.Size;
+		public const int Size = XdkWire.TrackingData.Size;
+		public const int CompactSize = XdkWire.CompactTrackingData.Size;
+
+		private const byte CompactCalibrationFlag = XdkWire.CompactTrackingData.FlagCalibration;
+		private const byte CompactPreviousValidFlag = XdkWire.CompactTrackingData.FlagPreviousValid;
+		private const int CompactCurrentComponentShift = XdkWire.CompactTrackingData.CurrentComponentShift;
+		private const int CompactPreviousComponentShift = XdkWire.CompactTrackingData.PreviousComponentShift;
+		private const int CompactComponentMask = XdkWire.CompactTrackingData.ComponentMask;
+		private const double PackScale = 32767D * 1.41421356D;
+
+		public static bool TryDecode(byte[] buffer, int offset, int count, out Quaternion rotation, out bool isCalibration)
+		{
+			int sequence;
+			return TryDecode(buffer, offset, count, out rotation, out isCalibration, out sequence);
+		}
+
+		/// <summary>
+		/// Decodes one notification payload of count bytes. The sequence number
+		/// is -1 for legacy payloads.
+		/// </summary>
+		public static bool TryDecode(byte[] buffer, int offset, int count, out Quaternion rotation, out bool isCalibration, out int sequence)
+		{
+			if (count < LegacySize || (count > LegacySize && count < Size))
+			{
+				rotation = Quaternion.Identity;
+				isCalibration = false;
+				sequence = -1;
+				return false;
+			}
+
+			if (count >= Size)
+			{
+				XdkWire.TrackingData data = XdkWire.TrackingData.Decode(buffer, offset);
+				rotation = new Quaternion(data.X, data.Y, data.Z, data.W);
+				isCalibration = data.UseForCalibration;
+				sequence = data.Sequence;
+			}
+			else
+			{
+				XdkWire.LegacyTrackingData data = XdkWire.LegacyTrackingData.Decode(buffer, offset);
+				rotation = new Quaternion(data.X, data.Y, data.Z, data.W);
+				isCalibration = data.UseForCalibration;
+				sequence = -1;
+			}
+			return true;
+		}
+
+		public static void Encode(Quaternion rotation, bool isCalibration, byte[] buffer, int offset)
+		{
+			Encode(rotation, isCalibration, 0, buffer, offset);
+		}
+
+		public static void Encode(Quaternion rotation, bool isCalibration, int sequence, byte[] buffer, int offset)
+		{
+			new XdkWire.TrackingData
+			{
+				W = (float)rotation.W,
+				X = (float)rotation.X,
+				Y = (float)rotation.Y,
+				Z = (float)rotation.Z,
+				UseForCalibration = isCalibration,
+				Sequence = (ushort)sequence,
+			}.Encode(buffer, offset);
+		}
+
+		/// <summary>
+		/// Decodes one compact notification payload. The previous sample, if
+		/// present, is the one with sequence number sequence - 1.
+		/// </summary>
+		public static bool TryDecodeCompact(byte[] buffer, int offset, int count, out Quaternion rotation, out bool isCalibration, out int sequence, out bool hasPrevious, out Quaternion previous)
+		{
+			if (count != CompactSize)
+			{
+				rotation = previous = Quaternion.Identity;
+				isCalibration = hasPrevious = false;
+				sequence = -1;
+				return false;
+			}
+
+			byte flags = buffer[offset];
+			isCalibration = (flags & CompactCalibrationFlag) != 0;
+			hasPrevious = (flags & CompactPreviousValidFlag) != 0;
+			sequence = BitConverter.ToUInt16(buffer, offset + XdkWire.CompactTrackingData.SequenceOffset);
+			rotation = Unpack(buffer, offset + XdkWire.CompactTrackingData.CurrentOffset,
+				(flags >> CompactCurrentComponentShift) & CompactComponentMask);
+			previous = hasPrevious
+				? Unpack(buffer, offset + XdkWire.CompactTrackingData.PreviousOffset, (flags >> CompactPreviousComponentShift) & CompactComponentMask)
+				: Quaternion.Identity;
+			return true;
+		}
+
+		public static void EncodeCompact(Quaternion rotation, bool isCalibration, int sequence, bool hasPrevious, Quaternion previous, byte[] buffer, int offset)
+		{
+			int flags = Pack(rotation, buffer, offset + XdkWire.CompactTrackingData.CurrentOffset) << CompactCurrentComponentShift;
+			if (isCalibration)
+				flags |= CompactCalibrationFlag;
+			if (hasPrevious)
+				flags |= CompactPreviousValidFlag | Pack(previous, buffer, offset + XdkWire.CompactTrackingData.PreviousOffset) << CompactPreviousComponentShift;
+			else
+				Array.Clear(buffer, offset + XdkWire.CompactTrackingData.PreviousOffset, 3 * sizeof(short));
+			buffer[offset + XdkWire.CompactTrackingData.FlagsOffset] = (byte)flags;
+			Array.Copy(BitConverter.GetBytes((ushort)sequence), 0, buffer, offset + XdkWire.CompactTrackingData.SequenceOffset, sizeof(ushort));
+		}
+
+		/// <summary>
+		/// Same "smallest three" packing as QuatPack_Pack of the firmware.
+		/// Returns the index (w, x, y, z) of the dropped component.
+		/// </summary>
+		private static int Pack(Quaternion rotation, byte[] buffer, int offset)
+		{
+			double[] components = { rotation.W, rotation.X, rotation.Y, rotation.Z };
+			int largest = 0;
+			for (int i = 1; i < components.Length; i++)
+			{
+				if (Math.Abs(components[i]) > Math.Abs(components[largest]))
+					largest = i;
+			}
+
+			double sign = components[largest] >= 0D ? 1D : -1D;
+			for (int i = 0, j = 0; i < components.Length; i++)
+			{
+				if (i == largest)
+					continue;
+				double scaled = Math.Max(-short.MaxValue, Math.Min(short.MaxValue, sign * components[i] * PackScale));
+				short packed = (short)(scaled + (scaled >= 0D ? 0.5D : -0.5D));
+				Array.Copy(BitConverter.GetBytes(packed), 0, buffer, offset + sizeof(short) * j++, sizeof(short));
+			}
+			return largest;
+		}
+
+		/// <summary>
+		/// Inverse of Pack, also used for the rotations of flight recordings.
+		/// </summary>
+		internal static Quaternion Unpack(byte[] buffer, int offset, int dropped)
+		{
+			double[] components = new double[4];
+			double sum = 0D;
+			for (int i = 0, j = 0; i < components.Length; i++)
+			{
+				if (i == dropped)
+					continue;
+				components[i] = BitConverter.ToInt16(buffer, offset + sizeof(short) * j++) / PackScale;
+				sum += components[i] * components[i];
+			}
+			components[dropped] = Math.Sqrt(Math.Max(0D, 1D - sum));
+			return new Quaternion(components[1], components[2], components[3], components[0]);
+		}
+	}
+}
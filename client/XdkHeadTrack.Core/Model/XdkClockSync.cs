@@ -0,0 +1,233 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Estimates offset and drift of the device clock (TimeSync_GetDeviceTime of
+	/// the firmware, 32 bit microseconds) against HostClock from NTP style
+	/// "SYNC" exchanges. Every exchange yields a pair of host and device
+	/// midpoints that is correct within half its round trip delay. A line is
+	/// fitted through the pairs of the exchanges with the shortest delays in
+	/// the window, which also gives the drift.
+	/// </summary>
+	public class XdkClockSync
+	{
+		/// <summary>Number of recent exchanges the estimate is based on.</summary>
+		public const int WindowSize = 64;
+
+		/// <summary>
+		/// Device time the used exchanges have to span before the drift is
+		/// estimated. Until then the clocks are assumed to run at the same rate.
+		/// </summary>
+		public const double MinDriftSpanMicroseconds = 20000000D;
+
+		/// <summary>
+		/// An exchange whose device time is further off the estimate than this
+		/// is taken as a device restart and starts the estimate over.
+		/// </summary>
+		public const double RestartThresholdMicroseconds = 1000000D;
+
+		/// <summary>
+		/// Assumed uncertainty of the drift estimate, covers e.g. temperature
+		/// changes between exchanges. Adds to the error bound with the distance
+		/// to the newest exchange, together with the standard error of the fit.
+		/// </summary>
+		public double DriftUncertaintyPpm { get; set; } = 5D;
+
+		/// <summary>
+		/// Drift assumed while it is not estimated yet, the tolerance of the
+		/// crystals of both clocks.
+		/// </summary>
+		public double MaxDriftPpm { get; set; } = 100D;
+
+		public bool IsSynchronized { get { lock (_lock) return _count > 0; } }
+		public long ExchangeCount { get { lock (_lock) return _exchangeCount; } }
+		public long RestartCount { get { lock (_lock) return _restartCount; } }
+		/// <summary>Device clock minus host clock at the newest exchange.</summary>
+		public double OffsetMicroseconds { get { lock (_lock) return _referenceDevice - _referenceHost - _intercept; } }
+		public double DriftPpm { get { lock (_lock) return (1D / _slope - 1D) * 1000000D; } }
+		/// <summary>Error bound of a mapping at the time of the newest exchange.</summary>
+		public double ErrorBoundMicroseconds { get { lock (_lock) return _errorBound; } }
+		public double MinRoundTripMicroseconds { get { lock (_lock) return _minRoundTrip; } }
+
+		private struct Exchange
+		{
+			public double Host;
+			public double Device;
+			public double RoundTrip;
+		}
+
+		private readonly Exchange[] _window = new Exchange[WindowSize];
+		private readonly object _lock = new object();
+		private int _count;
+		private int _next;
+		private long _exchangeCount;
+		private long _restartCount;
+		private long _lastDevice;
+		// host = _referenceHost + _intercept + _slope * (device - _referenceDevice), all in microseconds.
+		private double _referenceHost;
+		private double _referenceDevice;
+		private double _intercept;
+		private double _slope = 1D;
+		private double _slopeUncertainty;
+		private double _errorBound = double.NaN;
+		private double _minRoundTrip = double.NaN;
+
+		public static string CreateRequest(long hostTimestamp)
+		{
+			return "SYNC " + hostTimestamp.ToString(CultureInfo.InvariantCulture);
+		}
+
+		/// <summary>
+		/// Parses the payload of a ">>RESP: SYNC t1 t2 t3" line received at
+		/// hostReceived and adds the exchange.
+		/// </summary>
+		public bool TryAddResponse(string payload, long hostReceived)
+		{
+			string[] parts = payload.Split(' ');
+			long hostSent;
+			uint deviceReceived, deviceSent;
+			if (parts.Length != 4 || parts[0] != "SYNC"
+				|| !long.TryParse(parts[1], NumberStyles.None, CultureInfo.InvariantCulture, out hostSent)
+				|| !uint.TryParse(parts[2], NumberStyles.None, CultureInfo.InvariantCulture, out deviceReceived)
+				|| !uint.TryParse(parts[3], NumberStyles.None, CultureInfo.InvariantCulture, out deviceSent))
+			{
+				return false;
+			}
+			return AddExchange(hostSent, deviceReceived, deviceSent, hostReceived);
+		}
+
+		/// <summary>
+		/// Adds one exchange: request sent and response received in HostClock
+		/// ticks, request received and response sent in device microseconds.
+		/// </summary>
+		public bool AddExchange(long hostSent, uint deviceReceived, uint deviceSent, long hostReceived)
+		{
+			double roundTrip = HostClock.ToMicroseconds(hostReceived - hostSent) - (uint)(deviceSent - deviceReceived);
+			if (hostReceived < hostSent || roundTrip < 0D)
+				return false;
+
+			lock (_lock)
+			{
+				double host = HostClock.ToMicroseconds(hostSent) + HostClock.ToMicroseconds(hostReceived - hostSent) / 2D;
+				long device = Extend(deviceReceived) + (uint)(deviceSent - deviceReceived) / 2;
+				if (_count > 0 && Math.Abs(ToHost(device) - host) > RestartThresholdMicroseconds)
+				{
+					// Fit reads the window from its start.
+					_count = 0;
+					_next = 0;
+					_restartCount++;
+				}
+
+				_window[_next] = new Exchange { Host = host, Device = device, RoundTrip = roundTrip };
+				_next = (_next + 1) % WindowSize;
+				_count = Math.Min(_count + 1, WindowSize);
+				_exchangeCount++;
+				_lastDevice = device;
+				_referenceHost = host;
+				_referenceDevice = device;
+				Fit();
+				return true;
+			}
+		}
+
+		/// <summary>
+		/// Maps a device time, e.g. of a sample, to HostClock ticks. The error
+		/// bound holds as long as the device clock behaved as estimated.
+		/// </summary>
+		public bool TryToHostTime(uint deviceTime, out long hostTimestamp, out double errorBoundMicroseconds)
+		{
+			lock (_lock)
+			{
+				if (_count == 0)
+				{
+					hostTimestamp = 0;
+					errorBoundMicroseconds = double.NaN;
+					return false;
+				}
+
+				long device = _lastDevice + (int)(deviceTime - (uint)_lastDevice);
+				hostTimestamp = HostClock.FromSeconds(ToHost(device) / 1000000D);
+				errorBoundMicroseconds = _errorBound + Math.Abs(device - _referenceDevice) * _slopeUncertainty;
+				return true;
+			}
+		}
+
+		public void Reset()
+		{
+			lock (_lock)
+			{
+				_count = 0;
+				_next = 0;
+				_exchangeCount = 0;
+				_restartCount = 0;
+				_slope = 1D;
+				_intercept = 0D;
+				_errorBound = double.NaN;
+				_minRoundTrip = double.NaN;
+			}
+		}
+
+		private long Extend(uint deviceTime)
+		{
+			return _count == 0 ? deviceTime : _lastDevice + (int)(deviceTime - (uint)_lastDevice);
+		}
+
+		private double ToHost(long device)
+		{
+			return _referenceHost + _intercept + _slope * (device - _referenceDevice);
+		}
+
+		private void Fit()
+		{
+			// The faster half of the exchanges, their midpoints are the most exact.
+			List<Exchange> used = new List<Exchange>(_count);
+			for (int i = 0; i < _count; i++)
+				used.Add(_window[i]);
+			used.Sort((a, b) => a.RoundTrip.CompareTo(b.RoundTrip));
+			_minRoundTrip = used[0].RoundTrip;
+			used.RemoveRange((used.Count + 1) / 2, used.Count / 2);
+
+			double meanX = 0D, meanY = 0D;
+			foreach (Exchange exchange in used)
+			{
+				meanX += exchange.Device - _referenceDevice;
+				meanY += exchange.Host - _referenceHost;
+			}
+			meanX /= used.Count;
+			meanY /= used.Count;
+
+			double sxx = 0D, sxy = 0D, minX = double.MaxValue, maxX = double.MinValue;
+			foreach (Exchange exchange in used)
+			{
+				double x = exchange.Device - _referenceDevice;
+				minX = Math.Min(minX, x);
+				maxX = Math.Max(maxX, x);
+				sxx += (x - meanX) * (x - meanX);
+				sxy += (x - meanX) * (exchange.Host - _referenceHost - meanY);
+			}
+
+			// Needs some span before the drift can be told from the delay noise.
+			bool isDriftKnown = maxX - minX >= MinDriftSpanMicroseconds && used.Count > 2;
+			_slope = isDriftKnown ? sxy / sxx : 1D;
+			_intercept = meanY - _slope * meanX;
+
+			double squaredResiduals = 0D;
+			_errorBound = 0D;
+			foreach (Exchange exchange in used)
+			{
+				double residual = exchange.Host - ToHost((long)exchange.Device);
+				squaredResiduals += residual * residual;
+				_errorBound = Math.Max(_errorBound, Math.Abs(residual) + exchange.RoundTrip / 2D);
+			}
+
+			// Three standard errors of the fitted slope.
+			_slopeUncertainty = isDriftKnown
+				? 3D * Math.Sqrt(squaredResiduals / (used.Count - 2) / sxx) + DriftUncertaintyPpm / 1000000D
+				: MaxDriftPpm / 1000000D;
+		}
+	}
+}
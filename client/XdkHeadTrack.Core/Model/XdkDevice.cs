@@ -0,0 +1,160 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// One XDK managed by an XdkAggregator. Holds the calibration and sample
+	/// bookkeeping of that device and forwards calibrated rotations to its
+	/// Output. Unlike XdkIO it does not raise property change notifications,
+	/// so many devices can be fed from worker threads without a dispatcher.
+	/// </summary>
+	public class XdkDevice
+	{
+		public const int MaxLineLength = XdkLineAssembler.MaxLineLength;
+
+		public int Id { get; private set; }
+		public string Name { get; private set; }
+		public XdkSerialDemux Demux { get; } = new XdkSerialDemux();
+
+		/// <summary>
+		/// Receives the device, its calibrated rotation and the host timestamp
+		/// of every sample. Called on the aggregator's worker threads.
+		/// </summary>
+		public Action<XdkDevice, Quaternion, long> Output { get; set; }
+
+		private readonly object _stateLock = new object();
+		private Quaternion _calibrationCorrection = Quaternion.Identity;
+		private Quaternion _rawRotation = Quaternion.Identity;
+		private Quaternion _calibratedRotation = Quaternion.Identity;
+		private long _sampleCount;
+		private long _lastTimestamp;
+		private long _discardedLineCount;
+		private long _lostSampleCount;
+		private int _lastSequence = -1;
+
+		public Quaternion CalibrationCorrection
+		{
+			get { lock (_stateLock) { return _calibrationCorrection; } }
+		}
+
+		public Quaternion RawRotation
+		{
+			get { lock (_stateLock) { return _rawRotation; } }
+		}
+
+		public Quaternion CalibratedRotation
+		{
+			get { lock (_stateLock) { return _calibratedRotation; } }
+		}
+
+		public long SampleCount
+		{
+			get { lock (_stateLock) { return _sampleCount; } }
+		}
+
+		public long LastTimestamp
+		{
+			get { lock (_stateLock) { return _lastTimestamp; } }
+		}
+
+		public long DiscardedLineCount
+		{
+			get { lock (_stateLock) { return _discardedLineCount; } }
+		}
+
+		/// <summary>
+		/// Samples missing in the sequence numbers sent by the firmware.
+		/// </summary>
+		public long LostSampleCount
+		{
+			get { lock (_stateLock) { return _lostSampleCount; } }
+		}
+
+		/// <summary>
+		/// Sequence number of the last sample that had one, -1 before. Read from
+		/// Output it belongs to the sample passed there.
+		/// </summary>
+		public int LastSequence
+		{
+			get { lock (_stateLock) { return _lastSequence; } }
+		}
+
+		private readonly XdkLineAssembler _lineAssembler = new XdkLineAssembler();
+		private readonly Action<string, long> _routeLine;
+
+		public XdkDevice(int id, string name)
+		{
+			Id = id;
+			Name = name;
+			Demux.Register(XdkSerialChannel.Tracking, ProcessTrackingLine);
+			_routeLine = (line, timestamp) => Demux.Route(line, timestamp);
+		}
+
+		public void RouteTo(UdpOrientationSender sender)
+		{
+			Output = (device, rotation, timestamp) => sender.Send(rotation);
+		}
+
+		/// <summary>
+		/// Feeds raw bytes read from the device. All bytes of one read share the
+		/// given timestamp. Must not be called concurrently for the same device.
+		/// </summary>
+		public void Feed(byte[] buffer, int offset, int count, long timestamp)
+		{
+			int discarded = _lineAssembler.Feed(buffer, offset, count, timestamp, _routeLine);
+			if (discarded > 0)
+			{
+				lock (_stateLock)
+				{
+					_discardedLineCount += discarded;
+				}
+			}
+		}
+
+		public void ProcessLine(string line, long timestamp)
+		{
+			Demux.Route(line, timestamp);
+		}
+
+		private void ProcessTrackingLine(string line, long timestamp)
+		{
+			Quaternion rotation;
+			int sequence;
+			switch (XdkLineParser.TryParse(line, out rotation, out sequence))
+			{
+				case XdkLineType.Rotation:
+					Quaternion calibrated;
+					lock (_stateLock)
+					{
+						if (sequence >= 0)
+						{
+							int gap = (ushort)(sequence - _lastSequence);
+							if (_lastSequence >= 0 && gap > 0 && gap <= XdkLinkMerger.WindowSize)
+								_lostSampleCount += gap - 1;
+							_lastSequence = sequence;
+						}
+						calibrated = XdkIO.Calibrate(rotation, _calibrationCorrection);
+						_rawRotation = rotation;
+						_calibratedRotation = calibrated;
+						_sampleCount++;
+						_lastTimestamp = timestamp;
+					}
+					Output?.Invoke(this, calibrated, timestamp);
+					break;
+				case XdkLineType.Calibration:
+					lock (_stateLock)
+					{
+						_calibrationCorrection = rotation;
+					}
+					break;
+				default:
+					lock (_stateLock)
+					{
+						_discardedLineCount++;
+					}
+					break;
+			}
+		}
+	}
+}
@@ -0,0 +1,170 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// FlightRecorder_Reason_T of the firmware.
+	/// </summary>
+	public enum XdkFlightRecorderReason
+	{
+		Button,
+		Command,
+		ReadFailure,
+		/// <summary>Fused rotation jumped further than plausible between two samples.</summary>
+		Glitch,
+	}
+
+	/// <summary>
+	/// One FlightRecorder_Sample_T of a flight recording.
+	/// </summary>
+	public class XdkFlightSample
+	{
+		/// <summary>Device time in microseconds, see XdkClockSync.</summary>
+		public uint Time { get; internal set; }
+		public int Sequence { get; internal set; }
+		public bool IsCalibration { get; internal set; }
+		/// <summary>The rotation could not be read, Rotation is the previous one.</summary>
+		public bool IsReadFailed { get; internal set; }
+		/// <summary>Acceleration and AngularRate hold values.</summary>
+		public bool HasRawSensors { get; internal set; }
+		public Quaternion Rotation { get; internal set; }
+		/// <summary>Accelerometer in g.</summary>
+		public Vector3D Acceleration { get; internal set; }
+		/// <summary>Gyroscope in deg/s.</summary>
+		public Vector3D AngularRate { get; internal set; }
+	}
+
+	/// <summary>
+	/// Recording of the firmware's flight recorder (FlightRecorder.c), a
+	/// "RECnnnnn.BIN" file of the XDK's SD card. The file is a header block
+	/// followed by blocks of samples, each of 512 bytes and with a CRC of its
+	/// samples. Blocks whose CRC does not match are left out and counted.
+	/// </summary>
+	public class XdkFlightRecording
+	{
+		public const int BlockSize = 512;
+		public const byte FormatVersion = 1;
+		/// <summary>Size of FlightRecorder_Sample_T, later versions may append fields.</summary>
+		public const int MinSampleSize = 25;
+
+		private const string Magic = "XHFR";
+		private const int FileHeaderSize = 20;
+		private const int BlockHeaderSize = 6;
+		private const byte CalibrationFlag = 0x01;
+		private const byte ReadFailedFlag = 0x02;
+		private const byte RawValidFlag = 0x04;
+		private const int ComponentShift = 4;
+
+		public XdkFlightRecorderReason Reason { get; private set; }
+		/// <summary>Device time of the first sample after the trigger.</summary>
+		public uint TriggerTime { get; private set; }
+		/// <summary>Samples lost while the previous recording was written.</summary>
+		public long MissedSamples { get; private set; }
+		/// <summary>Samples the device wrote, Samples may hold less.</summary>
+		public int DeclaredSampleCount { get; private set; }
+		public int CorruptBlockCount { get; private set; }
+		public IList<XdkFlightSample> Samples { get; private set; }
+
+		public static XdkFlightRecording Load(string path)
+		{
+			using (FileStream stream = File.OpenRead(path))
+				return Read(stream);
+		}
+
+		/// <summary>
+		/// Reads a recording, throws InvalidDataException if the stream holds
+		/// none.
+		/// </summary>
+		public static XdkFlightRecording Read(Stream stream)
+		{
+			byte[] block = new byte[BlockSize];
+			if (ReadBlock(stream, block) < FileHeaderSize || Encoding.ASCII.GetString(block, 0, Magic.Length) != Magic)
+				throw new InvalidDataException("No flight recording.");
+			if (block[4] != FormatVersion)
+				throw new InvalidDataException("Unsupported flight recording version " + block[4] + ".");
+
+			int sampleSize = BitConverter.ToUInt16(block, 6);
+			int samplesPerBlock = BitConverter.ToUInt16(block, 8);
+			if (sampleSize < MinSampleSize || BlockHeaderSize + samplesPerBlock * sampleSize > BlockSize)
+				throw new InvalidDataException("Invalid flight recording layout.");
+
+			XdkFlightRecording recording = new XdkFlightRecording
+			{
+				Reason = (XdkFlightRecorderReason)block[5],
+				DeclaredSampleCount = BitConverter.ToUInt16(block, 10),
+				TriggerTime = BitConverter.ToUInt32(block, 12),
+				MissedSamples = BitConverter.ToUInt32(block, 16),
+			};
+
+			List<XdkFlightSample> samples = new List<XdkFlightSample>(recording.DeclaredSampleCount);
+			int length;
+			while ((length = ReadBlock(stream, block)) > 0)
+			{
+				int count = block[2];
+				ushort crc = BitConverter.ToUInt16(block, 4);
+				if (length < BlockSize || count > samplesPerBlock
+					|| crc != Crc16(block, BlockHeaderSize, count * sampleSize))
+				{
+					recording.CorruptBlockCount++;
+					continue;
+				}
+
+				for (int i = 0; i < count; i++)
+					samples.Add(DecodeSample(block, BlockHeaderSize + i * sampleSize));
+			}
+			recording.Samples = samples;
+			return recording;
+		}
+
+		/// <summary>
+		/// CRC-16/CCITT-FALSE as used for the blocks.
+		/// </summary>
+		public static ushort Crc16(byte[] buffer, int offset, int count)
+		{
+			int crc = 0xFFFF;
+			for (int i = offset; i < offset + count; i++)
+			{
+				crc ^= buffer[i] << 8;
+				for (int bit = 0; bit < 8; bit++)
+					crc = (crc & 0x8000) != 0 ? (crc << 1) ^ 0x1021 : crc << 1;
+			}
+			return (ushort)crc;
+		}
+
+		private static XdkFlightSample DecodeSample(byte[] buffer, int offset)
+		{
+			byte flags = buffer[offset + 6];
+			return new XdkFlightSample
+			{
+				Time = BitConverter.ToUInt32(buffer, offset),
+				Sequence = BitConverter.ToUInt16(buffer, offset + 4),
+				IsCalibration = (flags & CalibrationFlag) != 0,
+				IsReadFailed = (flags & ReadFailedFlag) != 0,
+				HasRawSensors = (flags & RawValidFlag) != 0,
+				Rotation = XdkBleFrame.Unpack(buffer, offset + 7, (flags >> ComponentShift) & 0x03),
+				Acceleration = ReadVector(buffer, offset + 13, 0.001D),
+				AngularRate = ReadVector(buffer, offset + 19, 0.1D),
+			};
+		}
+
+		private static Vector3D ReadVector(byte[] buffer, int offset, double scale)
+		{
+			return new Vector3D(
+				BitConverter.ToInt16(buffer, offset) * scale,
+				BitConverter.ToInt16(buffer, offset + sizeof(short)) * scale,
+				BitConverter.ToInt16(buffer, offset + 2 * sizeof(short)) * scale);
+		}
+
+		private static int ReadBlock(Stream stream, byte[] block)
+		{
+			int length = 0, read;
+			while (length < block.Length && (read = stream.Read(block, length, block.Length - length)) > 0)
+				length += read;
+			return length;
+		}
+	}
+}
@@ -0,0 +1,692 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.IO.Ports;
+using System.Threading;
+using System.Threading.Tasks;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	public class XdkIO : BaseSynchronizedNotifyPropertyChanged
+	{
+		/// <summary>
+		/// Raised on the thread that received the sample, after XdkIO released
+		/// its locks, so handlers may call back into it.
+		/// </summary>
+		public event EventHandler<XdkIORotationEventArgs> RotationDataReceived;
+
+		/// <summary>
+		/// Latest calibrated rotation, set on the thread receiving the samples.
+		/// It raises no change notifications, which would queue one dispatcher
+		/// call per sample, other threads read LatestRotation or RotationSink.
+		/// </summary>
+		public Quaternion CalibratedRotation { get; private set; }
+
+		/// <summary>
+		/// Latest rotation before calibration, see CalibratedRotation.
+		/// </summary>
+		public Quaternion RawRotation { get; private set; }
+
+		/// <summary>
+		/// Calibrated samples for one reader that only wants the newest, e.g.
+		/// the UI once per frame.
+		/// </summary>
+		public TripleBuffer<RotationSample> LatestRotation { get; } = new TripleBuffer<RotationSample>();
+
+		private volatile RotationWorker _rotationSink;
+		/// <summary>
+		/// Worker receiving every calibrated sample, the first stage of the
+		/// host pipeline after this one. Null if there is none.
+		/// </summary>
+		public RotationWorker RotationSink
+		{
+			get { return _rotationSink; }
+			set { _rotationSink = value; }
+		}
+
+		private Quaternion _calibrationCorrection;
+		public Quaternion CalibrationCorrection
+		{
+			get { return _calibrationCorrection; }
+			private set { _calibrationCorrection = value; NotifyPropertyChanged(); }
+		}
+
+		/// <summary>
+		/// True while a serial session is open, also while it is suspended.
+		/// </summary>
+		public bool IsSerialConnected
+		{
+			get { return _port.IsOpen || _isSerialSuspended; }
+		}
+
+		private volatile bool _isSerialSuspended;
+		/// <summary>
+		/// True while the port of the serial session went away and
+		/// TryResumeSerial may bring the session back, see SuspendSerial.
+		/// </summary>
+		public bool IsSerialSuspended
+		{
+			get { return _isSerialSuspended; }
+		}
+
+		public XdkReconnectStats ReconnectStats { get; } = new XdkReconnectStats();
+
+		public XdkSerialDemux Demux { get; } = new XdkSerialDemux();
+
+		public XdkLinkMerger LinkMerger { get; } = new XdkLinkMerger();
+
+		public XdkLossConcealer LossConcealer { get; } = new XdkLossConcealer();
+
+		/// <summary>
+		/// Device clock estimate, kept up to date by a SYNC exchange every
+		/// ClockSyncInterval while the serial port is open.
+		/// </summary>
+		public XdkClockSync ClockSync { get; } = new XdkClockSync();
+
+		public TimeSpan ClockSyncInterval { get; set; } = TimeSpan.FromSeconds(1D);
+
+		private XdkSchedulerStats _schedulerStats = new XdkSchedulerStats();
+		/// <summary>
+		/// Latest stats of the firmware's sampling scheduler, updated every few
+		/// seconds over the stats channel.
+		/// </summary>
+		public XdkSchedulerStats SchedulerStats
+		{
+			get { return _schedulerStats; }
+			private set { _schedulerStats = value; NotifyPropertyChanged(); }
+		}
+
+		private XdkRuntimeStats _runtimeStats;
+		/// <summary>
+		/// Latest task, heap and queue stats of the firmware, sent periodically
+		/// or after RequestRuntimeStats. Null until the first sample arrived.
+		/// </summary>
+		public XdkRuntimeStats RuntimeStats
+		{
+			get { return _runtimeStats; }
+			private set { _runtimeStats = value; NotifyPropertyChanged(); }
+		}
+
+		/// <summary>
+		/// Stack high-water mark in words below which a task is reported as
+		/// about to overflow its stack.
+		/// </summary>
+		public int LowStackWarningWords { get; set; } = 32;
+
+		private readonly XdkRuntimeStats.Decoder _runtimeStatsDecoder = new XdkRuntimeStats.Decoder();
+
+		private bool _isLossConcealmentEnabled;
+		/// <summary>
+		/// Fills gaps in the sequence numbered rotation stream, see XdkLossConcealer.
+		/// </summary>
+		public bool IsLossConcealmentEnabled
+		{
+			get { return _isLossConcealmentEnabled; }
+			set
+			{
+				lock (_sampleSyncLock)
+				{
+					if (value == _isLossConcealmentEnabled)
+						return;
+					_isLossConcealmentEnabled = value;
+					LossConcealer.Reset();
+				}
+				// Outside the lock the timer handler takes. A timer left over by a
+				// racing setter finds the flag cleared and does nothing until the
+				// next one replaces it.
+				Interlocked.Exchange(ref _concealTimer, null)?.Dispose();
+				if (value)
+				{
+					int period = Math.Max(1, (int)(HostClock.ToMicroseconds(LossConcealer.SamplePeriod) / 2000D));
+					Interlocked.Exchange(ref _concealTimer, new Timer(HandleConcealTimerElapsed, null, period, period))?.Dispose();
+				}
+				NotifyPropertyChanged();
+			}
+		}
+
+		public string CurrentSerialPortName
+		{
+			get { lock (_portSyncLock) { return _port.PortName; } }
+		}
+
+		private SerialPort _port;
+		private readonly object _portSyncLock = new object();
+		private readonly object _sampleSyncLock = new object();
+		private Timer _concealTimer;
+		// RotationDataReceived events of the samples processed under
+		// _sampleSyncLock, raised once it is released.
+		private List<XdkIORotationEventArgs> _receivedEvents;
+		private Timer _clockSyncTimer;
+		// HostClock time the port of the suspended session went away.
+		private long _suspendedAt;
+		// Same for a resumed session until its first sample arrived, else 0.
+		private long _resumePendingSince;
+		// Device timestamp of the sample currently passed through LossConcealer.
+		private long _pendingDeviceTimestamp;
+		private double _pendingDeviceTimestampError = double.NaN;
+		// Calibrate with the inverse of CalibrationCorrection computed once.
+		private CalibrateStage _calibrateStage = new CalibrateStage(Quaternion.Identity);
+
+		public XdkIO()
+		{
+			_port = new SerialPort();
+			_port.BaudRate = 115200;
+			Demux.Register(XdkSerialChannel.Tracking, ProcessTrackingLine);
+			Demux.Register(XdkSerialChannel.Log, (message, timestamp) => Debug.WriteLine("XDK: " + message));
+			Demux.Register(XdkSerialChannel.Response, ProcessResponseLine);
+			Demux.Register(XdkSerialChannel.Stats, ProcessStatsLine);
+			LossConcealer.Output = (sequence, rotation, origin, timestamp) =>
+			{
+				if (origin == XdkSampleOrigin.Received)
+					ProcessRotation(rotation, false, sequence, timestamp, origin, _pendingDeviceTimestamp, _pendingDeviceTimestampError);
+				else
+					ProcessRotation(rotation, false, sequence, timestamp, origin, 0, double.NaN);
+			};
+		}
+
+		public void ConnectSerial(string portName)
+		{
+			lock (_portSyncLock)
+			{
+				if (_isSerialSuspended)
+				{
+					throw new InvalidOperationException("Serial session suspended, resume or disconnect it first");
+				}
+				else if (!_port.IsOpen)
+				{
+					_port.PortName = portName;
+					_port.Open();
+					ClockSync.Reset();
+					LinkMerger.Reset();
+					LossConcealer.Reset();
+					StartReader();
+					StartClockSync();
+				}
+				else
+				{
+					throw new InvalidOperationException("Serial already connected to port: " + _port.PortName);
+				}
+			}
+			NotifyPropertyChanged("IsSerialConnected");
+		}
+
+		public void DisconnectSerial()
+		{
+			lock (_portSyncLock)
+			{
+				StopClockSync();
+				EndSuspension();
+				if (_port.IsOpen)
+					_port.Close();
+			}
+			NotifyPropertyChanged("IsSerialConnected");
+		}
+
+		public async Task DisconnectSerialAsync()
+		{
+			await Task.Run(() =>
+			{
+				lock (_portSyncLock)
+				{
+					StopClockSync();
+					EndSuspension();
+					if (_port.IsOpen)
+						_port.Close();
+				}
+			});
+			NotifyPropertyChanged("IsSerialConnected");
+		}
+
+		/// <summary>
+		/// Closes the port of a serial session that went away, e.g. on a cable
+		/// glitch or a USB reset, but keeps the session for TryResumeSerial: the
+		/// calibration, the sequence state of LinkMerger and LossConcealer, the
+		/// device clock estimate and the reported transport.
+		/// </summary>
+		public void SuspendSerial()
+		{
+			lock (_portSyncLock)
+			{
+				if (!_port.IsOpen)
+					return;
+				StopClockSync();
+				try
+				{
+					_port.Close();
+				}
+				catch (IOException)
+				{
+					// The device is gone already.
+				}
+				catch (UnauthorizedAccessException)
+				{
+				}
+				_isSerialSuspended = true;
+				_suspendedAt = HostClock.Now;
+				Volatile.Write(ref _resumePendingSince, 0L);
+				ReconnectStats.AddSuspension();
+			}
+			NotifyPropertyChanged("IsSerialSuspended");
+		}
+
+		/// <summary>
+		/// Reopens a suspended serial session on the port the device came back
+		/// at. Returns false if the port can not be opened yet, e.g. while the
+		/// driver still sets it up, so callers retry for a while.
+		/// </summary>
+		public bool TryResumeSerial(string portName)
+		{
+			long reopenTime;
+			lock (_portSyncLock)
+			{
+				if (!_isSerialSuspended)
+					return false;
+				_port.PortName = portName;
+				try
+				{
+					_port.Open();
+				}
+				catch (IOException)
+				{
+					return false;
+				}
+				catch (UnauthorizedAccessException)
+				{
+					return false;
+				}
+				reopenTime = HostClock.Now - _suspendedAt;
+				_isSerialSuspended = false;
+				Volatile.Write(ref _resumePendingSince, _suspendedAt);
+				ReconnectStats.AddReopen(reopenTime);
+				StartReader();
+				StartClockSync();
+			}
+			Debug.WriteLine(string.Format(CultureInfo.InvariantCulture, "XDK serial session resumed on {0} after {1:0.0} ms",
+				portName, HostClock.ToMicroseconds(reopenTime) / 1000D));
+			NotifyPropertyChanged("IsSerialSuspended");
+			return true;
+		}
+
+		// Called with _portSyncLock held.
+		private void EndSuspension()
+		{
+			if (!_isSerialSuspended)
+				return;
+			_isSerialSuspended = false;
+			ReconnectStats.AddAbandoned();
+		}
+
+		// Called with _sampleSyncLock held, the events are raised by
+		// FireRotationDataReceived once it is released.
+		private void QueueRotationDataReceived(XdkIORotationEventArgs args)
+		{
+			if (RotationDataReceived == null)
+				return;
+			if (_receivedEvents == null)
+				_receivedEvents = new List<XdkIORotationEventArgs>();
+			_receivedEvents.Add(args);
+		}
+
+		// Called with _sampleSyncLock held.
+		private List<XdkIORotationEventArgs> TakeRotationDataReceived()
+		{
+			List<XdkIORotationEventArgs> events = _receivedEvents;
+			_receivedEvents = null;
+			return events;
+		}
+
+		// Called without _sampleSyncLock, so a slow or re-entrant handler can
+		// not stall the other threads feeding samples.
+		private void FireRotationDataReceived(List<XdkIORotationEventArgs> events)
+		{
+			if (events == null)
+				return;
+			foreach (XdkIORotationEventArgs args in events)
+				RotationDataReceived?.Invoke(this, args);
+		}
+
+		public void ProcessLine(string line, long timestamp)
+		{
+			Demux.Route(line, timestamp);
+		}
+
+		private void ProcessTrackingLine(string line, long timestamp)
+		{
+			Quaternion parsed;
+			int sequence;
+			long deviceTime;
+			XdkLineType type = XdkLineParser.TryParse(line, out parsed, out sequence, out deviceTime);
+			if (type == XdkLineType.Unknown)
+				return;
+
+			if (Volatile.Read(ref _resumePendingSince) != 0)
+			{
+				long since = Interlocked.Exchange(ref _resumePendingSince, 0L);
+				if (since != 0)
+					ReconnectStats.AddResume(timestamp - since);
+			}
+
+			long deviceTimestamp = 0;
+			double deviceTimestampError = double.NaN;
+			if (deviceTime >= 0)
+				ClockSync.TryToHostTime((uint)deviceTime, out deviceTimestamp, out deviceTimestampError);
+			ProcessSample(XdkLink.Serial, parsed, type == XdkLineType.Calibration, sequence, false, Quaternion.Identity, timestamp,
+				deviceTimestamp, deviceTimestampError);
+		}
+
+		private void ProcessResponseLine(string payload, long timestamp)
+		{
+			if (payload.StartsWith("SYNC ", StringComparison.Ordinal))
+				ClockSync.TryAddResponse(payload, timestamp);
+			else
+				Debug.WriteLine("XDK response: " + payload);
+		}
+
+		private void ProcessStatsLine(string payload, long timestamp)
+		{
+			XdkRuntimeStats runtimeStats;
+			if (_runtimeStatsDecoder.Add(payload, out runtimeStats))
+			{
+				if (runtimeStats != null)
+					ProcessRuntimeStats(runtimeStats);
+				return;
+			}
+
+			// "LINK" level changes and "LINKERR" error summaries of the device's
+			// link health, the device already adapted to them.
+			if (payload.StartsWith("LINK", StringComparison.Ordinal))
+			{
+				Debug.WriteLine("XDK link health: " + payload);
+				return;
+			}
+
+			// Connection parameters negotiated with the central after a request.
+			if (payload.StartsWith("BLECP", StringComparison.Ordinal))
+			{
+				Debug.WriteLine("XDK BLE connection: " + payload);
+				return;
+			}
+
+			XdkSchedulerStats previous = SchedulerStats;
+			XdkSchedulerStats updated = previous.Update(payload);
+			if (updated == null)
+				return;
+			if (updated.Overruns > previous.Overruns || updated.Failures > previous.Failures)
+			{
+				Debug.WriteLine(string.Format(CultureInfo.InvariantCulture, "XDK sampling degraded: {0} overruns, {1} skipped, {2} failed periods",
+					updated.Overruns - previous.Overruns, updated.Skipped - previous.Skipped, updated.Failures - previous.Failures));
+			}
+			SchedulerStats = updated;
+		}
+
+		private void ProcessRuntimeStats(XdkRuntimeStats stats)
+		{
+			foreach (XdkTaskStats task in stats.Tasks)
+			{
+				if (task.StackHighWaterMarkWords < LowStackWarningWords)
+				{
+					Debug.WriteLine(string.Format(CultureInfo.InvariantCulture, "XDK task {0} low on stack: {1} words never used",
+						task.Name, task.StackHighWaterMarkWords));
+				}
+			}
+			RuntimeStats = stats;
+		}
+
+		/// <summary>
+		/// Asks the firmware for a runtime stats sample right away, it arrives
+		/// as RuntimeStats.
+		/// </summary>
+		public void RequestRuntimeStats()
+		{
+			lock (_portSyncLock)
+			{
+				if (!_port.IsOpen)
+					throw new InvalidOperationException("Serial not connected");
+				_port.Write(">>CMD: STATS\n");
+			}
+		}
+
+		private void WriteCommand(string command)
+		{
+			lock (_portSyncLock)
+			{
+				if (_port.IsOpen)
+					_port.Write(">>CMD: " + command + "\n");
+			}
+		}
+
+		private void SendClockSyncRequest()
+		{
+			lock (_portSyncLock)
+			{
+				if (!_port.IsOpen)
+					return;
+				// ">>CMD:" lines are handled by UsbUi.c of the firmware. The
+				// time spent formatting and writing counts towards the round trip.
+				string line = ">>CMD: " + XdkClockSync.CreateRequest(HostClock.Now) + "\n";
+				_port.Write(line);
+			}
+		}
+
+		// Called with _portSyncLock held, after the port was opened. Each open
+		// port gets its own reader and line assembler, a line cut by closing
+		// the port never continues on the next one.
+		private void StartReader()
+		{
+			Stream stream = _port.BaseStream;
+			XdkLineAssembler assembler = new XdkLineAssembler();
+			Task.Run(() => ReadPortAsync(stream, assembler));
+		}
+
+		private async Task ReadPortAsync(Stream stream, XdkLineAssembler assembler)
+		{
+			byte[] buffer = new byte[XdkAggregator.ReadBufferSize];
+			Action<string, long> processLine = ProcessLine;
+			try
+			{
+				int read;
+				while ((read = await stream.ReadAsync(buffer, 0, buffer.Length).ConfigureAwait(false)) > 0)
+					assembler.Feed(buffer, 0, read, HostClock.Now, processLine);
+			}
+			// Closing the port ends the read.
+			catch (OperationCanceledException) { }
+			catch (ObjectDisposedException) { }
+			catch (IOException) { }
+		}
+
+		// Called with _portSyncLock held, after the port was opened.
+		private void StartClockSync()
+		{
+			_clockSyncTimer = new Timer(HandleClockSyncTimerElapsed, null, TimeSpan.Zero, ClockSyncInterval);
+		}
+
+		private void StopClockSync()
+		{
+			_clockSyncTimer?.Dispose();
+			_clockSyncTimer = null;
+		}
+
+		/// <summary>
+		/// Feeds one BLE notification payload, for hosts receiving the BLE link.
+		/// </summary>
+		public bool ProcessBleFrame(byte[] buffer, int offset, int count, long timestamp)
+		{
+			Quaternion rotation;
+			bool isCalibration;
+			int sequence;
+			if (count == XdkBleFrame.CompactSize)
+			{
+				bool hasPrevious;
+				Quaternion previous;
+				if (!XdkBleFrame.TryDecodeCompact(buffer, offset, count, out rotation, out isCalibration, out sequence, out hasPrevious, out previous))
+					return false;
+				ProcessSample(XdkLink.Ble, rotation, isCalibration, sequence, hasPrevious, previous, timestamp);
+				return true;
+			}
+
+			if (!XdkBleFrame.TryDecode(buffer, offset, count, out rotation, out isCalibration, out sequence))
+				return false;
+			ProcessSample(XdkLink.Ble, rotation, isCalibration, sequence, timestamp);
+			return true;
+		}
+
+		/// <summary>
+		/// Processes a sample received over the given link. Rotations that already
+		/// arrived over another link are dropped, calibrations are idempotent and
+		/// always applied.
+		/// </summary>
+		public void ProcessSample(XdkLink link, Quaternion rotation, bool isCalibration, int sequence, long timestamp)
+		{
+			ProcessSample(link, rotation, isCalibration, sequence, false, Quaternion.Identity, timestamp);
+		}
+
+		/// <summary>
+		/// Same as above for frames that also carry a copy of the previous sample.
+		/// </summary>
+		public void ProcessSample(XdkLink link, Quaternion rotation, bool isCalibration, int sequence, bool hasPrevious, Quaternion previous, long timestamp)
+		{
+			ProcessSample(link, rotation, isCalibration, sequence, hasPrevious, previous, timestamp, 0, double.NaN);
+		}
+
+		private void ProcessSample(XdkLink link, Quaternion rotation, bool isCalibration, int sequence, bool hasPrevious, Quaternion previous, long timestamp,
+			long deviceTimestamp, double deviceTimestampError)
+		{
+			List<XdkIORotationEventArgs> events;
+			lock (_sampleSyncLock)
+			{
+				ProcessSampleLocked(link, rotation, isCalibration, sequence, hasPrevious, previous, timestamp, deviceTimestamp, deviceTimestampError);
+				events = TakeRotationDataReceived();
+			}
+			FireRotationDataReceived(events);
+		}
+
+		// Called with _sampleSyncLock held.
+		private void ProcessSampleLocked(XdkLink link, Quaternion rotation, bool isCalibration, int sequence, bool hasPrevious, Quaternion previous, long timestamp,
+			long deviceTimestamp, double deviceTimestampError)
+		{
+			if (!isCalibration && sequence >= 0)
+			{
+				long restarts = LinkMerger.RestartCount;
+				if (!LinkMerger.Accept(link, sequence, timestamp))
+					return;
+				if (LinkMerger.RestartCount != restarts)
+					LossConcealer.Restart();
+			}
+			if (!isCalibration && sequence >= 0 && _isLossConcealmentEnabled)
+			{
+				_pendingDeviceTimestamp = deviceTimestamp;
+				_pendingDeviceTimestampError = deviceTimestampError;
+				LossConcealer.Receive(sequence, rotation, hasPrevious, previous, timestamp);
+			}
+			else
+			{
+				ProcessRotation(rotation, isCalibration, sequence, timestamp, XdkSampleOrigin.Received, deviceTimestamp, deviceTimestampError);
+			}
+		}
+
+		public void ProcessRotation(Quaternion rotation, bool isCalibration, long timestamp)
+		{
+			List<XdkIORotationEventArgs> events;
+			lock (_sampleSyncLock)
+			{
+				ProcessRotation(rotation, isCalibration, -1, timestamp, XdkSampleOrigin.Received, 0, double.NaN);
+				events = TakeRotationDataReceived();
+			}
+			FireRotationDataReceived(events);
+		}
+
+		// Always called with _sampleSyncLock held, which makes the threads
+		// feeding samples one producer for LatestRotation and RotationSink.
+		private void ProcessRotation(Quaternion rotation, bool isCalibration, int sequence, long timestamp, XdkSampleOrigin origin,
+			long deviceTimestamp, double deviceTimestampError)
+		{
+			if (isCalibration)
+			{
+				CalibrationCorrection = rotation;
+				_calibrateStage.SetCorrection(rotation);
+			}
+			else
+			{
+				RawRotation = rotation;
+				RotationSample sample = new RotationSample(rotation, timestamp);
+				_calibrateStage.Process(ref sample);
+				CalibratedRotation = sample.Rotation;
+				LatestRotation.Write(sample);
+				_rotationSink?.Post(sample);
+				QueueRotationDataReceived(new XdkIORotationEventArgs(rotation, timestamp, origin, deviceTimestamp, deviceTimestampError, sequence));
+			}
+		}
+
+		public static Quaternion Calibrate(Quaternion rotation, Quaternion calibrationCorrection)
+		{
+			Quaternion tmp = calibrationCorrection;
+			tmp.Invert();
+			return rotation * tmp * new Quaternion(new Vector3D(0, 0, 1), 180);
+		}
+
+		#region Event Handlers
+		private void HandleClockSyncTimerElapsed(object state)
+		{
+			SendClockSyncRequest();
+		}
+
+		private void HandleConcealTimerElapsed(object state)
+		{
+			List<XdkIORotationEventArgs> events;
+			lock (_sampleSyncLock)
+			{
+				if (_isLossConcealmentEnabled)
+					LossConcealer.Tick(HostClock.Now);
+				events = TakeRotationDataReceived();
+			}
+			FireRotationDataReceived(events);
+		}
+		#endregion
+	}
+
+	public class XdkIORotationEventArgs
+	{
+		public Quaternion Rotation { get; private set; }
+		public long Timestamp { get; private set; }
+		public XdkSampleOrigin Origin { get; private set; }
+		/// <summary>
+		/// HostClock time the device took the sample at, 0 if not known, see
+		/// XdkClockSync.
+		/// </summary>
+		public long DeviceTimestamp { get; private set; }
+		public double DeviceTimestampErrorMicroseconds { get; private set; }
+		/// <summary>
+		/// Sequence number the firmware gave the sample, -1 if the link sent none.
+		/// </summary>
+		public int Sequence { get; private set; }
+
+		public XdkIORotationEventArgs(Quaternion rotation, long timestamp)
+			: this(rotation, timestamp, XdkSampleOrigin.Received)
+		{
+		}
+
+		public XdkIORotationEventArgs(Quaternion rotation, long timestamp, XdkSampleOrigin origin)
+			: this(rotation, timestamp, origin, 0, double.NaN)
+		{
+		}
+
+		public XdkIORotationEventArgs(Quaternion rotation, long timestamp, XdkSampleOrigin origin, long deviceTimestamp, double deviceTimestampErrorMicroseconds)
+			: this(rotation, timestamp, origin, deviceTimestamp, deviceTimestampErrorMicroseconds, -1)
+		{
+		}
+
+		public XdkIORotationEventArgs(Quaternion rotation, long timestamp, XdkSampleOrigin origin, long deviceTimestamp, double deviceTimestampErrorMicroseconds, int sequence)
+		{
+			Rotation = rotation;
+			Timestamp = timestamp;
+			Origin = origin;
+			DeviceTimestamp = deviceTimestamp;
+			DeviceTimestampErrorMicroseconds = deviceTimestampErrorMicroseconds;
+			Sequence = sequence;
+		}
+	}
+}
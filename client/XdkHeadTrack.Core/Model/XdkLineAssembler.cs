@@ -0,0 +1,59 @@
+﻿using System;
+using System.Text;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Cuts the bytes read from a serial link into lines. Keeps the partial
+	/// line between reads, so one instance belongs to one open link and its
+	/// reader. Lines longer than MaxLineLength are dropped whole.
+	/// </summary>
+	public class XdkLineAssembler
+	{
+		public const int MaxLineLength = 256;
+
+		private readonly byte[] _line = new byte[MaxLineLength];
+		private int _lineLength;
+		private bool _isLineOverflowing;
+
+		/// <summary>
+		/// Feeds raw bytes, passing every completed line without its line end
+		/// to output. All lines of one read share the given timestamp. Returns
+		/// the number of lines dropped for their length.
+		/// </summary>
+		public int Feed(byte[] buffer, int offset, int count, long timestamp, Action<string, long> output)
+		{
+			int discarded = 0;
+			int end = offset + count;
+			for (int i = offset; i < end; i++)
+			{
+				byte b = buffer[i];
+				if (b == (byte)'\n')
+				{
+					if (_isLineOverflowing)
+					{
+						discarded++;
+					}
+					else
+					{
+						int length = _lineLength;
+						if (length > 0 && _line[length - 1] == (byte)'\r')
+							length--;
+						output(Encoding.ASCII.GetString(_line, 0, length), timestamp);
+					}
+					_lineLength = 0;
+					_isLineOverflowing = false;
+				}
+				else if (_lineLength < _line.Length)
+				{
+					_line[_lineLength++] = b;
+				}
+				else
+				{
+					_isLineOverflowing = true;
+				}
+			}
+			return discarded;
+		}
+	}
+}
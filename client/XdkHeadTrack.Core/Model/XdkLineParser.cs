@@ -0,0 +1,104 @@
+﻿using System;
+using System.Globalization;
+using System.Text.RegularExpressions;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Model
+{
+	public enum XdkLineType
+	{
+		Unknown,
+		Rotation,
+		Calibration,
+	}
+
+	public static class XdkLineParser
+	{
+		// Tag, w, x, y, z and the optional sequence number and device time.
+		private const string FieldsPattern = @".*?([0-9\.\-\+]{1,}).*?([0-9\.\-\+]{1,}).*?([0-9\.\-\+]{1,}).*?([0-9\.\-\+]{1,})(?:\s+([0-9]+)(?:\s+([0-9]+))?)?";
+		private static readonly Regex QuatRegex = new Regex(Regex.Escape(XdkWire.RotationLineTag) + FieldsPattern, RegexOptions.Compiled);
+		private static readonly Regex CaliRegex = new Regex(Regex.Escape(XdkWire.CalibrationLineTag) + FieldsPattern, RegexOptions.Compiled);
+		private static readonly IFormatProvider Format = CultureInfo.GetCultureInfo("en-US").NumberFormat;
+
+		public static XdkLineType TryParse(string line, out Quaternion rotation)
+		{
+			int sequence;
+			return TryParse(line, out rotation, out sequence);
+		}
+
+		/// <summary>
+		/// Also returns the sample sequence number of the line, or -1 for
+		/// firmware that does not send one yet.
+		/// </summary>
+		public static XdkLineType TryParse(string line, out Quaternion rotation, out int sequence)
+		{
+			long deviceTime;
+			return TryParse(line, out rotation, out sequence, out deviceTime);
+		}
+
+		/// <summary>
+		/// Also returns the device time (microseconds, see XdkClockSync) the
+		/// sample was taken at, or -1 for firmware that does not send it yet.
+		/// </summary>
+		public static XdkLineType TryParse(string line, out Quaternion rotation, out int sequence, out long deviceTime)
+		{
+			rotation = Quaternion.Identity;
+			sequence = -1;
+			deviceTime = -1;
+			if (line == null)
+				return XdkLineType.Unknown;
+
+			// Lines corrupted on the wire may still match, with garbage numbers.
+			Match match = QuatRegex.Match(line);
+			if (match.Success && TryToQuaternion(match, out rotation))
+			{
+				sequence = ToSequence(match);
+				deviceTime = ToDeviceTime(match);
+				return XdkLineType.Rotation;
+			}
+
+			match = CaliRegex.Match(line);
+			if (match.Success && TryToQuaternion(match, out rotation))
+			{
+				sequence = ToSequence(match);
+				deviceTime = ToDeviceTime(match);
+				return XdkLineType.Calibration;
+			}
+
+			return XdkLineType.Unknown;
+		}
+
+		private static bool TryToQuaternion(Match match, out Quaternion rotation)
+		{
+			double w, x, y, z;
+			if (double.TryParse(match.Groups[1].Value, NumberStyles.Float, Format, out w)
+				&& double.TryParse(match.Groups[2].Value, NumberStyles.Float, Format, out x)
+				&& double.TryParse(match.Groups[3].Value, NumberStyles.Float, Format, out y)
+				&& double.TryParse(match.Groups[4].Value, NumberStyles.Float, Format, out z))
+			{
+				rotation = new Quaternion(x, y, z, w);
+				return true;
+			}
+			rotation = Quaternion.Identity;
+			return false;
+		}
+
+		private static int ToSequence(Match match)
+		{
+			int sequence;
+			Group group = match.Groups[5];
+			if (group.Success && int.TryParse(group.Value, NumberStyles.None, CultureInfo.InvariantCulture, out sequence))
+				return sequence;
+			return -1;
+		}
+
+		private static long ToDeviceTime(Match match)
+		{
+			uint deviceTime;
+			Group group = match.Groups[6];
+			if (group.Success && uint.TryParse(group.Value, NumberStyles.None, CultureInfo.InvariantCulture, out deviceTime))
+				return deviceTime;
+			return -1;
+		}
+	}
+}
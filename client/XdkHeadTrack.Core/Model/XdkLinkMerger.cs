@@ -0,0 +1,154 @@
+﻿using System;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	public enum XdkLink
+	{
+		Serial,
+		Ble,
+	}
+
+	/// <summary>
+	/// Snapshot of the arrivals of one link of an XdkLinkMerger.
+	/// </summary>
+	public class XdkLinkStatistics
+	{
+		public XdkLink Link { get; private set; }
+		/// <summary>Samples this link delivered before any other link.</summary>
+		public long FirstArrivals { get; private set; }
+		/// <summary>Samples this link delivered after another link already had.</summary>
+		public long LateArrivals { get; private set; }
+		public double MeanLagMicroseconds { get; private set; }
+		public double MaxLagMicroseconds { get; private set; }
+		/// <summary>HostClock timestamp of the latest arrival, 0 if none yet.</summary>
+		public long LastArrival { get; private set; }
+
+		public long Arrivals => FirstArrivals + LateArrivals;
+		public double WinRate => Arrivals > 0 ? FirstArrivals / (double)Arrivals : double.NaN;
+
+		public XdkLinkStatistics(XdkLink link, long firstArrivals, long lateArrivals, double meanLagMicroseconds, double maxLagMicroseconds, long lastArrival)
+		{
+			Link = link;
+			FirstArrivals = firstArrivals;
+			LateArrivals = lateArrivals;
+			MeanLagMicroseconds = meanLagMicroseconds;
+			MaxLagMicroseconds = maxLagMicroseconds;
+			LastArrival = lastArrival;
+		}
+	}
+
+	/// <summary>
+	/// Merges the copies of the samples the firmware sends over several links
+	/// in redundant mode. The first copy of a sequence number wins, later copies
+	/// are dropped and only counted towards the lag statistics of their link,
+	/// so losing one link never leaves a gap as long as the other one delivers.
+	/// </summary>
+	public class XdkLinkMerger
+	{
+		/// <summary>
+		/// Number of recent sequence numbers remembered. A sample further behind
+		/// the newest one is taken as a device restart.
+		/// </summary>
+		public const int WindowSize = 1024;
+
+		/// <summary>
+		/// A copy arriving this long after the first copy of its sequence number
+		/// is taken as a device restart too, which catches restarts of runs
+		/// shorter than WindowSize samples. Copies over the other link lag by
+		/// milliseconds, in HostClock ticks.
+		/// </summary>
+		public long RestartAfter { get; set; } = HostClock.FromSeconds(1D);
+
+		/// <summary>Number of device restarts detected since the last Reset.</summary>
+		public long RestartCount { get { lock (_lock) return _restartCount; } }
+
+		private readonly long[] _windowSequences = new long[WindowSize];
+		private readonly long[] _windowArrivals = new long[WindowSize];
+		private readonly long[] _firstArrivals = new long[2];
+		private readonly long[] _lateArrivals = new long[2];
+		private readonly long[] _lagSums = new long[2];
+		private readonly long[] _lagMaxima = new long[2];
+		private readonly long[] _lastArrivals = new long[2];
+		private readonly object _lock = new object();
+		private long _newest;
+		private long _restartCount;
+
+		public XdkLinkMerger()
+		{
+			Reset();
+		}
+
+		public void Reset()
+		{
+			lock (_lock)
+			{
+				ResetWindow();
+				Array.Clear(_firstArrivals, 0, _firstArrivals.Length);
+				Array.Clear(_lateArrivals, 0, _lateArrivals.Length);
+				Array.Clear(_lagSums, 0, _lagSums.Length);
+				Array.Clear(_lagMaxima, 0, _lagMaxima.Length);
+				Array.Clear(_lastArrivals, 0, _lastArrivals.Length);
+				_restartCount = 0;
+			}
+		}
+
+		/// <summary>
+		/// Registers the arrival of a 16 bit sample sequence number on a link.
+		/// Returns true for the first copy of the sample, which should be used.
+		/// </summary>
+		public bool Accept(XdkLink link, int sequence, long timestamp)
+		{
+			int l = (int)link;
+			lock (_lock)
+			{
+				_lastArrivals[l] = timestamp;
+
+				long extended = _newest < 0 ? sequence : _newest + (short)(ushort)(sequence - _newest);
+				int slot = (int)(((extended % WindowSize) + WindowSize) % WindowSize);
+				if (_newest >= 0 && (extended <= _newest - WindowSize
+					|| (_windowSequences[slot] == extended && timestamp - _windowArrivals[slot] > RestartAfter)))
+				{
+					ResetWindow();
+					_restartCount++;
+					extended = sequence;
+					slot = sequence % WindowSize;
+				}
+
+				if (_windowSequences[slot] == extended)
+				{
+					long lag = timestamp - _windowArrivals[slot];
+					_lateArrivals[l]++;
+					_lagSums[l] += lag;
+					_lagMaxima[l] = Math.Max(_lagMaxima[l], lag);
+					return false;
+				}
+
+				_windowSequences[slot] = extended;
+				_windowArrivals[slot] = timestamp;
+				_firstArrivals[l]++;
+				_newest = Math.Max(_newest, extended);
+				return true;
+			}
+		}
+
+		public XdkLinkStatistics GetStatistics(XdkLink link)
+		{
+			int l = (int)link;
+			lock (_lock)
+			{
+				return new XdkLinkStatistics(link, _firstArrivals[l], _lateArrivals[l],
+					_lateArrivals[l] > 0 ? HostClock.ToMicroseconds(_lagSums[l]) / _lateArrivals[l] : 0D,
+					HostClock.ToMicroseconds(_lagMaxima[l]),
+					_lastArrivals[l]);
+			}
+		}
+
+		private void ResetWindow()
+		{
+			for (int i = 0; i < WindowSize; i++)
+				_windowSequences[i] = long.MinValue;
+			_newest = -1;
+		}
+	}
+}
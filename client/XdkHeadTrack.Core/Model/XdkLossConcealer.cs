@@ -0,0 +1,229 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	public enum XdkSampleOrigin
+	{
+		/// <summary>Sample as sent by the device.</summary>
+		Received,
+		/// <summary>Lost sample restored from the copy in the next frame.</summary>
+		Recovered,
+		/// <summary>Lost sample guessed from the recent angular velocity.</summary>
+		Concealed,
+	}
+
+	/// <summary>
+	/// Fills the gaps of a sequence numbered rotation stream. A missing sample
+	/// is restored from the redundant copy of the compact BLE frames where
+	/// possible, otherwise it is extrapolated with the angular velocity of the
+	/// last two samples that were actually known. Tick conceals samples that
+	/// are overdue, so a lost notification does not stall the output until the
+	/// next one arrives.
+	/// </summary>
+	public class XdkLossConcealer
+	{
+		/// <summary>
+		/// Gaps longer than this (and samples further behind) are taken as a
+		/// device restart and not filled. So is a sample not newer than the known
+		/// one that arrives this many periods after it, which catches restarts
+		/// of runs shorter than MaxGap samples.
+		/// </summary>
+		public const int MaxGap = 64;
+
+		/// <summary>
+		/// Receives every sample in sequence order: 16 bit sequence number,
+		/// rotation, origin and timestamp. A received sample may follow the
+		/// concealed one of the same sequence number.
+		/// </summary>
+		public Action<int, Quaternion, XdkSampleOrigin, long> Output { get; set; }
+
+		/// <summary>Extrapolation stops after this many samples and holds.</summary>
+		public int MaxConcealedSamples { get; set; } = 10;
+
+		/// <summary>Nominal sample period of the device, in HostClock ticks.</summary>
+		public long SamplePeriod { get; set; } = HostClock.FromSeconds(0.02D);
+
+		/// <summary>
+		/// Tick conceals a sample once it is this many periods late. While the
+		/// frames carry the previous sample it waits one period longer, for the
+		/// next frame that could restore it.
+		/// </summary>
+		public double ConcealAfterPeriods { get; set; } = 1.5D;
+
+		public long ReceivedCount { get { lock (_lock) return _receivedCount; } }
+		public long RecoveredCount { get { lock (_lock) return _recoveredCount; } }
+		public long ConcealedCount { get { lock (_lock) return _concealedCount; } }
+		public long DuplicateCount { get { lock (_lock) return _duplicateCount; } }
+
+		private readonly object _lock = new object();
+		private long _receivedCount;
+		private long _recoveredCount;
+		private long _concealedCount;
+		private long _duplicateCount;
+
+		// Last two samples known to be true, i.e. received or recovered.
+		private long _knownSequence;
+		private Quaternion _knownRotation;
+		private long _olderKnownSequence;
+		private Quaternion _olderKnownRotation;
+		private long _knownArrival;
+		private bool _hasRedundancy;
+		// Newest sample put out, possibly concealed.
+		private long _emittedSequence;
+
+		public XdkLossConcealer()
+		{
+			Reset();
+		}
+
+		public void Reset()
+		{
+			lock (_lock)
+			{
+				ResetStream();
+				_receivedCount = 0;
+				_recoveredCount = 0;
+				_concealedCount = 0;
+				_duplicateCount = 0;
+			}
+		}
+
+		/// <summary>
+		/// Feeds a sample with its 16 bit sequence number. previous is the copy
+		/// of sample sequence - 1 the frame carried, if hasPrevious.
+		/// </summary>
+		public void Receive(int sequence, Quaternion rotation, bool hasPrevious, Quaternion previous, long timestamp)
+		{
+			lock (_lock)
+			{
+				long extended = _knownSequence < 0 ? sequence : _knownSequence + (short)(ushort)(sequence - _knownSequence);
+				if (_knownSequence >= 0 && (extended > _emittedSequence + MaxGap || extended < _knownSequence - MaxGap
+					|| (extended <= _knownSequence && timestamp - _knownArrival > MaxGap * SamplePeriod)))
+				{
+					ResetStream();
+					extended = sequence;
+				}
+				else if (_knownSequence >= 0 && extended <= _knownSequence)
+				{
+					_duplicateCount++;
+					return;
+				}
+
+				// A new stream starts with this sample, nothing before it is missing.
+				if (_knownSequence < 0)
+					_emittedSequence = extended - 1;
+
+				for (long missing = _emittedSequence + 1; missing < extended; missing++)
+				{
+					if (hasPrevious && missing == extended - 1)
+					{
+						Learn(missing, previous, timestamp);
+						Emit(missing, previous, XdkSampleOrigin.Recovered, timestamp);
+						_recoveredCount++;
+					}
+					else
+					{
+						Emit(missing, Extrapolate(missing), XdkSampleOrigin.Concealed, timestamp);
+						_concealedCount++;
+					}
+				}
+
+				// Already concealed by Tick, the copy still sharpens the velocity.
+				if (hasPrevious && extended - 1 > _knownSequence && extended - 1 <= _emittedSequence)
+					Learn(extended - 1, previous, timestamp);
+
+				Learn(extended, rotation, timestamp);
+				_hasRedundancy = hasPrevious;
+				_emittedSequence = Math.Max(_emittedSequence, extended);
+				Emit(extended, rotation, XdkSampleOrigin.Received, timestamp);
+				_receivedCount++;
+			}
+		}
+
+		/// <summary>
+		/// Forgets the stream but keeps the counters, e.g. after a device restart
+		/// was detected elsewhere. The next sample starts a new stream.
+		/// </summary>
+		public void Restart()
+		{
+			lock (_lock)
+			{
+				ResetStream();
+			}
+		}
+
+		/// <summary>
+		/// Conceals the samples that are overdue at now. Call this about once
+		/// per sample period.
+		/// </summary>
+		public void Tick(long now)
+		{
+			lock (_lock)
+			{
+				if (_knownSequence < 0)
+					return;
+
+				double wait = ConcealAfterPeriods + (_hasRedundancy ? 1D : 0D);
+				while (_emittedSequence - _knownSequence < MaxConcealedSamples)
+				{
+					long next = _emittedSequence + 1;
+					long due = _knownArrival + (long)((next - _knownSequence - 1 + wait) * SamplePeriod);
+					if (now < due)
+						break;
+					_emittedSequence = next;
+					Emit(next, Extrapolate(next), XdkSampleOrigin.Concealed, now);
+					_concealedCount++;
+				}
+			}
+		}
+
+		private void Learn(long sequence, Quaternion rotation, long timestamp)
+		{
+			if (sequence <= _knownSequence)
+				return;
+			_olderKnownSequence = _knownSequence;
+			_olderKnownRotation = _knownRotation;
+			_knownSequence = sequence;
+			_knownRotation = rotation;
+			_knownArrival = timestamp;
+			_emittedSequence = Math.Max(_emittedSequence, sequence);
+		}
+
+		private Quaternion Extrapolate(long sequence)
+		{
+			if (_olderKnownSequence < 0)
+				return _knownRotation;
+
+			// Rotation per sample in the frame of the device.
+			Quaternion inverse = _olderKnownRotation;
+			inverse.Invert();
+			Quaternion step = Quaternion.Slerp(Quaternion.Identity, inverse * _knownRotation,
+				1D / (_knownSequence - _olderKnownSequence));
+
+			Quaternion extrapolated = _knownRotation;
+			long steps = Math.Min(sequence - _knownSequence, MaxConcealedSamples);
+			for (long i = 0; i < steps; i++)
+				extrapolated = extrapolated * step;
+			extrapolated.Normalize();
+			return extrapolated;
+		}
+
+		private void Emit(long sequence, Quaternion rotation, XdkSampleOrigin origin, long timestamp)
+		{
+			Output?.Invoke((ushort)sequence, rotation, origin, timestamp);
+		}
+
+		private void ResetStream()
+		{
+			_knownSequence = -1;
+			_olderKnownSequence = -1;
+			_knownRotation = Quaternion.Identity;
+			_olderKnownRotation = Quaternion.Identity;
+			_knownArrival = 0;
+			_hasRedundancy = false;
+			_emittedSequence = -1;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+﻿using System;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// How fast serial sessions of an XdkIO came back after their port went
+	/// away, e.g. on a cable glitch or a USB reset, see XdkIO.SuspendSerial.
+	/// Thread safe.
+	/// </summary>
+	public class XdkReconnectStats
+	{
+		public long Suspensions { get { lock (_lock) return _suspensions; } }
+		/// <summary>Suspended sessions that got their port back.</summary>
+		public long Reopens { get { lock (_lock) return _reopens; } }
+		/// <summary>Reopened sessions that received a sample again.</summary>
+		public long Resumes { get { lock (_lock) return _resumes; } }
+		/// <summary>Suspended sessions that were disconnected instead.</summary>
+		public long Abandoned { get { lock (_lock) return _abandoned; } }
+
+		/// <summary>
+		/// Time from the port going away until it was open again, of the
+		/// latest reopen. NaN if there was none.
+		/// </summary>
+		public double LastReopenMilliseconds { get { lock (_lock) return _lastReopen; } }
+		/// <summary>
+		/// Time from the port going away until the first sample arrived again,
+		/// of the latest resume. NaN if there was none.
+		/// </summary>
+		public double LastResumeMilliseconds { get { lock (_lock) return _lastResume; } }
+		public double MeanResumeMilliseconds { get { lock (_lock) return _resumes > 0 ? _resumeSum / _resumes : double.NaN; } }
+		public double MaxResumeMilliseconds { get { lock (_lock) return _resumes > 0 ? _maxResume : double.NaN; } }
+
+		private readonly object _lock = new object();
+		private long _suspensions;
+		private long _reopens;
+		private long _resumes;
+		private long _abandoned;
+		private double _lastReopen = double.NaN;
+		private double _lastResume = double.NaN;
+		private double _resumeSum;
+		private double _maxResume;
+
+		internal void AddSuspension()
+		{
+			lock (_lock)
+				_suspensions++;
+		}
+
+		internal void AddReopen(long duration)
+		{
+			lock (_lock)
+			{
+				_reopens++;
+				_lastReopen = HostClock.ToMicroseconds(duration) / 1000D;
+			}
+		}
+
+		internal void AddResume(long duration)
+		{
+			lock (_lock)
+			{
+				double milliseconds = HostClock.ToMicroseconds(duration) / 1000D;
+				_resumes++;
+				_lastResume = milliseconds;
+				_resumeSum += milliseconds;
+				_maxResume = Math.Max(_maxResume, milliseconds);
+			}
+		}
+
+		internal void AddAbandoned()
+		{
+			lock (_lock)
+				_abandoned++;
+		}
+	}
+}
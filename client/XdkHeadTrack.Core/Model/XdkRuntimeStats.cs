@@ -0,0 +1,191 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Text;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Stats of one firmware task, see RuntimeStats_TaskEntry_T.
+	/// </summary>
+	public class XdkTaskStats
+	{
+		public int Number { get; set; }
+		/// <summary>Task name, cut to RUNTIME_STATS_TASK_NAME_LENGTH characters.</summary>
+		public string Name { get; set; }
+		/// <summary>FreeRTOS eTaskState: 0 running, 1 ready, 2 blocked, 3 suspended, 4 deleted.</summary>
+		public int State { get; set; }
+		public int Priority { get; set; }
+		/// <summary>Share of the CPU time since the previous sample, 0 to 1, NaN if unknown.</summary>
+		public double CpuShare { get; set; }
+		/// <summary>Stack the task never used so far, in 32 bit words.</summary>
+		public int StackHighWaterMarkWords { get; set; }
+		public int StackHighWaterMarkBytes { get { return StackHighWaterMarkWords * 4; } }
+	}
+
+	/// <summary>
+	/// One sample of the firmware's runtime stats (RuntimeStats.c): CPU share
+	/// and stack high-water mark per task, heap and queue depths. Sent on the
+	/// stats channel as hex encoded binary records, "RTS 01..." for the system
+	/// record followed by "RTS 02..." lines with up to three tasks each.
+	/// </summary>
+	public class XdkRuntimeStats
+	{
+		public const string LinePrefix = "RTS ";
+
+		private const byte SystemRecord = 1;
+		private const byte TasksRecord = 2;
+		private const byte CpuShareFlag = 0x01;
+		private const byte TasksTruncatedFlag = 0x02;
+		private const int SystemRecordSize = 24;
+		private const int TasksHeaderSize = 4;
+		private const int TaskEntrySize = 15;
+		private const int TaskNameLength = 8;
+		private const ushort CpuShareUnknown = 0xFFFF;
+
+		public int Sample { get; private set; }
+		public long UptimeMilliseconds { get; private set; }
+		/// <summary>Time the CPU shares were measured over.</summary>
+		public long IntervalMilliseconds { get; private set; }
+		public bool IsCpuShareKnown { get; private set; }
+		/// <summary>The device had more tasks than fit a sample.</summary>
+		public bool IsTruncated { get; private set; }
+		public long FreeHeap { get; private set; }
+		public long MinimumEverFreeHeap { get; private set; }
+		public int CmdQueueDepth { get; private set; }
+		public int CmdQueueLength { get; private set; }
+		public int SerialQueueDepth { get; private set; }
+		public int SerialQueueLength { get; private set; }
+		public IReadOnlyList<XdkTaskStats> Tasks { get { return _tasks; } }
+
+		/// <summary>Share of the CPU time not spent idle, NaN if unknown.</summary>
+		public double CpuLoad
+		{
+			get
+			{
+				XdkTaskStats idle = _tasks.Find(task => task.Name == "IDLE");
+				return idle != null ? 1D - idle.CpuShare : double.NaN;
+			}
+		}
+
+		private readonly List<XdkTaskStats> _tasks = new List<XdkTaskStats>();
+		private int _expectedTasks;
+
+		/// <summary>
+		/// Collects the records of one sample. Add returns the sample once all
+		/// its task records arrived. Samples with lost lines are dropped.
+		/// </summary>
+		public class Decoder
+		{
+			private XdkRuntimeStats _pending;
+
+			/// <summary>Samples dropped because some of their lines were lost.</summary>
+			public long IncompleteCount { get; private set; }
+
+			/// <summary>
+			/// Feeds a stats line payload. Returns true if it was a runtime stats
+			/// line, completed is set when it finished a sample.
+			/// </summary>
+			public bool Add(string payload, out XdkRuntimeStats completed)
+			{
+				completed = null;
+				byte[] record;
+				if (!payload.StartsWith(LinePrefix, StringComparison.Ordinal) || !TryParseHex(payload.Substring(LinePrefix.Length), out record) || record.Length < 2)
+					return false;
+
+				if (record[0] == SystemRecord)
+				{
+					if (_pending != null)
+						IncompleteCount++;
+					_pending = ParseSystemRecord(record);
+				}
+				else if (record[0] == TasksRecord && _pending != null)
+				{
+					if (!ParseTasksRecord(record, _pending))
+					{
+						IncompleteCount++;
+						_pending = null;
+					}
+				}
+				else
+				{
+					return record[0] == TasksRecord;
+				}
+
+				if (_pending != null && _pending._tasks.Count == _pending._expectedTasks)
+				{
+					completed = _pending;
+					_pending = null;
+				}
+				return true;
+			}
+		}
+
+		private static XdkRuntimeStats ParseSystemRecord(byte[] record)
+		{
+			if (record.Length < SystemRecordSize)
+				return null;
+			byte flags = record[2];
+			return new XdkRuntimeStats
+			{
+				Sample = record[1],
+				IsCpuShareKnown = (flags & CpuShareFlag) != 0,
+				IsTruncated = (flags & TasksTruncatedFlag) != 0,
+				_expectedTasks = record[3],
+				UptimeMilliseconds = BitConverter.ToUInt32(record, 4),
+				IntervalMilliseconds = BitConverter.ToUInt32(record, 8),
+				FreeHeap = BitConverter.ToUInt32(record, 12),
+				MinimumEverFreeHeap = BitConverter.ToUInt32(record, 16),
+				CmdQueueDepth = record[20],
+				CmdQueueLength = record[21],
+				SerialQueueDepth = record[22],
+				SerialQueueLength = record[23],
+			};
+		}
+
+		private static bool ParseTasksRecord(byte[] record, XdkRuntimeStats stats)
+		{
+			if (record.Length < TasksHeaderSize)
+				return false;
+			int count = record[3];
+			if (record[1] != stats.Sample || record[2] != stats._tasks.Count
+				|| record.Length != TasksHeaderSize + count * TaskEntrySize
+				|| stats._tasks.Count + count > stats._expectedTasks)
+			{
+				return false;
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				int offset = TasksHeaderSize + i * TaskEntrySize;
+				ushort cpuShare = BitConverter.ToUInt16(record, offset + 3);
+				int nameLength = Array.IndexOf(record, (byte)0, offset + 7, TaskNameLength) - (offset + 7);
+				stats._tasks.Add(new XdkTaskStats
+				{
+					Number = record[offset],
+					State = record[offset + 1],
+					Priority = record[offset + 2],
+					CpuShare = cpuShare == CpuShareUnknown ? double.NaN : cpuShare / 1000D,
+					StackHighWaterMarkWords = BitConverter.ToUInt16(record, offset + 5),
+					Name = Encoding.ASCII.GetString(record, offset + 7, nameLength >= 0 ? nameLength : TaskNameLength),
+				});
+			}
+			return true;
+		}
+
+		private static bool TryParseHex(string hex, out byte[] bytes)
+		{
+			bytes = null;
+			if (hex.Length % 2 != 0)
+				return false;
+			byte[] parsed = new byte[hex.Length / 2];
+			for (int i = 0; i < parsed.Length; i++)
+			{
+				if (!byte.TryParse(hex.Substring(i * 2, 2), NumberStyles.AllowHexSpecifier, CultureInfo.InvariantCulture, out parsed[i]))
+					return false;
+			}
+			bytes = parsed;
+			return true;
+		}
+	}
+}
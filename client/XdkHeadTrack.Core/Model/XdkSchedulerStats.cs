@@ -0,0 +1,85 @@
+﻿using System;
+using System.Globalization;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Stats of the firmware's sampling scheduler (SampleScheduler.c), sent on
+	/// the stats channel as three lines "SCHED", "SCHED_JITTER" and
+	/// "SCHED_EXEC". All counts are totals since the device started.
+	/// </summary>
+	public class XdkSchedulerStats
+	{
+		/// <summary>
+		/// Upper limits of the histogram buckets, SAMPLE_SCHEDULER_BUCKET_LIMITS_US.
+		/// </summary>
+		public static readonly uint[] BucketLimitsMicroseconds = { 50, 100, 200, 500, 1000, 2000, 5000, uint.MaxValue };
+
+		public long Periods { get; private set; }
+		public long Failures { get; private set; }
+		public long Overruns { get; private set; }
+		public long Skipped { get; private set; }
+		public long Bursts { get; private set; }
+		public long MaxJitterMicroseconds { get; private set; }
+		public long[] JitterHistogram { get; private set; } = new long[BucketLimitsMicroseconds.Length];
+		public long MaxExecutionMicroseconds { get; private set; }
+		public long[] ExecutionHistogram { get; private set; } = new long[BucketLimitsMicroseconds.Length];
+
+		/// <summary>
+		/// Share of the periods since previous that overran, NaN if none passed.
+		/// </summary>
+		public double GetOverrunRate(XdkSchedulerStats previous)
+		{
+			long periods = Periods - (previous?.Periods ?? 0);
+			long overruns = Overruns - (previous?.Overruns ?? 0);
+			return periods > 0 ? overruns / (double)periods : double.NaN;
+		}
+
+		/// <summary>
+		/// Returns a copy updated with one stats line, or null if the line is no
+		/// scheduler stats line.
+		/// </summary>
+		public XdkSchedulerStats Update(string payload)
+		{
+			string[] parts = payload.Split(' ');
+			long[] values = new long[parts.Length - 1];
+			for (int i = 1; i < parts.Length; i++)
+			{
+				if (!long.TryParse(parts[i], NumberStyles.None, CultureInfo.InvariantCulture, out values[i - 1]))
+					return null;
+			}
+
+			XdkSchedulerStats updated = (XdkSchedulerStats)MemberwiseClone();
+			int buckets = BucketLimitsMicroseconds.Length;
+			switch (parts[0])
+			{
+				case "SCHED":
+					if (values.Length != 5)
+						return null;
+					updated.Periods = values[0];
+					updated.Failures = values[1];
+					updated.Overruns = values[2];
+					updated.Skipped = values[3];
+					updated.Bursts = values[4];
+					break;
+				case "SCHED_JITTER":
+					if (values.Length != buckets + 1)
+						return null;
+					updated.MaxJitterMicroseconds = values[0];
+					updated.JitterHistogram = new long[buckets];
+					Array.Copy(values, 1, updated.JitterHistogram, 0, buckets);
+					break;
+				case "SCHED_EXEC":
+					if (values.Length != buckets + 1)
+						return null;
+					updated.MaxExecutionMicroseconds = values[0];
+					updated.ExecutionHistogram = new long[buckets];
+					Array.Copy(values, 1, updated.ExecutionHistogram, 0, buckets);
+					break;
+				default:
+					return null;
+			}
+			return updated;
+		}
+	}
+}
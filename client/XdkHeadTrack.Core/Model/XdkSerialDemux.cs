@@ -0,0 +1,85 @@
+﻿using System;
+
+namespace XdkHeadTrack.Model
+{
+	public enum XdkSerialChannel
+	{
+		Tracking,
+		Log,
+		Stats,
+		Response,
+	}
+
+	/// <summary>
+	/// Routes the lines of the firmware's serial mux to one consumer per
+	/// channel. Tracking lines keep their ">>QUAT:"/">>CALI:" tag, the other
+	/// channels are tagged ">>LOG:", ">>STAT:" and ">>RESP:" and their consumers
+	/// get the payload behind the tag. Untagged lines, as printed by older
+	/// firmware or the SDK itself, are treated as log output.
+	/// </summary>
+	public class XdkSerialDemux
+	{
+		private static readonly string[] TrackingTags = { ">>QUAT:", ">>CALI:" };
+		private static readonly string[] ChannelTags = { null, ">>LOG:", ">>STAT:", ">>RESP:" };
+
+		private readonly Action<string, long>[] _consumers = new Action<string, long>[ChannelTags.Length];
+		private readonly object _consumersLock = new object();
+
+		public void Register(XdkSerialChannel channel, Action<string, long> consumer)
+		{
+			lock (_consumersLock)
+			{
+				_consumers[(int)channel] += consumer;
+			}
+		}
+
+		public void Unregister(XdkSerialChannel channel, Action<string, long> consumer)
+		{
+			lock (_consumersLock)
+			{
+				_consumers[(int)channel] -= consumer;
+			}
+		}
+
+		public XdkSerialChannel Route(string line, long timestamp)
+		{
+			string payload;
+			XdkSerialChannel channel = Classify(line, out payload);
+			Action<string, long> consumer;
+			lock (_consumersLock)
+			{
+				consumer = _consumers[(int)channel];
+			}
+			consumer?.Invoke(payload, timestamp);
+			return channel;
+		}
+
+		public static XdkSerialChannel Classify(string line, out string payload)
+		{
+			foreach (string tag in TrackingTags)
+			{
+				if (line.StartsWith(tag, StringComparison.Ordinal))
+				{
+					payload = line;
+					return XdkSerialChannel.Tracking;
+				}
+			}
+
+			for (int i = 1; i < ChannelTags.Length; i++)
+			{
+				string tag = ChannelTags[i];
+				if (line.StartsWith(tag, StringComparison.Ordinal))
+				{
+					int start = tag.Length;
+					if (start < line.Length && line[start] == ' ')
+						start++;
+					payload = line.Substring(start);
+					return (XdkSerialChannel)i;
+				}
+			}
+
+			payload = line;
+			return XdkSerialChannel.Log;
+		}
+	}
+}
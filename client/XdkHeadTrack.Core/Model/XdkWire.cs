@@ -0,0 +1,254 @@
+﻿// Generated by schema/wiregen.py from schema/XdkWire.json, do not edit.
+using System;
+using System.Runtime.InteropServices;
+
+namespace XdkHeadTrack.Model
+{
+	/// <summary>
+	/// Wire formats shared with the firmware, see schema/XdkWire.json. All
+	/// values are little endian.
+	/// </summary>
+	public static class XdkWire
+	{
+		public const int SchemaVersion = 1;
+		/// <summary>Rotation sample on the serial tracking channel. Fields: w x y z sequence time.</summary>
+		public const string RotationLineTag = ">>QUAT:";
+		/// <summary>Calibration sample on the serial tracking channel. Fields: w x y z sequence time.</summary>
+		public const string CalibrationLineTag = ">>CALI:";
+
+		/// <summary>
+		/// BLE notification of firmware without sequence numbers.
+		/// </summary>
+		public struct LegacyTrackingData
+		{
+			public const int Version = 1;
+			public const int Size = 17;
+			public const uint LayoutHash = 0x1005E91C;
+			public const int WOffset = 0;
+			public const int XOffset = 4;
+			public const int YOffset = 8;
+			public const int ZOffset = 12;
+			public const int UseForCalibrationOffset = 16;
+
+			public float W;
+			public float X;
+			public float Y;
+			public float Z;
+			public bool UseForCalibration;
+
+			public static LegacyTrackingData Decode(byte[] buffer, int offset)
+			{
+				return new LegacyTrackingData
+				{
+					W = BitConverter.ToSingle(buffer, offset),
+					X = BitConverter.ToSingle(buffer, offset + 4),
+					Y = BitConverter.ToSingle(buffer, offset + 8),
+					Z = BitConverter.ToSingle(buffer, offset + 12),
+					UseForCalibration = buffer[offset + 16] != 0,
+				};
+			}
+
+			public void Encode(byte[] buffer, int offset)
+			{
+				WriteSingle(W, buffer, offset);
+				WriteSingle(X, buffer, offset + 4);
+				WriteSingle(Y, buffer, offset + 8);
+				WriteSingle(Z, buffer, offset + 12);
+				buffer[offset + 16] = (byte)(UseForCalibration ? 1 : 0);
+			}
+		}
+
+		/// <summary>
+		/// BLE notification with the rotation as floats.
+		/// </summary>
+		public struct TrackingData
+		{
+			public const int Version = 2;
+			public const int Size = 19;
+			public const uint LayoutHash = 0x442D63E4;
+			public const int WOffset = 0;
+			public const int XOffset = 4;
+			public const int YOffset = 8;
+			public const int ZOffset = 12;
+			public const int UseForCalibrationOffset = 16;
+			public const int SequenceOffset = 17;
+
+			public float W;
+			public float X;
+			public float Y;
+			public float Z;
+			public bool UseForCalibration;
+			public ushort Sequence;
+
+			public static TrackingData Decode(byte[] buffer, int offset)
+			{
+				return new TrackingData
+				{
+					W = BitConverter.ToSingle(buffer, offset),
+					X = BitConverter.ToSingle(buffer, offset + 4),
+					Y = BitConverter.ToSingle(buffer, offset + 8),
+					Z = BitConverter.ToSingle(buffer, offset + 12),
+					UseForCalibration = buffer[offset + 16] != 0,
+					Sequence = ReadUInt16(buffer, offset + 17),
+				};
+			}
+
+			public void Encode(byte[] buffer, int offset)
+			{
+				WriteSingle(W, buffer, offset);
+				WriteSingle(X, buffer, offset + 4);
+				WriteSingle(Y, buffer, offset + 8);
+				WriteSingle(Z, buffer, offset + 12);
+				buffer[offset + 16] = (byte)(UseForCalibration ? 1 : 0);
+				WriteUInt16(Sequence, buffer, offset + 17);
+			}
+		}
+
+		/// <summary>
+		/// BLE notification with the current and previous sample packed with
+		/// QuatPack, the flags hold the dropped components. Lets the host
+		/// restore a single lost notification.
+		/// </summary>
+		public struct CompactTrackingData
+		{
+			public const int Version = 3;
+			public const int Size = 15;
+			public const uint LayoutHash = 0xEFB4F709;
+			public const byte FlagCalibration = 1;
+			public const byte FlagPreviousValid = 2;
+			public const byte CurrentComponentShift = 2;
+			public const byte PreviousComponentShift = 4;
+			public const byte ComponentMask = 3;
+			public const int FlagsOffset = 0;
+			public const int SequenceOffset = 1;
+			public const int CurrentOffset = 3;
+			public const int PreviousOffset = 9;
+
+			public byte Flags;
+			public ushort Sequence;
+			public short Current0;
+			public short Current1;
+			public short Current2;
+			public short Previous0;
+			public short Previous1;
+			public short Previous2;
+
+			public static CompactTrackingData Decode(byte[] buffer, int offset)
+			{
+				return new CompactTrackingData
+				{
+					Flags = buffer[offset],
+					Sequence = ReadUInt16(buffer, offset + 1),
+					Current0 = (short)ReadUInt16(buffer, offset + 3),
+					Current1 = (short)ReadUInt16(buffer, offset + 5),
+					Current2 = (short)ReadUInt16(buffer, offset + 7),
+					Previous0 = (short)ReadUInt16(buffer, offset + 9),
+					Previous1 = (short)ReadUInt16(buffer, offset + 11),
+					Previous2 = (short)ReadUInt16(buffer, offset + 13),
+				};
+			}
+
+			public void Encode(byte[] buffer, int offset)
+			{
+				buffer[offset] = Flags;
+				WriteUInt16(Sequence, buffer, offset + 1);
+				WriteUInt16((ushort)Current0, buffer, offset + 3);
+				WriteUInt16((ushort)Current1, buffer, offset + 5);
+				WriteUInt16((ushort)Current2, buffer, offset + 7);
+				WriteUInt16((ushort)Previous0, buffer, offset + 9);
+				WriteUInt16((ushort)Previous1, buffer, offset + 11);
+				WriteUInt16((ushort)Previous2, buffer, offset + 13);
+			}
+		}
+
+		/// <summary>
+		/// UDP packet to the head tracking receiver (opentrack): translation
+		/// and yaw, pitch, roll in degrees.
+		/// </summary>
+		public struct UdpOrientation
+		{
+			public const int Version = 1;
+			public const int Size = 48;
+			public const uint LayoutHash = 0x657956BD;
+			public const int XOffset = 0;
+			public const int YOffset = 8;
+			public const int ZOffset = 16;
+			public const int YawOffset = 24;
+			public const int PitchOffset = 32;
+			public const int RollOffset = 40;
+
+			public double X;
+			public double Y;
+			public double Z;
+			public double Yaw;
+			public double Pitch;
+			public double Roll;
+
+			public static UdpOrientation Decode(byte[] buffer, int offset)
+			{
+				return new UdpOrientation
+				{
+					X = BitConverter.ToDouble(buffer, offset),
+					Y = BitConverter.ToDouble(buffer, offset + 8),
+					Z = BitConverter.ToDouble(buffer, offset + 16),
+					Yaw = BitConverter.ToDouble(buffer, offset + 24),
+					Pitch = BitConverter.ToDouble(buffer, offset + 32),
+					Roll = BitConverter.ToDouble(buffer, offset + 40),
+				};
+			}
+
+			public void Encode(byte[] buffer, int offset)
+			{
+				WriteDouble(X, buffer, offset);
+				WriteDouble(Y, buffer, offset + 8);
+				WriteDouble(Z, buffer, offset + 16);
+				WriteDouble(Yaw, buffer, offset + 24);
+				WriteDouble(Pitch, buffer, offset + 32);
+				WriteDouble(Roll, buffer, offset + 40);
+			}
+		}
+
+		private static ushort ReadUInt16(byte[] buffer, int offset)
+		{
+			return (ushort)(buffer[offset] | buffer[offset + 1] << 8);
+		}
+
+		private static uint ReadUInt32(byte[] buffer, int offset)
+		{
+			return (uint)(buffer[offset] | buffer[offset + 1] << 8 | buffer[offset + 2] << 16 | buffer[offset + 3] << 24);
+		}
+
+		private static void WriteUInt16(ushort value, byte[] buffer, int offset)
+		{
+			buffer[offset] = (byte)value;
+			buffer[offset + 1] = (byte)(value >> 8);
+		}
+
+		private static void WriteUInt32(uint value, byte[] buffer, int offset)
+		{
+			buffer[offset] = (byte)value;
+			buffer[offset + 1] = (byte)(value >> 8);
+			buffer[offset + 2] = (byte)(value >> 16);
+			buffer[offset + 3] = (byte)(value >> 24);
+		}
+
+		private static void WriteSingle(float value, byte[] buffer, int offset)
+		{
+			WriteUInt32(new SingleBits { Single = value }.Bits, buffer, offset);
+		}
+
+		private static void WriteDouble(double value, byte[] buffer, int offset)
+		{
+			long bits = BitConverter.DoubleToInt64Bits(value);
+			WriteUInt32((uint)bits, buffer, offset);
+			WriteUInt32((uint)(bits >> 32), buffer, offset + 4);
+		}
+
+		[StructLayout(LayoutKind.Explicit)]
+		private struct SingleBits
+		{
+			[FieldOffset(0)] public float Single;
+			[FieldOffset(0)] public uint Bits;
+		}
+	}
+}
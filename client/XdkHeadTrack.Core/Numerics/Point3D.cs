@@ -0,0 +1,53 @@
+﻿using System;
+using System.Globalization;
+
+namespace XdkHeadTrack.Numerics
+{
+	/// <summary>
+	/// Point in double precision, in place of the WPF
+	/// System.Windows.Media.Media3D.Point3D, see Quaternion.
+	/// </summary>
+	public struct Point3D : IEquatable<Point3D>
+	{
+		public double X { get; set; }
+		public double Y { get; set; }
+		public double Z { get; set; }
+
+		public Point3D(double x, double y, double z)
+		{
+			X = x;
+			Y = y;
+			Z = z;
+		}
+
+		public bool Equals(Point3D other)
+		{
+			return X.Equals(other.X) && Y.Equals(other.Y) && Z.Equals(other.Z);
+		}
+
+		public override bool Equals(object obj)
+		{
+			return obj is Point3D && Equals((Point3D)obj);
+		}
+
+		public override int GetHashCode()
+		{
+			return X.GetHashCode() ^ Y.GetHashCode() ^ Z.GetHashCode();
+		}
+
+		public static bool operator ==(Point3D left, Point3D right)
+		{
+			return left.Equals(right);
+		}
+
+		public static bool operator !=(Point3D left, Point3D right)
+		{
+			return !left.Equals(right);
+		}
+
+		public override string ToString()
+		{
+			return string.Format(CultureInfo.InvariantCulture, "{0},{1},{2}", X, Y, Z);
+		}
+	}
+}
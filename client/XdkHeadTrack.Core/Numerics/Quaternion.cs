@@ -0,0 +1,277 @@
+﻿using System;
+using System.Globalization;
+
+namespace XdkHeadTrack.Numerics
+{
+	/// <summary>
+	/// Rotation quaternion in double precision. Follows the math of the WPF
+	/// System.Windows.Media.Media3D.Quaternion, so the model runs the same
+	/// without WPF, e.g. in the tools on Linux. As there, the default value is
+	/// the identity and angles are in degrees.
+	/// </summary>
+	public struct Quaternion : IEquatable<Quaternion>
+	{
+		private double _x;
+		private double _y;
+		private double _z;
+		// W is 1 while not set, so default(Quaternion) is the identity.
+		private double _w;
+		private bool _isSet;
+
+		public Quaternion(double x, double y, double z, double w)
+		{
+			_x = x;
+			_y = y;
+			_z = z;
+			_w = w;
+			_isSet = true;
+		}
+
+		/// <summary>
+		/// Rotation by angleInDegrees around axisOfRotation, which need not be
+		/// normalized but must not be zero.
+		/// </summary>
+		public Quaternion(Vector3D axisOfRotation, double angleInDegrees)
+		{
+			double length = axisOfRotation.Length;
+			if (length == 0D)
+				throw new InvalidOperationException("Axis of rotation must not be zero");
+
+			double halfAngle = (angleInDegrees % 360D) * (Math.PI / 360D);
+			double scale = Math.Sin(halfAngle) / length;
+			_x = axisOfRotation.X * scale;
+			_y = axisOfRotation.Y * scale;
+			_z = axisOfRotation.Z * scale;
+			_w = Math.Cos(halfAngle);
+			_isSet = true;
+		}
+
+		public static Quaternion Identity => new Quaternion();
+
+		public double X { get { return _x; } set { Set(); _x = value; } }
+		public double Y { get { return _y; } set { Set(); _y = value; } }
+		public double Z { get { return _z; } set { Set(); _z = value; } }
+		public double W { get { return _isSet ? _w : 1D; } set { Set(); _w = value; } }
+
+		public bool IsIdentity => !_isSet || (_x == 0D && _y == 0D && _z == 0D && _w == 1D);
+
+		public bool IsNormalized => Math.Abs(X * X + Y * Y + Z * Z + W * W - 1D) < 1E-12D;
+
+		/// <summary>Normalized axis of rotation, the Y axis for the identity.</summary>
+		public Vector3D Axis
+		{
+			get
+			{
+				if (_x == 0D && _y == 0D && _z == 0D)
+					return new Vector3D(0D, 1D, 0D);
+				Vector3D axis = new Vector3D(_x, _y, _z);
+				axis.Normalize();
+				return axis;
+			}
+		}
+
+		/// <summary>Angle of rotation in degrees, in [0, 360].</summary>
+		public double Angle
+		{
+			get
+			{
+				if (!_isSet)
+					return 0D;
+				double sin = Math.Sqrt(_x * _x + _y * _y + _z * _z);
+				double cos = _w;
+				if (!(sin <= double.MaxValue))
+				{
+					double max = Math.Max(Math.Abs(_x), Math.Max(Math.Abs(_y), Math.Abs(_z)));
+					double x = _x / max;
+					double y = _y / max;
+					double z = _z / max;
+					sin = Math.Sqrt(x * x + y * y + z * z);
+					cos = _w / max;
+				}
+				return Math.Atan2(sin, cos) * (360D / Math.PI);
+			}
+		}
+
+		public void Conjugate()
+		{
+			if (!_isSet)
+				return;
+			_x = -_x;
+			_y = -_y;
+			_z = -_z;
+		}
+
+		public void Invert()
+		{
+			if (!_isSet)
+				return;
+			Conjugate();
+			double norm2 = _x * _x + _y * _y + _z * _z + _w * _w;
+			_x /= norm2;
+			_y /= norm2;
+			_z /= norm2;
+			_w /= norm2;
+		}
+
+		public void Normalize()
+		{
+			if (!_isSet)
+				return;
+			double norm2 = _x * _x + _y * _y + _z * _z + _w * _w;
+			if (norm2 > double.MaxValue)
+			{
+				// Scale down first so the squares do not overflow.
+				double scale = 1D / Math.Max(Math.Max(Math.Abs(_x), Math.Abs(_y)), Math.Max(Math.Abs(_z), Math.Abs(_w)));
+				_x *= scale;
+				_y *= scale;
+				_z *= scale;
+				_w *= scale;
+				norm2 = _x * _x + _y * _y + _z * _z + _w * _w;
+			}
+			double inverse = 1D / Math.Sqrt(norm2);
+			_x *= inverse;
+			_y *= inverse;
+			_z *= inverse;
+			_w *= inverse;
+		}
+
+		public static Quaternion operator *(Quaternion left, Quaternion right)
+		{
+			if (!left._isSet)
+				return right;
+			if (!right._isSet)
+				return left;
+			return new Quaternion(
+				left._w * right._x + left._x * right._w + left._y * right._z - left._z * right._y,
+				left._w * right._y + left._y * right._w + left._z * right._x - left._x * right._z,
+				left._w * right._z + left._z * right._w + left._x * right._y - left._y * right._x,
+				left._w * right._w - left._x * right._x - left._y * right._y - left._z * right._z);
+		}
+
+		public static Quaternion Slerp(Quaternion from, Quaternion to, double t)
+		{
+			return Slerp(from, to, t, true);
+		}
+
+		/// <summary>
+		/// Spherical interpolation, t = 0 gives from and t = 1 gives to. The
+		/// length of the result is interpolated multiplicatively between the
+		/// lengths of both.
+		/// </summary>
+		public static Quaternion Slerp(Quaternion from, Quaternion to, double t, bool useShortestPath)
+		{
+			double fromX = from.X, fromY = from.Y, fromZ = from.Z, fromW = from.W;
+			double toX = to.X, toY = to.Y, toZ = to.Z, toW = to.W;
+
+			double fromLength = Math.Sqrt(fromX * fromX + fromY * fromY + fromZ * fromZ + fromW * fromW);
+			double toLength = Math.Sqrt(toX * toX + toY * toY + toZ * toZ + toW * toW);
+			fromX /= fromLength;
+			fromY /= fromLength;
+			fromZ /= fromLength;
+			fromW /= fromLength;
+			toX /= toLength;
+			toY /= toLength;
+			toZ /= toLength;
+			toW /= toLength;
+
+			double cosOmega = fromX * toX + fromY * toY + fromZ * toZ + fromW * toW;
+			if (useShortestPath)
+			{
+				if (cosOmega < 0D)
+				{
+					cosOmega = -cosOmega;
+					toX = -toX;
+					toY = -toY;
+					toZ = -toZ;
+					toW = -toW;
+				}
+			}
+			else if (cosOmega < -1D)
+			{
+				cosOmega = -1D;
+			}
+			if (cosOmega > 1D)
+				cosOmega = 1D;
+
+			double scaleFrom;
+			double scaleTo;
+			if (cosOmega > 1D - 1E-6D)
+			{
+				// Too close for the sines, interpolate linearly.
+				scaleFrom = 1D - t;
+				scaleTo = t;
+			}
+			else if (cosOmega < 1E-10D - 1D)
+			{
+				// Opposite, go through a perpendicular rotation.
+				toX = -fromY;
+				toY = fromX;
+				toZ = -fromW;
+				toW = fromZ;
+				double theta = t * Math.PI;
+				scaleFrom = Math.Cos(theta);
+				scaleTo = Math.Sin(theta);
+			}
+			else
+			{
+				double omega = Math.Acos(cosOmega);
+				double sinOmega = Math.Sqrt(1D - cosOmega * cosOmega);
+				scaleFrom = Math.Sin((1D - t) * omega) / sinOmega;
+				scaleTo = Math.Sin(t * omega) / sinOmega;
+			}
+
+			double length = fromLength * Math.Pow(toLength / fromLength, t);
+			scaleFrom *= length;
+			scaleTo *= length;
+			return new Quaternion(
+				scaleFrom * fromX + scaleTo * toX,
+				scaleFrom * fromY + scaleTo * toY,
+				scaleFrom * fromZ + scaleTo * toZ,
+				scaleFrom * fromW + scaleTo * toW);
+		}
+
+		public bool Equals(Quaternion other)
+		{
+			if (!_isSet || !other._isSet)
+				return IsIdentity == other.IsIdentity;
+			return _x.Equals(other._x) && _y.Equals(other._y) && _z.Equals(other._z) && _w.Equals(other._w);
+		}
+
+		public override bool Equals(object obj)
+		{
+			return obj is Quaternion && Equals((Quaternion)obj);
+		}
+
+		public override int GetHashCode()
+		{
+			if (IsIdentity)
+				return 0;
+			return _x.GetHashCode() ^ _y.GetHashCode() ^ _z.GetHashCode() ^ _w.GetHashCode();
+		}
+
+		public static bool operator ==(Quaternion left, Quaternion right)
+		{
+			return left.Equals(right);
+		}
+
+		public static bool operator !=(Quaternion left, Quaternion right)
+		{
+			return !left.Equals(right);
+		}
+
+		public override string ToString()
+		{
+			if (!_isSet)
+				return "Identity";
+			return string.Format(CultureInfo.InvariantCulture, "{0},{1},{2},{3}", _x, _y, _z, _w);
+		}
+
+		private void Set()
+		{
+			if (_isSet)
+				return;
+			_w = 1D;
+			_isSet = true;
+		}
+	}
+}
@@ -0,0 +1,95 @@
+﻿using System;
+using System.Globalization;
+
+namespace XdkHeadTrack.Numerics
+{
+	/// <summary>
+	/// Vector in double precision, in place of the WPF
+	/// System.Windows.Media.Media3D.Vector3D, see Quaternion.
+	/// </summary>
+	public struct Vector3D : IEquatable<Vector3D>
+	{
+		public double X { get; set; }
+		public double Y { get; set; }
+		public double Z { get; set; }
+
+		public Vector3D(double x, double y, double z)
+		{
+			X = x;
+			Y = y;
+			Z = z;
+		}
+
+		public double Length => Math.Sqrt(LengthSquared);
+
+		public double LengthSquared => X * X + Y * Y + Z * Z;
+
+		public void Normalize()
+		{
+			double length = Length;
+			X /= length;
+			Y /= length;
+			Z /= length;
+		}
+
+		public static Vector3D operator +(Vector3D left, Vector3D right)
+		{
+			return new Vector3D(left.X + right.X, left.Y + right.Y, left.Z + right.Z);
+		}
+
+		public static Vector3D operator -(Vector3D left, Vector3D right)
+		{
+			return new Vector3D(left.X - right.X, left.Y - right.Y, left.Z - right.Z);
+		}
+
+		public static Vector3D operator -(Vector3D vector)
+		{
+			return new Vector3D(-vector.X, -vector.Y, -vector.Z);
+		}
+
+		public static Vector3D operator *(Vector3D vector, double scalar)
+		{
+			return new Vector3D(vector.X * scalar, vector.Y * scalar, vector.Z * scalar);
+		}
+
+		public static Vector3D operator *(double scalar, Vector3D vector)
+		{
+			return vector * scalar;
+		}
+
+		public static Vector3D operator /(Vector3D vector, double scalar)
+		{
+			return vector * (1D / scalar);
+		}
+
+		public bool Equals(Vector3D other)
+		{
+			return X.Equals(other.X) && Y.Equals(other.Y) && Z.Equals(other.Z);
+		}
+
+		public override bool Equals(object obj)
+		{
+			return obj is Vector3D && Equals((Vector3D)obj);
+		}
+
+		public override int GetHashCode()
+		{
+			return X.GetHashCode() ^ Y.GetHashCode() ^ Z.GetHashCode();
+		}
+
+		public static bool operator ==(Vector3D left, Vector3D right)
+		{
+			return left.Equals(right);
+		}
+
+		public static bool operator !=(Vector3D left, Vector3D right)
+		{
+			return !left.Equals(right);
+		}
+
+		public override string ToString()
+		{
+			return string.Format(CultureInfo.InvariantCulture, "{0},{1},{2}", X, Y, Z);
+		}
+	}
+}
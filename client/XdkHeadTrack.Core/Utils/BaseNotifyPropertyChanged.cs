@@ -2,7 +2,6 @@
 using System.ComponentModel;
 using System.Runtime.CompilerServices;
 using System.Threading;
-using System.Windows.Threading;
 
 namespace XdkHeadTrack.Utils
 {
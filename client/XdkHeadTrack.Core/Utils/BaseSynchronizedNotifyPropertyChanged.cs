@@ -0,0 +1,38 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.CompilerServices;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace XdkHeadTrack.Utils
+{
+	/// <summary>
+	/// Raises PropertyChanged through the SynchronizationContext of the thread
+	/// that created the object, e.g. the dispatcher of the UI thread. Without
+	/// one, as in the command line tools, it is raised on the changing thread.
+	/// </summary>
+	public class BaseSynchronizedNotifyPropertyChanged : BaseNotifyPropertyChanged
+	{
+		protected bool IsSynchronized => _context == null || Thread.CurrentThread == _thread;
+		private readonly SynchronizationContext _context;
+		private readonly Thread _thread;
+
+		public BaseSynchronizedNotifyPropertyChanged() : this(SynchronizationContext.Current, Thread.CurrentThread) { }
+
+		public BaseSynchronizedNotifyPropertyChanged(SynchronizationContext context, Thread thread)
+		{
+			_context = context;
+			_thread = thread;
+		}
+
+		protected override void NotifyPropertyChanged([CallerMemberName] String propertyName = "")
+		{
+			if (IsSynchronized)
+				base.NotifyPropertyChanged(propertyName);
+			else
+				_context.Post(state => base.NotifyPropertyChanged(propertyName), null);
+		}
+	}
+}
@@ -0,0 +1,20 @@
+﻿using System.Diagnostics;
+
+namespace XdkHeadTrack.Utils
+{
+	/// <summary>
+	/// Common monotonic time base for all host side timestamps.
+	/// </summary>
+	public static class HostClock
+	{
+		public static long Frequency => Stopwatch.Frequency;
+
+		public static long Now => Stopwatch.GetTimestamp();
+
+		public static double ToSeconds(long ticks) => ticks / (double)Stopwatch.Frequency;
+
+		public static double ToMicroseconds(long ticks) => ticks * 1000000D / Stopwatch.Frequency;
+
+		public static long FromSeconds(double seconds) => (long)(seconds * Stopwatch.Frequency);
+	}
+}
@@ -0,0 +1,195 @@
+﻿using System;
+using System.Runtime.CompilerServices;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Utils
+{
+	public enum EulerPrecision
+	{
+		/// <summary>Math.Atan2 and Math.Asin.</summary>
+		Exact,
+		/// <summary>
+		/// Polynomial atan, no angle off by more than MaxApproximationErrorDegrees
+		/// from the exact one.
+		/// </summary>
+		Approximate,
+	}
+
+	/// <summary>
+	/// Unit quaternions as structure of arrays, for converting many of them
+	/// to Euler angles in one go (analytics, several devices per update).
+	/// The angles are the components of QuaternionExtension.QuatToEuler, in
+	/// radians, which is the single quaternion version of ToEuler.
+	///
+	/// Both modes handle gimbal lock the same: once |pitch| is within
+	/// GimbalLockThreshold of 90°, pitch is set to ±90°, the second atan2
+	/// (the Y component) to 0 and the whole remaining rotation goes into the
+	/// first one. Near the poles the Euler angles still describe the rotation
+	/// and never become NaN.
+	/// </summary>
+	public class QuaternionBatch
+	{
+		/// <summary>Measured over a dense grid of rotations, including the poles.</summary>
+		public const double MaxApproximationErrorDegrees = 0.0015D;
+		/// <summary>Sine of the pitch from which on it counts as gimbal lock, less than 0.004° off.</summary>
+		public const double GimbalLockThreshold = 1D - 1e-9D;
+
+		// Odd minimax polynomial of atan on [-1, 1], Abramowitz and Stegun 4.4.49.
+		private const double Atan1 = 0.9998660D;
+		private const double Atan3 = -0.3302995D;
+		private const double Atan5 = 0.1801410D;
+		private const double Atan7 = -0.0851330D;
+		private const double Atan9 = 0.0208351D;
+
+		public readonly double[] W;
+		public readonly double[] X;
+		public readonly double[] Y;
+		public readonly double[] Z;
+
+		public int Count { get; private set; }
+		public int Capacity => W.Length;
+
+		public QuaternionBatch(int capacity)
+		{
+			W = new double[capacity];
+			X = new double[capacity];
+			Y = new double[capacity];
+			Z = new double[capacity];
+		}
+
+		public void Add(Quaternion rotation)
+		{
+			if (Count == Capacity)
+				throw new InvalidOperationException("Batch is full.");
+			W[Count] = rotation.W;
+			X[Count] = rotation.X;
+			Y[Count] = rotation.Y;
+			Z[Count] = rotation.Z;
+			Count++;
+		}
+
+		public void Clear()
+		{
+			Count = 0;
+		}
+
+		/// <summary>
+		/// Writes the Euler angles of all Count quaternions to the three arrays,
+		/// which must hold at least Count values each.
+		/// </summary>
+		public void ToEuler(double[] eulerX, double[] eulerY, double[] eulerZ, EulerPrecision precision)
+		{
+			if (eulerX.Length < Count || eulerY.Length < Count || eulerZ.Length < Count)
+				throw new ArgumentException("Output arrays are shorter than the batch.");
+
+			if (precision == EulerPrecision.Exact)
+				ToEulerExact(eulerX, eulerY, eulerZ);
+			else
+				ToEulerApproximate(eulerX, eulerY, eulerZ);
+		}
+
+		/// <summary>
+		/// The conversion of a single quaternion, exactly as the batch does it.
+		/// </summary>
+		public static Vector3D ToEuler(Quaternion q, EulerPrecision precision)
+		{
+			double w = q.W, x = q.X, y = q.Y, z = q.Z;
+			double sinPitch = Clamp(2D * (w * x - z * y));
+			if (Math.Abs(sinPitch) >= GimbalLockThreshold)
+			{
+				double locked = -2D * Math.Sign(sinPitch) * (precision == EulerPrecision.Exact ? Math.Atan2(y, w) : Atan2(y, w));
+				return new Vector3D(Wrap(locked), 0D, Math.Sign(sinPitch) * Math.PI * 0.5D);
+			}
+
+			double xNum = 2D * (w * z + y * x), xDen = 1D - 2D * (x * x + z * z);
+			double yNum = 2D * (w * y + x * z), yDen = 1D - 2D * (y * y + x * x);
+			return precision == EulerPrecision.Exact
+				? new Vector3D(Math.Atan2(xNum, xDen), Math.Atan2(yNum, yDen), Math.Asin(sinPitch))
+				: new Vector3D(Atan2(xNum, xDen), Atan2(yNum, yDen), Asin(sinPitch));
+		}
+
+		private void ToEulerExact(double[] eulerX, double[] eulerY, double[] eulerZ)
+		{
+			double[] ws = W, xs = X, ys = Y, zs = Z;
+			for (int i = 0; i < Count; i++)
+			{
+				double w = ws[i], x = xs[i], y = ys[i], z = zs[i];
+				double sinPitch = Clamp(2D * (w * x - z * y));
+				if (Math.Abs(sinPitch) < GimbalLockThreshold)
+				{
+					eulerX[i] = Math.Atan2(2D * (w * z + y * x), 1D - 2D * (x * x + z * z));
+					eulerY[i] = Math.Atan2(2D * (w * y + x * z), 1D - 2D * (y * y + x * x));
+					eulerZ[i] = Math.Asin(sinPitch);
+				}
+				else
+				{
+					eulerX[i] = Wrap(-2D * Math.Sign(sinPitch) * Math.Atan2(y, w));
+					eulerY[i] = 0D;
+					eulerZ[i] = Math.Sign(sinPitch) * Math.PI * 0.5D;
+				}
+			}
+		}
+
+		private void ToEulerApproximate(double[] eulerX, double[] eulerY, double[] eulerZ)
+		{
+			double[] ws = W, xs = X, ys = Y, zs = Z;
+			for (int i = 0; i < Count; i++)
+			{
+				double w = ws[i], x = xs[i], y = ys[i], z = zs[i];
+				double sinPitch = Clamp(2D * (w * x - z * y));
+				if (Math.Abs(sinPitch) < GimbalLockThreshold)
+				{
+					eulerX[i] = Atan2(2D * (w * z + y * x), 1D - 2D * (x * x + z * z));
+					eulerY[i] = Atan2(2D * (w * y + x * z), 1D - 2D * (y * y + x * x));
+					eulerZ[i] = Asin(sinPitch);
+				}
+				else
+				{
+					eulerX[i] = Wrap(-2D * Math.Sign(sinPitch) * Atan2(y, w));
+					eulerY[i] = 0D;
+					eulerZ[i] = Math.Sign(sinPitch) * Math.PI * 0.5D;
+				}
+			}
+		}
+
+		[MethodImpl(MethodImplOptions.AggressiveInlining)]
+		private static double Atan2(double y, double x)
+		{
+			double ax = Math.Abs(x), ay = Math.Abs(y);
+			double max = Math.Max(ax, ay);
+			double t = max > 0D ? Math.Min(ax, ay) / max : 0D;
+			double t2 = t * t;
+			double r = t * (Atan1 + t2 * (Atan3 + t2 * (Atan5 + t2 * (Atan7 + t2 * Atan9))));
+			if (ay > ax)
+				r = Math.PI * 0.5D - r;
+			if (x < 0D)
+				r = Math.PI - r;
+			return y < 0D ? -r : r;
+		}
+
+		[MethodImpl(MethodImplOptions.AggressiveInlining)]
+		private static double Asin(double s)
+		{
+			return Atan2(s, Math.Sqrt(1D - s * s));
+		}
+
+		[MethodImpl(MethodImplOptions.AggressiveInlining)]
+		private static double Clamp(double s)
+		{
+			return s > 1D ? 1D : (s < -1D ? -1D : s);
+		}
+
+		/// <summary>
+		/// Wraps the locked angle, twice an atan2, back into [-π, π].
+		/// </summary>
+		[MethodImpl(MethodImplOptions.AggressiveInlining)]
+		private static double Wrap(double angle)
+		{
+			if (angle > Math.PI)
+				return angle - 2D * Math.PI;
+			if (angle < -Math.PI)
+				return angle + 2D * Math.PI;
+			return angle;
+		}
+	}
+}
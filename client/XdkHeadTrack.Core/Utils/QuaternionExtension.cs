@@ -1,5 +1,5 @@
 ﻿using System;
-using System.Windows.Media.Media3D;
+using XdkHeadTrack.Numerics;
 
 namespace XdkHeadTrack.Utils
 {
@@ -64,22 +64,16 @@ namespace XdkHeadTrack.Utils
 			return result;
 		}
 
+		/// <summary>
+		/// Euler angles in radians, X about the Z axis, Y about the Y axis and
+		/// Z about the X axis (pitch). Same as QuaternionBatch.ToEuler, which
+		/// converts many quaternions at once.
+		/// </summary>
 		public static Vector3D QuatToEuler(this Quaternion q)
 		{
-			//This is the code from 
+			//Based on the code from
 			//http://www.mawsoft.com/blog/?p=197
-			var rotation = q;
-			double q0 = rotation.W;
-			double q1 = rotation.Y;
-			double q2 = rotation.X;
-			double q3 = rotation.Z;
-
-			Vector3D radAngles = new Vector3D();
-			radAngles.Y = Math.Atan2(2 * (q0 * q1 + q2 * q3), 1 - 2 * (Math.Pow(q1, 2) + Math.Pow(q2, 2)));
-			radAngles.Z = Math.Asin(2 * (q0 * q2 - q3 * q1));
-			radAngles.X = Math.Atan2(2 * (q0 * q3 + q1 * q2), 1 - 2 * (Math.Pow(q2, 2) + Math.Pow(q3, 2)));
-
-			return radAngles;
+			return QuaternionBatch.ToEuler(q, EulerPrecision.Exact);
 		}
 	}
 }
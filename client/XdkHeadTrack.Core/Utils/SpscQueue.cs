@@ -0,0 +1,90 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace XdkHeadTrack.Utils
+{
+	// Each side of an SpscQueue keeps its index and its cached copy of the
+	// other side's index on a cache line of its own, so the two threads only
+	// share a line when one of them has to refresh its copy. Outside of the
+	// queue since generic types cannot have an explicit layout.
+	[StructLayout(LayoutKind.Explicit, Size = 128)]
+	internal struct SpscQueueSide
+	{
+		[FieldOffset(64)]
+		public int Index;
+		[FieldOffset(68)]
+		public int Cached;
+	}
+
+	/// <summary>
+	/// Bounded lock-free queue for exactly one producer and one consumer
+	/// thread, see RotationWorker. Neither side ever blocks or allocates: a
+	/// full queue rejects the item and the producer decides what to drop.
+	///
+	/// Only the producer calls TryEnqueue and only the consumer TryDequeue.
+	/// Several producers are fine as long as they are serialized, e.g. by a
+	/// lock, since that orders their writes as well.
+	/// </summary>
+	public class SpscQueue<T>
+	{
+		private readonly T[] _items;
+		private readonly int _mask;
+		private SpscQueueSide _producer;
+		private SpscQueueSide _consumer;
+
+		/// <param name="capacity">Rounded up to a power of two.</param>
+		public SpscQueue(int capacity)
+		{
+			if (capacity < 1 || capacity > 1 << 30)
+				throw new ArgumentOutOfRangeException(nameof(capacity));
+			int size = 1;
+			while (size < capacity)
+				size <<= 1;
+			_items = new T[size];
+			_mask = size - 1;
+		}
+
+		public int Capacity => _items.Length;
+
+		/// <summary>
+		/// Items in the queue, only a snapshot while the other side is running.
+		/// </summary>
+		public int Count => Volatile.Read(ref _producer.Index) - Volatile.Read(ref _consumer.Index);
+
+		public bool IsEmpty => Count == 0;
+
+		public bool TryEnqueue(T item)
+		{
+			// Indices wrap around, their difference stays correct.
+			int tail = _producer.Index;
+			if (tail - _producer.Cached >= _items.Length)
+			{
+				_producer.Cached = Volatile.Read(ref _consumer.Index);
+				if (tail - _producer.Cached >= _items.Length)
+					return false;
+			}
+			_items[tail & _mask] = item;
+			Volatile.Write(ref _producer.Index, tail + 1);
+			return true;
+		}
+
+		public bool TryDequeue(out T item)
+		{
+			int head = _consumer.Index;
+			if (head == _consumer.Cached)
+			{
+				_consumer.Cached = Volatile.Read(ref _producer.Index);
+				if (head == _consumer.Cached)
+				{
+					item = default(T);
+					return false;
+				}
+			}
+			item = _items[head & _mask];
+			_items[head & _mask] = default(T);
+			Volatile.Write(ref _consumer.Index, head + 1);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace XdkHeadTrack.Utils
+{
+	/// <summary>
+	/// Pins threads to a logical processor, to keep the cache of a pipeline
+	/// stage warm and the stages from competing for one core.
+	/// </summary>
+	public static class ThreadAffinity
+	{
+		[DllImport("kernel32.dll")]
+		private static extern IntPtr GetCurrentThread();
+
+		[DllImport("kernel32.dll", SetLastError = true)]
+		private static extern UIntPtr SetThreadAffinityMask(IntPtr thread, UIntPtr mask);
+
+		/// <summary>
+		/// Restricts the calling thread to the processor and keeps the managed
+		/// thread on its OS thread until it ends. Returns false if the processor
+		/// does not exist or the OS does not support pinning, the thread then
+		/// keeps running wherever the scheduler puts it.
+		/// </summary>
+		public static bool PinCurrentThread(int processor)
+		{
+			if (processor < 0 || processor >= Environment.ProcessorCount || processor >= 8 * UIntPtr.Size)
+				return false;
+			if (Environment.OSVersion.Platform != PlatformID.Win32NT)
+				return false;
+
+			Thread.BeginThreadAffinity();
+			return SetThreadAffinityMask(GetCurrentThread(), new UIntPtr(1UL << processor)) != UIntPtr.Zero;
+		}
+	}
+}
@@ -0,0 +1,52 @@
+﻿using System.Threading;
+
+namespace XdkHeadTrack.Utils
+{
+	/// <summary>
+	/// Hands the latest value from one writer thread to one reader thread,
+	/// for consumers that only care about the newest pose, like the UI. Both
+	/// sides are wait-free: the writer never waits for a slow reader and the
+	/// reader simply skips values written in between.
+	///
+	/// The writer fills its own slot and swaps it with the shared one, the
+	/// reader swaps its own slot with the shared one if that holds a value it
+	/// has not seen yet. No slot is ever used by both sides at once.
+	/// </summary>
+	public class TripleBuffer<T>
+	{
+		private const int IndexMask = 3;
+		private const int Fresh = 4;
+
+		private readonly T[] _slots = new T[3];
+		// Index of the shared slot, plus Fresh if it was written since the
+		// reader took it last.
+		private int _shared;
+		private int _writeIndex = 1;
+		private int _readIndex = 2;
+
+		/// <summary>
+		/// Publishes a value, only called by the writer.
+		/// </summary>
+		public void Write(T value)
+		{
+			_slots[_writeIndex] = value;
+			_writeIndex = Interlocked.Exchange(ref _shared, _writeIndex | Fresh) & IndexMask;
+		}
+
+		/// <summary>
+		/// Gets the latest value, only called by the reader. Returns false and
+		/// the value read before if nothing was written since.
+		/// </summary>
+		public bool TryRead(out T value)
+		{
+			if ((Volatile.Read(ref _shared) & Fresh) == 0)
+			{
+				value = _slots[_readIndex];
+				return false;
+			}
+			_readIndex = Interlocked.Exchange(ref _shared, _readIndex) & IndexMask;
+			value = _slots[_readIndex];
+			return true;
+		}
+	}
+}
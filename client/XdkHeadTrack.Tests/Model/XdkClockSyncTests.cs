@@ -0,0 +1,194 @@
+﻿using System;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tests.Model
+{
+	[TestClass]
+	public class XdkClockSyncTests
+	{
+		// One way delays of the exchanges and the time the device takes to answer.
+		private const double RequestDelay = 400D;
+		private const double ResponseDelay = 600D;
+		private const double TurnaroundTime = 100D;
+
+		/// <summary>
+		/// Device clock that runs drift ppm fast and reads offset at host time 0,
+		/// all in microseconds.
+		/// </summary>
+		private class DeviceClock
+		{
+			public double Offset;
+			public double DriftPpm;
+
+			public uint At(double host)
+			{
+				return (uint)(long)Math.Round(Offset + host * (1D + DriftPpm / 1000000D));
+			}
+		}
+
+		private static long Ticks(double microseconds)
+		{
+			return HostClock.FromSeconds(microseconds / 1000000D);
+		}
+
+		private static bool Exchange(XdkClockSync sync, DeviceClock device, double host, double requestDelay = RequestDelay, double responseDelay = ResponseDelay)
+		{
+			double received = host + requestDelay;
+			double sent = received + TurnaroundTime;
+			return sync.AddExchange(Ticks(host), device.At(received), device.At(sent), Ticks(sent + responseDelay));
+		}
+
+		private static void AssertMaps(XdkClockSync sync, DeviceClock device, double host, double tolerance)
+		{
+			long hostTimestamp;
+			double errorBound;
+			Assert.IsTrue(sync.TryToHostTime(device.At(host), out hostTimestamp, out errorBound));
+			double error = HostClock.ToMicroseconds(hostTimestamp) - host;
+			Assert.AreEqual(0D, error, tolerance, "Mapping off by {0} us.", error);
+			Assert.IsTrue(Math.Abs(error) <= errorBound + 1D, "Error {0} us beyond bound {1} us.", error, errorBound);
+		}
+
+		[TestMethod]
+		public void NotSynchronizedWithoutExchange()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			long hostTimestamp;
+			double errorBound;
+			Assert.IsFalse(sync.IsSynchronized);
+			Assert.IsFalse(sync.TryToHostTime(1000, out hostTimestamp, out errorBound));
+			Assert.IsTrue(double.IsNaN(errorBound));
+		}
+
+		[TestMethod]
+		public void SingleExchangeIsWithinHalfRoundTrip()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			DeviceClock device = new DeviceClock { Offset = 5000000D };
+			Assert.IsTrue(Exchange(sync, device, 1000000D));
+
+			Assert.IsTrue(sync.IsSynchronized);
+			Assert.AreEqual(RequestDelay + ResponseDelay, sync.MinRoundTripMicroseconds, 1D);
+			// The asymmetry of the delays is what a single exchange cannot see.
+			Assert.AreEqual(5000000D - (ResponseDelay - RequestDelay) / 2D, sync.OffsetMicroseconds, 2D);
+			Assert.AreEqual((RequestDelay + ResponseDelay) / 2D, sync.ErrorBoundMicroseconds, 1D);
+			AssertMaps(sync, device, 1000000D, (RequestDelay + ResponseDelay) / 2D);
+		}
+
+		[TestMethod]
+		public void EstimatesDrift()
+		{
+			XdkClockSync sync = new XdkClockSync { DriftUncertaintyPpm = 0D };
+			DeviceClock device = new DeviceClock { Offset = 123456D, DriftPpm = 50D };
+			for (int i = 0; i < 60; i++)
+				Exchange(sync, device, i * 1000000D);
+
+			Assert.AreEqual(50D, sync.DriftPpm, 0.5D);
+			// One minute after the last exchange the drift adds 3 ms.
+			AssertMaps(sync, device, 120000000D, 150D);
+		}
+
+		[TestMethod]
+		public void AssumesNoDriftOverShortSpan()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			DeviceClock device = new DeviceClock { DriftPpm = 50D };
+			for (int i = 0; i < 10; i++)
+				Exchange(sync, device, i * 1000000D);
+
+			Assert.AreEqual(0D, sync.DriftPpm, 1E-9D);
+		}
+
+		[TestMethod]
+		public void PrefersFastExchanges()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			DeviceClock device = new DeviceClock { Offset = 1000000D };
+			for (int i = 0; i < 40; i++)
+			{
+				// Every other response is held up in the host's buffers.
+				double responseDelay = i % 2 == 0 ? RequestDelay : 20000D;
+				Exchange(sync, device, i * 500000D, RequestDelay, responseDelay);
+			}
+
+			Assert.AreEqual(2D * RequestDelay, sync.MinRoundTripMicroseconds, 1D);
+			Assert.AreEqual(1000000D, sync.OffsetMicroseconds, 5D);
+			AssertMaps(sync, device, 20000000D, 10D);
+		}
+
+		[TestMethod]
+		public void FollowsDeviceClockWrapAround()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			// The 32 bit microsecond clock wraps after 71.6 minutes.
+			DeviceClock device = new DeviceClock { Offset = uint.MaxValue - 5000000D };
+			for (int i = 0; i < 10; i++)
+				Exchange(sync, device, i * 1000000D);
+
+			Assert.AreEqual(0, sync.RestartCount);
+			AssertMaps(sync, device, 9500000D, (RequestDelay + ResponseDelay) / 2D);
+		}
+
+		[TestMethod]
+		public void DeviceRestartStartsOver()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			DeviceClock device = new DeviceClock { Offset = 60000000D };
+			for (int i = 0; i < 10; i++)
+				Exchange(sync, device, i * 1000000D);
+
+			device.Offset = -10000000D;
+			Exchange(sync, device, 10000000D);
+			Assert.AreEqual(1, sync.RestartCount);
+			Assert.AreEqual(11, sync.ExchangeCount);
+			AssertMaps(sync, device, 10000000D, (RequestDelay + ResponseDelay) / 2D);
+		}
+
+		[TestMethod]
+		public void RejectsImpossibleExchange()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			// The device claims to have taken longer than the whole round trip.
+			Assert.IsFalse(sync.AddExchange(Ticks(0D), 0, 2000, Ticks(1000D)));
+			Assert.IsFalse(sync.AddExchange(Ticks(1000D), 0, 0, Ticks(0D)));
+			Assert.IsFalse(sync.IsSynchronized);
+		}
+
+		[TestMethod]
+		public void ParsesResponse()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			long hostSent = Ticks(1000000D);
+			string request = XdkClockSync.CreateRequest(hostSent);
+			Assert.AreEqual("SYNC " + hostSent, request);
+
+			Assert.IsTrue(sync.TryAddResponse(request + " 4000400 4000500", Ticks(1001000D)));
+			Assert.AreEqual(1, sync.ExchangeCount);
+			Assert.AreEqual(900D, sync.MinRoundTripMicroseconds, 1D);
+		}
+
+		[TestMethod]
+		public void RejectsMalformedResponse()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			Assert.IsFalse(sync.TryAddResponse("SYNC 1 2", 10));
+			Assert.IsFalse(sync.TryAddResponse("SYNC 1 2 x", 10));
+			Assert.IsFalse(sync.TryAddResponse("SYNC -1 2 3", 10));
+			Assert.IsFalse(sync.TryAddResponse("RATE 1 2 3", 10));
+			Assert.AreEqual(0, sync.ExchangeCount);
+		}
+
+		[TestMethod]
+		public void ResetForgetsExchanges()
+		{
+			XdkClockSync sync = new XdkClockSync();
+			Exchange(sync, new DeviceClock(), 0D);
+			sync.Reset();
+
+			Assert.IsFalse(sync.IsSynchronized);
+			Assert.AreEqual(0, sync.ExchangeCount);
+			Assert.AreEqual(0D, sync.DriftPpm);
+		}
+	}
+}
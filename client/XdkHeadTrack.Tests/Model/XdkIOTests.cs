@@ -0,0 +1,56 @@
+﻿using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Tests.Model
+{
+	[TestClass]
+	public class XdkIOTests
+	{
+		/// <summary>
+		/// A handler waiting for another thread that feeds XdkIO, as one that
+		/// invokes on a busy dispatcher does, must not deadlock the reader.
+		/// </summary>
+		[TestMethod]
+		[Timeout(10000)]
+		public void RaisesRotationDataReceivedOutsideLock()
+		{
+			XdkIO io = new XdkIO();
+			int received = 0;
+			io.RotationDataReceived += (sender, e) =>
+			{
+				if (Interlocked.Increment(ref received) == 1)
+				{
+					Task other = Task.Run(() =>
+					{
+						io.ProcessRotation(Quaternion.Identity, false, 2);
+						io.IsLossConcealmentEnabled = true;
+						io.IsLossConcealmentEnabled = false;
+					});
+					Assert.IsTrue(other.Wait(5000), "Other thread blocked by the handler.");
+				}
+			};
+
+			io.ProcessRotation(Quaternion.Identity, false, 1);
+			Assert.AreEqual(2, received);
+		}
+
+		[TestMethod]
+		public void RaisesConcealedSamplesInOrder()
+		{
+			XdkIO io = new XdkIO();
+			io.IsLossConcealmentEnabled = true;
+			List<int> sequences = new List<int>();
+			io.RotationDataReceived += (sender, e) => sequences.Add(e.Sequence);
+
+			io.ProcessSample(XdkLink.Serial, Quaternion.Identity, false, 0, 0);
+			io.ProcessSample(XdkLink.Serial, Quaternion.Identity, false, 3, 3 * io.LossConcealer.SamplePeriod);
+			io.IsLossConcealmentEnabled = false;
+
+			Assert.AreEqual("0 1 2 3", string.Join(" ", sequences));
+		}
+	}
+}
@@ -0,0 +1,124 @@
+﻿using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tests.Model
+{
+	[TestClass]
+	public class XdkLinkMergerTests
+	{
+		private static readonly long Millisecond = HostClock.FromSeconds(0.001D);
+
+		[TestMethod]
+		public void FirstCopyWins()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 10, 0));
+			Assert.IsFalse(merger.Accept(XdkLink.Ble, 10, 5 * Millisecond));
+			Assert.IsTrue(merger.Accept(XdkLink.Ble, 11, 20 * Millisecond));
+			Assert.IsFalse(merger.Accept(XdkLink.Serial, 11, 21 * Millisecond));
+
+			XdkLinkStatistics serial = merger.GetStatistics(XdkLink.Serial);
+			Assert.AreEqual(1, serial.FirstArrivals);
+			Assert.AreEqual(1, serial.LateArrivals);
+			Assert.AreEqual(21 * Millisecond, serial.LastArrival);
+			Assert.AreEqual(0.5D, serial.WinRate);
+		}
+
+		[TestMethod]
+		public void MeasuresLagOfLateCopies()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			merger.Accept(XdkLink.Serial, 0, 0);
+			merger.Accept(XdkLink.Ble, 0, 2 * Millisecond);
+			merger.Accept(XdkLink.Serial, 1, 20 * Millisecond);
+			merger.Accept(XdkLink.Ble, 1, 26 * Millisecond);
+
+			XdkLinkStatistics ble = merger.GetStatistics(XdkLink.Ble);
+			Assert.AreEqual(0, ble.FirstArrivals);
+			Assert.AreEqual(2, ble.LateArrivals);
+			Assert.AreEqual(4000D, ble.MeanLagMicroseconds, 1D);
+			Assert.AreEqual(6000D, ble.MaxLagMicroseconds, 1D);
+			Assert.AreEqual(0D, merger.GetStatistics(XdkLink.Serial).MeanLagMicroseconds);
+		}
+
+		[TestMethod]
+		public void LostCopyIsFilledByOtherLink()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			int used = 0;
+			for (int sequence = 0; sequence < 100; sequence++)
+			{
+				// Each link drops a different third of the samples.
+				if (sequence % 3 != 0 && merger.Accept(XdkLink.Serial, sequence, sequence))
+					used++;
+				if (sequence % 3 != 1 && merger.Accept(XdkLink.Ble, sequence, sequence))
+					used++;
+			}
+			Assert.AreEqual(100, used);
+		}
+
+		[TestMethod]
+		public void SequenceWrapsAround()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 65534, 0));
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 65535, 1));
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 0, 2));
+			Assert.IsFalse(merger.Accept(XdkLink.Ble, 65535, 3));
+			Assert.IsFalse(merger.Accept(XdkLink.Ble, 0, 4));
+			Assert.IsTrue(merger.Accept(XdkLink.Ble, 1, 5));
+		}
+
+		[TestMethod]
+		public void ReorderedSampleIsStillUsed()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 5, 0));
+			Assert.IsTrue(merger.Accept(XdkLink.Ble, 3, 1));
+			Assert.IsFalse(merger.Accept(XdkLink.Serial, 3, 2));
+		}
+
+		[TestMethod]
+		public void SampleFarBehindIsRestart()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			for (int sequence = 0; sequence < 2000; sequence++)
+				merger.Accept(XdkLink.Serial, sequence, sequence);
+
+			// The device restarted and counts from 0 again.
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 0, 2000));
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 1, 2001));
+			Assert.IsFalse(merger.Accept(XdkLink.Ble, 1, 2002));
+		}
+
+		[TestMethod]
+		public void ShortRunRestartIsDetected()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			for (int sequence = 0; sequence < 100; sequence++)
+				merger.Accept(XdkLink.Serial, sequence, sequence * 20 * Millisecond);
+
+			// The device restarted well before it had sent WindowSize samples.
+			long restart = 100 * 20 * Millisecond + merger.RestartAfter;
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 0, restart));
+			Assert.IsTrue(merger.Accept(XdkLink.Serial, 1, restart + 20 * Millisecond));
+			Assert.IsFalse(merger.Accept(XdkLink.Ble, 1, restart + 22 * Millisecond));
+			Assert.AreEqual(1, merger.RestartCount);
+		}
+
+		[TestMethod]
+		public void ResetForgetsSamplesAndStatistics()
+		{
+			XdkLinkMerger merger = new XdkLinkMerger();
+			merger.Accept(XdkLink.Serial, 7, 0);
+			merger.Accept(XdkLink.Ble, 7, 1);
+			merger.Reset();
+
+			Assert.IsTrue(merger.Accept(XdkLink.Ble, 7, 2));
+			Assert.AreEqual(0, merger.GetStatistics(XdkLink.Serial).Arrivals);
+			Assert.AreEqual(1, merger.GetStatistics(XdkLink.Ble).Arrivals);
+			Assert.AreEqual(0, merger.GetStatistics(XdkLink.Ble).LateArrivals);
+		}
+	}
+}
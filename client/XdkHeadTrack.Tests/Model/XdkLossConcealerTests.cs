@@ -0,0 +1,334 @@
+﻿using System;
+using System.Collections.Generic;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tests.Model
+{
+	[TestClass]
+	public class XdkLossConcealerTests
+	{
+		private static readonly long Period = HostClock.FromSeconds(0.02D);
+
+		private struct Sample
+		{
+			public int Sequence;
+			public Quaternion Rotation;
+			public XdkSampleOrigin Origin;
+			public long Timestamp;
+		}
+
+		private readonly List<Sample> _output = new List<Sample>();
+
+		private XdkLossConcealer CreateConcealer()
+		{
+			_output.Clear();
+			return new XdkLossConcealer
+			{
+				SamplePeriod = Period,
+				Output = (sequence, rotation, origin, timestamp) => _output.Add(new Sample
+				{
+					Sequence = sequence,
+					Rotation = rotation,
+					Origin = origin,
+					Timestamp = timestamp,
+				}),
+			};
+		}
+
+		private static Quaternion Yaw(double degrees)
+		{
+			return new Quaternion(new Vector3D(0D, 0D, 1D), degrees);
+		}
+
+		private static void AssertYaw(double degrees, Quaternion actual, double tolerance = 0.01D)
+		{
+			Quaternion difference = Yaw(degrees);
+			difference.Invert();
+			difference = difference * actual;
+			Assert.AreEqual(0D, 360D - difference.Angle < difference.Angle ? 360D - difference.Angle : difference.Angle, tolerance,
+				"Expected yaw {0}, got {1}.", degrees, actual);
+		}
+
+		private static void Receive(XdkLossConcealer concealer, int sequence, double degrees, long timestamp)
+		{
+			concealer.Receive(sequence, Yaw(degrees), false, Quaternion.Identity, timestamp);
+		}
+
+		private static void Receive(XdkLossConcealer concealer, int sequence, double degrees, double previousDegrees, long timestamp)
+		{
+			concealer.Receive(sequence, Yaw(degrees), true, Yaw(previousDegrees), timestamp);
+		}
+
+		[TestMethod]
+		public void PassesCompleteStream()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			for (int sequence = 0; sequence < 5; sequence++)
+				Receive(concealer, sequence, sequence, sequence * Period);
+
+			Assert.AreEqual(5, _output.Count);
+			for (int i = 0; i < 5; i++)
+			{
+				Assert.AreEqual(i, _output[i].Sequence);
+				Assert.AreEqual(XdkSampleOrigin.Received, _output[i].Origin);
+			}
+			Assert.AreEqual(5, concealer.ReceivedCount);
+			Assert.AreEqual(0, concealer.ConcealedCount);
+		}
+
+		[TestMethod]
+		public void RecoversLostSampleFromNextFrame()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 0, 0D, 0);
+			Receive(concealer, 2, 20D, 10D, 2 * Period);
+
+			Assert.AreEqual(3, _output.Count);
+			Assert.AreEqual(1, _output[1].Sequence);
+			Assert.AreEqual(XdkSampleOrigin.Recovered, _output[1].Origin);
+			AssertYaw(10D, _output[1].Rotation);
+			Assert.AreEqual(2, _output[2].Sequence);
+			Assert.AreEqual(XdkSampleOrigin.Received, _output[2].Origin);
+			Assert.AreEqual(1, concealer.RecoveredCount);
+		}
+
+		[TestMethod]
+		public void ExtrapolatesGapWithLastVelocity()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 0, 0D, 0);
+			Receive(concealer, 1, 10D, Period);
+			Receive(concealer, 4, 40D, 4 * Period);
+
+			Assert.AreEqual(5, _output.Count);
+			Assert.AreEqual(XdkSampleOrigin.Concealed, _output[2].Origin);
+			AssertYaw(20D, _output[2].Rotation);
+			Assert.AreEqual(XdkSampleOrigin.Concealed, _output[3].Origin);
+			AssertYaw(30D, _output[3].Rotation);
+			Assert.AreEqual(4, _output[4].Sequence);
+			Assert.AreEqual(2, concealer.ConcealedCount);
+		}
+
+		[TestMethod]
+		public void DropsDuplicatesAndOldSamples()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 4, 0D, 0);
+			Receive(concealer, 5, 0D, Period);
+			Receive(concealer, 5, 0D, Period);
+			Receive(concealer, 3, 0D, Period);
+
+			Assert.AreEqual(2, _output.Count);
+			Assert.AreEqual(2, concealer.DuplicateCount);
+		}
+
+		[TestMethod]
+		public void SequenceWrapsAround()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 65535, 0D, 0);
+			Receive(concealer, 1, 2D, 1D, 2 * Period);
+
+			Assert.AreEqual(3, _output.Count);
+			Assert.AreEqual(0, _output[1].Sequence);
+			Assert.AreEqual(XdkSampleOrigin.Recovered, _output[1].Origin);
+			Assert.AreEqual(1, _output[2].Sequence);
+		}
+
+		[TestMethod]
+		public void LargeGapIsRestart()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 100, 0D, 0);
+			Receive(concealer, 100 + XdkLossConcealer.MaxGap + 1, 0D, Period);
+
+			Assert.AreEqual(2, _output.Count);
+			Assert.AreEqual(0, concealer.ConcealedCount);
+		}
+
+		[TestMethod]
+		public void ShortRunRestartIsDetected()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			for (int sequence = 0; sequence < 10; sequence++)
+				Receive(concealer, sequence, sequence, sequence * Period);
+
+			// The device restarted before it had sent MaxGap samples.
+			long restart = 10 * Period + XdkLossConcealer.MaxGap * Period;
+			Receive(concealer, 0, 0D, restart);
+			Receive(concealer, 1, 1D, restart + Period);
+
+			Assert.AreEqual(12, _output.Count);
+			Assert.AreEqual(0, _output[10].Sequence);
+			Assert.AreEqual(XdkSampleOrigin.Received, _output[10].Origin);
+			Assert.AreEqual(1, _output[11].Sequence);
+			Assert.AreEqual(0, concealer.DuplicateCount);
+		}
+
+		[TestMethod]
+		public void RestartForgetsStreamButKeepsCounters()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 40, 0D, 0);
+			Receive(concealer, 41, 0D, Period);
+			concealer.Restart();
+			Receive(concealer, 0, 0D, 2 * Period);
+
+			Assert.AreEqual(3, _output.Count);
+			Assert.AreEqual(0, _output[2].Sequence);
+			Assert.AreEqual(3, concealer.ReceivedCount);
+		}
+
+		[TestMethod]
+		public void TickConcealsOverdueSample()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 0, 0D, 0);
+			Receive(concealer, 1, 10D, Period);
+
+			// Sample 2 is concealed 1.5 periods after sample 1 arrived.
+			concealer.Tick(Period + (long)(1.5D * Period) - 1);
+			Assert.AreEqual(2, _output.Count);
+			concealer.Tick(Period + (long)(1.5D * Period));
+			Assert.AreEqual(3, _output.Count);
+			Assert.AreEqual(2, _output[2].Sequence);
+			Assert.AreEqual(XdkSampleOrigin.Concealed, _output[2].Origin);
+			AssertYaw(20D, _output[2].Rotation);
+
+			// The late sample still follows its concealed stand-in.
+			Receive(concealer, 2, 21D, 4 * Period);
+			Assert.AreEqual(4, _output.Count);
+			Assert.AreEqual(2, _output[3].Sequence);
+			Assert.AreEqual(XdkSampleOrigin.Received, _output[3].Origin);
+		}
+
+		[TestMethod]
+		public void TickWaitsForRedundantCopy()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 0, 0D, 0);
+			Receive(concealer, 1, 10D, 0D, Period);
+
+			concealer.Tick(Period + (long)(2.5D * Period) - 1);
+			Assert.AreEqual(2, _output.Count);
+			concealer.Tick(Period + (long)(2.5D * Period));
+			Assert.AreEqual(3, _output.Count);
+		}
+
+		[TestMethod]
+		public void TickStopsAfterMaxConcealedSamples()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			Receive(concealer, 0, 0D, 0);
+			Receive(concealer, 1, 10D, Period);
+
+			concealer.Tick(1000 * Period);
+			concealer.Tick(2000 * Period);
+			Assert.AreEqual(concealer.MaxConcealedSamples, concealer.ConcealedCount);
+			Assert.AreEqual(1 + concealer.MaxConcealedSamples, _output[_output.Count - 1].Sequence);
+		}
+
+		[TestMethod]
+		public void TickDoesNothingBeforeFirstSample()
+		{
+			XdkLossConcealer concealer = CreateConcealer();
+			concealer.Tick(1000 * Period);
+			Assert.AreEqual(0, _output.Count);
+		}
+
+		[TestMethod]
+		public void ReplaysPeriodicLoss()
+		{
+			Replay((random, i) => i % 10 == 0);
+		}
+
+		[TestMethod]
+		public void ReplaysRandomLoss()
+		{
+			Replay((random, i) => random.NextDouble() < 0.05D);
+		}
+
+		[TestMethod]
+		public void ReplaysBurstLoss()
+		{
+			Replay((random, i) => i % 37 > 33);
+		}
+
+		/// <summary>
+		/// Sends a constant rate yaw through compact BLE frames, drops the ones
+		/// isLost picks and ticks the concealer twice per period as XdkIO does.
+		/// Every sample has to come out, in order, close to the truth, and a
+		/// single lost frame has to be recovered if the next one carries its copy.
+		/// </summary>
+		private void Replay(Func<Random, int, bool> isLost)
+		{
+			const int Count = 2000;
+			const double DegreesPerSample = 0.7D;
+
+			foreach (bool isRedundant in new[] { true, false })
+			{
+				bool[] lost = new bool[Count];
+				Random random = new Random(1);
+				// The stream starts with two received frames, to know the velocity,
+				// and ends with one.
+				for (int i = 2; i < Count - 1; i++)
+					lost[i] = isLost(random, i);
+
+				XdkLossConcealer concealer = CreateConcealer();
+				byte[] frame = new byte[XdkBleFrame.CompactSize];
+				long nextTick = 0;
+				for (int i = 0; i < Count; i++)
+				{
+					long arrival = i * Period;
+					for (; nextTick < arrival; nextTick += Period / 2)
+						concealer.Tick(nextTick);
+					if (lost[i])
+						continue;
+
+					XdkBleFrame.EncodeCompact(Yaw(i * DegreesPerSample), false, i & 0xFFFF,
+						isRedundant && i > 0, Yaw((i - 1) * DegreesPerSample), frame, 0);
+					Quaternion rotation, previous;
+					bool isCalibration, hasPrevious;
+					int sequence;
+					Assert.IsTrue(XdkBleFrame.TryDecodeCompact(frame, 0, frame.Length, out rotation, out isCalibration, out sequence, out hasPrevious, out previous));
+					concealer.Receive(sequence, rotation, hasPrevious, previous, arrival);
+				}
+
+				// What a consumer saw first of every sample.
+				Sample?[] seen = new Sample?[Count];
+				int newest = -1;
+				foreach (Sample sample in _output)
+				{
+					if (seen[sample.Sequence] != null)
+						continue;
+					Assert.AreEqual(newest + 1, sample.Sequence, "Sample skipped.");
+					seen[sample.Sequence] = sample;
+					newest = sample.Sequence;
+				}
+				Assert.AreEqual(Count - 1, newest);
+
+				int lostCount = 0;
+				for (int i = 0; i < Count; i++)
+				{
+					Sample sample = seen[i].Value;
+					Assert.AreEqual(lost[i], sample.Origin != XdkSampleOrigin.Received);
+					// The error of the compact format adds up over the extrapolated steps.
+					AssertYaw(i * DegreesPerSample, sample.Rotation, lost[i] ? 0.05D : 0.01D);
+					if (!lost[i])
+						continue;
+					lostCount++;
+					if (isRedundant && !lost[i + 1])
+						Assert.AreEqual(XdkSampleOrigin.Recovered, sample.Origin);
+					else
+						Assert.AreEqual(XdkSampleOrigin.Concealed, sample.Origin);
+				}
+				Assert.IsTrue(lostCount > 0);
+				Assert.AreEqual(Count - lostCount, concealer.ReceivedCount);
+				Assert.AreEqual(0, concealer.DuplicateCount);
+			}
+		}
+	}
+}
@@ -0,0 +1,75 @@
+﻿using System;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Tests.Numerics
+{
+	[TestClass]
+	public class QuaternionTests
+	{
+		private const double Tolerance = 1E-9D;
+
+		private static void AssertEqual(Quaternion expected, Quaternion actual)
+		{
+			Assert.AreEqual(expected.X, actual.X, Tolerance, "X");
+			Assert.AreEqual(expected.Y, actual.Y, Tolerance, "Y");
+			Assert.AreEqual(expected.Z, actual.Z, Tolerance, "Z");
+			Assert.AreEqual(expected.W, actual.W, Tolerance, "W");
+		}
+
+		[TestMethod]
+		public void DefaultIsIdentity()
+		{
+			Quaternion q = default(Quaternion);
+
+			Assert.IsTrue(q.IsIdentity);
+			Assert.AreEqual(1D, q.W);
+			Assert.AreEqual(0D, q.Angle);
+			Assert.AreEqual(Quaternion.Identity, new Quaternion(0D, 0D, 0D, 1D));
+
+			q.X = 0.5D;
+			Assert.AreEqual(1D, q.W);
+			Assert.IsFalse(q.IsIdentity);
+		}
+
+		[TestMethod]
+		public void AxisAngleRoundTrips()
+		{
+			Quaternion q = new Quaternion(new Vector3D(0D, 0D, 2D), 90D);
+
+			AssertEqual(new Quaternion(0D, 0D, Math.Sqrt(0.5D), Math.Sqrt(0.5D)), q);
+			Assert.AreEqual(90D, q.Angle, Tolerance);
+			Assert.AreEqual(new Vector3D(0D, 0D, 1D), q.Axis);
+		}
+
+		[TestMethod]
+		public void MultiplyComposesRotations()
+		{
+			Quaternion x90 = new Quaternion(new Vector3D(1D, 0D, 0D), 90D);
+			Quaternion y90 = new Quaternion(new Vector3D(0D, 1D, 0D), 90D);
+
+			AssertEqual(new Quaternion(0.5D, 0.5D, 0.5D, 0.5D), x90 * y90);
+			AssertEqual(new Quaternion(0.5D, 0.5D, -0.5D, 0.5D), y90 * x90);
+			AssertEqual(x90, Quaternion.Identity * x90);
+
+			Quaternion inverse = x90;
+			inverse.Invert();
+			AssertEqual(new Quaternion(0D, 0D, 0D, 1D), x90 * inverse);
+		}
+
+		[TestMethod]
+		public void SlerpTakesShortestPath()
+		{
+			Quaternion from = new Quaternion(new Vector3D(0D, 0D, 1D), 10D);
+			Quaternion to = new Quaternion(new Vector3D(0D, 0D, 1D), 50D);
+
+			AssertEqual(from, Quaternion.Slerp(from, to, 0D));
+			AssertEqual(to, Quaternion.Slerp(from, to, 1D));
+			Assert.AreEqual(30D, Quaternion.Slerp(from, to, 0.5D).Angle, Tolerance);
+
+			// The negated quaternion is the same rotation; slerp must not go the long way round.
+			Quaternion negated = new Quaternion(-to.X, -to.Y, -to.Z, -to.W);
+			Assert.AreEqual(30D, Quaternion.Slerp(from, negated, 0.5D).Angle, Tolerance);
+		}
+	}
+}
@@ -0,0 +1,120 @@
+﻿using System;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tests.Utils
+{
+	[TestClass]
+	public class SpscQueueTests
+	{
+		private const int StressItems = 1000000;
+
+		[TestMethod]
+		public void CapacityIsRoundedUpToPowerOfTwo()
+		{
+			Assert.AreEqual(1, new SpscQueue<int>(1).Capacity);
+			Assert.AreEqual(8, new SpscQueue<int>(5).Capacity);
+			Assert.AreEqual(1024, new SpscQueue<int>(1024).Capacity);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ArgumentOutOfRangeException))]
+		public void RejectsZeroCapacity()
+		{
+			new SpscQueue<int>(0);
+		}
+
+		[TestMethod]
+		public void RejectsItemsWhenFull()
+		{
+			SpscQueue<int> queue = new SpscQueue<int>(4);
+			for (int i = 0; i < 4; i++)
+				Assert.IsTrue(queue.TryEnqueue(i));
+			Assert.IsFalse(queue.TryEnqueue(4));
+			Assert.AreEqual(4, queue.Count);
+
+			int item;
+			Assert.IsTrue(queue.TryDequeue(out item));
+			Assert.AreEqual(0, item);
+			Assert.IsTrue(queue.TryEnqueue(4));
+		}
+
+		[TestMethod]
+		public void KeepsOrderAcrossWrapAround()
+		{
+			SpscQueue<int> queue = new SpscQueue<int>(4);
+			int next = 0;
+			int expected = 0;
+			for (int round = 0; round < 100; round++)
+			{
+				while (queue.TryEnqueue(next))
+					next++;
+				int item;
+				for (int i = 0; i < 3; i++)
+				{
+					Assert.IsTrue(queue.TryDequeue(out item));
+					Assert.AreEqual(expected++, item);
+				}
+			}
+		}
+
+		[TestMethod]
+		public void DequeueFromEmptyFails()
+		{
+			SpscQueue<string> queue = new SpscQueue<string>(2);
+			string item;
+			Assert.IsFalse(queue.TryDequeue(out item));
+			Assert.IsNull(item);
+			Assert.IsTrue(queue.IsEmpty);
+		}
+
+		/// <summary>
+		/// One producer and one consumer thread race through a small queue, so
+		/// both sides wrap around and see it full and empty many times. Every
+		/// item has to arrive exactly once and in order. Both yield while they
+		/// wait, or a single core machine would only switch on its time slices.
+		/// </summary>
+		[TestMethod]
+		[Timeout(60000)]
+		public void StressOneProducerOneConsumer()
+		{
+			SpscQueue<long> queue = new SpscQueue<long>(64);
+			long rejected = 0;
+			Thread producer = new Thread(() =>
+			{
+				for (long i = 0; i < StressItems; i++)
+				{
+					while (!queue.TryEnqueue(i))
+					{
+						rejected++;
+						Thread.Yield();
+					}
+				}
+			});
+
+			long expected = 0;
+			long empty = 0;
+			producer.Start();
+			while (expected < StressItems)
+			{
+				long item;
+				if (!queue.TryDequeue(out item))
+				{
+					empty++;
+					Thread.Yield();
+					continue;
+				}
+				if (item != expected)
+					Assert.Fail("Expected item {0}, got {1}.", expected, item);
+				expected++;
+			}
+			producer.Join();
+
+			long last;
+			Assert.IsFalse(queue.TryDequeue(out last));
+			Assert.IsTrue(queue.IsEmpty);
+			Console.WriteLine("full {0}, empty {1}", rejected, empty);
+		}
+	}
+}
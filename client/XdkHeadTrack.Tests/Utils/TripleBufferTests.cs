@@ -0,0 +1,122 @@
+﻿using System;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tests.Utils
+{
+	[TestClass]
+	public class TripleBufferTests
+	{
+		private const int StressWrites = 1000000;
+
+		// Too wide to be written atomically, a torn read mixes two writes.
+		private struct Pose
+		{
+			public long Sequence;
+			public long Check;
+			public double Angle;
+
+			public Pose(long sequence)
+			{
+				Sequence = sequence;
+				Check = ~sequence;
+				Angle = sequence * 0.5D;
+			}
+
+			public bool IsWhole => Check == ~Sequence && Angle == Sequence * 0.5D;
+		}
+
+		[TestMethod]
+		public void ReadsNothingBeforeFirstWrite()
+		{
+			TripleBuffer<int> buffer = new TripleBuffer<int>();
+			int value;
+			Assert.IsFalse(buffer.TryRead(out value));
+			Assert.AreEqual(0, value);
+		}
+
+		[TestMethod]
+		public void ReadsLatestWrite()
+		{
+			TripleBuffer<int> buffer = new TripleBuffer<int>();
+			buffer.Write(1);
+			buffer.Write(2);
+			buffer.Write(3);
+
+			int value;
+			Assert.IsTrue(buffer.TryRead(out value));
+			Assert.AreEqual(3, value);
+		}
+
+		[TestMethod]
+		public void KeepsLastValueUntilNextWrite()
+		{
+			TripleBuffer<int> buffer = new TripleBuffer<int>();
+			buffer.Write(7);
+
+			int value;
+			Assert.IsTrue(buffer.TryRead(out value));
+			Assert.IsFalse(buffer.TryRead(out value));
+			Assert.AreEqual(7, value);
+
+			buffer.Write(8);
+			Assert.IsTrue(buffer.TryRead(out value));
+			Assert.AreEqual(8, value);
+		}
+
+		/// <summary>
+		/// A writer thread publishes as fast as it can while the reader polls.
+		/// The reader has to see whole values only, never an older value after
+		/// a newer one, and in the end the last value written. The writer yields
+		/// now and then, so the reader also runs on a single core machine.
+		/// </summary>
+		[TestMethod]
+		[Timeout(60000)]
+		public void StressOneWriterOneReader()
+		{
+			TripleBuffer<Pose> buffer = new TripleBuffer<Pose>();
+			bool isDone = false;
+			Thread writer = new Thread(() =>
+			{
+				for (long i = 1; i <= StressWrites; i++)
+				{
+					buffer.Write(new Pose(i));
+					if (i % 64 == 0)
+						Thread.Yield();
+				}
+				Volatile.Write(ref isDone, true);
+			});
+
+			long newest = 0;
+			long reads = 0;
+			writer.Start();
+			while (true)
+			{
+				bool wasDone = Volatile.Read(ref isDone);
+				Pose pose;
+				if (buffer.TryRead(out pose))
+				{
+					if (!pose.IsWhole)
+						Assert.Fail("Torn value {0}/{1}/{2}.", pose.Sequence, ~pose.Check, pose.Angle);
+					if (pose.Sequence <= newest)
+						Assert.Fail("Read {0} after {1}.", pose.Sequence, newest);
+					newest = pose.Sequence;
+					reads++;
+				}
+				else if (wasDone)
+				{
+					break;
+				}
+				else
+				{
+					Thread.Yield();
+				}
+			}
+			writer.Join();
+
+			Assert.AreEqual(StressWrites, newest);
+			Console.WriteLine("reads {0}", reads);
+		}
+	}
+}
@@ -0,0 +1,142 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.IO.Pipes;
+using System.Linq;
+using System.Threading.Tasks;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Scaling benchmark of the XdkAggregator. A sim-fleet child process streams
+	/// N devices over named pipes, the host measures its own CPU time and the
+	/// latency from the device write to the aggregator output of every sample.
+	///
+	/// Usage: aggregator-bench [duration-s] [rate-hz] [max-devices]
+	/// Prints one JSON line per device count.
+	/// </summary>
+	public static class AggregatorBenchmark
+	{
+		private static readonly int[] DeviceCounts = { 1, 2, 4, 8, 16, 32, 48, 64 };
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 5D;
+			double rate = args.Length > 1 ? double.Parse(args[1], CultureInfo.InvariantCulture) : 100D;
+			int maxDevices = args.Length > 2 ? int.Parse(args[2], CultureInfo.InvariantCulture) : 64;
+
+			foreach (int deviceCount in DeviceCounts.Where(n => n <= maxDevices))
+				Console.WriteLine(RunOnce(deviceCount, rate, duration));
+			return 0;
+		}
+
+		private static BenchmarkReport RunOnce(int deviceCount, double rate, double duration)
+		{
+			int count = (int)(duration * rate);
+			long[][] received = new long[deviceCount][];
+			for (int i = 0; i < deviceCount; i++)
+				received[i] = new long[count];
+
+			string prefix = string.Format(CultureInfo.InvariantCulture, "xdkagg-{0}-{1}-", Process.GetCurrentProcess().Id, deviceCount);
+			string logPath = Path.GetTempFileName();
+			NamedPipeServerStream[] pipes = new NamedPipeServerStream[deviceCount];
+			for (int i = 0; i < deviceCount; i++)
+				pipes[i] = new NamedPipeServerStream(prefix + i.ToString(CultureInfo.InvariantCulture), PipeDirection.In, 1, PipeTransmissionMode.Byte, PipeOptions.Asynchronous);
+			Task[] connected = pipes.Select(p => p.WaitForConnectionAsync()).ToArray();
+
+			TimeSpan cpu;
+			double wall;
+			int threads;
+			using (Process fleet = StartFleet(prefix, deviceCount, rate, duration, logPath))
+			using (XdkAggregator aggregator = new XdkAggregator())
+			{
+				Task.WaitAll(connected);
+				aggregator.RotationReceived += (o, e) =>
+				{
+					long timestamp = HostClock.Now;
+					long seq = e.Device.SampleCount - 1;
+					if (seq < count)
+						received[e.Device.Id][seq] = timestamp;
+				};
+
+				TimeSpan cpuBefore = Process.GetCurrentProcess().TotalProcessorTime;
+				long wallBefore = HostClock.Now;
+				for (int i = 0; i < deviceCount; i++)
+					aggregator.Add("sim" + i.ToString(CultureInfo.InvariantCulture), pipes[i]);
+
+				fleet.WaitForExit();
+				aggregator.Completion.Wait();
+				Process self = Process.GetCurrentProcess();
+				cpu = self.TotalProcessorTime - cpuBefore;
+				wall = HostClock.ToSeconds(HostClock.Now - wallBefore);
+				threads = self.Threads.Count;
+			}
+
+			long[][] sent = LoadSent(logPath, deviceCount, count);
+			File.Delete(logPath);
+
+			int sentCount = 0;
+			List<double> latencies = new List<double>(deviceCount * count);
+			for (int device = 0; device < deviceCount; device++)
+			{
+				for (int seq = 0; seq < count; seq++)
+				{
+					if (sent[device][seq] == 0)
+						continue;
+					sentCount++;
+					if (received[device][seq] != 0)
+						latencies.Add(HostClock.ToMicroseconds(received[device][seq] - sent[device][seq]));
+				}
+			}
+			latencies.Sort();
+
+			return new BenchmarkReport()
+				.Add("benchmark", "aggregator")
+				.Add("devices", deviceCount)
+				.Add("rate_hz", rate)
+				.Add("sent", sentCount)
+				.Add("received", latencies.Count)
+				.Add("drop_rate", sentCount > 0 ? 1D - latencies.Count / (double)sentCount : double.NaN)
+				.AddPercentiles("latency_us", latencies)
+				.Add("host_cpu_us_per_sample", sentCount > 0 ? cpu.TotalMilliseconds * 1000D / sentCount : double.NaN)
+				.Add("host_cpu_pct_per_device", cpu.TotalSeconds / wall / deviceCount * 100D)
+				.Add("host_threads", threads);
+		}
+
+		private static Process StartFleet(string prefix, int deviceCount, double rate, double duration, string logPath)
+		{
+			ProcessStartInfo info = new ProcessStartInfo(Process.GetCurrentProcess().MainModule.FileName,
+				string.Format(CultureInfo.InvariantCulture, "sim-fleet {0} {1} {2} {3} \"{4}\"", prefix, deviceCount, rate, duration, logPath));
+			info.UseShellExecute = false;
+			info.CreateNoWindow = true;
+			return Process.Start(info);
+		}
+
+		private static long[][] LoadSent(string path, int deviceCount, int count)
+		{
+			long[][] sent = new long[deviceCount][];
+			for (int i = 0; i < deviceCount; i++)
+				sent[i] = new long[count];
+
+			foreach (string line in File.ReadLines(path))
+			{
+				string[] parts = line.Split(' ');
+				int device, seq;
+				long timestamp;
+				if (parts.Length == 3
+					&& int.TryParse(parts[0], NumberStyles.Integer, CultureInfo.InvariantCulture, out device)
+					&& int.TryParse(parts[1], NumberStyles.Integer, CultureInfo.InvariantCulture, out seq)
+					&& long.TryParse(parts[2], NumberStyles.Integer, CultureInfo.InvariantCulture, out timestamp)
+					&& device >= 0 && device < deviceCount && seq >= 0 && seq < count)
+				{
+					sent[device][seq] = timestamp;
+				}
+			}
+			return sent;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Text;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Builds one flat JSON object per result, so that benchmark output can be
+	/// collected as JSON lines and compared across releases.
+	/// </summary>
+	public class BenchmarkReport
+	{
+		private readonly StringBuilder _builder = new StringBuilder("{");
+
+		public BenchmarkReport Add(string key, string value)
+		{
+			AppendKey(key);
+			_builder.Append('"').Append(value.Replace("\\", "\\\\").Replace("\"", "\\\"")).Append('"');
+			return this;
+		}
+
+		public BenchmarkReport Add(string key, double value)
+		{
+			AppendKey(key);
+			if (double.IsNaN(value) || double.IsInfinity(value))
+				_builder.Append("null");
+			else
+				_builder.Append(value.ToString("R", CultureInfo.InvariantCulture));
+			return this;
+		}
+
+		public BenchmarkReport Add(string key, long value)
+		{
+			AppendKey(key);
+			_builder.Append(value.ToString(CultureInfo.InvariantCulture));
+			return this;
+		}
+
+		public BenchmarkReport AddPercentiles(string prefix, IList<double> sorted)
+		{
+			Add(prefix + "_p50", Percentile(sorted, 0.5D));
+			Add(prefix + "_p90", Percentile(sorted, 0.9D));
+			Add(prefix + "_p99", Percentile(sorted, 0.99D));
+			Add(prefix + "_p999", Percentile(sorted, 0.999D));
+			Add(prefix + "_max", sorted.Count > 0 ? sorted[sorted.Count - 1] : double.NaN);
+			return this;
+		}
+
+		public override string ToString()
+		{
+			return _builder.ToString() + "}";
+		}
+
+		public static double Percentile(IList<double> sorted, double p)
+		{
+			if (sorted.Count == 0)
+				return double.NaN;
+			int index = (int)Math.Ceiling(p * sorted.Count) - 1;
+			return sorted[Math.Max(0, Math.Min(sorted.Count - 1, index))];
+		}
+
+		private void AppendKey(string key)
+		{
+			if (_builder.Length > 1)
+				_builder.Append(',');
+			_builder.Append('"').Append(key).Append("\":");
+		}
+	}
+}
@@ -0,0 +1,93 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Replays SYNC exchanges against a simulated device clock with offset,
+	/// drift and a 32 bit microsecond counter that wraps during the run. The
+	/// USB delays are asymmetric (responses wait for the serial mux writer)
+	/// and some exchanges are delayed a lot, as when the host is busy. The
+	/// device times of 50 Hz samples are mapped through XdkClockSync and the
+	/// result compared with the true host time of the samples.
+	///
+	/// Usage: clock-sync-sim [duration-s] [drift-ppm] [interval-s] [seed]
+	/// Prints one JSON line.
+	/// </summary>
+	public static class ClockSyncBenchmark
+	{
+		private const double SampleRate = 50D;
+		private const double OutlierProbability = 0.05D;
+		private const double OutlierDelaySeconds = 0.02D;
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 600D;
+			double driftPpm = args.Length > 1 ? double.Parse(args[1], CultureInfo.InvariantCulture) : 40D;
+			double interval = args.Length > 2 ? double.Parse(args[2], CultureInfo.InvariantCulture) : 1D;
+			Random random = new Random(args.Length > 3 ? int.Parse(args[3], CultureInfo.InvariantCulture) : 1);
+
+			// Starts shortly before the device counter wraps.
+			double deviceStart = uint.MaxValue - 30D * 1000000D;
+			double hostStart = 1000D;
+			Func<double, uint> deviceClock = t => (uint)(long)(deviceStart + (t - hostStart) * 1000000D * (1D + driftPpm / 1000000D));
+
+			XdkClockSync sync = new XdkClockSync();
+			List<double> errors = new List<double>();
+			List<double> bounds = new List<double>();
+			long outsideBound = 0;
+			double nextSample = hostStart;
+
+			for (double t1 = hostStart; t1 < hostStart + duration; t1 += interval)
+			{
+				double t2 = t1 + Delay(random, 0.0003D, 0.0005D);
+				double t3 = t2 + 0.0001D + random.NextDouble() * 0.0005D;
+				double t4 = t3 + Delay(random, 0.0003D, 0.0015D);
+
+				// Samples taken until this exchange completes use the estimate so far.
+				for (; nextSample < t4; nextSample += 1D / SampleRate)
+				{
+					long mapped;
+					double bound;
+					if (!sync.TryToHostTime(deviceClock(nextSample), out mapped, out bound))
+						continue;
+					double error = Math.Abs(HostClock.ToMicroseconds(mapped) - nextSample * 1000000D);
+					errors.Add(error);
+					bounds.Add(bound);
+					if (error > bound)
+						outsideBound++;
+				}
+
+				sync.AddExchange(HostClock.FromSeconds(t1), deviceClock(t2), deviceClock(t3), HostClock.FromSeconds(t4));
+			}
+			errors.Sort();
+			bounds.Sort();
+
+			Console.WriteLine(new BenchmarkReport()
+				.Add("benchmark", "clock-sync")
+				.Add("duration_s", duration)
+				.Add("interval_s", interval)
+				.Add("exchanges", sync.ExchangeCount)
+				.Add("restarts", sync.RestartCount)
+				.Add("true_drift_ppm", driftPpm)
+				.Add("estimated_drift_ppm", sync.DriftPpm)
+				.Add("min_round_trip_us", sync.MinRoundTripMicroseconds)
+				.Add("samples", errors.Count)
+				.AddPercentiles("error_us", errors)
+				.AddPercentiles("bound_us", bounds)
+				.Add("outside_bound", outsideBound));
+			return 0;
+		}
+
+		private static double Delay(Random random, double minimum, double mean)
+		{
+			double delay = minimum - Math.Log(1D - random.NextDouble()) * mean;
+			if (random.NextDouble() < OutlierProbability)
+				delay += random.NextDouble() * OutlierDelaySeconds;
+			return delay;
+		}
+	}
+}
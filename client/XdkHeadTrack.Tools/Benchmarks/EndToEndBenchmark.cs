@@ -0,0 +1,218 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+using System.Threading.Tasks;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Measures the full device -> host -> UDP path. A simulated XDK runs as a
+	/// child process and streams over a pipe (serial text or BLE stand-in), the
+	/// host side is the XdkIO ingestion plus a UdpOrientationSender output stage
+	/// structured like MainViewModel.StartUdpSender, and the UDP packets are
+	/// captured on a local socket. The sample sequence number is carried in the
+	/// (otherwise unused) translation X field of the packet.
+	///
+	/// Usage: e2e-bench [duration-s] [udp-port]
+	/// Prints one JSON line per transport and sample rate.
+	/// </summary>
+	public static class EndToEndBenchmark
+	{
+		private static readonly double[] SampleRates = { 50D, 100D, 200D, 500D, 1000D };
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 5D;
+			short port = args.Length > 1 ? short.Parse(args[1], CultureInfo.InvariantCulture) : (short)4243;
+
+			foreach (SimulatedTransport transport in new[] { SimulatedTransport.Serial, SimulatedTransport.Ble })
+			{
+				foreach (double rate in SampleRates)
+				{
+					Console.WriteLine(RunOnce(transport, rate, duration, port));
+				}
+			}
+			return 0;
+		}
+
+		private static BenchmarkReport RunOnce(SimulatedTransport transport, double rate, double duration, short port)
+		{
+			int count = (int)(duration * rate);
+			long[] sent = new long[count];
+			long[] received = new long[count];
+
+			XdkIO xdk = new XdkIO();
+			UdpOrientationSender sender = new UdpOrientationSender();
+			sender.TargetIPAddress = IPAddress.Loopback;
+			sender.TargetPort = port;
+
+			TimeSpan cpu;
+			using (UdpClient capture = new UdpClient(new IPEndPoint(IPAddress.Loopback, port)))
+			using (CancellationTokenSource cancel = new CancellationTokenSource())
+			using (AutoResetEvent signal = new AutoResetEvent(false))
+			{
+				Thread captureThread = new Thread(() => Capture(capture, received));
+				captureThread.Start();
+
+				object latestLock = new object();
+				int ingested = 0;
+				int latestSequence = -1;
+				Quaternion latestRotation = Quaternion.Identity;
+				xdk.RotationDataReceived += (o, e) =>
+				{
+					lock (latestLock)
+					{
+						latestSequence = ingested++;
+						latestRotation = xdk.CalibratedRotation;
+					}
+					signal.Set();
+				};
+
+				Task output = Task.Run(() =>
+				{
+					while (WaitHandle.WaitAny(new[] { cancel.Token.WaitHandle, signal }) != 0)
+					{
+						int sequence;
+						Quaternion rotation;
+						lock (latestLock)
+						{
+							sequence = latestSequence;
+							rotation = latestRotation;
+						}
+						sender.Send(new Orientation(new Point3D(sequence, 0, 0), rotation));
+					}
+				});
+
+				TimeSpan cpuBefore = Process.GetCurrentProcess().TotalProcessorTime;
+				using (Process device = StartDevice(transport, rate, duration))
+				{
+					device.ErrorDataReceived += (o, e) => RecordSent(e.Data, sent);
+					device.BeginErrorReadLine();
+					Ingest(device.StandardOutput.BaseStream, transport, xdk);
+					device.WaitForExit();
+				}
+				Thread.Sleep(250);
+				cancel.Cancel();
+				output.Wait();
+				cpu = Process.GetCurrentProcess().TotalProcessorTime - cpuBefore;
+
+				capture.Close();
+				captureThread.Join();
+			}
+
+			int sentCount = 0;
+			List<double> latencies = new List<double>(count);
+			for (int i = 0; i < count; i++)
+			{
+				if (sent[i] == 0)
+					continue;
+				sentCount++;
+				if (received[i] != 0)
+					latencies.Add(HostClock.ToMicroseconds(received[i] - sent[i]));
+			}
+			latencies.Sort();
+
+			return new BenchmarkReport()
+				.Add("benchmark", "e2e")
+				.Add("transport", transport == SimulatedTransport.Serial ? "serial" : "ble")
+				.Add("rate_hz", rate)
+				.Add("sent", sentCount)
+				.Add("received", latencies.Count)
+				.Add("drop_rate", sentCount > 0 ? 1D - latencies.Count / (double)sentCount : double.NaN)
+				.AddPercentiles("latency_us", latencies)
+				.Add("host_cpu_us_per_sample", sentCount > 0 ? cpu.TotalMilliseconds * 1000D / sentCount : double.NaN);
+		}
+
+		private static Process StartDevice(SimulatedTransport transport, double rate, double duration)
+		{
+			ProcessStartInfo info = new ProcessStartInfo(Process.GetCurrentProcess().MainModule.FileName,
+				string.Format(CultureInfo.InvariantCulture, "sim-device {0} {1} {2}",
+					transport == SimulatedTransport.Serial ? "serial" : "ble", rate, duration));
+			info.UseShellExecute = false;
+			info.CreateNoWindow = true;
+			info.RedirectStandardOutput = true;
+			info.RedirectStandardError = true;
+			return Process.Start(info);
+		}
+
+		private static void Ingest(Stream stream, SimulatedTransport transport, XdkIO xdk)
+		{
+			if (transport == SimulatedTransport.Serial)
+			{
+				StreamReader reader = new StreamReader(stream);
+				string line;
+				while ((line = reader.ReadLine()) != null)
+					xdk.ProcessLine(line, HostClock.Now);
+			}
+			else
+			{
+				byte[] buffer = new byte[XdkBleFrame.Size * 64];
+				int filled = 0;
+				int read;
+				while ((read = stream.Read(buffer, filled, buffer.Length - filled)) > 0)
+				{
+					long timestamp = HostClock.Now;
+					filled += read;
+					int offset = 0;
+					while (filled - offset >= XdkBleFrame.Size && xdk.ProcessBleFrame(buffer, offset, XdkBleFrame.Size, timestamp))
+						offset += XdkBleFrame.Size;
+					Array.Copy(buffer, offset, buffer, 0, filled - offset);
+					filled -= offset;
+				}
+			}
+		}
+
+		private static void Capture(UdpClient capture, long[] received)
+		{
+			IPEndPoint remote = new IPEndPoint(IPAddress.Any, 0);
+			while (true)
+			{
+				byte[] data;
+				try
+				{
+					data = capture.Receive(ref remote);
+				}
+				catch (SocketException)
+				{
+					break;
+				}
+				catch (ObjectDisposedException)
+				{
+					break;
+				}
+
+				long timestamp = HostClock.Now;
+				if (data.Length < sizeof(double))
+					continue;
+				int sequence = (int)BitConverter.ToDouble(data, 0);
+				if (sequence >= 0 && sequence < received.Length && received[sequence] == 0)
+					received[sequence] = timestamp;
+			}
+		}
+
+		private static void RecordSent(string line, long[] sent)
+		{
+			if (line == null)
+				return;
+			string[] parts = line.Split(' ');
+			int sequence;
+			long timestamp;
+			if (parts.Length == 2
+				&& int.TryParse(parts[0], NumberStyles.Integer, CultureInfo.InvariantCulture, out sequence)
+				&& long.TryParse(parts[1], NumberStyles.Integer, CultureInfo.InvariantCulture, out timestamp)
+				&& sequence >= 0 && sequence < sent.Length)
+			{
+				sent[sequence] = timestamp;
+			}
+		}
+	}
+}
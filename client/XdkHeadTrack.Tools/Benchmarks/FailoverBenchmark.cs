@@ -0,0 +1,151 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Replays a tracking session in which every sample is sent over serial and
+	/// BLE, as in the firmware's redundant mode, through an XdkLinkMerger. Serial
+	/// delay is modelled from the line length at 115200 baud, BLE delay from the
+	/// connection interval, and the radio has random outages. For comparison
+	/// the old behavior is replayed as well, where the firmware switches links
+	/// on BLE connect and disconnect and the samples of the switch are lost.
+	///
+	/// Usage: failover-sim [duration-s] [rate-hz] [ble-outages-per-minute] [seed]
+	/// Prints one JSON line with per-link statistics and output gaps.
+	/// </summary>
+	public static class FailoverBenchmark
+	{
+		private const double SerialLineSeconds = 60D * 10D / 115200D;
+		private const double BleConnectionInterval = 0.0075D;
+		private const double MinOutageSeconds = 0.2D;
+		private const double MaxOutageSeconds = 3D;
+		private const double ReconnectSeconds = 1D;
+
+		private struct Arrival
+		{
+			public double Time;
+			public XdkLink Link;
+			public int Sequence;
+		}
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 300D;
+			double rate = args.Length > 1 ? double.Parse(args[1], CultureInfo.InvariantCulture) : 50D;
+			double outagesPerMinute = args.Length > 2 ? double.Parse(args[2], CultureInfo.InvariantCulture) : 4D;
+			Random random = new Random(args.Length > 3 ? int.Parse(args[3], CultureInfo.InvariantCulture) : 1);
+
+			int count = (int)(duration * rate);
+			List<KeyValuePair<double, double>> outages = GenerateOutages(random, duration, outagesPerMinute);
+
+			List<Arrival> arrivals = new List<Arrival>(2 * count);
+			bool[] switchedDelivered = new bool[count];
+			for (int seq = 0; seq < count; seq++)
+			{
+				double sent = seq / rate;
+				arrivals.Add(new Arrival { Time = sent + SerialLineSeconds + random.NextDouble() * 0.002D, Link = XdkLink.Serial, Sequence = seq });
+
+				double bleArrival = (Math.Floor(sent / BleConnectionInterval) + 1D) * BleConnectionInterval + random.NextDouble() * 0.001D;
+				bool isBleUp = !IsInOutage(outages, sent, 0D);
+				if (isBleUp)
+					arrivals.Add(new Arrival { Time = bleArrival, Link = XdkLink.Ble, Sequence = seq });
+
+				// Switching firmware: BLE while connected, serial otherwise, nothing
+				// while the loss is detected and while the reconnect switches back.
+				switchedDelivered[seq] = isBleUp ? !IsInOutage(outages, sent, ReconnectSeconds) : !IsInDetection(outages, sent);
+			}
+			arrivals.Sort((a, b) => a.Time.CompareTo(b.Time));
+
+			XdkLinkMerger merger = new XdkLinkMerger();
+			bool[] delivered = new bool[count];
+			foreach (Arrival arrival in arrivals)
+			{
+				if (merger.Accept(arrival.Link, (ushort)arrival.Sequence, HostClock.FromSeconds(arrival.Time)))
+					delivered[arrival.Sequence] = true;
+			}
+
+			XdkLinkStatistics serial = merger.GetStatistics(XdkLink.Serial);
+			XdkLinkStatistics ble = merger.GetStatistics(XdkLink.Ble);
+			Console.WriteLine(new BenchmarkReport()
+				.Add("benchmark", "failover")
+				.Add("samples", count)
+				.Add("ble_outages", outages.Count)
+				.Add("serial_first", serial.FirstArrivals)
+				.Add("serial_late", serial.LateArrivals)
+				.Add("serial_mean_lag_us", serial.MeanLagMicroseconds)
+				.Add("ble_first", ble.FirstArrivals)
+				.Add("ble_late", ble.LateArrivals)
+				.Add("ble_mean_lag_us", ble.MeanLagMicroseconds)
+				.Add("redundant_missing", CountMissing(delivered))
+				.Add("redundant_gaps", CountGaps(delivered))
+				.Add("switching_missing", CountMissing(switchedDelivered))
+				.Add("switching_gaps", CountGaps(switchedDelivered)));
+			return 0;
+		}
+
+		private static List<KeyValuePair<double, double>> GenerateOutages(Random random, double duration, double outagesPerMinute)
+		{
+			List<KeyValuePair<double, double>> outages = new List<KeyValuePair<double, double>>();
+			if (outagesPerMinute <= 0D)
+				return outages;
+			double t = 0D;
+			while (true)
+			{
+				t += -Math.Log(1D - random.NextDouble()) * 60D / outagesPerMinute;
+				if (t >= duration)
+					break;
+				double length = MinOutageSeconds + random.NextDouble() * (MaxOutageSeconds - MinOutageSeconds);
+				outages.Add(new KeyValuePair<double, double>(t, t + length));
+				t += length;
+			}
+			return outages;
+		}
+
+		private static bool IsInOutage(List<KeyValuePair<double, double>> outages, double t, double extension)
+		{
+			foreach (KeyValuePair<double, double> outage in outages)
+			{
+				if (t >= outage.Key && t < outage.Value + extension)
+					return true;
+			}
+			return false;
+		}
+
+		private static bool IsInDetection(List<KeyValuePair<double, double>> outages, double t)
+		{
+			// The supervision timeout has to expire before a disconnect is reported.
+			foreach (KeyValuePair<double, double> outage in outages)
+			{
+				if (t >= outage.Key && t < Math.Min(outage.Value, outage.Key + 0.5D))
+					return true;
+			}
+			return false;
+		}
+
+		private static long CountMissing(bool[] delivered)
+		{
+			long missing = 0;
+			foreach (bool d in delivered)
+			{
+				if (!d)
+					missing++;
+			}
+			return missing;
+		}
+
+		private static long CountGaps(bool[] delivered)
+		{
+			long gaps = 0;
+			for (int i = 0; i < delivered.Length; i++)
+			{
+				if (!delivered[i] && (i == 0 || delivered[i - 1]))
+					gaps++;
+			}
+			return gaps;
+		}
+	}
+}
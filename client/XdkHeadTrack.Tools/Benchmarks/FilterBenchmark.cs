@@ -0,0 +1,140 @@
+﻿using System;
+using System.Globalization;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Tools.Traces;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Runs the One-Euro rotation filter over a recorded (or synthetic) trace for
+	/// a grid of parameter sets and reports the added latency during motion and
+	/// the residual jitter once settled at rest.
+	///
+	/// Usage: filter-bench [capture.txt [sample-rate]]
+	/// </summary>
+	public static class FilterBenchmark
+	{
+		private static readonly double[] MinCutoffs = { 0.25D, 0.5D, 1D, 2D, 4D };
+		private static readonly double[] Betas = { 0D, 0.5D, 1D, 2D, 5D };
+
+		private const double MovingSpeed = 0.5D;
+		private const double RestSpeed = 0.05D;
+		private const double SettleTime = 0.5D;
+		private const double MaxLatency = 0.2D;
+		private const double LatencyStep = 0.0005D;
+
+		public static int Run(string[] args)
+		{
+			RotationTrace input, reference;
+			if (args.Length > 0)
+			{
+				double rate = args.Length > 1 ? double.Parse(args[1], CultureInfo.InvariantCulture) : 50D;
+				input = RotationTrace.LoadSerialCapture(args[0], rate);
+				reference = input.Smooth((int)Math.Ceiling(rate * 0.1D));
+			}
+			else
+			{
+				input = new HeadMotionModel(42).Generate(120D, 50D, out reference);
+			}
+
+			if (input.Count < 2)
+			{
+				Console.Error.WriteLine("Trace contains too few samples.");
+				return 1;
+			}
+
+			bool[] moving, resting;
+			Classify(reference, out moving, out resting);
+
+			Console.WriteLine("min_cutoff_hz,beta,latency_ms,jitter_deg");
+			Console.WriteLine(string.Format(CultureInfo.InvariantCulture, "raw,raw,{0:F2},{1:F4}",
+				Latency(input, reference, moving) * 1000D, Jitter(input, reference, resting)));
+
+			foreach (double minCutoff in MinCutoffs)
+			{
+				foreach (double beta in Betas)
+				{
+					OneEuroRotationFilter filter = new OneEuroRotationFilter(minCutoff, beta, OneEuroRotationFilter.DefaultDerivativeCutoff);
+					RotationTrace output = new RotationTrace(input.Count);
+					for (int i = 0; i < input.Count; i++)
+						output.Add(input.Timestamps[i], filter.Filter(input.Rotations[i], input.Timestamps[i]));
+
+					Console.WriteLine(string.Format(CultureInfo.InvariantCulture, "{0},{1},{2:F2},{3:F4}",
+						minCutoff, beta, Latency(output, reference, moving) * 1000D, Jitter(output, reference, resting)));
+				}
+			}
+			return 0;
+		}
+
+		private static void Classify(RotationTrace reference, out bool[] moving, out bool[] resting)
+		{
+			moving = new bool[reference.Count];
+			resting = new bool[reference.Count];
+			double restSince = reference.Timestamps[0];
+			for (int i = 1; i < reference.Count; i++)
+			{
+				double dt = reference.Timestamps[i] - reference.Timestamps[i - 1];
+				double speed = OneEuroRotationFilter.AngleBetween(reference.Rotations[i - 1], reference.Rotations[i]) / dt;
+				moving[i] = speed > MovingSpeed;
+				if (speed >= RestSpeed)
+					restSince = reference.Timestamps[i];
+				resting[i] = reference.Timestamps[i] - restSince >= SettleTime;
+			}
+		}
+
+		/// <summary>
+		/// The time shift of the output that best matches the reference while moving.
+		/// </summary>
+		private static double Latency(RotationTrace output, RotationTrace reference, bool[] moving)
+		{
+			double bestShift = 0D;
+			double bestError = double.MaxValue;
+			for (double shift = 0D; shift <= MaxLatency; shift += LatencyStep)
+			{
+				double error = 0D;
+				int count = 0;
+				int j = 0;
+				for (int i = 0; i < reference.Count; i++)
+				{
+					if (!moving[i])
+						continue;
+					double t = reference.Timestamps[i] + shift;
+					while (j + 1 < output.Count && output.Timestamps[j + 1] <= t)
+						j++;
+					if (j + 1 >= output.Count)
+						break;
+					double s = (t - output.Timestamps[j]) / (output.Timestamps[j + 1] - output.Timestamps[j]);
+					Quaternion shifted = Quaternion.Slerp(output.Rotations[j], output.Rotations[j + 1], s);
+					error += OneEuroRotationFilter.AngleBetween(shifted, reference.Rotations[i]);
+					count++;
+				}
+				if (count > 0 && error / count < bestError)
+				{
+					bestError = error / count;
+					bestShift = shift;
+				}
+			}
+			return bestShift;
+		}
+
+		/// <summary>
+		/// RMS deviation from the reference at rest, in degrees.
+		/// </summary>
+		private static double Jitter(RotationTrace output, RotationTrace reference, bool[] resting)
+		{
+			double sum = 0D;
+			int count = 0;
+			for (int i = 0; i < output.Count; i++)
+			{
+				if (!resting[i])
+					continue;
+				double angle = OneEuroRotationFilter.AngleBetween(output.Rotations[i], reference.Rotations[i]);
+				sum += angle * angle;
+				count++;
+			}
+			return count > 0 ? Math.Sqrt(sum / count) * 180D / Math.PI : 0D;
+		}
+	}
+}
@@ -0,0 +1,274 @@
+﻿using System;
+using System.Globalization;
+using System.Text;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Tools.Traces;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Microbenchmarks of the hot host kernels: line and frame parsing, the
+	/// quaternion math used for calibration and the Euler conversions.
+	/// The batch Euler conversions are reported per quaternion, to compare
+	/// with the scalar ones. Input data is taken from a serial capture or a
+	/// synthetic trace.
+	///
+	/// Usage: micro-bench [name-regex [capture.txt]]
+	/// </summary>
+	public static class KernelBenchmarks
+	{
+		private const int DataSize = 1024;
+		private const int DataMask = DataSize - 1;
+
+		private static double Sink;
+
+		public static int Run(string[] args)
+		{
+			string filter = args.Length > 0 ? args[0] : null;
+			RotationTrace trace;
+			if (args.Length > 1)
+			{
+				trace = RotationTrace.LoadSerialCapture(args[1], 50D);
+			}
+			else
+			{
+				RotationTrace truth;
+				trace = new HeadMotionModel(7).Generate(DataSize / 50D + 1D, 50D, out truth);
+			}
+
+			if (trace.Count < DataSize)
+			{
+				Console.Error.WriteLine("Trace must contain at least " + DataSize + " samples.");
+				return 1;
+			}
+
+			MicroBenchmarkRunner runner = new MicroBenchmarkRunner();
+			Register(runner, trace);
+			foreach (BenchmarkReport report in runner.Run(filter))
+				Console.WriteLine(report);
+			return 0;
+		}
+
+		public static void Register(MicroBenchmarkRunner runner, RotationTrace trace)
+		{
+			Quaternion[] rotations = new Quaternion[DataSize];
+			string[] lines = new string[DataSize];
+			byte[] frames = new byte[DataSize * XdkBleFrame.Size];
+			byte[] compactFrames = new byte[DataSize * XdkBleFrame.CompactSize];
+			long lineBytes = 0;
+			for (int i = 0; i < DataSize; i++)
+			{
+				rotations[i] = trace.Rotations[i];
+				lines[i] = SimulatedXdk.FormatSerialLine(rotations[i], false).TrimEnd('\n');
+				lineBytes += lines[i].Length + 1;
+				XdkBleFrame.Encode(rotations[i], false, frames, i * XdkBleFrame.Size);
+				XdkBleFrame.EncodeCompact(rotations[i], false, i, i > 0, rotations[Math.Max(0, i - 1)], compactFrames, i * XdkBleFrame.CompactSize);
+			}
+			QuaternionBatch batch = new QuaternionBatch(DataSize);
+			foreach (Quaternion rotation in rotations)
+				batch.Add(rotation);
+			double[] eulerX = new double[DataSize], eulerY = new double[DataSize], eulerZ = new double[DataSize];
+			Quaternion calibration = rotations[DataSize / 2];
+			Quaternion zRotation = new Quaternion(new Vector3D(0, 0, 1), 180);
+
+			runner.Add("parse/line/scalar", state =>
+			{
+				state.BytesPerIteration = lineBytes / DataSize;
+				Quaternion q;
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					XdkLineParser.TryParse(lines[i & DataMask], out q);
+					Sink += q.W;
+				}
+			});
+
+			runner.Add("parse/ble-frame/scalar", state =>
+			{
+				state.BytesPerIteration = XdkBleFrame.Size;
+				Quaternion q;
+				bool isCalibration;
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					XdkBleFrame.TryDecode(frames, (int)(i & DataMask) * XdkBleFrame.Size, XdkBleFrame.Size, out q, out isCalibration);
+					Sink += q.W;
+				}
+			});
+
+			runner.Add("parse/ble-compact/scalar", state =>
+			{
+				state.BytesPerIteration = XdkBleFrame.CompactSize;
+				Quaternion q, previous;
+				bool isCalibration, hasPrevious;
+				int sequence;
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					XdkBleFrame.TryDecodeCompact(compactFrames, (int)(i & DataMask) * XdkBleFrame.CompactSize, XdkBleFrame.CompactSize,
+						out q, out isCalibration, out sequence, out hasPrevious, out previous);
+					Sink += q.W + previous.W;
+				}
+			});
+
+			runner.Add("quat/multiply/scalar", state =>
+			{
+				Quaternion acc = Quaternion.Identity;
+				for (long i = 0; i < state.Iterations; i++)
+					acc = rotations[i & DataMask] * rotations[(i + 1) & DataMask];
+				Sink += acc.W;
+			});
+
+			runner.Add("quat/invert/scalar", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					Quaternion q = rotations[i & DataMask];
+					q.Invert();
+					Sink += q.W;
+				}
+			});
+
+			runner.Add("quat/normalize/scalar", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					Quaternion q = rotations[i & DataMask];
+					q.Normalize();
+					Sink += q.W;
+				}
+			});
+
+			runner.Add("quat/calibrate/scalar", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					Quaternion inverse = calibration;
+					inverse.Invert();
+					Quaternion q = rotations[i & DataMask] * inverse * zRotation;
+					Sink += q.W;
+				}
+			});
+
+			runner.Add("quat/slerp/scalar", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					Quaternion q = Quaternion.Slerp(rotations[i & DataMask], rotations[(i + 7) & DataMask], 0.3D);
+					Sink += q.W;
+				}
+			});
+
+			runner.Add("euler/QuatToEuler/scalar", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+					Sink += rotations[i & DataMask].QuatToEuler().X;
+			});
+
+			runner.Add("euler/ToEulerAngles/scalar", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+					Sink += rotations[i & DataMask].ToEulerAngles().X;
+			});
+
+			runner.Add("euler/batch-exact/soa", state =>
+			{
+				state.ItemsPerIteration = DataSize;
+				for (long i = 0; i < state.Iterations; i++)
+					batch.ToEuler(eulerX, eulerY, eulerZ, EulerPrecision.Exact);
+				Sink += eulerX[0];
+			});
+
+			runner.Add("euler/batch-approx/soa", state =>
+			{
+				state.ItemsPerIteration = DataSize;
+				for (long i = 0; i < state.Iterations; i++)
+					batch.ToEuler(eulerX, eulerY, eulerZ, EulerPrecision.Approximate);
+				Sink += eulerX[0];
+			});
+
+			// Full host chain at 1 kHz: calibrate, axis remap, filter, predict,
+			// resample to 250 Hz and encode, composed at compile and at run time.
+			long samplePeriod = HostClock.FromSeconds(0.001D);
+			Quaternion remap = new Quaternion(new Vector3D(1, 0, 0), 90);
+			RotationPipeline<CalibrateStage, RotationPipeline<AxisRemapStage, RotationPipeline<FilterStage,
+				RotationPipeline<PredictStage, RotationPipeline<ResampleStage, UdpEncodeStage>>>>> staticPipeline =
+				new RotationPipeline<CalibrateStage, RotationPipeline<AxisRemapStage, RotationPipeline<FilterStage,
+					RotationPipeline<PredictStage, RotationPipeline<ResampleStage, UdpEncodeStage>>>>>(
+					new CalibrateStage(calibration),
+					new RotationPipeline<AxisRemapStage, RotationPipeline<FilterStage, RotationPipeline<PredictStage, RotationPipeline<ResampleStage, UdpEncodeStage>>>>(
+						new AxisRemapStage(remap),
+						new RotationPipeline<FilterStage, RotationPipeline<PredictStage, RotationPipeline<ResampleStage, UdpEncodeStage>>>(
+							new FilterStage(new OneEuroRotationFilter()),
+							new RotationPipeline<PredictStage, RotationPipeline<ResampleStage, UdpEncodeStage>>(
+								new PredictStage(HostClock.FromSeconds(0.01D)),
+								new RotationPipeline<ResampleStage, UdpEncodeStage>(
+									new ResampleStage(4 * samplePeriod), UdpEncodeStage.Create())))));
+			DynamicRotationPipeline dynamicPipeline = new DynamicRotationPipeline()
+				.Add(new CalibrateStage(calibration))
+				.Add(new AxisRemapStage(remap))
+				.Add(new FilterStage(new OneEuroRotationFilter()))
+				.Add(new PredictStage(HostClock.FromSeconds(0.01D)))
+				.Add(new ResampleStage(4 * samplePeriod))
+				.Add(UdpEncodeStage.Create());
+
+			runner.Add("pipeline/full/static", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					RotationSample sample = new RotationSample(rotations[i & DataMask], i * samplePeriod);
+					if (staticPipeline.Process(ref sample))
+						Sink += sample.Rotation.W;
+				}
+			});
+
+			runner.Add("pipeline/full/dynamic", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					RotationSample sample = new RotationSample(rotations[i & DataMask], i * samplePeriod);
+					if (dynamicPipeline.Process(ref sample))
+						Sink += sample.Rotation.W;
+				}
+			});
+
+			// Cost of a stage boundary of the threaded pipeline on one thread,
+			// without the cache traffic between the cores.
+			SpscQueue<RotationSample> queue = new SpscQueue<RotationSample>(DataSize);
+			TripleBuffer<RotationSample> latest = new TripleBuffer<RotationSample>();
+
+			runner.Add("handoff/spsc-queue/single-thread", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					RotationSample sample;
+					queue.TryEnqueue(new RotationSample(rotations[i & DataMask], i));
+					if (queue.TryDequeue(out sample))
+						Sink += sample.Rotation.W;
+				}
+			});
+
+			runner.Add("handoff/triple-buffer/single-thread", state =>
+			{
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					RotationSample sample;
+					latest.Write(new RotationSample(rotations[i & DataMask], i));
+					if (latest.TryRead(out sample))
+						Sink += sample.Rotation.W;
+				}
+			});
+
+			runner.Add("encode/udp-packet/scalar", state =>
+			{
+				state.BytesPerIteration = 6 * sizeof(double);
+				for (long i = 0; i < state.Iterations; i++)
+				{
+					Orientation orientation = new Orientation(new Point3D(), rotations[i & DataMask]);
+					// Same access pattern as UdpOrientationSender.Send
+					Sink += orientation.Bytes.Length + orientation.Bytes[24];
+				}
+			});
+		}
+	}
+}
@@ -0,0 +1,314 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Linq;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+using System.Threading.Tasks;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Tools.Linux;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Tools.Traces;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Load and soak test of the host against a VirtualXdkFarm, without
+	/// hardware. Serial devices are read by an XdkAggregator from their pseudo
+	/// terminals, BLE devices by one XdkIO each from their loopback socket,
+	/// reconnecting after every disconnect. Every sample the host emits is
+	/// matched by device and sequence number against what the farm sent,
+	/// giving the latency from device write to host output, the loss, the
+	/// corrupted samples the host let through and, after every injected
+	/// disconnect, the time until the first new sample came out of the host.
+	///
+	/// With --serve only the farm runs and its endpoints are printed, for
+	/// soak testing a separately started host.
+	///
+	/// Usage: load-gen [--serial n] [--ble n] [--rate hz] [--duration s]
+	///   [--trace capture.txt] [--corrupt p] [--drop p] [--burst p length]
+	///   [--disconnect per-minute seconds] [--seed n] [--serve]
+	/// Prints one JSON line, preceded by one per device with --serve.
+	/// </summary>
+	public static class LoadBenchmark
+	{
+		private class HostStats
+		{
+			public readonly List<double> Latencies = new List<double>();
+			public readonly List<double> Recoveries = new List<double>();
+			public long CorruptedAccepted;
+			public long Concealed;
+			public long Unmatched;
+		}
+
+		public static int Run(string[] args)
+		{
+			int serialCount = 8;
+			int bleCount = 0;
+			double rate = 100D;
+			double duration = 10D;
+			string tracePath = null;
+			int seed = 1;
+			bool isServing = false;
+			FaultProfile faults = new FaultProfile();
+			for (int i = 0; i < args.Length; i++)
+			{
+				switch (args[i])
+				{
+					case "--serial":
+						serialCount = int.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--ble":
+						bleCount = int.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--rate":
+						rate = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--duration":
+						duration = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--trace":
+						tracePath = args[++i];
+						break;
+					case "--corrupt":
+						faults.CorruptionRate = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--drop":
+						faults.DropRate = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--burst":
+						faults.BurstRate = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						faults.BurstLength = int.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--disconnect":
+						faults.DisconnectsPerMinute = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						faults.DisconnectDuration = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--seed":
+						seed = int.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--serve":
+						isServing = true;
+						break;
+					default:
+						Console.Error.WriteLine("Unknown option " + args[i] + ".");
+						return 1;
+				}
+			}
+
+			if (!LinuxInput.IsSupported)
+			{
+				Console.Error.WriteLine("load-gen needs Linux.");
+				return 1;
+			}
+
+			RotationTrace trace = tracePath != null ? RotationTrace.LoadSerialCapture(tracePath, rate) : null;
+			try
+			{
+				using (VirtualXdkFarm farm = new VirtualXdkFarm(serialCount, bleCount, rate, faults, trace, seed))
+				{
+					if (isServing)
+						Serve(farm, duration, faults);
+					else
+						Console.WriteLine(RunOnce(farm, duration, faults));
+				}
+			}
+			catch (IOException e)
+			{
+				Console.Error.WriteLine(e.Message);
+				return 1;
+			}
+			return 0;
+		}
+
+		private static void Serve(VirtualXdkFarm farm, double duration, FaultProfile faults)
+		{
+			foreach (VirtualXdk xdk in farm.Devices)
+			{
+				Console.WriteLine(new BenchmarkReport()
+					.Add("device", xdk.Id)
+					.Add("transport", xdk.Transport == SimulatedTransport.Serial ? "serial" : "ble")
+					.Add("endpoint", xdk.Endpoint));
+			}
+			Console.Out.Flush();
+
+			farm.Run(duration, TimeSpan.FromSeconds(faults.DisconnectDuration), CancellationToken.None);
+			Console.WriteLine(AddFarmCounts(new BenchmarkReport().Add("benchmark", "load-gen-serve"), farm));
+		}
+
+		private static BenchmarkReport RunOnce(VirtualXdkFarm farm, double duration, FaultProfile faults)
+		{
+			int deviceCount = farm.Devices.Count;
+			HostStats[] stats = new HostStats[deviceCount];
+			for (int i = 0; i < deviceCount; i++)
+				stats[i] = new HostStats();
+
+			// Reads of pseudo terminals block a pool thread each on Linux, the
+			// pool would only grow to that over seconds.
+			int workerThreads, ioThreads;
+			ThreadPool.GetMinThreads(out workerThreads, out ioThreads);
+			ThreadPool.SetMinThreads(Math.Max(workerThreads, 2 * deviceCount + 4), ioThreads);
+
+			List<XdkIO> bleHosts = new List<XdkIO>();
+			List<Task> bleReaders = new List<Task>();
+			long start, end;
+			long discardedLines = 0;
+			long countedLost = 0;
+			using (CancellationTokenSource cancel = new CancellationTokenSource())
+			using (XdkAggregator aggregator = new XdkAggregator())
+			{
+				// Aggregator ids follow the order of Add, serial devices come first.
+				aggregator.RotationReceived += (o, e) =>
+					Record(farm.Devices[e.Device.Id], stats[e.Device.Id], e.Sequence, e.Origin, HostClock.Now);
+				foreach (VirtualXdk xdk in farm.Devices)
+				{
+					if (xdk.Transport == SimulatedTransport.Serial)
+					{
+						aggregator.Add(xdk.Endpoint, xdk.Terminal.OpenSlave());
+						continue;
+					}
+
+					XdkIO host = new XdkIO();
+					host.LossConcealer.SamplePeriod = HostClock.FromSeconds(1D / farm.SampleRate);
+					VirtualXdk device = xdk;
+					host.RotationDataReceived += (o, e) =>
+						Record(device, stats[device.Id], e.Sequence, e.Origin, HostClock.Now);
+					bleHosts.Add(host);
+					bleReaders.Add(Task.Run(() => ReadBleAsync(device, host, cancel.Token)));
+				}
+
+				start = HostClock.Now;
+				farm.Run(duration, TimeSpan.FromSeconds(faults.DisconnectDuration), CancellationToken.None);
+				Thread.Sleep(250);
+				end = HostClock.Now;
+
+				// Closing the device ends of all links ends the host's reads.
+				cancel.Cancel();
+				farm.Dispose();
+				aggregator.Completion.Wait(TimeSpan.FromSeconds(2D));
+				Task.WaitAll(bleReaders.ToArray(), TimeSpan.FromSeconds(2D));
+
+				foreach (XdkDevice device in aggregator.Devices)
+				{
+					discardedLines += device.DiscardedLineCount;
+					countedLost += device.LostSampleCount;
+				}
+			}
+
+			long sentIntact = 0;
+			foreach (VirtualXdk xdk in farm.Devices)
+				sentIntact += xdk.Sent - xdk.Faults.Corrupted;
+
+			List<double> latencies = stats.SelectMany(s => s.Latencies).ToList();
+			List<double> recoveries = stats.SelectMany(s => s.Recoveries).ToList();
+			latencies.Sort();
+			recoveries.Sort();
+			double wall = HostClock.ToSeconds(end - start);
+
+			BenchmarkReport report = new BenchmarkReport().Add("benchmark", "load-gen");
+			return AddFarmCounts(report, farm)
+				.Add("received", latencies.Count)
+				.Add("loss_rate", sentIntact > 0 ? 1D - latencies.Count / (double)sentIntact : double.NaN)
+				.Add("corrupted_accepted", stats.Sum(s => s.CorruptedAccepted))
+				.Add("concealed", stats.Sum(s => s.Concealed))
+				.Add("unmatched", stats.Sum(s => s.Unmatched))
+				.Add("throughput_hz", latencies.Count / wall)
+				.AddPercentiles("latency_us", latencies)
+				.Add("recoveries", recoveries.Count)
+				.AddPercentiles("recovery_ms", recoveries)
+				.Add("host_discarded_lines", discardedLines)
+				.Add("host_lost_samples", countedLost)
+				.Add("ble_duplicates", bleHosts.Sum(h => h.LossConcealer.DuplicateCount));
+		}
+
+		private static BenchmarkReport AddFarmCounts(BenchmarkReport report, VirtualXdkFarm farm)
+		{
+			IReadOnlyList<VirtualXdk> devices = farm.Devices;
+			return report
+				.Add("serial_devices", devices.Count(d => d.Transport == SimulatedTransport.Serial))
+				.Add("ble_devices", devices.Count(d => d.Transport == SimulatedTransport.Ble))
+				.Add("rate_hz", farm.SampleRate)
+				.Add("generated", devices.Sum(d => d.Generated))
+				.Add("sent", devices.Sum(d => d.Sent))
+				.Add("injected_drops", devices.Sum(d => d.Faults.Dropped))
+				.Add("injected_corruptions", devices.Sum(d => d.Faults.Corrupted))
+				.Add("injected_disconnects", devices.Sum(d => d.Faults.Disconnects))
+				.Add("offline", devices.Sum(d => d.Offline))
+				.Add("overflowed", devices.Sum(d => d.Overflowed));
+		}
+
+		private static void Record(VirtualXdk device, HostStats stats, int sequence, XdkSampleOrigin origin, long timestamp)
+		{
+			if (origin != XdkSampleOrigin.Received)
+			{
+				stats.Concealed++;
+				return;
+			}
+
+			long sentTime;
+			bool isCorrupted;
+			if (sequence < 0 || !device.SentSamples.TryTake(sequence, out sentTime, out isCorrupted))
+			{
+				stats.Unmatched++;
+				return;
+			}
+			if (isCorrupted)
+			{
+				stats.CorruptedAccepted++;
+				return;
+			}
+			stats.Latencies.Add(HostClock.ToMicroseconds(timestamp - sentTime));
+
+			long resumedAt = Volatile.Read(ref device.ResumedAt);
+			if (resumedAt != 0 && sentTime >= resumedAt && Interlocked.CompareExchange(ref device.ResumedAt, 0L, resumedAt) == resumedAt)
+				stats.Recoveries.Add(HostClock.ToMicroseconds(timestamp - resumedAt) / 1000D);
+		}
+
+		private static async Task ReadBleAsync(VirtualXdk device, XdkIO host, CancellationToken cancel)
+		{
+			byte[] buffer = new byte[64 * XdkBleFrame.Size];
+			while (!cancel.IsCancellationRequested)
+			{
+				using (TcpClient client = new TcpClient())
+				{
+					try
+					{
+						await client.ConnectAsync(IPAddress.Loopback, device.BlePort);
+					}
+					catch (SocketException)
+					{
+						await Task.Delay(10);
+						continue;
+					}
+					client.NoDelay = true;
+
+					NetworkStream stream = client.GetStream();
+					int filled = 0;
+					try
+					{
+						int read;
+						while ((read = await stream.ReadAsync(buffer, filled, buffer.Length - filled)) > 0)
+						{
+							long timestamp = HostClock.Now;
+							filled += read;
+							int offset = 0;
+							for (; filled - offset >= XdkBleFrame.Size; offset += XdkBleFrame.Size)
+								host.ProcessBleFrame(buffer, offset, XdkBleFrame.Size, timestamp);
+							Array.Copy(buffer, offset, buffer, 0, filled - offset);
+							filled -= offset;
+						}
+					}
+					catch (IOException)
+					{
+					}
+					catch (ObjectDisposedException)
+					{
+					}
+				}
+			}
+		}
+	}
+}
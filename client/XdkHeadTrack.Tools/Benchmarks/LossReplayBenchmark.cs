@@ -0,0 +1,170 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Tools.Traces;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Replays a synthetic head motion trace as compact BLE frames through an
+	/// XdkLossConcealer while dropping frames after several loss patterns, once
+	/// with the redundant copy of the previous sample and once without. The
+	/// samples the consumer saw in place of the lost ones are compared against
+	/// the ground truth of the motion model and against simply holding the
+	/// last received sample. Tick runs twice per sample period as in XdkIO.
+	///
+	/// Usage: loss-replay [duration-s] [rate-hz] [seed]
+	/// Prints one JSON line per loss pattern and mode.
+	/// </summary>
+	public static class LossReplayBenchmark
+	{
+		private const double MaxJitterSeconds = 0.002D;
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 120D;
+			double rate = args.Length > 1 ? double.Parse(args[1], CultureInfo.InvariantCulture) : 50D;
+			int seed = args.Length > 2 ? int.Parse(args[2], CultureInfo.InvariantCulture) : 1;
+
+			RotationTrace truth;
+			RotationTrace trace = new HeadMotionModel(seed).Generate(duration, rate, out truth);
+
+			foreach (KeyValuePair<string, Func<Random, int, bool>> pattern in CreatePatterns())
+			{
+				bool[] lost = new bool[trace.Count];
+				Random random = new Random(seed);
+				for (int i = 1; i < lost.Length; i++)
+					lost[i] = pattern.Value(random, i);
+
+				foreach (bool isRedundant in new[] { true, false })
+					Console.WriteLine(Replay(trace, truth, lost, rate, pattern.Key, isRedundant, new Random(seed)));
+			}
+			return 0;
+		}
+
+		private static List<KeyValuePair<string, Func<Random, int, bool>>> CreatePatterns()
+		{
+			return new List<KeyValuePair<string, Func<Random, int, bool>>>
+			{
+				new KeyValuePair<string, Func<Random, int, bool>>("none", (random, i) => false),
+				new KeyValuePair<string, Func<Random, int, bool>>("random-1", (random, i) => random.NextDouble() < 0.01D),
+				new KeyValuePair<string, Func<Random, int, bool>>("random-5", (random, i) => random.NextDouble() < 0.05D),
+				new KeyValuePair<string, Func<Random, int, bool>>("random-10", (random, i) => random.NextDouble() < 0.10D),
+				new KeyValuePair<string, Func<Random, int, bool>>("burst-3", CreateBurstPattern(3, 0.01D)),
+				new KeyValuePair<string, Func<Random, int, bool>>("burst-10", CreateBurstPattern(10, 0.005D)),
+				new KeyValuePair<string, Func<Random, int, bool>>("periodic-10", (random, i) => i % 10 == 0),
+			};
+		}
+
+		private static Func<Random, int, bool> CreateBurstPattern(int length, double probability)
+		{
+			int remaining = 0;
+			return (random, i) =>
+			{
+				if (remaining == 0 && random.NextDouble() < probability)
+					remaining = length;
+				if (remaining == 0)
+					return false;
+				remaining--;
+				return true;
+			};
+		}
+
+		private static BenchmarkReport Replay(RotationTrace trace, RotationTrace truth, bool[] lost, double rate, string pattern, bool isRedundant, Random random)
+		{
+			long period = HostClock.FromSeconds(1D / rate);
+			XdkLossConcealer concealer = new XdkLossConcealer();
+			concealer.SamplePeriod = period;
+
+			// First output per sample, i.e. what a consumer saw at the time.
+			Quaternion?[] seen = new Quaternion?[trace.Count];
+			long lastOutput = 0, maxOutputGap = 0;
+			long extended = -1;
+			concealer.Output = (sequence, rotation, origin, timestamp) =>
+			{
+				extended = extended < 0 ? sequence : extended + (short)(ushort)(sequence - extended);
+				if (extended >= 0 && extended < seen.Length && seen[extended] == null)
+					seen[extended] = rotation;
+				if (lastOutput != 0)
+					maxOutputGap = Math.Max(maxOutputGap, timestamp - lastOutput);
+				lastOutput = timestamp;
+			};
+
+			byte[] frame = new byte[XdkBleFrame.CompactSize];
+			long nextTick = 0;
+			long lastArrival = 0, maxArrivalGap = 0;
+			List<double> receivedErrors = new List<double>();
+			List<double> restoredErrors = new List<double>();
+			List<double> heldErrors = new List<double>();
+			Quaternion held = trace.Rotations[0];
+			for (int i = 0; i < trace.Count; i++)
+			{
+				long arrival = i * period + HostClock.FromSeconds(random.NextDouble() * MaxJitterSeconds);
+				for (; nextTick < arrival; nextTick += period / 2)
+					concealer.Tick(nextTick);
+
+				if (lost[i])
+				{
+					heldErrors.Add(AngleBetween(held, truth.Rotations[i]));
+					continue;
+				}
+
+				XdkBleFrame.EncodeCompact(trace.Rotations[i], false, i, isRedundant && i > 0, i > 0 ? trace.Rotations[i - 1] : Quaternion.Identity, frame, 0);
+				Quaternion rotation, previous;
+				bool isCalibration, hasPrevious;
+				int sequence;
+				XdkBleFrame.TryDecodeCompact(frame, 0, frame.Length, out rotation, out isCalibration, out sequence, out hasPrevious, out previous);
+				concealer.Receive(sequence, rotation, hasPrevious, previous, arrival);
+
+				held = trace.Rotations[i];
+				if (lastArrival != 0)
+					maxArrivalGap = Math.Max(maxArrivalGap, arrival - lastArrival);
+				lastArrival = arrival;
+			}
+
+			for (int i = 0; i < trace.Count; i++)
+			{
+				if (seen[i] == null)
+					continue;
+				(lost[i] ? restoredErrors : receivedErrors).Add(AngleBetween(seen[i].Value, truth.Rotations[i]));
+			}
+			receivedErrors.Sort();
+			restoredErrors.Sort();
+			heldErrors.Sort();
+
+			return new BenchmarkReport()
+				.Add("benchmark", "loss-replay")
+				.Add("pattern", pattern)
+				.Add("mode", isRedundant ? "redundant" : "conceal-only")
+				.Add("frame_bytes", XdkBleFrame.CompactSize)
+				.Add("samples", trace.Count)
+				.Add("lost", heldErrors.Count)
+				.Add("received", concealer.ReceivedCount)
+				.Add("recovered", concealer.RecoveredCount)
+				.Add("concealed", concealer.ConcealedCount)
+				.Add("received_err_deg_mean", Mean(receivedErrors))
+				.AddPercentiles("restored_err_deg", restoredErrors)
+				.AddPercentiles("held_err_deg", heldErrors)
+				.Add("max_output_gap_ms", HostClock.ToMicroseconds(maxOutputGap) / 1000D)
+				.Add("max_arrival_gap_ms", HostClock.ToMicroseconds(maxArrivalGap) / 1000D);
+		}
+
+		private static double AngleBetween(Quaternion a, Quaternion b)
+		{
+			double dot = Math.Abs(a.W * b.W + a.X * b.X + a.Y * b.Y + a.Z * b.Z);
+			return 2D * Math.Acos(Math.Min(1D, dot)) * 180D / Math.PI;
+		}
+
+		private static double Mean(List<double> values)
+		{
+			double sum = 0D;
+			foreach (double value in values)
+				sum += value;
+			return values.Count > 0 ? sum / values.Count : double.NaN;
+		}
+	}
+}
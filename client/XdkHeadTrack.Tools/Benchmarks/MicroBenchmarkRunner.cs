@@ -0,0 +1,81 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Text.RegularExpressions;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	public class MicroBenchmarkState
+	{
+		public long Iterations { get; internal set; }
+
+		/// <summary>
+		/// Items handled per iteration, used to report the throughput.
+		/// </summary>
+		public long ItemsPerIteration { get; set; } = 1;
+
+		/// <summary>
+		/// Bytes handled per iteration, used to report the throughput. Optional.
+		/// </summary>
+		public long BytesPerIteration { get; set; }
+	}
+
+	/// <summary>
+	/// Minimal Google-Benchmark style runner: every benchmark body loops over
+	/// state.Iterations, the runner grows the iteration count until a run takes
+	/// at least the minimum time and then reports ns/op and throughput.
+	/// </summary>
+	public class MicroBenchmarkRunner
+	{
+		private readonly List<KeyValuePair<string, Action<MicroBenchmarkState>>> _benchmarks = new List<KeyValuePair<string, Action<MicroBenchmarkState>>>();
+
+		public TimeSpan MinTime { get; set; } = TimeSpan.FromSeconds(0.5D);
+
+		public void Add(string name, Action<MicroBenchmarkState> body)
+		{
+			_benchmarks.Add(new KeyValuePair<string, Action<MicroBenchmarkState>>(name, body));
+		}
+
+		public IEnumerable<BenchmarkReport> Run(string filter)
+		{
+			Regex regex = new Regex(string.IsNullOrEmpty(filter) ? "." : filter);
+			foreach (KeyValuePair<string, Action<MicroBenchmarkState>> benchmark in _benchmarks)
+			{
+				if (regex.IsMatch(benchmark.Key))
+					yield return Run(benchmark.Key, benchmark.Value);
+			}
+		}
+
+		private BenchmarkReport Run(string name, Action<MicroBenchmarkState> body)
+		{
+			MicroBenchmarkState state = new MicroBenchmarkState();
+			Stopwatch watch = new Stopwatch();
+			long iterations = 1;
+			while (true)
+			{
+				state.Iterations = iterations;
+				GC.Collect();
+				GC.WaitForPendingFinalizers();
+				watch.Restart();
+				body(state);
+				watch.Stop();
+
+				if (watch.Elapsed >= MinTime || iterations >= long.MaxValue / 16)
+					break;
+
+				double scale = watch.Elapsed.TotalSeconds > 0D ? MinTime.TotalSeconds * 1.4D / watch.Elapsed.TotalSeconds : 16D;
+				iterations = (long)(iterations * Math.Max(2D, Math.Min(16D, scale)));
+			}
+
+			double seconds = watch.Elapsed.TotalSeconds;
+			BenchmarkReport report = new BenchmarkReport()
+				.Add("benchmark", name)
+				.Add("iterations", iterations)
+				.Add("ns_per_op", seconds * 1e9D / (iterations * state.ItemsPerIteration))
+				.Add("items_per_s", iterations * state.ItemsPerIteration / seconds);
+			if (state.BytesPerIteration > 0)
+				report.Add("bytes_per_s", iterations * state.BytesPerIteration / seconds);
+			return report;
+		}
+	}
+}
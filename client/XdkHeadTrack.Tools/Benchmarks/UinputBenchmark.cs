@@ -0,0 +1,219 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Threading;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Linux;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Tools.Traces;
+using XdkHeadTrack.Tools.Uinput;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Benchmarks
+{
+	/// <summary>
+	/// Measures the latency from sample arrival to the evdev event of the
+	/// uinput joystick output, without a game or any hardware. A synthetic
+	/// head motion is fed at the sample rate into XdkIO, whose RotationSink is
+	/// a worker running UinputStage, and the joystick is read back through
+	/// its /dev/input/event* node like a game would. Every frame read is
+	/// matched against the axis values expected for the samples in order, so
+	/// the run also checks the mapping. Samples that do not move any axis
+	/// produce no frame, the kernel drops unchanged values, and are counted
+	/// as unchanged.
+	///
+	/// Needs Linux with write access to /dev/uinput and udev creating the
+	/// event nodes.
+	///
+	/// Usage: uinput-bench [duration-s] [rate-hz]...
+	/// Prints one JSON line per sample rate.
+	/// </summary>
+	public static class UinputBenchmark
+	{
+		private static readonly double[] DefaultSampleRates = { 100D, 250D, 500D, 1000D };
+
+		// Frames are matched this many samples ahead at most.
+		private const int Lookahead = 64;
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 5D;
+			List<double> rates = new List<double>();
+			for (int i = 1; i < args.Length; i++)
+				rates.Add(double.Parse(args[i], CultureInfo.InvariantCulture));
+			if (rates.Count == 0)
+				rates.AddRange(DefaultSampleRates);
+
+			if (!LinuxInput.IsSupported)
+			{
+				Console.Error.WriteLine("uinput-bench needs Linux.");
+				return 1;
+			}
+
+			try
+			{
+				foreach (double rate in rates)
+					Console.WriteLine(RunOnce(rate, duration));
+			}
+			catch (Exception e) when (e is IOException || e is TimeoutException)
+			{
+				Console.Error.WriteLine(e.Message);
+				return 1;
+			}
+			return 0;
+		}
+
+		private static BenchmarkReport RunOnce(double rate, double duration)
+		{
+			RotationTrace truth;
+			RotationTrace trace = new HeadMotionModel(3).Generate(duration, rate, out truth);
+			int count = trace.Count;
+			JoystickMapping mapping = new JoystickMapping();
+
+			// XdkIO calibrates with the identity until a calibration arrives.
+			int[][] expected = new int[count][];
+			CalibrateStage calibrate = new CalibrateStage(Quaternion.Identity);
+			for (int i = 0; i < count; i++)
+			{
+				RotationSample sample = new RotationSample(trace.Rotations[i], 0);
+				calibrate.Process(ref sample);
+				expected[i] = new int[3];
+				mapping.ToValues(sample.Rotation, expected[i]);
+			}
+
+			long[] arrived = new long[count];
+			long[] received = new long[count];
+			int posted = 0;
+			int mismatched = 0;
+			int dropped = 0;
+
+			XdkIO xdk = new XdkIO();
+			using (UinputJoystick joystick = new UinputJoystick(mapping, "XdkHeadTrack uinput-bench"))
+			{
+				int fd = LinuxInput.Open(joystick.WaitForEventDevice(TimeSpan.FromSeconds(2D)), LinuxInput.ReadOnly);
+				Thread reader = new Thread(() => ReadBack(fd, mapping, expected, arrived, received, ref posted, ref mismatched, ref dropped));
+				reader.Start();
+
+				using (RotationWorker<UinputStage> worker = new RotationWorker<UinputStage>("uinput output", new UinputStage(joystick)))
+				{
+					worker.Start();
+					xdk.RotationSink = worker;
+
+					long start = HostClock.Now;
+					double period = HostClock.Frequency / rate;
+					for (int i = 0; i < count; i++)
+					{
+						long due = start + (long)(i * period);
+						long wait;
+						while ((wait = due - HostClock.Now) > 0)
+						{
+							if (wait > HostClock.FromSeconds(0.002D))
+								Thread.Sleep(1);
+							else
+								Thread.Yield();
+						}
+
+						arrived[i] = HostClock.Now;
+						Volatile.Write(ref posted, i + 1);
+						xdk.ProcessRotation(trace.Rotations[i], false, arrived[i]);
+					}
+
+					Thread.Sleep(250);
+					xdk.RotationSink = null;
+				}
+
+				// Destroying the device ends the blocking read.
+				joystick.Dispose();
+				reader.Join();
+				LinuxInput.Close(fd);
+			}
+
+			List<double> latencies = new List<double>(count);
+			for (int i = 0; i < count; i++)
+			{
+				if (received[i] != 0)
+					latencies.Add(HostClock.ToMicroseconds(received[i] - arrived[i]));
+			}
+			latencies.Sort();
+
+			return new BenchmarkReport()
+				.Add("benchmark", "uinput")
+				.Add("rate_hz", rate)
+				.Add("sent", count)
+				.Add("received", latencies.Count)
+				.Add("unchanged", count - latencies.Count)
+				.Add("mismatched_frames", mismatched)
+				.Add("dropped_frames", dropped)
+				.AddPercentiles("latency_us", latencies);
+		}
+
+		private static void ReadBack(int fd, JoystickMapping mapping, int[][] expected, long[] arrived, long[] received,
+			ref int posted, ref int mismatched, ref int dropped)
+		{
+			byte[] buffer = new byte[64 * LinuxInput.EventSize];
+			int[] current = new int[3];
+			bool isSynced = true;
+			int next = 0;
+			while (true)
+			{
+				int read;
+				try
+				{
+					read = LinuxInput.Read(fd, buffer, buffer.Length);
+				}
+				catch (IOException)
+				{
+					break;
+				}
+				if (read <= 0)
+					break;
+
+				long timestamp = HostClock.Now;
+				for (int offset = 0; offset + LinuxInput.EventSize <= read; offset += LinuxInput.EventSize)
+				{
+					ushort type, code;
+					int value;
+					LinuxInput.ReadEvent(buffer, offset, out type, out code, out value);
+					if (type == LinuxInput.EvAbs)
+					{
+						if (code == mapping.Yaw.Code)
+							current[0] = value;
+						else if (code == mapping.Pitch.Code)
+							current[1] = value;
+						else if (code == mapping.Roll.Code)
+							current[2] = value;
+					}
+					else if (type == LinuxInput.EvSyn && code != LinuxInput.SynReport)
+					{
+						// SYN_DROPPED, the evdev buffer overflowed and the axis state
+						// is unknown until the next complete frame.
+						dropped++;
+						isSynced = false;
+					}
+					else if (type == LinuxInput.EvSyn)
+					{
+						int end = Math.Min(Volatile.Read(ref posted), next + Lookahead);
+						int match = -1;
+						for (int i = next; i < end && match < 0; i++)
+						{
+							if (expected[i][0] == current[0] && expected[i][1] == current[1] && expected[i][2] == current[2])
+								match = i;
+						}
+						if (match >= 0)
+						{
+							received[match] = timestamp;
+							next = match + 1;
+						}
+						else if (isSynced)
+						{
+							mismatched++;
+						}
+						isSynced = true;
+					}
+				}
+			}
+		}
+	}
+}
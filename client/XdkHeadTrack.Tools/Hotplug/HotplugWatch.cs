@@ -0,0 +1,211 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using XdkHeadTrack.Tools.Benchmarks;
+using XdkHeadTrack.Tools.Linux;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Hotplug
+{
+	/// <summary>
+	/// Watches serial ports come and go through kernel uevents, to see how
+	/// fast a device is back after a cable glitch or a USB reset on Linux,
+	/// where the GUI does not run. A tty that is added again for a device
+	/// removed before, matched by its USB serial number or by the port name
+	/// for devices without one, counts as replug: reported are the times from
+	/// the removal until the add event and until the port opened.
+	///
+	/// Needs Linux.
+	///
+	/// Usage: hotplug-watch [duration-s]
+	/// Prints one JSON line per tty added or removed, and a summary of the
+	/// replugs at the end.
+	/// </summary>
+	public static class HotplugWatch
+	{
+		// udev sets the permissions of the node after the add event.
+		private static readonly TimeSpan OpenTimeout = TimeSpan.FromSeconds(2D);
+		private static readonly TimeSpan OpenRetryInterval = TimeSpan.FromMilliseconds(1D);
+
+		private const int NoControllingTerminal = 0x100;
+
+		private static readonly object _lock = new object();
+		// Device name below /dev -> USB serial number, of the ttys seen.
+		private static readonly Dictionary<string, string> _serialNumbers = new Dictionary<string, string>();
+		// Serial number, or port of devices without one -> time it was removed.
+		private static readonly Dictionary<string, long> _removals = new Dictionary<string, long>();
+		private static readonly List<double> _addTimes = new List<double>();
+		private static readonly List<double> _openTimes = new List<double>();
+		private static readonly List<Task> _opens = new List<Task>();
+		private static int _openFailures;
+
+		public static int Run(string[] args)
+		{
+			double duration = args.Length > 0 ? double.Parse(args[0], CultureInfo.InvariantCulture) : 60D;
+
+			if (!LinuxInput.IsSupported)
+			{
+				Console.Error.WriteLine("hotplug-watch needs Linux.");
+				return 1;
+			}
+
+			// A removal only tells the device name, its sysfs entry may be gone.
+			foreach (string tty in Directory.GetDirectories("/sys/class/tty"))
+			{
+				string name = Path.GetFileName(tty);
+				string serialNumber = GetSerialNumber(name);
+				if (serialNumber != null)
+					_serialNumbers[name] = serialNumber;
+			}
+
+			try
+			{
+				using (LinuxUeventMonitor monitor = new LinuxUeventMonitor())
+				{
+					monitor.Received += HandleUevent;
+					monitor.Start();
+					Thread.Sleep(TimeSpan.FromSeconds(duration));
+					monitor.Stop();
+				}
+			}
+			catch (IOException e)
+			{
+				Console.Error.WriteLine(e.Message);
+				return 1;
+			}
+
+			Task[] opens;
+			lock (_lock)
+				opens = _opens.ToArray();
+			Task.WaitAll(opens);
+
+			lock (_lock)
+			{
+				_addTimes.Sort();
+				_openTimes.Sort();
+				Console.WriteLine(new BenchmarkReport()
+					.Add("replugs", _addTimes.Count)
+					.Add("open_failures", _openFailures)
+					.AddPercentiles("add_ms", _addTimes)
+					.AddPercentiles("open_ms", _openTimes));
+			}
+			return 0;
+		}
+
+		private static void HandleUevent(object sender, LinuxUeventArgs e)
+		{
+			if (e.Subsystem != "tty" || e.DevName == null || (e.Action != "add" && e.Action != "remove"))
+				return;
+
+			long now = HostClock.Now;
+			string port = "/dev/" + e.DevName;
+			lock (_lock)
+			{
+				string serialNumber;
+				if (e.Action == "remove")
+				{
+					_serialNumbers.TryGetValue(e.DevName, out serialNumber);
+					_serialNumbers.Remove(e.DevName);
+					_removals[serialNumber ?? port] = now;
+					Report(e.Action, port, serialNumber, double.NaN);
+					return;
+				}
+
+				serialNumber = GetSerialNumber(e.DevName);
+				if (serialNumber != null)
+					_serialNumbers[e.DevName] = serialNumber;
+				long removedAt;
+				if (!_removals.TryGetValue(serialNumber ?? port, out removedAt))
+				{
+					Report(e.Action, port, serialNumber, double.NaN);
+					return;
+				}
+
+				_removals.Remove(serialNumber ?? port);
+				double addTime = HostClock.ToMicroseconds(now - removedAt) / 1000D;
+				_addTimes.Add(addTime);
+				Report(e.Action, port, serialNumber, addTime);
+				_opens.Add(Task.Run(() => WaitForOpen(port, removedAt)));
+			}
+		}
+
+		private static void WaitForOpen(string port, long removedAt)
+		{
+			long deadline = HostClock.Now + HostClock.FromSeconds(OpenTimeout.TotalSeconds);
+			while (true)
+			{
+				try
+				{
+					LinuxInput.Close(LinuxInput.Open(port, LinuxInput.ReadOnly | LinuxInput.NonBlocking | NoControllingTerminal));
+					break;
+				}
+				catch (IOException)
+				{
+					if (HostClock.Now >= deadline)
+					{
+						Interlocked.Increment(ref _openFailures);
+						return;
+					}
+					Thread.Sleep(OpenRetryInterval);
+				}
+			}
+
+			double openTime = HostClock.ToMicroseconds(HostClock.Now - removedAt) / 1000D;
+			lock (_lock)
+			{
+				_openTimes.Add(openTime);
+				Report("open", port, null, openTime);
+			}
+		}
+
+		private static void Report(string action, string port, string serialNumber, double sinceRemovalMs)
+		{
+			Console.WriteLine(new BenchmarkReport()
+				.Add("action", action)
+				.Add("port", port)
+				.Add("serial_number", serialNumber ?? "")
+				.Add("since_removal_ms", sinceRemovalMs));
+		}
+
+		// The tty's device is the USB interface for CDC ACM, a port below the
+		// interface for USB serial bridges; the serial number is an attribute
+		// of the USB device above. The kernel resolves the ".." after the
+		// symbolic link, which the managed path functions would drop.
+		private static string GetSerialNumber(string devName)
+		{
+			string device = "/sys/class/tty/" + devName + "/device/";
+			foreach (string attribute in new[] { "../serial", "../../serial" })
+			{
+				int fd;
+				try
+				{
+					fd = LinuxInput.Open(device + attribute, LinuxInput.ReadOnly);
+				}
+				catch (IOException)
+				{
+					continue;
+				}
+				try
+				{
+					byte[] buffer = new byte[256];
+					int length = LinuxInput.Read(fd, buffer, buffer.Length);
+					string serialNumber = Encoding.ASCII.GetString(buffer, 0, length).Trim();
+					return serialNumber.Length > 0 ? serialNumber : null;
+				}
+				catch (IOException)
+				{
+					return null;
+				}
+				finally
+				{
+					LinuxInput.Close(fd);
+				}
+			}
+			return null;
+		}
+	}
+}
@@ -0,0 +1,197 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading;
+using XdkHeadTrack.Tools.Linux;
+
+namespace XdkHeadTrack.Tools.Hotplug
+{
+	/// <summary>
+	/// Hotplug events of the Linux kernel, as udev receives them: a netlink
+	/// socket of the NETLINK_KOBJECT_UEVENT family bound to the kernel's
+	/// multicast group. Events arrive as soon as the kernel added or removed
+	/// a device, without waiting for udev's rules. Received is raised on a
+	/// thread of the monitor. Failing calls throw an IOException with the
+	/// errno.
+	/// </summary>
+	public sealed class LinuxUeventMonitor : IDisposable
+	{
+		private const string Libc = "libc";
+
+		private const int AfNetlink = 16;
+		private const int SockDgram = 2;
+		private const int SockCloexec = 0x80000;
+		private const int NetlinkKobjectUevent = 15;
+		private const int KernelGroup = 1;
+		private const short PollIn = 0x1;
+		// Stop waits for the thread at most this long.
+		private const int PollTimeoutMilliseconds = 100;
+
+		[StructLayout(LayoutKind.Sequential)]
+		private struct PollFd
+		{
+			public int Fd;
+			public short Events;
+			public short Revents;
+		}
+
+		[DllImport(Libc, EntryPoint = "socket", SetLastError = true)]
+		private static extern int NativeSocket(int domain, int type, int protocol);
+
+		[DllImport(Libc, EntryPoint = "bind", SetLastError = true)]
+		private static extern int NativeBind(int fd, byte[] address, uint length);
+
+		[DllImport(Libc, EntryPoint = "poll", SetLastError = true)]
+		private static extern int NativePoll(ref PollFd fds, UIntPtr count, int timeout);
+
+		[DllImport(Libc, EntryPoint = "recv", SetLastError = true)]
+		private static extern IntPtr NativeRecv(int fd, byte[] buffer, UIntPtr length, int flags);
+
+		[DllImport(Libc, EntryPoint = "close", SetLastError = true)]
+		private static extern int NativeClose(int fd);
+
+		public event EventHandler<LinuxUeventArgs> Received;
+
+		private readonly object _lock = new object();
+		private readonly byte[] _buffer = new byte[8192];
+		private int _fd = -1;
+		private Thread _thread;
+		private volatile bool _isRunning;
+
+		public LinuxUeventMonitor()
+		{
+			if (!LinuxInput.IsSupported)
+				throw new PlatformNotSupportedException("Kernel uevents need Linux.");
+
+			_fd = NativeSocket(AfNetlink, SockDgram | SockCloexec, NetlinkKobjectUevent);
+			if (_fd < 0)
+				throw Error("socket");
+
+			// struct sockaddr_nl: family, padding, port id 0 for the kernel to
+			// pick one, multicast groups.
+			byte[] address = new byte[12];
+			LinuxInput.WriteUInt16(address, 0, AfNetlink);
+			LinuxInput.WriteInt32(address, 8, KernelGroup);
+			if (NativeBind(_fd, address, (uint)address.Length) < 0)
+			{
+				IOException e = Error("bind");
+				NativeClose(_fd);
+				_fd = -1;
+				throw e;
+			}
+		}
+
+		public void Start()
+		{
+			lock (_lock)
+			{
+				if (_thread != null)
+					return;
+				_isRunning = true;
+				_thread = new Thread(Run) { Name = "Uevent monitor", IsBackground = true };
+				_thread.Start();
+			}
+		}
+
+		public void Stop()
+		{
+			lock (_lock)
+			{
+				if (_thread == null)
+					return;
+				_isRunning = false;
+				if (_thread != Thread.CurrentThread)
+					_thread.Join();
+				_thread = null;
+			}
+		}
+
+		private void Run()
+		{
+			PollFd poll = new PollFd { Fd = _fd, Events = PollIn };
+			while (_isRunning)
+			{
+				poll.Revents = 0;
+				if (NativePoll(ref poll, new UIntPtr(1U), PollTimeoutMilliseconds) <= 0)
+					continue;
+				long length = NativeRecv(_fd, _buffer, new UIntPtr((uint)_buffer.Length), 0).ToInt64();
+				if (length <= 0)
+					continue;
+
+				LinuxUeventArgs args = Parse(_buffer, (int)length);
+				if (args != null)
+					Received?.Invoke(this, args);
+			}
+		}
+
+		/// <summary>
+		/// Parses one message of the kernel: "action@devpath", then KEY=VALUE
+		/// pairs, each terminated by a zero byte. Null if it is none.
+		/// </summary>
+		public static LinuxUeventArgs Parse(byte[] buffer, int length)
+		{
+			int end = Array.IndexOf(buffer, (byte)0, 0, length);
+			if (end < 0 || Array.IndexOf(buffer, (byte)'@', 0, end) < 0)
+				return null;
+
+			Dictionary<string, string> properties = new Dictionary<string, string>(StringComparer.Ordinal);
+			for (int start = end + 1; start < length; start = end + 1)
+			{
+				end = Array.IndexOf(buffer, (byte)0, start, length - start);
+				if (end < 0)
+					end = length;
+				string pair = Encoding.ASCII.GetString(buffer, start, end - start);
+				int separator = pair.IndexOf('=');
+				if (separator > 0)
+					properties[pair.Substring(0, separator)] = pair.Substring(separator + 1);
+			}
+			return properties.ContainsKey("ACTION") ? new LinuxUeventArgs(properties) : null;
+		}
+
+		public void Dispose()
+		{
+			Stop();
+			if (_fd >= 0)
+			{
+				NativeClose(_fd);
+				_fd = -1;
+			}
+		}
+
+		private static IOException Error(string call)
+		{
+			int errno = Marshal.GetLastWin32Error();
+			return new IOException(call + " failed with errno " + errno + ".");
+		}
+	}
+
+	public class LinuxUeventArgs : EventArgs
+	{
+		private readonly IReadOnlyDictionary<string, string> _properties;
+
+		/// <summary>"add", "remove", "change", "bind" and so on.</summary>
+		public string Action => this["ACTION"];
+		public string Subsystem => this["SUBSYSTEM"];
+		/// <summary>Path of the device below /sys.</summary>
+		public string DevPath => this["DEVPATH"];
+		/// <summary>Name of the device node below /dev, null if it has none.</summary>
+		public string DevName => this["DEVNAME"];
+
+		/// <summary>Value of a property of the event, null if it has none.</summary>
+		public string this[string key]
+		{
+			get
+			{
+				string value;
+				return _properties.TryGetValue(key, out value) ? value : null;
+			}
+		}
+
+		public LinuxUeventArgs(IReadOnlyDictionary<string, string> properties)
+		{
+			_properties = properties;
+		}
+	}
+}
@@ -0,0 +1,218 @@
+﻿using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace XdkHeadTrack.Tools.Linux
+{
+	/// <summary>
+	/// The parts of the Linux input subsystem used by UinputJoystick: libc
+	/// file calls, the uinput ioctls and struct input_event, see
+	/// linux/input.h and linux/uinput.h. Failing calls throw an IOException
+	/// with the errno.
+	/// </summary>
+	public static class LinuxInput
+	{
+		private const string Libc = "libc";
+
+		public const int ReadOnly = 0x0;
+		public const int WriteOnly = 0x1;
+		public const int NonBlocking = 0x800;
+
+		public const ushort EvSyn = 0x00;
+		public const ushort EvKey = 0x01;
+		public const ushort EvAbs = 0x03;
+		public const ushort SynReport = 0x00;
+		public const ushort BtnTrigger = 0x120;
+		public const ushort AbsX = 0x00;
+		public const ushort AbsY = 0x01;
+		public const ushort AbsZ = 0x02;
+		public const ushort AbsRx = 0x03;
+		public const ushort AbsRy = 0x04;
+		public const ushort AbsRz = 0x05;
+		public const ushort BusVirtual = 0x06;
+
+		public const int MaxNameLength = 80;
+		// struct uinput_setup: struct input_id, name, ff_effects_max.
+		public const int SetupSize = 8 + MaxNameLength + 4;
+		// struct uinput_abs_setup: code, padding, struct input_absinfo.
+		public const int AbsSetupSize = 4 + 6 * 4;
+
+		public static readonly UIntPtr UiDevCreate = Io(1);
+		public static readonly UIntPtr UiDevDestroy = Io(2);
+		public static readonly UIntPtr UiDevSetup = Iow(3, SetupSize);
+		public static readonly UIntPtr UiAbsSetup = Iow(4, AbsSetupSize);
+		public static readonly UIntPtr UiSetEvBit = Iow(100, sizeof(int));
+		public static readonly UIntPtr UiSetKeyBit = Iow(101, sizeof(int));
+		public static readonly UIntPtr UiSetAbsBit = Iow(103, sizeof(int));
+
+		private const int SysNameLength = 64;
+		// UI_GET_SYSNAME(len), _IOC_READ in the direction bits.
+		private static readonly UIntPtr UiGetSysName = new UIntPtr(2U << 30 | (uint)(SysNameLength << 16 | 'U' << 8 | 44));
+
+		/// <summary>
+		/// struct input_event: a struct timeval, type, code and value. The
+		/// timeval is two longs, 8 or 16 bytes depending on the process.
+		/// </summary>
+		public static readonly int EventSize = 2 * IntPtr.Size + 8;
+
+		[DllImport(Libc, EntryPoint = "open", SetLastError = true)]
+		private static extern int NativeOpen([MarshalAs(UnmanagedType.LPStr)] string path, int flags);
+
+		[DllImport(Libc, EntryPoint = "close", SetLastError = true)]
+		private static extern int NativeClose(int fd);
+
+		[DllImport(Libc, EntryPoint = "ioctl", SetLastError = true)]
+		private static extern int NativeIoctl(int fd, UIntPtr request, IntPtr value);
+
+		[DllImport(Libc, EntryPoint = "ioctl", SetLastError = true)]
+		private static extern int NativeIoctl(int fd, UIntPtr request, byte[] data);
+
+		[DllImport(Libc, EntryPoint = "read", SetLastError = true)]
+		private static extern IntPtr NativeRead(int fd, byte[] buffer, UIntPtr count);
+
+		[DllImport(Libc, EntryPoint = "write", SetLastError = true)]
+		private static extern IntPtr NativeWrite(int fd, byte[] buffer, UIntPtr count);
+
+		[DllImport(Libc, EntryPoint = "uname", SetLastError = true)]
+		private static extern int NativeUname(byte[] name);
+
+		private static readonly Lazy<bool> _isSupported = new Lazy<bool>(IsLinux);
+
+		/// <summary>
+		/// True on Linux only. PlatformID.Unix also stands for macOS and the
+		/// BSDs, which have neither uinput nor these ioctls.
+		/// </summary>
+		public static bool IsSupported => _isSupported.Value;
+
+		// struct utsname starts with sysname. Its fields are 65 bytes on Linux,
+		// the buffer also fits the larger ones of other systems.
+		private static bool IsLinux()
+		{
+			if (Environment.OSVersion.Platform != PlatformID.Unix)
+				return false;
+			byte[] name = new byte[8192];
+			try
+			{
+				if (NativeUname(name) < 0)
+					return false;
+			}
+			catch (Exception e) when (e is DllNotFoundException || e is EntryPointNotFoundException)
+			{
+				return false;
+			}
+			int length = Array.IndexOf(name, (byte)0);
+			return Encoding.ASCII.GetString(name, 0, length < 0 ? name.Length : length) == "Linux";
+		}
+
+		public static int Open(string path, int flags)
+		{
+			int fd = NativeOpen(path, flags);
+			if (fd < 0)
+				throw Error("open " + path);
+			return fd;
+		}
+
+		public static void Close(int fd)
+		{
+			NativeClose(fd);
+		}
+
+		public static void Ioctl(int fd, UIntPtr request, int value)
+		{
+			if (NativeIoctl(fd, request, new IntPtr(value)) < 0)
+				throw Error("ioctl 0x" + request.ToUInt64().ToString("x"));
+		}
+
+		public static void Ioctl(int fd, UIntPtr request, byte[] data)
+		{
+			if (NativeIoctl(fd, request, data) < 0)
+				throw Error("ioctl 0x" + request.ToUInt64().ToString("x"));
+		}
+
+		/// <summary>
+		/// Name of a created uinput device below /sys/devices/virtual/input.
+		/// </summary>
+		public static string GetSysName(int fd)
+		{
+			byte[] name = new byte[SysNameLength];
+			Ioctl(fd, UiGetSysName, name);
+			int length = Array.IndexOf(name, (byte)0);
+			return Encoding.ASCII.GetString(name, 0, length < 0 ? name.Length : length);
+		}
+
+		/// <summary>
+		/// Returns the bytes read, 0 at the end of the file.
+		/// </summary>
+		public static int Read(int fd, byte[] buffer, int count)
+		{
+			long read = NativeRead(fd, buffer, new UIntPtr((uint)count)).ToInt64();
+			if (read < 0)
+				throw Error("read");
+			return (int)read;
+		}
+
+		public static void Write(int fd, byte[] buffer, int count)
+		{
+			long written = NativeWrite(fd, buffer, new UIntPtr((uint)count)).ToInt64();
+			if (written != count)
+				throw Error("write");
+		}
+
+		/// <summary>
+		/// Writes one input_event with a zero time, the kernel stamps the events
+		/// written to uinput itself. Returns the offset after it.
+		/// </summary>
+		public static int WriteEvent(byte[] buffer, int offset, ushort type, ushort code, int value)
+		{
+			Array.Clear(buffer, offset, 2 * IntPtr.Size);
+			offset += 2 * IntPtr.Size;
+			WriteUInt16(buffer, offset, type);
+			WriteUInt16(buffer, offset + 2, code);
+			WriteInt32(buffer, offset + 4, value);
+			return offset + 8;
+		}
+
+		/// <summary>
+		/// Reads type, code and value of the input_event at offset.
+		/// </summary>
+		public static void ReadEvent(byte[] buffer, int offset, out ushort type, out ushort code, out int value)
+		{
+			offset += 2 * IntPtr.Size;
+			type = (ushort)(buffer[offset] | buffer[offset + 1] << 8);
+			code = (ushort)(buffer[offset + 2] | buffer[offset + 3] << 8);
+			value = buffer[offset + 4] | buffer[offset + 5] << 8 | buffer[offset + 6] << 16 | buffer[offset + 7] << 24;
+		}
+
+		public static void WriteUInt16(byte[] buffer, int offset, int value)
+		{
+			buffer[offset] = (byte)value;
+			buffer[offset + 1] = (byte)(value >> 8);
+		}
+
+		public static void WriteInt32(byte[] buffer, int offset, int value)
+		{
+			buffer[offset] = (byte)value;
+			buffer[offset + 1] = (byte)(value >> 8);
+			buffer[offset + 2] = (byte)(value >> 16);
+			buffer[offset + 3] = (byte)(value >> 24);
+		}
+
+		private static UIntPtr Io(int number)
+		{
+			return new UIntPtr((uint)('U' << 8 | number));
+		}
+
+		private static UIntPtr Iow(int number, int size)
+		{
+			// _IOC_WRITE in the direction bits, the argument size below them.
+			return new UIntPtr(1U << 30 | (uint)size << 16 | (uint)('U' << 8 | number));
+		}
+
+		private static IOException Error(string call)
+		{
+			int errno = Marshal.GetLastWin32Error();
+			return new IOException(call + " failed with errno " + errno + ".");
+		}
+	}
+}
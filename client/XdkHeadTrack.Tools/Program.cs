@@ -0,0 +1,46 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using XdkHeadTrack.Tools.Benchmarks;
+using XdkHeadTrack.Tools.Hotplug;
+using XdkHeadTrack.Tools.Simulation;
+using XdkHeadTrack.Tools.Traces;
+
+namespace XdkHeadTrack.Tools
+{
+	public static class Program
+	{
+		private static readonly Dictionary<string, Func<string[], int>> Commands = new Dictionary<string, Func<string[], int>>
+		{
+			{ "filter-bench", FilterBenchmark.Run },
+			{ "e2e-bench", EndToEndBenchmark.Run },
+			{ "micro-bench", KernelBenchmarks.Run },
+			{ "aggregator-bench", AggregatorBenchmark.Run },
+			{ "failover-sim", FailoverBenchmark.Run },
+			{ "loss-replay", LossReplayBenchmark.Run },
+			{ "clock-sync-sim", ClockSyncBenchmark.Run },
+			{ "sim-device", SimulatedXdk.RunCommand },
+			{ "sim-fleet", SimulatedFleet.RunCommand },
+			{ "flight-recorder", FlightRecordingDecoder.Run },
+			{ "trace-analytics", TraceAnalytics.Run },
+			{ "uinput-bench", UinputBenchmark.Run },
+			{ "load-gen", LoadBenchmark.Run },
+			{ "hotplug-watch", HotplugWatch.Run },
+		};
+
+		public static int Main(string[] args)
+		{
+			Func<string[], int> command;
+			if (args.Length == 0 || !Commands.TryGetValue(args[0], out command))
+			{
+				Console.Error.WriteLine("Usage: XdkHeadTrack.Tools <command> [options]");
+				Console.Error.WriteLine("Commands:");
+				foreach (string name in Commands.Keys)
+					Console.Error.WriteLine("  " + name);
+				return 1;
+			}
+
+			return command(args.Skip(1).ToArray());
+		}
+	}
+}
@@ -0,0 +1,98 @@
+﻿using System;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	/// <summary>
+	/// Faults of a link, as probabilities per sample unless noted otherwise.
+	/// </summary>
+	public class FaultProfile
+	{
+		/// <summary>One bit of the encoded sample is flipped.</summary>
+		public double CorruptionRate { get; set; }
+		/// <summary>The sample is not sent.</summary>
+		public double DropRate { get; set; }
+		/// <summary>A burst of BurstLength samples is not sent.</summary>
+		public double BurstRate { get; set; }
+		public int BurstLength { get; set; } = 10;
+		/// <summary>Disconnects per minute and device, each lasting DisconnectDuration seconds.</summary>
+		public double DisconnectsPerMinute { get; set; }
+		public double DisconnectDuration { get; set; } = 1D;
+
+		public bool IsFaultFree => CorruptionRate <= 0D && DropRate <= 0D && BurstRate <= 0D && DisconnectsPerMinute <= 0D;
+	}
+
+	public enum FaultAction
+	{
+		None,
+		Corrupt,
+		Drop,
+		Disconnect,
+	}
+
+	/// <summary>
+	/// Decides the fault of every sample of one device after a FaultProfile,
+	/// reproducibly for a seed.
+	/// </summary>
+	public class FaultInjector
+	{
+		private readonly FaultProfile _profile;
+		private readonly Random _random;
+		private readonly double _disconnectRate;
+		private int _burstRemaining;
+
+		public long Corrupted { get; private set; }
+		public long Dropped { get; private set; }
+		public long Disconnects { get; private set; }
+
+		public FaultInjector(FaultProfile profile, double sampleRate, int seed)
+		{
+			_profile = profile;
+			_random = new Random(seed);
+			_disconnectRate = profile.DisconnectsPerMinute / (60D * sampleRate);
+		}
+
+		public FaultAction Next()
+		{
+			if (_burstRemaining == 0 && _random.NextDouble() < _profile.BurstRate)
+				_burstRemaining = _profile.BurstLength;
+			if (_burstRemaining > 0)
+			{
+				_burstRemaining--;
+				Dropped++;
+				return FaultAction.Drop;
+			}
+			if (_random.NextDouble() < _disconnectRate)
+			{
+				Disconnects++;
+				return FaultAction.Disconnect;
+			}
+			if (_random.NextDouble() < _profile.DropRate)
+			{
+				Dropped++;
+				return FaultAction.Drop;
+			}
+			if (_random.NextDouble() < _profile.CorruptionRate)
+			{
+				Corrupted++;
+				return FaultAction.Corrupt;
+			}
+			return FaultAction.None;
+		}
+
+		/// <summary>
+		/// Flips one random bit of the bytes.
+		/// </summary>
+		public void Corrupt(byte[] buffer, int offset, int count)
+		{
+			buffer[offset + _random.Next(count)] ^= (byte)(1 << _random.Next(8));
+		}
+
+		/// <summary>
+		/// Bytes of a sample still sent when the link goes down in the middle of it.
+		/// </summary>
+		public int CutLength(int count)
+		{
+			return _random.Next(count);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+﻿using System;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Traces;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	/// <summary>
+	/// Generates synthetic head motion: rest phases alternating with
+	/// minimum-jerk turns in yaw and pitch, plus white sensor noise.
+	/// </summary>
+	public class HeadMotionModel
+	{
+		public double MaxYaw { get; set; } = 70D;
+		public double MaxPitch { get; set; } = 25D;
+		public double MinRestDuration { get; set; } = 0.5D;
+		public double MaxRestDuration { get; set; } = 3D;
+		public double MinTurnDuration { get; set; } = 0.25D;
+		public double MaxTurnDuration { get; set; } = 1D;
+		public double NoiseDegrees { get; set; } = 0.15D;
+
+		private readonly Random _random;
+		private double _fromYaw, _fromPitch, _toYaw, _toPitch;
+		private double _segmentStart, _segmentEnd;
+		private bool _isTurning;
+		private double _time;
+
+		public HeadMotionModel(int seed)
+		{
+			_random = new Random(seed);
+			StartRest(0D);
+		}
+
+		/// <summary>
+		/// Advances the model by dt seconds and returns the true and the noisy orientation.
+		/// </summary>
+		public Quaternion Next(double dt, out Quaternion truth)
+		{
+			_time += dt;
+			while (_time >= _segmentEnd)
+			{
+				if (_isTurning)
+					StartRest(_segmentEnd);
+				else
+					StartTurn(_segmentEnd);
+			}
+
+			double yaw = _fromYaw, pitch = _fromPitch;
+			if (_isTurning)
+			{
+				double s = (_time - _segmentStart) / (_segmentEnd - _segmentStart);
+				double blend = s * s * s * (10D + s * (-15D + 6D * s));
+				yaw += (_toYaw - _fromYaw) * blend;
+				pitch += (_toPitch - _fromPitch) * blend;
+			}
+
+			truth = FromYawPitch(yaw, pitch);
+			return truth * RandomRotation(NoiseDegrees);
+		}
+
+		public RotationTrace Generate(double seconds, double sampleRate, out RotationTrace truth)
+		{
+			int count = (int)(seconds * sampleRate);
+			RotationTrace noisy = new RotationTrace(count);
+			truth = new RotationTrace(count);
+			double dt = 1D / sampleRate;
+			for (int i = 0; i < count; i++)
+			{
+				Quaternion t;
+				Quaternion n = Next(dt, out t);
+				noisy.Add(i * dt, n);
+				truth.Add(i * dt, t);
+			}
+			return noisy;
+		}
+
+		public static Quaternion FromYawPitch(double yawDegrees, double pitchDegrees)
+		{
+			return new Quaternion(new Vector3D(0, 0, 1), yawDegrees) * new Quaternion(new Vector3D(0, 1, 0), pitchDegrees);
+		}
+
+		private void StartRest(double start)
+		{
+			_isTurning = false;
+			_fromYaw = _toYaw;
+			_fromPitch = _toPitch;
+			_segmentStart = start;
+			_segmentEnd = start + Uniform(MinRestDuration, MaxRestDuration);
+		}
+
+		private void StartTurn(double start)
+		{
+			_isTurning = true;
+			_toYaw = Uniform(-MaxYaw, MaxYaw);
+			_toPitch = Uniform(-MaxPitch, MaxPitch);
+			_segmentStart = start;
+			_segmentEnd = start + Uniform(MinTurnDuration, MaxTurnDuration);
+		}
+
+		private Quaternion RandomRotation(double sigmaDegrees)
+		{
+			if (sigmaDegrees <= 0D)
+				return Quaternion.Identity;
+			Vector3D axis = new Vector3D(Gaussian(), Gaussian(), Gaussian());
+			if (axis.Length == 0D)
+				return Quaternion.Identity;
+			return new Quaternion(axis, Gaussian() * sigmaDegrees);
+		}
+
+		private double Uniform(double min, double max)
+		{
+			return min + _random.NextDouble() * (max - min);
+		}
+
+		private double Gaussian()
+		{
+			double u1 = 1D - _random.NextDouble();
+			double u2 = _random.NextDouble();
+			return Math.Sqrt(-2D * Math.Log(u1)) * Math.Cos(2D * Math.PI * u2);
+		}
+	}
+}
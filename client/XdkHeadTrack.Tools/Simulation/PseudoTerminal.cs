@@ -0,0 +1,128 @@
+﻿using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Text;
+using XdkHeadTrack.Tools.Linux;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	/// <summary>
+	/// A Linux pseudo terminal pair standing in for the USB serial port of an
+	/// XDK. The device side writes to the master, a host opens SlavePath like
+	/// any other serial port. The terminal is switched to raw mode, so bytes
+	/// pass unchanged and nothing is echoed back to the master.
+	///
+	/// The master is non-blocking: once the host stops reading and the
+	/// terminal's buffer is full, Write returns less than asked for, like a
+	/// UART overrunning its FIFO.
+	/// </summary>
+	public sealed class PseudoTerminal : IDisposable
+	{
+		private const string Libc = "libc";
+		private const int ReadWrite = 0x2;
+		private const int NoControllingTerminal = 0x100;
+		private const int SetNow = 0;
+		private const int WouldBlock = 11;
+		// Larger than struct termios on any Linux ABI, only passed through.
+		private const int TermiosSize = 256;
+
+		private int _master = -1;
+		private int _slave = -1;
+
+		public string SlavePath { get; private set; }
+
+		[DllImport(Libc, EntryPoint = "grantpt", SetLastError = true)]
+		private static extern int NativeGrantPt(int fd);
+
+		[DllImport(Libc, EntryPoint = "unlockpt", SetLastError = true)]
+		private static extern int NativeUnlockPt(int fd);
+
+		[DllImport(Libc, EntryPoint = "ptsname_r", SetLastError = true)]
+		private static extern int NativePtsName(int fd, byte[] buffer, UIntPtr length);
+
+		[DllImport(Libc, EntryPoint = "tcgetattr", SetLastError = true)]
+		private static extern int NativeGetAttributes(int fd, byte[] termios);
+
+		[DllImport(Libc, EntryPoint = "tcsetattr", SetLastError = true)]
+		private static extern int NativeSetAttributes(int fd, int action, byte[] termios);
+
+		[DllImport(Libc, EntryPoint = "cfmakeraw")]
+		private static extern void NativeMakeRaw(byte[] termios);
+
+		[DllImport(Libc, EntryPoint = "write", SetLastError = true)]
+		private static extern IntPtr NativeWrite(int fd, byte[] buffer, UIntPtr count);
+
+		public PseudoTerminal()
+		{
+			if (!LinuxInput.IsSupported)
+				throw new PlatformNotSupportedException("Pseudo terminals are only available on Linux.");
+
+			_master = LinuxInput.Open("/dev/ptmx", ReadWrite | NoControllingTerminal | LinuxInput.NonBlocking);
+			try
+			{
+				byte[] name = new byte[64];
+				if (NativeGrantPt(_master) < 0 || NativeUnlockPt(_master) < 0)
+					throw Error("unlockpt");
+				int error = NativePtsName(_master, name, new UIntPtr((uint)name.Length));
+				if (error != 0)
+					throw new IOException("ptsname_r failed with errno " + error + ".");
+				SlavePath = Encoding.ASCII.GetString(name, 0, Array.IndexOf(name, (byte)0));
+
+				// Held open so the terminal keeps its settings and the master
+				// stays writable while no host is attached.
+				_slave = LinuxInput.Open(SlavePath, ReadWrite | NoControllingTerminal);
+				byte[] termios = new byte[TermiosSize];
+				if (NativeGetAttributes(_slave, termios) < 0)
+					throw Error("tcgetattr");
+				NativeMakeRaw(termios);
+				if (NativeSetAttributes(_slave, SetNow, termios) < 0)
+					throw Error("tcsetattr");
+			}
+			catch
+			{
+				Dispose();
+				throw;
+			}
+		}
+
+		/// <summary>
+		/// Opens the host side for reading, as the host would open the port.
+		/// </summary>
+		public FileStream OpenSlave()
+		{
+			return new FileStream(SlavePath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite, 1, true);
+		}
+
+		/// <summary>
+		/// Writes to the device side and returns the bytes taken, fewer than
+		/// count if the terminal's buffer is full.
+		/// </summary>
+		public int Write(byte[] buffer, int count)
+		{
+			long written = NativeWrite(_master, buffer, new UIntPtr((uint)count)).ToInt64();
+			if (written >= 0)
+				return (int)written;
+			if (Marshal.GetLastWin32Error() == WouldBlock)
+				return 0;
+			throw Error("write");
+		}
+
+		/// <summary>
+		/// Closing the master ends the host's reads, like unplugging the XDK.
+		/// </summary>
+		public void Dispose()
+		{
+			if (_master >= 0)
+				LinuxInput.Close(_master);
+			if (_slave >= 0)
+				LinuxInput.Close(_slave);
+			_master = -1;
+			_slave = -1;
+		}
+
+		private static IOException Error(string call)
+		{
+			return new IOException(call + " failed with errno " + Marshal.GetLastWin32Error() + ".");
+		}
+	}
+}
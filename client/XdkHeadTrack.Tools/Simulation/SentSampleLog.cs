@@ -0,0 +1,51 @@
+﻿using System.Threading;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	/// <summary>
+	/// HostClock times of the samples a simulated device sent recently, by
+	/// their 16 bit sequence number, for matching what the host under test
+	/// received. Written by the device thread, taken by the host's threads.
+	/// </summary>
+	public class SentSampleLog
+	{
+		// Sent samples are remembered this long.
+		public const int Size = 4096;
+
+		private readonly long[] _sentTimes = new long[Size];
+		private readonly int[] _sequences = new int[Size];
+		private readonly bool[] _isCorrupted = new bool[Size];
+
+		public void Add(int sequence, long sentTime, bool isCorrupted)
+		{
+			int slot = sequence & (Size - 1);
+			_isCorrupted[slot] = isCorrupted;
+			Volatile.Write(ref _sequences[slot], sequence);
+			Volatile.Write(ref _sentTimes[slot], sentTime);
+		}
+
+		/// <summary>
+		/// Forgets a sample that did not make it onto the link after all.
+		/// </summary>
+		public void Remove(int sequence)
+		{
+			Volatile.Write(ref _sentTimes[sequence & (Size - 1)], 0L);
+		}
+
+		/// <summary>
+		/// Takes the sent sample with the sequence number the host saw. Returns
+		/// false for samples never sent, corrupted into another sequence number
+		/// or already taken.
+		/// </summary>
+		public bool TryTake(int sequence, out long sentTime, out bool isCorrupted)
+		{
+			int slot = sequence & (Size - 1);
+			isCorrupted = _isCorrupted[slot];
+			sentTime = 0;
+			if ((ushort)Volatile.Read(ref _sequences[slot]) != sequence)
+				return false;
+			sentTime = Interlocked.Exchange(ref _sentTimes[slot], 0L);
+			return sentTime != 0;
+		}
+	}
+}
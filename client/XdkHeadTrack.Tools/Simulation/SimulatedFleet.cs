@@ -0,0 +1,98 @@
+﻿using System;
+using System.Globalization;
+using System.IO;
+using System.IO.Pipes;
+using System.Text;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	/// <summary>
+	/// Many simulated XDKs streaming serial text lines into named pipes, driven
+	/// from a single thread so that the device side stays cheap even for large
+	/// fleets. The start times of the devices are spread evenly over one period.
+	/// </summary>
+	public class SimulatedFleet
+	{
+		public double SampleRate { get; set; } = 100D;
+
+		private readonly HeadMotionModel[] _motions;
+		private readonly Stream[] _outputs;
+
+		public SimulatedFleet(Stream[] outputs)
+		{
+			_outputs = outputs;
+			_motions = new HeadMotionModel[outputs.Length];
+			for (int i = 0; i < outputs.Length; i++)
+				_motions[i] = new HeadMotionModel(i + 1);
+		}
+
+		/// <summary>
+		/// Streams samples for the given duration, reporting device index,
+		/// sequence number and host timestamp of every sample right before it is written.
+		/// </summary>
+		public void Run(double duration, Action<int, int, long> onSampleSent)
+		{
+			int deviceCount = _outputs.Length;
+			double dt = 1D / SampleRate;
+			long period = HostClock.FromSeconds(dt);
+			int count = (int)(duration * SampleRate);
+			long start = HostClock.Now;
+
+			for (int step = 0; step < count * deviceCount; step++)
+			{
+				int device = step % deviceCount;
+				int seq = step / deviceCount;
+				SimulatedXdk.WaitUntil(start + seq * period + period * device / deviceCount);
+
+				Quaternion truth;
+				Quaternion rotation = _motions[device].Next(dt, out truth);
+				byte[] line = Encoding.ASCII.GetBytes(SimulatedXdk.FormatSerialLine(rotation, false, seq));
+				onSampleSent?.Invoke(device, seq, HostClock.Now);
+				_outputs[device].Write(line, 0, line.Length);
+				_outputs[device].Flush();
+			}
+		}
+
+		/// <summary>
+		/// Entry point of the sim-fleet command, used as child process by the
+		/// aggregator benchmark. Connects to the pipes "prefix0" .. "prefixN-1"
+		/// and writes "device seq timestamp" lines to the given log file.
+		///
+		/// Usage: sim-fleet pipe-prefix device-count rate-hz duration-s log-file
+		/// </summary>
+		public static int RunCommand(string[] args)
+		{
+			if (args.Length < 5)
+			{
+				Console.Error.WriteLine("Usage: sim-fleet pipe-prefix device-count rate-hz duration-s log-file");
+				return 1;
+			}
+			int deviceCount = int.Parse(args[1], CultureInfo.InvariantCulture);
+			NamedPipeClientStream[] pipes = new NamedPipeClientStream[deviceCount];
+			try
+			{
+				for (int i = 0; i < deviceCount; i++)
+				{
+					pipes[i] = new NamedPipeClientStream(".", args[0] + i.ToString(CultureInfo.InvariantCulture), PipeDirection.Out);
+					pipes[i].Connect();
+				}
+
+				SimulatedFleet fleet = new SimulatedFleet(pipes);
+				fleet.SampleRate = double.Parse(args[2], CultureInfo.InvariantCulture);
+				using (StreamWriter log = new StreamWriter(args[4], false, Encoding.ASCII, 1 << 16))
+				{
+					fleet.Run(double.Parse(args[3], CultureInfo.InvariantCulture), (device, seq, timestamp) =>
+						log.WriteLine(device.ToString(CultureInfo.InvariantCulture) + " " + seq.ToString(CultureInfo.InvariantCulture) + " " + timestamp.ToString(CultureInfo.InvariantCulture)));
+				}
+			}
+			finally
+			{
+				foreach (NamedPipeClientStream pipe in pipes)
+					pipe?.Dispose();
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,144 @@
+﻿using System;
+using System.Globalization;
+using System.IO;
+using System.Text;
+using System.Threading;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	public enum SimulatedTransport
+	{
+		Serial,
+		Ble,
+	}
+
+	/// <summary>
+	/// Stand-in for the XDK firmware. Emits the serial text lines or the BLE
+	/// notification payloads of HeadTrack.c at a fixed rate. The BLE stand-in
+	/// delivers all notifications queued during one connection interval at once.
+	/// </summary>
+	public class SimulatedXdk
+	{
+		public double SampleRate { get; set; } = 50D;
+		public SimulatedTransport Transport { get; set; } = SimulatedTransport.Serial;
+		public double BleConnectionInterval { get; set; } = 0.0075D;
+
+		private readonly HeadMotionModel _motion;
+
+		public SimulatedXdk(int seed)
+		{
+			_motion = new HeadMotionModel(seed);
+		}
+
+		public static string FormatSerialLine(Quaternion rotation, bool isCalibration)
+		{
+			return string.Format(CultureInfo.InvariantCulture, "{0} {1:F6} {2:F6} {3:F6} {4:F6}\n",
+				isCalibration ? ">>CALI:" : ">>QUAT:", (float)rotation.W, (float)rotation.X, (float)rotation.Y, (float)rotation.Z);
+		}
+
+		public static string FormatSerialLine(Quaternion rotation, bool isCalibration, int sequence)
+		{
+			return string.Format(CultureInfo.InvariantCulture, "{0} {1:F6} {2:F6} {3:F6} {4:F6} {5}\n",
+				isCalibration ? ">>CALI:" : ">>QUAT:", (float)rotation.W, (float)rotation.X, (float)rotation.Y, (float)rotation.Z, (ushort)sequence);
+		}
+
+		/// <summary>
+		/// The line as the current firmware sends it, with the device time in
+		/// microseconds.
+		/// </summary>
+		public static string FormatSerialLine(Quaternion rotation, bool isCalibration, int sequence, uint deviceTime)
+		{
+			return string.Format(CultureInfo.InvariantCulture, "{0} {1:F6} {2:F6} {3:F6} {4:F6} {5} {6}\n",
+				isCalibration ? XdkWire.CalibrationLineTag : XdkWire.RotationLineTag, (float)rotation.W, (float)rotation.X, (float)rotation.Y, (float)rotation.Z, (ushort)sequence, deviceTime);
+		}
+
+		/// <summary>
+		/// Streams samples to output for the given duration. The host timestamp of
+		/// every sample is reported through onSampleSent right before it is written.
+		/// </summary>
+		public int Run(Stream output, double duration, Action<int, long> onSampleSent)
+		{
+			double dt = 1D / SampleRate;
+			long period = HostClock.FromSeconds(dt);
+			long flushPeriod = Math.Max(1L, HostClock.FromSeconds(BleConnectionInterval));
+			int count = (int)(duration * SampleRate);
+			byte[] frame = new byte[XdkBleFrame.Size];
+			MemoryStream pending = new MemoryStream();
+
+			long start = HostClock.Now;
+			long nextFlush = start;
+			int seq = 0;
+			while (seq < count || pending.Length > 0)
+			{
+				long due = seq < count ? start + seq * period : long.MaxValue;
+				if (pending.Length > 0 && nextFlush <= due)
+				{
+					WaitUntil(nextFlush);
+					output.Write(pending.GetBuffer(), 0, (int)pending.Length);
+					output.Flush();
+					pending.SetLength(0);
+					continue;
+				}
+
+				WaitUntil(due);
+				Quaternion truth;
+				Quaternion rotation = _motion.Next(dt, out truth);
+
+				onSampleSent?.Invoke(seq, HostClock.Now);
+				if (Transport == SimulatedTransport.Serial)
+				{
+					byte[] line = Encoding.ASCII.GetBytes(FormatSerialLine(rotation, false, seq));
+					output.Write(line, 0, line.Length);
+					output.Flush();
+				}
+				else
+				{
+					XdkBleFrame.Encode(rotation, false, seq, frame, 0);
+					pending.Write(frame, 0, frame.Length);
+					while (nextFlush < HostClock.Now)
+						nextFlush += flushPeriod;
+				}
+				seq++;
+			}
+			return count;
+		}
+
+		internal static void WaitUntil(long timestamp)
+		{
+			long remaining;
+			while ((remaining = timestamp - HostClock.Now) > 0)
+			{
+				if (remaining > HostClock.FromSeconds(0.002D))
+					Thread.Sleep(1);
+				else
+					Thread.SpinWait(100);
+			}
+		}
+
+		/// <summary>
+		/// Entry point of the sim-device command, used as child process by the
+		/// benchmarks. Samples go to stdout, "seq timestamp" pairs to stderr.
+		///
+		/// Usage: sim-device [serial|ble] [rate-hz] [duration-s] [seed]
+		/// </summary>
+		public static int RunCommand(string[] args)
+		{
+			SimulatedXdk xdk = new SimulatedXdk(args.Length > 3 ? int.Parse(args[3], CultureInfo.InvariantCulture) : 1);
+			if (args.Length > 0)
+				xdk.Transport = args[0] == "ble" ? SimulatedTransport.Ble : SimulatedTransport.Serial;
+			if (args.Length > 1)
+				xdk.SampleRate = double.Parse(args[1], CultureInfo.InvariantCulture);
+			double duration = args.Length > 2 ? double.Parse(args[2], CultureInfo.InvariantCulture) : 5D;
+
+			using (Stream stdout = Console.OpenStandardOutput())
+			using (StreamWriter stderr = new StreamWriter(Console.OpenStandardError(), Encoding.ASCII, 1 << 16))
+			{
+				xdk.Run(stdout, duration, (seq, timestamp) => stderr.WriteLine(seq.ToString(CultureInfo.InvariantCulture) + " " + timestamp.ToString(CultureInfo.InvariantCulture)));
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,328 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Net.Sockets;
+using System.Text;
+using System.Threading;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Traces;
+using XdkHeadTrack.Utils;
+
+namespace XdkHeadTrack.Tools.Simulation
+{
+	/// <summary>
+	/// One device of a VirtualXdkFarm. Serial devices write the text lines of
+	/// HeadTrack.c to a PseudoTerminal, BLE devices the notification payloads
+	/// to a loopback TCP socket, which the host connects to and which stands
+	/// in for the BLE connection. Notifications are delivered in batches once
+	/// per connection interval, as with the real stack.
+	/// </summary>
+	public class VirtualXdk : IDisposable
+	{
+		public int Id { get; private set; }
+		public SimulatedTransport Transport { get; private set; }
+		public PseudoTerminal Terminal { get; private set; }
+		public int BlePort { get; private set; }
+
+		public string Endpoint => Transport == SimulatedTransport.Serial ? Terminal.SlavePath : "tcp:127.0.0.1:" + BlePort;
+
+		public FaultInjector Faults { get; private set; }
+		public SentSampleLog SentSamples { get; } = new SentSampleLog();
+
+		/// <summary>Samples taken, whether sent or not.</summary>
+		public long Generated { get; private set; }
+		/// <summary>Samples sent, intact or corrupted.</summary>
+		public long Sent { get; private set; }
+		/// <summary>Samples not sent while the link was down.</summary>
+		public long Offline { get; private set; }
+		/// <summary>Samples lost because the host did not read fast enough.</summary>
+		public long Overflowed { get; private set; }
+
+		/// <summary>
+		/// HostClock time the link came back after a disconnect, 0 once the
+		/// host received a sample sent after that.
+		/// </summary>
+		public long ResumedAt;
+
+		private readonly HeadMotionModel _motion;
+		private readonly RotationTrace _trace;
+		private int _traceIndex;
+		private readonly TcpListener _listener;
+		private Socket _connection;
+		private readonly byte[] _pending;
+		private int _pendingLength;
+		private int _pendingSamples;
+		private long _nextFlush;
+		private long _outageEnd;
+
+		internal VirtualXdk(int id, SimulatedTransport transport, FaultInjector faults, RotationTrace trace, int seed, int pendingCapacity)
+		{
+			Id = id;
+			Transport = transport;
+			Faults = faults;
+			if (trace != null && trace.Count > 0)
+			{
+				_trace = trace;
+				_traceIndex = (int)((long)trace.Count * seed % trace.Count);
+			}
+			else
+			{
+				_motion = new HeadMotionModel(seed);
+			}
+
+			if (transport == SimulatedTransport.Serial)
+			{
+				Terminal = new PseudoTerminal();
+			}
+			else
+			{
+				_pending = new byte[pendingCapacity * XdkBleFrame.Size];
+				_listener = new TcpListener(IPAddress.Loopback, 0);
+				_listener.Start();
+				BlePort = ((IPEndPoint)_listener.LocalEndpoint).Port;
+			}
+		}
+
+		internal void Step(int sequence, double dt, uint deviceTime, double connectionInterval, TimeSpan outage)
+		{
+			long now = HostClock.Now;
+			Quaternion rotation = NextRotation(dt);
+			Generated++;
+
+			if (_outageEnd != 0)
+			{
+				if (now < _outageEnd)
+				{
+					Offline++;
+					return;
+				}
+				_outageEnd = 0;
+				Volatile.Write(ref ResumedAt, now);
+			}
+
+			byte[] bytes;
+			int length;
+			if (Transport == SimulatedTransport.Serial)
+			{
+				bytes = Encoding.ASCII.GetBytes(SimulatedXdk.FormatSerialLine(rotation, false, sequence, deviceTime));
+				length = bytes.Length;
+			}
+			else
+			{
+				if (_connection == null && _listener.Pending())
+				{
+					_connection = _listener.AcceptSocket();
+					_connection.NoDelay = true;
+					_connection.Blocking = false;
+					_nextFlush = now;
+				}
+				// Notifications due are delivered first, the new sample may find
+				// room then.
+				Flush(now, connectionInterval);
+				if (_connection == null)
+				{
+					Offline++;
+					return;
+				}
+				if (_pendingLength == _pending.Length)
+				{
+					Overflowed++;
+					return;
+				}
+				bytes = _pending;
+				length = XdkBleFrame.Size;
+				XdkBleFrame.Encode(rotation, false, sequence, bytes, _pendingLength);
+			}
+
+			int offset = Transport == SimulatedTransport.Serial ? 0 : _pendingLength;
+			bool isCorrupted = false;
+			switch (Faults.Next())
+			{
+				case FaultAction.Drop:
+					return;
+				case FaultAction.Disconnect:
+					Disconnect(bytes, Faults.CutLength(length));
+					_outageEnd = now + HostClock.FromSeconds(outage.TotalSeconds);
+					return;
+				case FaultAction.Corrupt:
+					Faults.Corrupt(bytes, offset, length);
+					isCorrupted = true;
+					break;
+			}
+
+			SentSamples.Add(sequence, now, isCorrupted);
+			Sent++;
+
+			if (Transport == SimulatedTransport.Serial)
+			{
+				if (Terminal.Write(bytes, length) < length)
+				{
+					SentSamples.Remove(sequence);
+					Overflowed++;
+				}
+			}
+			else
+			{
+				_pendingLength += length;
+				_pendingSamples++;
+				Flush(now, connectionInterval);
+			}
+		}
+
+		internal void Flush(long now, double connectionInterval)
+		{
+			if (_connection == null || _pendingLength == 0 || now < _nextFlush)
+				return;
+
+			SocketError error;
+			int sent = _connection.Send(_pending, 0, _pendingLength, SocketFlags.None, out error);
+			if (error != SocketError.Success || sent < _pendingLength)
+			{
+				// A partial frame would shift all later ones, so the link is
+				// dropped as the BLE stack would on a full buffer.
+				Overflowed += _pendingSamples;
+				CloseConnection();
+			}
+			_pendingLength = 0;
+			_pendingSamples = 0;
+			long interval = Math.Max(1L, HostClock.FromSeconds(connectionInterval));
+			while (_nextFlush <= now)
+				_nextFlush += interval;
+		}
+
+		private Quaternion NextRotation(double dt)
+		{
+			if (_trace != null)
+			{
+				Quaternion rotation = _trace.Rotations[_traceIndex];
+				_traceIndex = (_traceIndex + 1) % _trace.Count;
+				return rotation;
+			}
+			Quaternion truth;
+			return _motion.Next(dt, out truth);
+		}
+
+		private void Disconnect(byte[] bytes, int cutLength)
+		{
+			if (Transport == SimulatedTransport.Serial)
+			{
+				// The line stops mid-way, as when the cable is pulled.
+				Terminal.Write(bytes, cutLength);
+			}
+			else
+			{
+				// Notifications not yet delivered die with the connection.
+				_pendingLength = 0;
+				_pendingSamples = 0;
+				CloseConnection();
+			}
+		}
+
+		private void CloseConnection()
+		{
+			if (_connection != null)
+			{
+				_connection.Dispose();
+				_connection = null;
+			}
+		}
+
+		public void Dispose()
+		{
+			CloseConnection();
+			_listener?.Stop();
+			Terminal?.Dispose();
+		}
+	}
+
+	/// <summary>
+	/// Many virtual XDKs for load and soak tests of the host without
+	/// hardware, driven from one thread like SimulatedFleet. Each device
+	/// emits the exact serial or BLE wire format of HeadTrack.c, follows its
+	/// own synthetic head motion or its own position in a recorded trace and
+	/// has its own FaultInjector. The start times of the devices are spread
+	/// evenly over one period. Needs Linux for the pseudo terminals.
+	/// </summary>
+	public sealed class VirtualXdkFarm : IDisposable
+	{
+		private readonly List<VirtualXdk> _devices = new List<VirtualXdk>();
+
+		public double SampleRate { get; private set; }
+		public double BleConnectionInterval { get; set; } = 0.0075D;
+		public IReadOnlyList<VirtualXdk> Devices => _devices;
+
+		/// <param name="trace">Recorded rotations to replay, null for synthetic head motion.</param>
+		public VirtualXdkFarm(int serialCount, int bleCount, double sampleRate, FaultProfile faults, RotationTrace trace, int seed)
+		{
+			SampleRate = sampleRate;
+			// Notifications the BLE stand-in queues before dropping, about
+			// what the XDK's stack buffers.
+			int pendingCapacity = Math.Max(8, (int)Math.Ceiling(sampleRate * BleConnectionInterval) * 4);
+			try
+			{
+				for (int i = 0; i < serialCount + bleCount; i++)
+				{
+					SimulatedTransport transport = i < serialCount ? SimulatedTransport.Serial : SimulatedTransport.Ble;
+					_devices.Add(new VirtualXdk(i, transport, new FaultInjector(faults, sampleRate, seed + i), trace, seed + i, pendingCapacity));
+				}
+			}
+			catch
+			{
+				Dispose();
+				throw;
+			}
+		}
+
+		/// <summary>
+		/// Streams samples of all devices for the given duration or until
+		/// cancelled.
+		/// </summary>
+		public void Run(double duration, TimeSpan disconnectDuration, CancellationToken cancel)
+		{
+			int deviceCount = _devices.Count;
+			if (deviceCount == 0)
+				return;
+
+			double dt = 1D / SampleRate;
+			long period = HostClock.FromSeconds(dt);
+			long count = (long)(duration * SampleRate);
+			long start = HostClock.Now;
+
+			for (long step = 0; step < count * deviceCount && !cancel.IsCancellationRequested; step++)
+			{
+				int device = (int)(step % deviceCount);
+				long seq = step / deviceCount;
+				WaitUntil(start + seq * period + period * device / deviceCount);
+
+				// The firmware's device time, microseconds since start.
+				uint deviceTime = (uint)(seq * 1000000L / (long)SampleRate);
+				_devices[device].Step((ushort)seq, dt, deviceTime, BleConnectionInterval, disconnectDuration);
+			}
+
+			long end = HostClock.Now + HostClock.FromSeconds(BleConnectionInterval);
+			WaitUntil(end);
+			foreach (VirtualXdk xdk in _devices)
+				xdk.Flush(HostClock.Now, BleConnectionInterval);
+		}
+
+		// Yields instead of spinning, the host under test shares the cores.
+		internal static void WaitUntil(long timestamp)
+		{
+			long remaining;
+			while ((remaining = timestamp - HostClock.Now) > 0)
+			{
+				if (remaining > HostClock.FromSeconds(0.002D))
+					Thread.Sleep(1);
+				else
+					Thread.Yield();
+			}
+		}
+
+		public void Dispose()
+		{
+			foreach (VirtualXdk xdk in _devices)
+				xdk.Dispose();
+		}
+	}
+}
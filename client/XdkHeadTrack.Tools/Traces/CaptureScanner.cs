@@ -0,0 +1,164 @@
+﻿using System;
+using System.Globalization;
+using System.Text;
+using XdkHeadTrack.Model;
+
+namespace XdkHeadTrack.Tools.Traces
+{
+	/// <summary>
+	/// One ">>QUAT:" or ">>CALI:" line of a serial capture.
+	/// </summary>
+	public struct CaptureSample
+	{
+		public bool IsCalibration;
+		public double W;
+		public double X;
+		public double Y;
+		public double Z;
+		/// <summary>16 bit sequence number, -1 if the firmware sent none.</summary>
+		public int Sequence;
+		/// <summary>Device time in microseconds, -1 if the firmware sent none.</summary>
+		public long DeviceTime;
+	}
+
+	/// <summary>
+	/// Parses serial captures straight from their bytes, the same lines as
+	/// XdkLineParser but without a string or regex per line. Lines of other
+	/// channels are skipped. Numbers in exponent notation, which the firmware
+	/// does not send, are handed to double.Parse.
+	/// </summary>
+	public static class CaptureScanner
+	{
+		private static readonly byte[] QuatTag = Encoding.ASCII.GetBytes(XdkWire.RotationLineTag);
+		private static readonly byte[] CaliTag = Encoding.ASCII.GetBytes(XdkWire.CalibrationLineTag);
+		private static readonly double[] PowersOfTen = CreatePowersOfTen(19);
+
+		/// <summary>
+		/// Returns the index after the line starting at start, i.e. after its
+		/// '\n', or end if the line is not terminated before it.
+		/// </summary>
+		public static int SkipLine(byte[] buffer, int start, int end)
+		{
+			int index = Array.IndexOf(buffer, (byte)'\n', start, end - start);
+			return index < 0 ? end : index + 1;
+		}
+
+		/// <summary>
+		/// Parses the line from start to lineEnd (exclusive, without '\n').
+		/// Returns false if it is no rotation line or malformed, isRotation
+		/// tells the two apart.
+		/// </summary>
+		public static bool TryParseLine(byte[] buffer, int start, int lineEnd, out CaptureSample sample, out bool isRotation)
+		{
+			sample = new CaptureSample { Sequence = -1, DeviceTime = -1 };
+			isRotation = false;
+			if (StartsWith(buffer, start, lineEnd, QuatTag))
+				sample.IsCalibration = false;
+			else if (StartsWith(buffer, start, lineEnd, CaliTag))
+				sample.IsCalibration = true;
+			else
+				return false;
+
+			isRotation = true;
+			int index = start + (sample.IsCalibration ? CaliTag : QuatTag).Length;
+			if (!TryParseDouble(buffer, ref index, lineEnd, out sample.W)
+				|| !TryParseDouble(buffer, ref index, lineEnd, out sample.X)
+				|| !TryParseDouble(buffer, ref index, lineEnd, out sample.Y)
+				|| !TryParseDouble(buffer, ref index, lineEnd, out sample.Z))
+			{
+				return false;
+			}
+
+			// Older firmware sends neither, the first one only the sequence number.
+			long value;
+			if (TryParseUnsigned(buffer, ref index, lineEnd, out value))
+			{
+				sample.Sequence = (ushort)value;
+				if (TryParseUnsigned(buffer, ref index, lineEnd, out value))
+					sample.DeviceTime = (uint)value;
+			}
+			return true;
+		}
+
+		private static bool StartsWith(byte[] buffer, int start, int end, byte[] tag)
+		{
+			if (end - start < tag.Length)
+				return false;
+			for (int i = 0; i < tag.Length; i++)
+			{
+				if (buffer[start + i] != tag[i])
+					return false;
+			}
+			return true;
+		}
+
+		private static int SkipSpaces(byte[] buffer, int index, int end)
+		{
+			while (index < end && (buffer[index] == ' ' || buffer[index] == '\t' || buffer[index] == '\r'))
+				index++;
+			return index;
+		}
+
+		private static bool TryParseUnsigned(byte[] buffer, ref int index, int end, out long value)
+		{
+			int i = SkipSpaces(buffer, index, end);
+			int first = i;
+			value = 0;
+			while (i < end && i - first < 18 && (uint)(buffer[i] - '0') <= 9)
+				value = value * 10 + (buffer[i++] - '0');
+			if (i == first)
+				return false;
+			index = i;
+			return true;
+		}
+
+		private static bool TryParseDouble(byte[] buffer, ref int index, int end, out double value)
+		{
+			int i = SkipSpaces(buffer, index, end);
+			int first = i;
+			bool isNegative = false;
+			if (i < end && (buffer[i] == '-' || buffer[i] == '+'))
+				isNegative = buffer[i++] == '-';
+
+			long mantissa = 0;
+			int integerStart = i, digit;
+			for (; i < end && (uint)(digit = buffer[i] - '0') <= 9; i++)
+				mantissa = mantissa * 10 + digit;
+			int digits = i - integerStart, fractionDigits = 0;
+			if (i < end && buffer[i] == '.')
+			{
+				int fractionStart = ++i;
+				for (; i < end && (uint)(digit = buffer[i] - '0') <= 9; i++)
+					mantissa = mantissa * 10 + digit;
+				fractionDigits = i - fractionStart;
+				digits += fractionDigits;
+			}
+
+			if ((i < end && (buffer[i] == 'e' || buffer[i] == 'E')) || digits >= PowersOfTen.Length)
+				return TryParseSlow(buffer, first, ref index, end, out value);
+
+			value = digits == 0 ? double.NaN : (isNegative ? -mantissa : mantissa) / PowersOfTen[fractionDigits];
+			index = i;
+			return digits > 0;
+		}
+
+		private static bool TryParseSlow(byte[] buffer, int first, ref int index, int end, out double value)
+		{
+			int i = first;
+			while (i < end && buffer[i] != ' ' && buffer[i] != '\t' && buffer[i] != '\r')
+				i++;
+			index = i;
+			return double.TryParse(Encoding.ASCII.GetString(buffer, first, i - first), NumberStyles.Float,
+				CultureInfo.InvariantCulture, out value);
+		}
+
+		private static double[] CreatePowersOfTen(int count)
+		{
+			double[] powers = new double[count];
+			powers[0] = 1D;
+			for (int i = 1; i < count; i++)
+				powers[i] = powers[i - 1] * 10D;
+			return powers;
+		}
+	}
+}
@@ -0,0 +1,119 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Benchmarks;
+
+namespace XdkHeadTrack.Tools.Traces
+{
+	/// <summary>
+	/// Decodes the flight recordings of the firmware, the "RECnnnnn.BIN" files
+	/// copied from the XDK's SD card, to one CSV file per recording. Also
+	/// prints a summary per recording: samples, time span, sequence gaps,
+	/// failed reads, corrupt blocks and the largest rotation step.
+	///
+	/// Usage: flight-recorder &lt;file|directory&gt; [out-directory]
+	/// Prints one JSON line per recording.
+	/// </summary>
+	public static class FlightRecordingDecoder
+	{
+		public static int Run(string[] args)
+		{
+			if (args.Length == 0)
+			{
+				Console.Error.WriteLine("Usage: flight-recorder <file|directory> [out-directory]");
+				return 1;
+			}
+
+			string[] paths = Directory.Exists(args[0])
+				? Directory.GetFiles(args[0], "REC*.BIN")
+				: new[] { args[0] };
+			Array.Sort(paths, StringComparer.OrdinalIgnoreCase);
+
+			int failed = 0;
+			foreach (string path in paths)
+			{
+				XdkFlightRecording recording;
+				try
+				{
+					recording = XdkFlightRecording.Load(path);
+				}
+				catch (InvalidDataException e)
+				{
+					Console.Error.WriteLine(path + ": " + e.Message);
+					failed++;
+					continue;
+				}
+
+				string outDirectory = args.Length > 1 ? args[1] : Path.GetDirectoryName(Path.GetFullPath(path));
+				string csvPath = Path.Combine(outDirectory, Path.GetFileNameWithoutExtension(path) + ".csv");
+				WriteCsv(recording, csvPath);
+				Console.WriteLine(Summarize(recording, path, csvPath));
+			}
+			return failed == 0 ? 0 : 1;
+		}
+
+		private static void WriteCsv(XdkFlightRecording recording, string path)
+		{
+			using (StreamWriter writer = new StreamWriter(path))
+			{
+				writer.WriteLine("time_us,since_trigger_ms,sequence,calibration,read_failed,w,x,y,z,acc_x_g,acc_y_g,acc_z_g,rate_x_dps,rate_y_dps,rate_z_dps");
+				foreach (XdkFlightSample sample in recording.Samples)
+				{
+					string raw = sample.HasRawSensors
+						? string.Format(CultureInfo.InvariantCulture, "{0},{1},{2},{3},{4},{5}",
+							sample.Acceleration.X, sample.Acceleration.Y, sample.Acceleration.Z,
+							sample.AngularRate.X, sample.AngularRate.Y, sample.AngularRate.Z)
+						: ",,,,,";
+					writer.WriteLine(string.Format(CultureInfo.InvariantCulture, "{0},{1},{2},{3},{4},{5:F6},{6:F6},{7:F6},{8:F6},{9}",
+						sample.Time, (int)(sample.Time - recording.TriggerTime) / 1000D, sample.Sequence,
+						sample.IsCalibration ? 1 : 0, sample.IsReadFailed ? 1 : 0,
+						sample.Rotation.W, sample.Rotation.X, sample.Rotation.Y, sample.Rotation.Z, raw));
+				}
+			}
+		}
+
+		private static BenchmarkReport Summarize(XdkFlightRecording recording, string path, string csvPath)
+		{
+			IList<XdkFlightSample> samples = recording.Samples;
+			long sequenceGaps = 0, readFailures = 0;
+			double maxStep = 0D;
+			for (int i = 0; i < samples.Count; i++)
+			{
+				if (samples[i].IsReadFailed)
+					readFailures++;
+				if (i == 0)
+					continue;
+				// A failed read repeats the sequence number of the next sample.
+				int step = (ushort)(samples[i].Sequence - samples[i - 1].Sequence);
+				if (step > 1 && !samples[i - 1].IsReadFailed)
+					sequenceGaps += step - 1;
+				maxStep = Math.Max(maxStep, AngleBetween(samples[i - 1].Rotation, samples[i].Rotation));
+			}
+
+			double duration = samples.Count > 1 ? (samples[samples.Count - 1].Time - samples[0].Time) / 1000000D : 0D;
+			return new BenchmarkReport()
+				.Add("tool", "flight-recorder")
+				.Add("file", Path.GetFileName(path))
+				.Add("csv", csvPath)
+				.Add("reason", recording.Reason.ToString())
+				.Add("samples", samples.Count)
+				.Add("declared_samples", recording.DeclaredSampleCount)
+				.Add("corrupt_blocks", recording.CorruptBlockCount)
+				.Add("missed_before", recording.MissedSamples)
+				.Add("duration_s", duration)
+				.Add("rate_hz", duration > 0D ? (samples.Count - 1) / duration : double.NaN)
+				.Add("sequence_gaps", sequenceGaps)
+				.Add("read_failures", readFailures)
+				.Add("max_step_deg", maxStep);
+		}
+
+		private static double AngleBetween(Quaternion a, Quaternion b)
+		{
+			double dot = Math.Abs(a.W * b.W + a.X * b.X + a.Y * b.Y + a.Z * b.Z);
+			return 2D * Math.Acos(Math.Min(1D, dot)) * 180D / Math.PI;
+		}
+	}
+}
@@ -0,0 +1,83 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Tools.Traces
+{
+	/// <summary>
+	/// A time series of rotations, e.g. loaded from a serial capture of the
+	/// XDK text output (one ">>QUAT: w x y z" line per sample).
+	/// </summary>
+	public class RotationTrace
+	{
+		private readonly List<double> _timestamps;
+		private readonly List<Quaternion> _rotations;
+
+		public int Count => _rotations.Count;
+		public IList<double> Timestamps => _timestamps;
+		public IList<Quaternion> Rotations => _rotations;
+
+		public RotationTrace() : this(0) { }
+
+		public RotationTrace(int capacity)
+		{
+			_timestamps = new List<double>(capacity);
+			_rotations = new List<Quaternion>(capacity);
+		}
+
+		public void Add(double timestamp, Quaternion rotation)
+		{
+			_timestamps.Add(timestamp);
+			_rotations.Add(rotation);
+		}
+
+		/// <summary>
+		/// Loads a serial capture. Samples are assumed to be equidistant at the given rate.
+		/// </summary>
+		public static RotationTrace LoadSerialCapture(string path, double sampleRate)
+		{
+			RotationTrace trace = new RotationTrace();
+			using (StreamReader reader = new StreamReader(path))
+			{
+				string line;
+				while ((line = reader.ReadLine()) != null)
+				{
+					Quaternion rotation;
+					if (XdkLineParser.TryParse(line, out rotation) == XdkLineType.Rotation)
+						trace.Add(trace.Count / sampleRate, rotation);
+				}
+			}
+			return trace;
+		}
+
+		/// <summary>
+		/// Centered moving average of the rotations, used as the reference for
+		/// traces where no ground truth is known.
+		/// </summary>
+		public RotationTrace Smooth(int halfWindow)
+		{
+			RotationTrace smoothed = new RotationTrace(Count);
+			for (int i = 0; i < Count; i++)
+			{
+				Quaternion center = _rotations[i];
+				double w = 0, x = 0, y = 0, z = 0;
+				int from = Math.Max(0, i - halfWindow), to = Math.Min(Count - 1, i + halfWindow);
+				for (int j = from; j <= to; j++)
+				{
+					Quaternion q = _rotations[j];
+					double sign = q.W * center.W + q.X * center.X + q.Y * center.Y + q.Z * center.Z < 0D ? -1D : 1D;
+					w += sign * q.W;
+					x += sign * q.X;
+					y += sign * q.Y;
+					z += sign * q.Z;
+				}
+				Quaternion mean = new Quaternion(x, y, z, w);
+				mean.Normalize();
+				smoothed.Add(_timestamps[i], mean);
+			}
+			return smoothed;
+		}
+	}
+}
@@ -0,0 +1,345 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Linq;
+using System.Threading.Tasks;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Benchmarks;
+
+namespace XdkHeadTrack.Tools.Traces
+{
+	/// <summary>
+	/// Offline analytics of serial captures, meant for nightly runs over many
+	/// sessions. Every file is memory mapped and cut into chunks that are
+	/// scanned in parallel across all files. The chunk statistics are then
+	/// merged in file order. The summary per file covers:
+	/// - the sample interval (device time) and sequence gap distributions,
+	/// - the drift of the rotation while the device rests, fitted over rest
+	///   periods of at least MinDriftSeconds,
+	/// - the noise at rest as RMS and as spectrum in a few bands,
+	/// - the stability of the calibrations, i.e. how far they lie apart.
+	///
+	/// Usage: trace-analytics &lt;file|directory&gt;... [--chunk-mb n] [--threads n] [--rate hz] [--pattern *.txt]
+	/// --rate is only used for captures without device time.
+	/// Prints one JSON line per file and one for the whole run.
+	/// </summary>
+	public static class TraceAnalytics
+	{
+		/// <summary>Lines longer than this are cut at chunk ends.</summary>
+		public const int MaxLineLength = 4096;
+		public const double MinDriftSeconds = 30D;
+		/// <summary>Longer pauses, e.g. lost samples, end a rest period.</summary>
+		public const double MaxRestPauseSeconds = 1D;
+
+		private static readonly double[] NoiseBandLimitsHz = { 1D, 3D, 10D, double.MaxValue };
+		private static readonly string[] NoiseBandNames = { "0_1hz", "1_3hz", "3_10hz", "10hz_up" };
+
+		private class CaptureFile
+		{
+			public string Path;
+			public long Length;
+			public MemoryMappedFile Map;
+			public TraceChunkStatistics[] Chunks;
+		}
+
+		public static int Run(string[] args)
+		{
+			int chunkSize = 16 << 20;
+			int threads = Environment.ProcessorCount;
+			double rate = 50D;
+			string pattern = "*.txt";
+			List<string> paths = new List<string>();
+			for (int i = 0; i < args.Length; i++)
+			{
+				switch (args[i])
+				{
+					case "--chunk-mb":
+						chunkSize = int.Parse(args[++i], CultureInfo.InvariantCulture) << 20;
+						break;
+					case "--threads":
+						threads = int.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--rate":
+						rate = double.Parse(args[++i], CultureInfo.InvariantCulture);
+						break;
+					case "--pattern":
+						pattern = args[++i];
+						break;
+					default:
+						if (Directory.Exists(args[i]))
+							paths.AddRange(Directory.GetFiles(args[i], pattern).OrderBy(p => p, StringComparer.OrdinalIgnoreCase));
+						else
+							paths.Add(args[i]);
+						break;
+				}
+			}
+			if (paths.Count == 0)
+			{
+				Console.Error.WriteLine("Usage: trace-analytics <file|directory>... [--chunk-mb n] [--threads n] [--rate hz] [--pattern *.txt]");
+				return 1;
+			}
+
+			List<CaptureFile> files = new List<CaptureFile>();
+			List<KeyValuePair<CaptureFile, int>> chunks = new List<KeyValuePair<CaptureFile, int>>();
+			Stopwatch stopwatch = Stopwatch.StartNew();
+			try
+			{
+				foreach (string path in paths)
+				{
+					CaptureFile file = new CaptureFile { Path = path, Length = new FileInfo(path).Length };
+					int count = (int)((file.Length + chunkSize - 1) / chunkSize);
+					file.Chunks = new TraceChunkStatistics[count];
+					// Empty files cannot be mapped.
+					if (file.Length > 0)
+						file.Map = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+					files.Add(file);
+					for (int i = 0; i < count; i++)
+						chunks.Add(new KeyValuePair<CaptureFile, int>(file, i));
+				}
+
+				Parallel.ForEach(chunks, new ParallelOptions { MaxDegreeOfParallelism = threads },
+					() => new byte[chunkSize + MaxLineLength + 1],
+					(chunk, state, buffer) =>
+					{
+						chunk.Key.Chunks[chunk.Value] = ScanChunk(chunk.Key, (long)chunk.Value * chunkSize, chunkSize, buffer);
+						return buffer;
+					},
+					buffer => { });
+			}
+			finally
+			{
+				foreach (CaptureFile file in files)
+					file.Map?.Dispose();
+			}
+
+			long bytes = 0, samples = 0;
+			foreach (CaptureFile file in files)
+			{
+				TraceChunkStatistics merged = new TraceChunkStatistics();
+				foreach (TraceChunkStatistics chunk in file.Chunks)
+					merged.Merge(chunk);
+				bytes += file.Length;
+				samples += merged.Samples;
+				Console.WriteLine(Summarize(file.Path, merged, rate));
+			}
+			double seconds = stopwatch.Elapsed.TotalSeconds;
+
+			Console.WriteLine(new BenchmarkReport()
+				.Add("tool", "trace-analytics")
+				.Add("files", files.Count)
+				.Add("bytes", bytes)
+				.Add("samples", samples)
+				.Add("chunks", chunks.Count)
+				.Add("chunk_mb", chunkSize >> 20)
+				.Add("threads", threads)
+				.Add("seconds", seconds)
+				.Add("gb_per_s", bytes / seconds / 1e9D));
+			return 0;
+		}
+
+		/// <summary>
+		/// Scans the lines starting in [start, start + size) of the file. The
+		/// line running into the chunk is left to the previous chunk, the one
+		/// running out of it is read on into the next.
+		/// </summary>
+		private static TraceChunkStatistics ScanChunk(CaptureFile file, long start, int size, byte[] buffer)
+		{
+			long viewStart = Math.Max(0L, start - 1);
+			int viewLength = (int)(Math.Min(file.Length, start + size + MaxLineLength) - viewStart);
+			using (Stream view = file.Map.CreateViewStream(viewStart, viewLength, MemoryMappedFileAccess.Read))
+			{
+				int read, length = 0;
+				while (length < viewLength && (read = view.Read(buffer, length, viewLength - length)) > 0)
+					length += read;
+			}
+
+			int index = (int)(start - viewStart);
+			if (start > 0 && buffer[0] != '\n')
+				index = CaptureScanner.SkipLine(buffer, index, viewLength);
+			int end = (int)(Math.Min(file.Length, start + size) - viewStart);
+
+			TraceChunkStatistics statistics = new TraceChunkStatistics();
+			statistics.Bytes = end - (start - viewStart);
+			while (index < end)
+			{
+				int next = CaptureScanner.SkipLine(buffer, index, viewLength);
+				int lineEnd = next > index && buffer[next - 1] == '\n' ? next - 1 : next;
+				statistics.Lines++;
+
+				CaptureSample sample;
+				bool isRotation;
+				if (CaptureScanner.TryParseLine(buffer, index, lineEnd, out sample, out isRotation))
+					statistics.Add(ref sample);
+				else if (isRotation)
+					statistics.Malformed++;
+				index = next;
+			}
+			statistics.Finish();
+			return statistics;
+		}
+
+		private static BenchmarkReport Summarize(string path, TraceChunkStatistics statistics, double nominalRate)
+		{
+			double medianInterval = HistogramPercentile(statistics.IntervalHistogram, 0.5D);
+			double rate = double.IsNaN(medianInterval)
+				? nominalRate
+				: 1000000D / (medianInterval - TraceChunkStatistics.IntervalBinMicroseconds / 2D);
+
+			// Unwraps the 32 bit device time over the windows, or counts
+			// samples at the nominal rate for captures without it. A step of
+			// more than half the wrap around is a device restart.
+			double[] starts = new double[statistics.Windows.Count];
+			double[] ends = new double[statistics.Windows.Count];
+			double time = 0D;
+			long previousEnd = -1;
+			for (int i = 0; i < statistics.Windows.Count; i++)
+			{
+				TraceWindow window = statistics.Windows[i];
+				uint step = (uint)(window.StartTime - previousEnd);
+				if (window.StartTime >= 0 && previousEnd >= 0 && step <= uint.MaxValue / 2)
+					starts[i] = time + step / 1000000D;
+				else
+					starts[i] = i == 0 ? 0D : time + 1D / rate;
+				ends[i] = window.StartTime >= 0
+					? starts[i] + (uint)(window.EndTime - window.StartTime) / 1000000D
+					: starts[i] + (window.Count - 1) / rate;
+				time = ends[i];
+				previousEnd = window.EndTime;
+			}
+
+			// Rest periods are runs of rest windows without a longer pause
+			// between them. Only full windows tell the noise.
+			List<double> driftRates = new List<double>();
+			List<double> restNoise = new List<double>();
+			double restSeconds = 0D;
+			int first = -1;
+			for (int i = 0; i <= statistics.Windows.Count; i++)
+			{
+				bool isRest = i < statistics.Windows.Count && statistics.Windows[i].IsRest;
+				if (isRest)
+				{
+					if (statistics.Windows[i].Count == TraceChunkStatistics.WindowSize)
+						restNoise.Add(statistics.Windows[i].RmsDeviationDegrees);
+					restSeconds += ends[i] - starts[i];
+				}
+				if (isRest && (first < 0 || starts[i] - ends[i - 1] > MaxRestPauseSeconds))
+				{
+					AddDrift(statistics.Windows, starts, ends, first, i - 1, driftRates);
+					first = i;
+				}
+				else if (!isRest && first >= 0)
+				{
+					AddDrift(statistics.Windows, starts, ends, first, i - 1, driftRates);
+					first = -1;
+				}
+			}
+			driftRates.Sort();
+			restNoise.Sort();
+
+			List<double> calibrationSteps = new List<double>();
+			double calibrationSpread = 0D;
+			for (int i = 1; i < statistics.Calibrations.Count; i++)
+			{
+				calibrationSteps.Add(AngleBetween(statistics.Calibrations[i - 1].Rotation, statistics.Calibrations[i].Rotation));
+				calibrationSpread = Math.Max(calibrationSpread, AngleBetween(statistics.Calibrations[0].Rotation, statistics.Calibrations[i].Rotation));
+			}
+			calibrationSteps.Sort();
+
+			long expected = statistics.Samples + statistics.LostSamples;
+			BenchmarkReport report = new BenchmarkReport()
+				.Add("tool", "trace-analytics")
+				.Add("file", Path.GetFileName(path))
+				.Add("bytes", statistics.Bytes)
+				.Add("samples", statistics.Samples)
+				.Add("calibrations", statistics.Calibrations.Count)
+				.Add("malformed", statistics.Malformed)
+				.Add("duration_s", time)
+				.Add("rate_hz", rate)
+				.Add("interval_us_p50", medianInterval)
+				.Add("interval_us_p99", HistogramPercentile(statistics.IntervalHistogram, 0.99D))
+				.Add("interval_us_p999", HistogramPercentile(statistics.IntervalHistogram, 0.999D))
+				.Add("interval_us_max", statistics.MaxIntervalMicroseconds)
+				.Add("sequence_gaps", statistics.SequenceGaps)
+				.Add("lost_samples", statistics.LostSamples)
+				.Add("loss_ratio", expected > 0 ? statistics.LostSamples / (double)expected : double.NaN)
+				.Add("max_gap", statistics.MaxGap)
+				.Add("duplicates", statistics.Duplicates)
+				.Add("restarts", statistics.Restarts)
+				.Add("rest_s", restSeconds)
+				.Add("drift_periods", driftRates.Count)
+				.Add("drift_deg_per_min_p50", BenchmarkReport.Percentile(driftRates, 0.5D))
+				.Add("drift_deg_per_min_max", driftRates.Count > 0 ? driftRates[driftRates.Count - 1] : double.NaN)
+				.Add("noise_rms_deg_p50", BenchmarkReport.Percentile(restNoise, 0.5D))
+				.Add("noise_rms_deg_p90", BenchmarkReport.Percentile(restNoise, 0.9D));
+			AddNoiseBands(report, statistics, rate);
+			return report
+				.Add("calibration_step_deg_p50", BenchmarkReport.Percentile(calibrationSteps, 0.5D))
+				.Add("calibration_step_deg_max", calibrationSteps.Count > 0 ? calibrationSteps[calibrationSteps.Count - 1] : double.NaN)
+				.Add("calibration_spread_deg", calibrationSpread);
+		}
+
+		private static void AddDrift(IList<TraceWindow> windows, double[] starts, double[] ends, int first, int last, List<double> driftRates)
+		{
+			if (first < 0 || last <= first)
+				return;
+			double span = (starts[last] + ends[last]) / 2D - (starts[first] + ends[first]) / 2D;
+			if (ends[last] - starts[first] >= MinDriftSeconds && span > 0D)
+				driftRates.Add(AngleBetween(windows[first].Mean, windows[last].Mean) / span * 60D);
+		}
+
+		private static void AddNoiseBands(BenchmarkReport report, TraceChunkStatistics statistics, double rate)
+		{
+			double[] bands = new double[NoiseBandLimitsHz.Length];
+			double peakPower = 0D, peakFrequency = double.NaN;
+			// The mean is removed per window, bin 0 holds no noise.
+			for (int k = 1; k < TraceChunkStatistics.SpectrumSize && statistics.NoiseWindows > 0; k++)
+			{
+				double frequency = k * rate / TraceChunkStatistics.WindowSize;
+				double power = statistics.NoisePower[k] / statistics.NoiseWindows;
+				int band = 0;
+				while (frequency >= NoiseBandLimitsHz[band])
+					band++;
+				bands[band] += power;
+				if (power > peakPower)
+				{
+					peakPower = power;
+					peakFrequency = frequency;
+				}
+			}
+
+			for (int i = 0; i < bands.Length; i++)
+				report.Add("noise_rms_deg_" + NoiseBandNames[i], statistics.NoiseWindows > 0 ? Math.Sqrt(bands[i]) : double.NaN);
+			report.Add("noise_peak_hz", peakFrequency);
+		}
+
+		/// <summary>
+		/// Upper limit of the interval bin the percentile falls in, NaN if empty.
+		/// </summary>
+		private static double HistogramPercentile(long[] histogram, double p)
+		{
+			long total = 0;
+			foreach (long count in histogram)
+				total += count;
+			if (total == 0)
+				return double.NaN;
+
+			long target = (long)Math.Ceiling(p * total), sum = 0;
+			for (int i = 0; i < histogram.Length; i++)
+			{
+				sum += histogram[i];
+				if (sum >= target)
+					return (i + 1) * (double)TraceChunkStatistics.IntervalBinMicroseconds;
+			}
+			return double.PositiveInfinity;
+		}
+
+		private static double AngleBetween(Quaternion a, Quaternion b)
+		{
+			double dot = Math.Abs(a.W * b.W + a.X * b.X + a.Y * b.Y + a.Z * b.Z);
+			return 2D * Math.Acos(Math.Min(1D, dot)) * 180D / Math.PI;
+		}
+	}
+}
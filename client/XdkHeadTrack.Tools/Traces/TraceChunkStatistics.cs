@@ -0,0 +1,353 @@
+﻿using System;
+using System.Collections.Generic;
+using XdkHeadTrack.Numerics;
+
+namespace XdkHeadTrack.Tools.Traces
+{
+	/// <summary>
+	/// Summary of up to TraceChunkStatistics.WindowSize consecutive rotation
+	/// samples, cut short by lost samples and at the end of a chunk. Times
+	/// are raw device times (32 bit microseconds), -1 for firmware that sends
+	/// none.
+	/// </summary>
+	public struct TraceWindow
+	{
+		public long StartTime;
+		public long EndTime;
+		public int Count;
+		public Quaternion Mean;
+		public double MaxDeviationDegrees;
+		public double RmsDeviationDegrees;
+		/// <summary>Never further than RestThresholdDegrees from Mean.</summary>
+		public bool IsRest;
+	}
+
+	public struct TraceCalibration
+	{
+		public long DeviceTime;
+		public Quaternion Rotation;
+	}
+
+	/// <summary>
+	/// Statistics of one chunk of a serial capture. Chunks are scanned
+	/// independently, so everything kept here either adds up (counts,
+	/// histograms, noise spectra) or is a short ordered list (windows,
+	/// calibrations) that Merge joins in file order. Only the step from the
+	/// last sample of a chunk to the first one of the next is left to Merge.
+	/// </summary>
+	public class TraceChunkStatistics
+	{
+		public const int WindowSize = 128;
+		public const int SpectrumSize = WindowSize / 2 + 1;
+		public const int IntervalBinMicroseconds = 100;
+		/// <summary>Intervals up to 100 ms, the last bin takes all longer ones.</summary>
+		public const int IntervalBinCount = 1000;
+		public const double RestThresholdDegrees = 0.5D;
+
+		private static readonly double[] Hann = CreateHann();
+		private static readonly double HannPower = SumOfSquares(Hann);
+		private static readonly int[] BitReversed = CreateBitReversed();
+		private static readonly double[] TwiddleRe = CreateTwiddles(Math.Cos);
+		private static readonly double[] TwiddleIm = CreateTwiddles(Math.Sin);
+
+		public long Bytes;
+		public long Lines;
+		public long Samples;
+		public long Malformed;
+		public long SequenceGaps;
+		public long LostSamples;
+		public long MaxGap;
+		public long Duplicates;
+		public long Restarts;
+		public long MaxIntervalMicroseconds;
+		public readonly long[] IntervalHistogram = new long[IntervalBinCount + 1];
+		/// <summary>One sided mean square per bin in deg², summed over NoiseWindows.</summary>
+		public readonly double[] NoisePower = new double[SpectrumSize];
+		public long NoiseWindows;
+		public readonly List<TraceWindow> Windows = new List<TraceWindow>();
+		public readonly List<TraceCalibration> Calibrations = new List<TraceCalibration>();
+
+		public int FirstSequence = -1;
+		public long FirstTime = -1;
+		public int LastSequence = -1;
+		public long LastTime = -1;
+
+		// Samples of the window being filled, as rotation quaternions.
+		private readonly double[] _w = new double[WindowSize];
+		private readonly double[] _x = new double[WindowSize];
+		private readonly double[] _y = new double[WindowSize];
+		private readonly double[] _z = new double[WindowSize];
+		private int _windowCount;
+		private long _windowStart;
+		// FFT work arrays.
+		private readonly double[] _re = new double[WindowSize];
+		private readonly double[] _im = new double[WindowSize];
+		private readonly double[][] _deviations = { new double[WindowSize], new double[WindowSize], new double[WindowSize] };
+
+		public void Add(ref CaptureSample sample)
+		{
+			// Calibration lines repeat the sequence number of the next sample.
+			if (sample.IsCalibration)
+			{
+				Calibrations.Add(new TraceCalibration
+				{
+					DeviceTime = sample.DeviceTime,
+					Rotation = new Quaternion(sample.X, sample.Y, sample.Z, sample.W),
+				});
+				return;
+			}
+
+			bool isContiguous = true;
+			if (Samples == 0)
+			{
+				FirstSequence = sample.Sequence;
+				FirstTime = sample.DeviceTime;
+			}
+			else
+			{
+				isContiguous = AddStep(LastSequence, LastTime, sample.Sequence, sample.DeviceTime);
+			}
+
+			// A window never spans lost samples.
+			if (_windowCount == WindowSize || !isContiguous)
+				Finish();
+			Samples++;
+			LastSequence = sample.Sequence;
+			LastTime = sample.DeviceTime;
+			if (_windowCount == 0)
+				_windowStart = sample.DeviceTime;
+			_w[_windowCount] = sample.W;
+			_x[_windowCount] = sample.X;
+			_y[_windowCount] = sample.Y;
+			_z[_windowCount] = sample.Z;
+			_windowCount++;
+		}
+
+		/// <summary>
+		/// Closes the window being filled, call once the chunk is scanned.
+		/// </summary>
+		public void Finish()
+		{
+			if (_windowCount == 0)
+				return;
+			Windows.Add(SummarizeWindow());
+			_windowCount = 0;
+		}
+
+		/// <summary>
+		/// Appends the statistics of the chunk that follows this one in the file.
+		/// </summary>
+		public void Merge(TraceChunkStatistics next)
+		{
+			if (Samples > 0 && next.Samples > 0)
+				AddStep(LastSequence, LastTime, next.FirstSequence, next.FirstTime);
+			if (Samples == 0)
+			{
+				FirstSequence = next.FirstSequence;
+				FirstTime = next.FirstTime;
+			}
+			if (next.Samples > 0)
+			{
+				LastSequence = next.LastSequence;
+				LastTime = next.LastTime;
+			}
+
+			Bytes += next.Bytes;
+			Lines += next.Lines;
+			Samples += next.Samples;
+			Malformed += next.Malformed;
+			SequenceGaps += next.SequenceGaps;
+			LostSamples += next.LostSamples;
+			MaxGap = Math.Max(MaxGap, next.MaxGap);
+			Duplicates += next.Duplicates;
+			Restarts += next.Restarts;
+			MaxIntervalMicroseconds = Math.Max(MaxIntervalMicroseconds, next.MaxIntervalMicroseconds);
+			for (int i = 0; i < IntervalHistogram.Length; i++)
+				IntervalHistogram[i] += next.IntervalHistogram[i];
+			for (int i = 0; i < NoisePower.Length; i++)
+				NoisePower[i] += next.NoisePower[i];
+			NoiseWindows += next.NoiseWindows;
+			Windows.AddRange(next.Windows);
+			Calibrations.AddRange(next.Calibrations);
+		}
+
+		/// <summary>
+		/// Accounts the step between two consecutive samples, returns false if
+		/// samples were lost in between or the device restarted.
+		/// </summary>
+		private bool AddStep(int previousSequence, long previousTime, int sequence, long time)
+		{
+			bool isContiguous = true;
+			if (previousSequence >= 0 && sequence >= 0)
+			{
+				int step = (ushort)(sequence - previousSequence);
+				if (step == 0)
+				{
+					Duplicates++;
+				}
+				else if (step > ushort.MaxValue / 2)
+				{
+					Restarts++;
+					return false;
+				}
+				else if (step > 1)
+				{
+					SequenceGaps++;
+					LostSamples += step - 1;
+					MaxGap = Math.Max(MaxGap, step - 1);
+					isContiguous = false;
+				}
+			}
+
+			if (previousTime >= 0 && time >= 0)
+			{
+				long interval = (uint)(time - previousTime);
+				IntervalHistogram[Math.Min(interval / IntervalBinMicroseconds, IntervalBinCount)]++;
+				MaxIntervalMicroseconds = Math.Max(MaxIntervalMicroseconds, interval);
+			}
+			return isContiguous;
+		}
+
+		private TraceWindow SummarizeWindow()
+		{
+			int n = _windowCount;
+
+			// Mean of the samples turned into the hemisphere of the first one.
+			double mw = 0D, mx = 0D, my = 0D, mz = 0D;
+			for (int i = 0; i < n; i++)
+			{
+				double sign = _w[i] * _w[0] + _x[i] * _x[0] + _y[i] * _y[0] + _z[i] * _z[0] >= 0D ? 1D : -1D;
+				mw += sign * _w[i];
+				mx += sign * _x[i];
+				my += sign * _y[i];
+				mz += sign * _z[i];
+			}
+			double norm = Math.Sqrt(mw * mw + mx * mx + my * my + mz * mz);
+			mw /= norm;
+			mx /= norm;
+			my /= norm;
+			mz /= norm;
+
+			// Small angle rotation vector of every sample relative to the mean, in degrees.
+			const double Scale = 2D * 180D / Math.PI;
+			double maxSquared = 0D, sumSquared = 0D;
+			for (int i = 0; i < n; i++)
+			{
+				double rw = mw * _w[i] + mx * _x[i] + my * _y[i] + mz * _z[i];
+				double sign = rw >= 0D ? Scale : -Scale;
+				double dx = sign * (mw * _x[i] - mx * _w[i] - my * _z[i] + mz * _y[i]);
+				double dy = sign * (mw * _y[i] + mx * _z[i] - my * _w[i] - mz * _x[i]);
+				double dz = sign * (mw * _z[i] - mx * _y[i] + my * _x[i] - mz * _w[i]);
+				_deviations[0][i] = dx;
+				_deviations[1][i] = dy;
+				_deviations[2][i] = dz;
+				double squared = dx * dx + dy * dy + dz * dz;
+				maxSquared = Math.Max(maxSquared, squared);
+				sumSquared += squared;
+			}
+
+			TraceWindow window = new TraceWindow
+			{
+				StartTime = _windowStart,
+				EndTime = LastTime,
+				Count = n,
+				Mean = new Quaternion(mx, my, mz, mw),
+				MaxDeviationDegrees = Math.Sqrt(maxSquared),
+				RmsDeviationDegrees = Math.Sqrt(sumSquared / n),
+			};
+			window.IsRest = window.MaxDeviationDegrees < RestThresholdDegrees;
+			if (window.IsRest && n == WindowSize)
+				AddNoiseSpectrum();
+			return window;
+		}
+
+		private void AddNoiseSpectrum()
+		{
+			foreach (double[] axis in _deviations)
+			{
+				double mean = 0D;
+				for (int i = 0; i < WindowSize; i++)
+					mean += axis[i];
+				mean /= WindowSize;
+				for (int i = 0; i < WindowSize; i++)
+				{
+					_re[BitReversed[i]] = (axis[i] - mean) * Hann[i];
+					_im[BitReversed[i]] = 0D;
+				}
+				TransformBitReversed(_re, _im);
+
+				for (int k = 0; k < SpectrumSize; k++)
+				{
+					double sides = k == 0 || k == WindowSize / 2 ? 1D : 2D;
+					NoisePower[k] += sides * (_re[k] * _re[k] + _im[k] * _im[k]) / (WindowSize * HannPower);
+				}
+			}
+			NoiseWindows++;
+		}
+
+		/// <summary>
+		/// Radix-2 FFT of input that is already in bit reversed order.
+		/// </summary>
+		private static void TransformBitReversed(double[] re, double[] im)
+		{
+			for (int size = 2; size <= WindowSize; size *= 2)
+			{
+				int half = size / 2, stride = WindowSize / size;
+				for (int k = 0; k < half; k++)
+				{
+					double wr = TwiddleRe[k * stride], wi = TwiddleIm[k * stride];
+					for (int start = 0; start < WindowSize; start += size)
+					{
+						int a = start + k, b = a + half;
+						double tr = wr * re[b] - wi * im[b];
+						double ti = wr * im[b] + wi * re[b];
+						re[b] = re[a] - tr;
+						im[b] = im[a] - ti;
+						re[a] += tr;
+						im[a] += ti;
+					}
+				}
+			}
+		}
+
+		private static double[] CreateTwiddles(Func<double, double> function)
+		{
+			double[] twiddles = new double[WindowSize / 2];
+			for (int k = 0; k < twiddles.Length; k++)
+				twiddles[k] = function(-2D * Math.PI * k / WindowSize);
+			return twiddles;
+		}
+
+		private static double[] CreateHann()
+		{
+			double[] window = new double[WindowSize];
+			for (int i = 0; i < WindowSize; i++)
+				window[i] = 0.5D - 0.5D * Math.Cos(2D * Math.PI * i / WindowSize);
+			return window;
+		}
+
+		private static double SumOfSquares(double[] values)
+		{
+			double sum = 0D;
+			foreach (double value in values)
+				sum += value * value;
+			return sum;
+		}
+
+		private static int[] CreateBitReversed()
+		{
+			int bits = 0;
+			while ((1 << bits) < WindowSize)
+				bits++;
+			int[] reversed = new int[WindowSize];
+			for (int i = 0; i < WindowSize; i++)
+			{
+				int r = 0;
+				for (int b = 0; b < bits; b++)
+					r |= ((i >> b) & 1) << (bits - 1 - b);
+				reversed[i] = r;
+			}
+			return reversed;
+		}
+	}
+}
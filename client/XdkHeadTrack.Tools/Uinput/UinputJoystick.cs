@@ -0,0 +1,179 @@
+﻿using System;
+using System.IO;
+using System.Text;
+using System.Threading;
+using XdkHeadTrack.Model;
+using XdkHeadTrack.Numerics;
+using XdkHeadTrack.Tools.Linux;
+
+namespace XdkHeadTrack.Tools.Uinput
+{
+	/// <summary>
+	/// Where one angle goes on the virtual joystick.
+	/// </summary>
+	public struct JoystickAxis
+	{
+		/// <summary>ABS_* code of the axis, see LinuxInput.</summary>
+		public ushort Code;
+		/// <summary>Angle in degrees at full deflection, larger ones are clamped.</summary>
+		public double RangeDegrees;
+		public bool IsInverted;
+
+		public JoystickAxis(ushort code, double rangeDegrees, bool isInverted = false)
+		{
+			Code = code;
+			RangeDegrees = rangeDegrees;
+			IsInverted = isInverted;
+		}
+
+		/// <summary>
+		/// Axis value of an angle, in [-JoystickMapping.AxisMaximum, AxisMaximum].
+		/// </summary>
+		public int ToValue(double degrees)
+		{
+			double value = Math.Round(degrees / RangeDegrees * JoystickMapping.AxisMaximum);
+			if (IsInverted)
+				value = -value;
+			return (int)Math.Max(-JoystickMapping.AxisMaximum, Math.Min(JoystickMapping.AxisMaximum, value));
+		}
+	}
+
+	/// <summary>
+	/// Axes of yaw, pitch and roll, the angles of Orientation.ToYawPitchRoll.
+	/// The defaults are the rotation axes OpenTrack's Linux joystick output
+	/// uses, so games bound to that work unchanged.
+	/// </summary>
+	public class JoystickMapping
+	{
+		public const int AxisMaximum = 32767;
+
+		public JoystickAxis Yaw { get; set; } = new JoystickAxis(LinuxInput.AbsRx, 180D);
+		public JoystickAxis Pitch { get; set; } = new JoystickAxis(LinuxInput.AbsRy, 180D);
+		public JoystickAxis Roll { get; set; } = new JoystickAxis(LinuxInput.AbsRz, 90D);
+
+		/// <summary>
+		/// Writes the yaw, pitch and roll axis values of a rotation to values.
+		/// </summary>
+		public void ToValues(Quaternion rotation, int[] values)
+		{
+			Vector3D yawPitchRoll = Orientation.ToYawPitchRoll(rotation);
+			values[0] = Yaw.ToValue(yawPitchRoll.X);
+			values[1] = Pitch.ToValue(yawPitchRoll.Y);
+			values[2] = Roll.ToValue(yawPitchRoll.Z);
+		}
+	}
+
+	/// <summary>
+	/// Publishes the rotation as a Linux uinput joystick with three absolute
+	/// axes, so local games read the head pose directly instead of over UDP
+	/// and OpenTrack. Every Send is a single write of three axis events and a
+	/// SYN_REPORT, the kernel hands them to the evdev readers right away.
+	///
+	/// Needs write access to /dev/uinput. Not thread safe, feed it from one
+	/// RotationWorker through UinputStage.
+	/// </summary>
+	public class UinputJoystick : IDisposable
+	{
+		public const string UinputPath = "/dev/uinput";
+		public const string DefaultName = "XdkHeadTrack";
+
+		private readonly JoystickMapping _mapping;
+		private readonly int[] _values = new int[3];
+		private readonly byte[] _events = new byte[4 * LinuxInput.EventSize];
+		private int _fd = -1;
+
+		/// <summary>
+		/// Name of the device below /sys/devices/virtual/input, e.g. "input17".
+		/// </summary>
+		public string SysName { get; private set; }
+
+		public UinputJoystick(JoystickMapping mapping, string name = DefaultName)
+		{
+			if (!LinuxInput.IsSupported)
+				throw new PlatformNotSupportedException("uinput is only available on Linux.");
+			_mapping = mapping;
+
+			_fd = LinuxInput.Open(UinputPath, LinuxInput.WriteOnly | LinuxInput.NonBlocking);
+			try
+			{
+				// A button makes udev and SDL treat the device as a joystick.
+				LinuxInput.Ioctl(_fd, LinuxInput.UiSetEvBit, LinuxInput.EvKey);
+				LinuxInput.Ioctl(_fd, LinuxInput.UiSetKeyBit, LinuxInput.BtnTrigger);
+				LinuxInput.Ioctl(_fd, LinuxInput.UiSetEvBit, LinuxInput.EvAbs);
+				foreach (JoystickAxis axis in new[] { mapping.Yaw, mapping.Pitch, mapping.Roll })
+				{
+					LinuxInput.Ioctl(_fd, LinuxInput.UiSetAbsBit, axis.Code);
+					byte[] absSetup = new byte[LinuxInput.AbsSetupSize];
+					LinuxInput.WriteUInt16(absSetup, 0, axis.Code);
+					LinuxInput.WriteInt32(absSetup, 8, -JoystickMapping.AxisMaximum);
+					LinuxInput.WriteInt32(absSetup, 12, JoystickMapping.AxisMaximum);
+					LinuxInput.Ioctl(_fd, LinuxInput.UiAbsSetup, absSetup);
+				}
+
+				byte[] setup = new byte[LinuxInput.SetupSize];
+				LinuxInput.WriteUInt16(setup, 0, LinuxInput.BusVirtual);
+				byte[] nameBytes = Encoding.ASCII.GetBytes(name);
+				Array.Copy(nameBytes, 0, setup, 8, Math.Min(nameBytes.Length, LinuxInput.MaxNameLength - 1));
+				LinuxInput.Ioctl(_fd, LinuxInput.UiDevSetup, setup);
+				LinuxInput.Ioctl(_fd, LinuxInput.UiDevCreate, 0);
+				SysName = LinuxInput.GetSysName(_fd);
+			}
+			catch
+			{
+				LinuxInput.Close(_fd);
+				_fd = -1;
+				throw;
+			}
+		}
+
+		/// <summary>
+		/// Waits until udev created the /dev/input/event* node of the device and
+		/// returns its path, for reading the joystick back.
+		/// </summary>
+		public string WaitForEventDevice(TimeSpan timeout)
+		{
+			string sysPath = Path.Combine("/sys/devices/virtual/input", SysName);
+			DateTime deadline = DateTime.UtcNow + timeout;
+			while (true)
+			{
+				if (Directory.Exists(sysPath))
+				{
+					foreach (string entry in Directory.GetDirectories(sysPath, "event*"))
+					{
+						string device = Path.Combine("/dev/input", Path.GetFileName(entry));
+						if (File.Exists(device))
+							return device;
+					}
+				}
+				if (DateTime.UtcNow > deadline)
+					throw new TimeoutException("No event device for " + sysPath + ".");
+				Thread.Sleep(10);
+			}
+		}
+
+		public void Send(Quaternion rotation)
+		{
+			_mapping.ToValues(rotation, _values);
+			int offset = LinuxInput.WriteEvent(_events, 0, LinuxInput.EvAbs, _mapping.Yaw.Code, _values[0]);
+			offset = LinuxInput.WriteEvent(_events, offset, LinuxInput.EvAbs, _mapping.Pitch.Code, _values[1]);
+			offset = LinuxInput.WriteEvent(_events, offset, LinuxInput.EvAbs, _mapping.Roll.Code, _values[2]);
+			offset = LinuxInput.WriteEvent(_events, offset, LinuxInput.EvSyn, LinuxInput.SynReport, 0);
+			LinuxInput.Write(_fd, _events, offset);
+		}
+
+		public void Dispose()
+		{
+			if (_fd < 0)
+				return;
+			try
+			{
+				LinuxInput.Ioctl(_fd, LinuxInput.UiDevDestroy, 0);
+			}
+			finally
+			{
+				LinuxInput.Close(_fd);
+				_fd = -1;
+			}
+		}
+	}
+}
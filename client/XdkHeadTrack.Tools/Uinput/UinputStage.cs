@@ -0,0 +1,23 @@
+﻿using XdkHeadTrack.Model;
+
+namespace XdkHeadTrack.Tools.Uinput
+{
+	/// <summary>
+	/// Moves the virtual joystick to the sample, for the uinput output worker.
+	/// </summary>
+	public struct UinputStage : IRotationStage
+	{
+		private readonly UinputJoystick _joystick;
+
+		public UinputStage(UinputJoystick joystick)
+		{
+			_joystick = joystick;
+		}
+
+		public bool Process(ref RotationSample sample)
+		{
+			_joystick.Send(sample.Rotation);
+			return true;
+		}
+	}
+}
@@ -4,9 +4,15 @@ using System.Linq;
 using System.Diagnostics.Contracts;
 using System.IO.Ports;
 using System.Management;
+using System.Text;
 
 namespace XdkHeadTrack.Utils
 {
+	/// <summary>
+	/// Raises PortsChanged when serial ports come and go, from WMI device
+	/// change events, and finds USB serial devices by their serial number
+	/// whatever port they got.
+	/// </summary>
 	public class SerialPortService
 	{
 		private readonly static Lazy<SerialPortService> _instance = new Lazy<SerialPortService>(() => new SerialPortService());
@@ -72,6 +78,81 @@ namespace XdkHeadTrack.Utils
 		}
 
 		public string[] GetPortNames() => SerialPort.GetPortNames();
+
+		/// <summary>
+		/// Serial number of the USB device behind a port, null if it is no USB
+		/// device or has none.
+		/// </summary>
+		public string GetSerialNumber(string portName)
+		{
+			string query = "SELECT PNPDeviceID FROM Win32_PnPEntity WHERE Name LIKE '%(" + EscapeLike(portName) + ")'";
+			using (ManagementObjectSearcher searcher = new ManagementObjectSearcher(query))
+			using (ManagementObjectCollection devices = searcher.Get())
+			{
+				foreach (ManagementBaseObject device in devices)
+					return GetSerialNumberOfDeviceId(device["PNPDeviceID"] as string);
+			}
+			return null;
+		}
+
+		/// <summary>
+		/// The port of the USB device with the given serial number, among the
+		/// given ports. Null if none.
+		/// </summary>
+		public string FindPort(string serialNumber, string[] portNames)
+		{
+			// One query for all ports, the device ids end with the serial number.
+			string query = "SELECT Name, PNPDeviceID FROM Win32_PnPEntity WHERE PNPDeviceID LIKE 'USB\\\\%\\\\" + EscapeLike(serialNumber) + "'";
+			using (ManagementObjectSearcher searcher = new ManagementObjectSearcher(query))
+			using (ManagementObjectCollection devices = searcher.Get())
+			{
+				foreach (ManagementBaseObject device in devices)
+				{
+					if (GetSerialNumberOfDeviceId(device["PNPDeviceID"] as string) != serialNumber)
+						continue;
+					string portName = GetPortNameOfDeviceName(device["Name"] as string);
+					if (portName != null && Array.IndexOf(portNames, portName) >= 0)
+						return portName;
+				}
+			}
+			return null;
+		}
+
+		// USB\VID_xxxx&PID_xxxx\<serial>, Windows makes up an instance id with
+		// '&' in it for devices without a serial number.
+		private static string GetSerialNumberOfDeviceId(string deviceId)
+		{
+			string[] parts = deviceId?.Split('\\');
+			if (parts == null || parts.Length != 3 || parts[0] != "USB" || parts[2].IndexOf('&') >= 0)
+				return null;
+			return parts[2];
+		}
+
+		// "USB Serial Device (COM3)"
+		private static string GetPortNameOfDeviceName(string name)
+		{
+			int start = name?.LastIndexOf('(') ?? -1;
+			if (start < 0 || !name.EndsWith(")", StringComparison.Ordinal))
+				return null;
+			return name.Substring(start + 1, name.Length - start - 2);
+		}
+
+		// Quotes and backslashes are escaped in WQL strings, the wildcards of
+		// LIKE are taken literally in brackets.
+		private static string EscapeLike(string value)
+		{
+			StringBuilder builder = new StringBuilder(value.Length);
+			foreach (char c in value)
+			{
+				if (c == '%' || c == '_' || c == '[')
+					builder.Append('[').Append(c).Append(']');
+				else if (c == '\\' || c == '\'')
+					builder.Append('\\').Append(c);
+				else
+					builder.Append(c);
+			}
+			return builder.ToString();
+		}
 	}
 
 	public enum SerialPortServiceEventType
@@ -11,12 +11,15 @@ namespace XdkHeadTrack.View.Model
 {
 	public abstract class BaseViewModel : BaseSynchronizedNotifyPropertyChanged
 	{
-		public BaseViewModel() : base()
+		protected readonly Dispatcher _dispatcher;
+
+		public BaseViewModel() : this(Dispatcher.CurrentDispatcher)
 		{
 		}
 
-		public BaseViewModel(Dispatcher dispatcher) : base(dispatcher)
+		public BaseViewModel(Dispatcher dispatcher) : base(new DispatcherSynchronizationContext(dispatcher), dispatcher.Thread)
 		{
+			_dispatcher = dispatcher;
 		}
 
 		protected void Invoke(Action callback)
@@ -1,11 +1,13 @@
 ﻿using HelixToolkit.Wpf;
 using System;
+using System.Diagnostics;
 using System.IO;
 using System.IO.Ports;
 using System.Net;
 using System.Threading;
 using System.Threading.Tasks;
 using System.Windows.Input;
+using System.Windows.Media;
 using System.Windows.Media.Media3D;
 using System.Windows.Threading;
 using Trustsoft.Commands;
@@ -48,10 +50,32 @@ namespace XdkHeadTrack.View.Model
 		{
 			get
 			{
-				return _udpTask != null && !_udpTask.IsCompleted && !_udpTask.IsFaulted && !_udpTask.IsCanceled;
+				return _filterWorker != null && _filterWorker.IsRunning && _udpWorker.IsRunning;
 			}
 		}
 
+		private Quaternion _displayRotation = Quaternion.Identity;
+		/// <summary>
+		/// Calibrated rotation shown by the view, the newest one once per
+		/// rendered frame.
+		/// </summary>
+		public Quaternion DisplayRotation
+		{
+			get { return _displayRotation; }
+			private set { _displayRotation = value; NotifyPropertyChanged(); }
+		}
+
+		/// <summary>
+		/// Logical processor for the filter worker of the UDP output, -1 to
+		/// leave it to the scheduler. Applies the next time UDP is started.
+		/// </summary>
+		public int ProcessingProcessor { get; set; } = -1;
+
+		/// <summary>
+		/// Same as ProcessingProcessor for the worker sending the packets.
+		/// </summary>
+		public int OutputProcessor { get; set; } = -1;
+
 		public XdkIO Xdk
 		{
 			get;
@@ -64,6 +88,25 @@ namespace XdkHeadTrack.View.Model
 			private set;
 		}
 
+		public OneEuroRotationFilter RotationFilter
+		{
+			get;
+			private set;
+		}
+
+		private bool _isRotationFilterEnabled;
+		public bool IsRotationFilterEnabled
+		{
+			get { return _isRotationFilterEnabled; }
+			set
+			{
+				_isRotationFilterEnabled = value;
+				if (_filterWorker != null)
+					_filterWorker.Stage.First.IsEnabled = value;
+				NotifyPropertyChanged();
+			}
+		}
+
 		public ICommand ClosingCommand
 		{
 			get;
@@ -88,9 +131,34 @@ namespace XdkHeadTrack.View.Model
 			private set;
 		}
 
+		/// <summary>
+		/// Capacity of the queues between the UDP output workers. Kept short, an
+		/// output that falls behind should drop samples rather than send old ones.
+		/// </summary>
+		public const int UdpQueueCapacity = 64;
+
+		/// <summary>
+		/// Time a suspended serial session keeps trying to reopen the port its
+		/// device came back at before it is disconnected.
+		/// </summary>
+		public static readonly TimeSpan SerialResumeTimeout = TimeSpan.FromSeconds(2D);
+
+		/// <summary>
+		/// Time a serial session stays suspended waiting for its device to come
+		/// back at any port before it is disconnected.
+		/// </summary>
+		public static readonly TimeSpan SerialSuspensionTimeout = TimeSpan.FromSeconds(10D);
+
+		private static readonly TimeSpan SerialResumeRetryInterval = TimeSpan.FromMilliseconds(10D);
+
 		private Task _toggleSerialTask;
-		private Task _udpTask;
-		private CancellationTokenSource _udpTaskCancelSource;
+		// USB serial number of the connected device, null if it has none.
+		private volatile string _serialNumber;
+		private int _isResumingSerial;
+		// Serial thread -> _filterWorker -> _udpWorker, see RotationWorker.
+		private RotationWorker<RotationPipeline<FilterStage, ForwardStage>> _filterWorker;
+		private RotationWorker<UdpSendStage> _udpWorker;
+		private Task _udpStopTask;
 
 		public MainViewModel() : this(Dispatcher.CurrentDispatcher) { }
 
@@ -100,6 +168,8 @@ namespace XdkHeadTrack.View.Model
 			UdpSender = new UdpOrientationSender();
 			UdpSender.TargetIPAddress = IPAddress.Loopback;
 			UdpSender.TargetPort = 4242;
+			RotationFilter = new OneEuroRotationFilter();
+			IsRotationFilterEnabled = true;
 
 			SerialPortNameToUse = Xdk.CurrentSerialPortName;
 
@@ -110,9 +180,10 @@ namespace XdkHeadTrack.View.Model
 			ToggleConnectSerialCommand = CommandFactory.Create(ToggleSerialConnectExecuteAsync, CanToggleSerialConnectExecute, true);
 			RefreshPortsCommand = CommandFactory.Create(() => RefreshSerialPorts(), () => !IsPortConnected, true);
 			ToggleConnectUdpCommand = CommandFactory.Create(ToggleUdpConnectionExecuteAsync, () => UdpSender.TargetEndpoint != null && 
-			(_udpTaskCancelSource == null || !_udpTaskCancelSource.IsCancellationRequested), true);
+			_udpStopTask == null, true);
 
 			RefreshSerialPorts();
+			CompositionTarget.Rendering += OnRendering;
 
 			ObjReader objReader = new ObjReader();
 			using (Stream stream = new MemoryStream(Properties.Resources.Head))
@@ -124,6 +195,7 @@ namespace XdkHeadTrack.View.Model
 		private void ConnectSerial(string portName)
 		{
 			Xdk.ConnectSerial(portName);
+			_serialNumber = SerialPortService.Instance.GetSerialNumber(portName);
 			Invoke(() =>
 			{
 				IsPortConnected = Xdk.IsSerialConnected;
@@ -179,64 +251,108 @@ namespace XdkHeadTrack.View.Model
 			CommandManager.InvalidateRequerySuggested();
 		}
 
-		private void StartUdpSender()
+		/// <summary>
+		/// Looks for the device of the suspended serial session among the ports
+		/// and reopens it there, retrying while the port is not accessible yet.
+		/// Devices without a USB serial number are expected at their old port.
+		/// </summary>
+		private async void ResumeSerialAsync(string[] portNames)
 		{
-			_udpTaskCancelSource = new CancellationTokenSource();
-			CancellationToken ct = _udpTaskCancelSource.Token;
-			_udpTask = Task.Run(() =>
+			if (Interlocked.Exchange(ref _isResumingSerial, 1) == 1)
+				return;
+			try
 			{
-				AutoResetEvent eventSignal = new AutoResetEvent(false);
-				EventHandler<XdkIORotationEventArgs> handler = (o, p) =>
-				{
-					eventSignal.Set();
-				};
-
-				try
+				string serialNumber = _serialNumber;
+				string portName = serialNumber != null
+					? SerialPortService.Instance.FindPort(serialNumber, portNames)
+					: Array.Find(portNames, p => p == Xdk.CurrentSerialPortName);
+				if (portName == null)
+					return;
+
+				long deadline = HostClock.Now + HostClock.FromSeconds(SerialResumeTimeout.TotalSeconds);
+				while (Xdk.IsSerialSuspended && !Xdk.TryResumeSerial(portName))
 				{
-					Xdk.RotationDataReceived += handler;
-					while (!ct.IsCancellationRequested)
+					if (HostClock.Now >= deadline)
 					{
-						int source = WaitHandle.WaitAny(new[] { ct.WaitHandle, eventSignal });
-						if (source == WaitHandle.WaitTimeout)
-							continue;
-						else if (source == 0)
-							break;
-
-						UdpSender.Send(Xdk.CalibratedRotation);
+						Debug.WriteLine("XDK came back at " + portName + " but the port did not open, disconnecting");
+						await Task.Run(() => DisconnectSerial());
+						return;
 					}
+					await Task.Delay(SerialResumeRetryInterval);
 				}
-				finally
-				{
-					Xdk.RotationDataReceived -= handler;
-				}
-			}, ct);
+			}
+			finally
+			{
+				Volatile.Write(ref _isResumingSerial, 0);
+			}
+		}
+
+		/// <summary>
+		/// Disconnects the session if it is still in the given suspension after
+		/// SerialSuspensionTimeout, e.g. since no port that came up was its
+		/// device's. A resume in progress gets to finish first.
+		/// </summary>
+		private async void DisconnectIfNotResumedAsync(long suspension)
+		{
+			await Task.Delay(SerialSuspensionTimeout);
+			while (Volatile.Read(ref _isResumingSerial) == 1)
+				await Task.Delay(SerialResumeRetryInterval);
+			if (!Xdk.IsSerialSuspended || Xdk.ReconnectStats.Suspensions != suspension)
+				return;
+
+			Debug.WriteLine("XDK did not come back within " + SerialSuspensionTimeout + ", disconnecting");
+			await Task.Run(() => DisconnectSerial());
+		}
+
+		private void StartUdpSender()
+		{
+			// Workers of an output that failed on its own.
+			DisposeWorkers(DetachUdpWorkers());
+
+			RotationFilter.Reset();
+			_udpWorker = new RotationWorker<UdpSendStage>("UDP output", new UdpSendStage(UdpSender), UdpQueueCapacity, OutputProcessor);
+			FilterStage filter = new FilterStage(RotationFilter) { IsEnabled = IsRotationFilterEnabled };
+			_filterWorker = new RotationWorker<RotationPipeline<FilterStage, ForwardStage>>("Rotation filter",
+				new RotationPipeline<FilterStage, ForwardStage>(filter, new ForwardStage(_udpWorker)), UdpQueueCapacity, ProcessingProcessor);
+			_udpWorker.Start();
+			_filterWorker.Start();
+			Xdk.RotationSink = _filterWorker;
+			CommandManager.InvalidateRequerySuggested();
+		}
+
+		private RotationWorker[] DetachUdpWorkers()
+		{
+			if (_filterWorker == null)
+				return new RotationWorker[0];
+
+			// Samples posted after this are queued and never processed.
+			Xdk.RotationSink = null;
+			RotationWorker[] workers = new RotationWorker[] { _filterWorker, _udpWorker };
+			_filterWorker = null;
+			_udpWorker = null;
+			return workers;
+		}
+
+		private static void DisposeWorkers(RotationWorker[] workers)
+		{
+			// In pipeline order, no worker posts to one already stopped.
+			foreach (RotationWorker worker in workers)
+				worker.Dispose();
 		}
 
 		private void StopUdpSender()
 		{
-			if (_udpTask != null)
-			{
-				_udpTaskCancelSource?.Cancel();
-				CommandManager.InvalidateRequerySuggested();
-				_udpTask.Wait();
-				_udpTaskCancelSource?.Dispose();
-				_udpTaskCancelSource = null;
-				_udpTask = null;
-			}
+			DisposeWorkers(DetachUdpWorkers());
 			CommandManager.InvalidateRequerySuggested();
 		}
 
 		private async Task StopUdpSenderAsync()
 		{
-			if (_udpTask != null)
-			{
-				_udpTaskCancelSource?.Cancel();
-				CommandManager.InvalidateRequerySuggested();
-				await _udpTask;
-				_udpTaskCancelSource?.Dispose();
-				_udpTaskCancelSource = null;
-				_udpTask = null;
-			}
+			RotationWorker[] workers = DetachUdpWorkers();
+			_udpStopTask = Task.Run(() => DisposeWorkers(workers));
+			CommandManager.InvalidateRequerySuggested();
+			await _udpStopTask;
+			_udpStopTask = null;
 			CommandManager.InvalidateRequerySuggested();
 		}
 
@@ -258,6 +374,7 @@ namespace XdkHeadTrack.View.Model
 		{
 			try
 			{
+				CompositionTarget.Rendering -= OnRendering;
 				SerialPortService.Instance.StopMonitoring();
 			}
 			finally
@@ -288,17 +405,41 @@ namespace XdkHeadTrack.View.Model
 		#endregion
 
 		#region Event Handlers
+		private void OnRendering(object sender, EventArgs e)
+		{
+			RotationSample sample;
+			// The model has its own quaternion, the view binds the WPF one.
+			if (Xdk.LatestRotation.TryRead(out sample))
+				DisplayRotation = new Quaternion(sample.Rotation.X, sample.Rotation.Y, sample.Rotation.Z, sample.Rotation.W);
+		}
+
 		private void OnPortsChanged(object sender, PortsChangedArgs e)
 		{
+			if (!Xdk.IsSerialConnected)
+			{
+				Invoke(() => RefreshSerialPorts());
+				return;
+			}
+
+			// An open session survives its port going away, it resumes as soon
+			// as the device is back.
 			switch (e.EventType)
 			{
 				case SerialPortServiceEventType.Insertion:
+					if (Xdk.IsSerialSuspended)
+						ResumeSerialAsync(e.SerialPorts);
+					break;
 				case SerialPortServiceEventType.Removal:
-					Invoke(() => RefreshSerialPorts());
+					if (!Xdk.IsSerialSuspended && Array.IndexOf(e.SerialPorts, Xdk.CurrentSerialPortName) < 0)
+					{
+						Xdk.SuspendSerial();
+						DisconnectIfNotResumedAsync(Xdk.ReconnectStats.Suspensions);
+					}
 					break;
 				default:
 					throw new InvalidOperationException();
 			}
+			Invoke(() => SerialPortNames = e.SerialPorts);
 		}
 		#endregion
 	}
@@ -28,6 +28,26 @@ enum AppModuleId_E
 	APP_MODULE_LEDANIMATOR,
 	APP_MODULE_BUTTONUI,
 	APP_MODULE_BLEUI,
+	APP_MODULE_TEXTFORMAT,
+	APP_MODULE_SERIALMUX,
+	APP_MODULE_QUATPACK,
+	APP_MODULE_TIMESYNC,
+	APP_MODULE_USBUI,
+	APP_MODULE_SAMPLESCHEDULER,
+	APP_MODULE_RUNTIMESTATS,
+	APP_MODULE_CONTROLMAILBOX,
+	APP_MODULE_FLIGHTRECORDER,
+	APP_MODULE_LINKHEALTH,
+	APP_MODULE_BLECONNPARAMS,
+	APP_MODULE_BLECONNPOLICY,
 };
 
+/* Creates the tasks, semaphores, queues and timers of the application from
+ * static buffers instead of the FreeRTOS heap, so their RAM is fixed at link
+ * time and shows up per module in "make memory_report". Needs
+ * configSUPPORT_STATIC_ALLOCATION in the FreeRTOS configuration. */
+#ifndef APP_USE_STATIC_ALLOCATION
+#define APP_USE_STATIC_ALLOCATION	(0)
+#endif
+
 #endif /* XDKAPP_H_ */
@@ -0,0 +1,106 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKBLECONNPARAMS_H_
+#define XDKBLECONNPARAMS_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_CmdProcessor.h"
+
+#include "XdkBleConnPolicy.h"
+
+/**
+ * @brief Access to the BLE stack. Both functions are called on the command
+ * processor, which makes them easy to replace with stubs.
+ */
+struct BleConnParams_Port_S
+{
+	/** Asks the central for new parameters, it answers asynchronously. */
+	Retcode_T (*Request)(const BleConnParams_T* params);
+	/** Reads the parameters currently used by the connection. */
+	Retcode_T (*Read)(BleConnParams_T* params);
+};
+typedef struct BleConnParams_Port_S BleConnParams_Port_T;
+
+struct BleConnParams_Stats_S
+{
+	/** Last parameters requested. */
+	BleConnParams_T Requested;
+	/** Parameters read back after the last request. */
+	BleConnParams_T Negotiated;
+	uint32_t Requests;
+	/** The central applied parameters within the requested range. */
+	uint32_t Accepted;
+	/** The central kept or chose parameters outside the requested range. */
+	uint32_t Rejected;
+	/** Requests or read-backs the stack failed. */
+	uint32_t Failed;
+};
+typedef struct BleConnParams_Stats_S BleConnParams_Stats_T;
+
+/**
+ * @brief Initializes the XdkBleConnParams module.
+ *
+ * @param [in] cmdProcessor  Command processor requests and read-backs are
+ *                           run on.
+ * @param [in] port          Access to the BLE stack, must stay valid.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T BleConnParams_Initialize(const CmdProcessor_T* cmdProcessor,
+		const BleConnParams_Port_T* port);
+
+/**
+ * @brief Requests the parameters for the current sampling period once a
+ * central connected. May be called from any task.
+ *
+ * @param [in] isConnected  Whether a central is connected now.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T BleConnParams_NotifyConnection(bool isConnected);
+
+/**
+ * @brief Renegotiates the parameters if the policy asks for different ones
+ * at the new sampling period. May be called from any task.
+ *
+ * @param [in] periodMs  New sampling period.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T BleConnParams_NotifySamplePeriod(uint32_t periodMs);
+
+/**
+ * @brief Must be called on the command processor.
+ */
+void BleConnParams_GetStats(BleConnParams_Stats_T* stats);
+
+/**
+ * @brief Publishes the stats on the stats channel as "BLECP interval-us
+ * slave-latency timeout-ms requested-min-us requested-max-us requests
+ * accepted rejected failed". Done after every read-back, must be called on
+ * the command processor.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T BleConnParams_PublishStats(void);
+
+#endif /* XDKBLECONNPARAMS_H_ */
@@ -0,0 +1,135 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKBLECONNPOLICY_H_
+#define XDKBLECONNPOLICY_H_
+
+/* Only the C library, so the policy is tested on the host, see test/. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Unit of the connection intervals, see the Bluetooth Core
+ * Specification.
+ */
+#define BLE_CONN_PARAMS_INTERVAL_UNIT_US	(UINT32_C(1250))
+
+/**
+ * @brief Unit of the supervision timeout.
+ */
+#define BLE_CONN_PARAMS_TIMEOUT_UNIT_MS		(UINT32_C(10))
+
+/**
+ * @brief Parameters of a BLE connection, in the units the link layer uses.
+ * Requests give a range of intervals, negotiated parameters have
+ * MinInterval equal to MaxInterval. Data length and PHY are missing on
+ * purpose: the Bluetooth 4.1 controller of the XDK110 has neither data
+ * length extension nor 2M PHY, so every notification is one 27 byte link
+ * layer packet on the 1M PHY.
+ */
+struct BleConnParams_S
+{
+	/** In BLE_CONN_PARAMS_INTERVAL_UNIT_US. */
+	uint16_t MinInterval;
+	uint16_t MaxInterval;
+	/** Connection events the peripheral may skip while it has no data. */
+	uint16_t SlaveLatency;
+	/** In BLE_CONN_PARAMS_TIMEOUT_UNIT_MS. */
+	uint16_t SupervisionTimeout;
+};
+typedef struct BleConnParams_S BleConnParams_T;
+
+/**
+ * @brief When to ask the central for which parameters. Owned by one task,
+ * XdkBleConnParams runs it on the command processor.
+ */
+struct BleConnPolicy_S
+{
+	bool IsConnected;
+	/** A request went out on this connection, Requested holds it. */
+	bool IsRequested;
+	/** The request waits for its read-back, later changes wait for it. */
+	bool IsSettling;
+	uint32_t SamplePeriodMs;
+	BleConnParams_T Requested;
+};
+typedef struct BleConnPolicy_S BleConnPolicy_T;
+
+/**
+ * @brief The parameters to request while sampling with a period. The
+ * interval is at most half the period, so a notification waits for less
+ * than half a sample before it goes out, and no connection event is
+ * skipped, so commands from the host are not held back either.
+ *
+ * @param [in] samplePeriodMs  Sampling period, 0 for the shortest interval.
+ * @param [out] params         Parameters to request.
+ */
+void BleConnPolicy_Compute(uint32_t samplePeriodMs, BleConnParams_T* params);
+
+/**
+ * @brief Starts disconnected, with nothing requested.
+ */
+void BleConnPolicy_Initialize(BleConnPolicy_T* policy);
+
+/**
+ * @brief Each connection starts with the central's defaults. A disconnect
+ * also drops a request still settling, its read-back would otherwise be
+ * taken for the next connection.
+ */
+void BleConnPolicy_SetConnected(BleConnPolicy_T* policy, bool isConnected);
+
+void BleConnPolicy_SetSamplePeriod(BleConnPolicy_T* policy,
+		uint32_t periodMs);
+
+/**
+ * @brief Whether to request new parameters now: connected, no request
+ * settling and the period asks for other parameters than requested last.
+ * If so, the request counts as sent and settling from here on.
+ *
+ * @param [out] params  Parameters to request, if true is returned.
+ *
+ * @return True if params must be requested.
+ */
+bool BleConnPolicy_NextRequest(BleConnPolicy_T* policy,
+		BleConnParams_T* params);
+
+/**
+ * @brief The request returned last could not be sent or timed. It is not
+ * repeated before the policy asks for other parameters.
+ */
+void BleConnPolicy_AbortRequest(BleConnPolicy_T* policy);
+
+/**
+ * @brief Ends the settling of the current request.
+ *
+ * @return True if its outcome is to be read back, false if there is none
+ * any more, e.g. since the central disconnected meanwhile.
+ */
+bool BleConnPolicy_EndSettling(BleConnPolicy_T* policy);
+
+/**
+ * @brief Whether the central applied the request: an interval within the
+ * requested range and at most the requested slave latency. Otherwise it
+ * kept or chose parameters of its own.
+ */
+bool BleConnPolicy_IsAccepted(const BleConnParams_T* requested,
+		const BleConnParams_T* negotiated);
+
+#endif /* XDKBLECONNPOLICY_H_ */
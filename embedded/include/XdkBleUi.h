@@ -26,22 +26,28 @@
 
 #include "BCDS_CmdProcessor.h"
 
-#pragma pack(push, 1)
-struct BleUi_TrackingData_S
-{
-	float W;
-	float X;
-	float Y;
-	float Z;
-	bool UseForCalibration;
-};
-#pragma pack(pop)
-typedef struct BleUi_TrackingData_S BleUi_TrackingData_T;
+/* BleUi_TrackingData_T, BleUi_CompactTrackingData_T and their flags are
+ * generated from schema/XdkWire.json. */
+#include "XdkWire.h"
 
 Retcode_T BleUi_Initialize(const CmdProcessor_T* cmdProcessor);
 
+/* Waits for the previous notification to complete before sending. */
 Retcode_T BleUi_SendTrackingData(const BleUi_TrackingData_T* data);
 
+/* Like BleUi_SendTrackingData but skips the data if the previous notification
+ * is still in flight, never blocking the caller. */
+Retcode_T BleUi_TrySendTrackingData(const BleUi_TrackingData_T* data);
+
+Retcode_T BleUi_SendCompactTrackingData(const BleUi_CompactTrackingData_T* data);
+
+Retcode_T BleUi_TrySendCompactTrackingData(
+		const BleUi_CompactTrackingData_T* data);
+
+/* Whether the previous notification is still in flight, so a send would have
+ * to wait for it. */
+bool BleUi_IsSendPending(void);
+
 Retcode_T BleUi_Deinitialize(void);
 
 #endif /* XDKBLEUI_H_ */
@@ -0,0 +1,99 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKCONTROLMAILBOX_H_
+#define XDKCONTROLMAILBOX_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+/**
+ * @brief Control operations of the sampling task. Each one is pending at
+ * most once, posting it again before it was taken only updates its
+ * argument, the newest argument wins.
+ */
+enum ControlMailbox_Op_E
+{
+	/** Argument: true to sample, false to stop. */
+	CONTROL_MAILBOX_OP_RUN,
+	/** Argument unused. Repeated requests make one calibration. */
+	CONTROL_MAILBOX_OP_CALIBRATE,
+	/** Argument: HeadTrack_CommunicationMode_T. */
+	CONTROL_MAILBOX_OP_MODE,
+	/** Argument: sampling period in milliseconds. */
+	CONTROL_MAILBOX_OP_PERIOD,
+	/** Argument: true if a BLE central is connected. */
+	CONTROL_MAILBOX_OP_BLE_CONNECTION,
+
+	CONTROL_MAILBOX_OP_MAX
+};
+typedef enum ControlMailbox_Op_E ControlMailbox_Op_T;
+
+#define CONTROL_MAILBOX_OP_BIT(op)	(UINT32_C(1) << (op))
+
+struct ControlMailbox_Stats_S
+{
+	/** Operations posted. */
+	uint32_t Posted;
+	/** Posts that found their operation still pending. */
+	uint32_t Coalesced;
+	/** Operations taken by the consumer. */
+	uint32_t Taken;
+	/** Longest time an operation waited to be taken. */
+	uint32_t MaxLatencyUs;
+};
+typedef struct ControlMailbox_Stats_S ControlMailbox_Stats_T;
+
+/**
+ * @brief Posts an operation for the consumer. Lock-free, may be called from
+ * any task or interrupt. The caller wakes the consumer if needed.
+ *
+ * @param [in] op   Operation to post.
+ * @param [in] arg  Argument of the operation.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T ControlMailbox_Post(ControlMailbox_Op_T op, uint32_t arg);
+
+/**
+ * @brief Takes all pending operations. Must only be called by the single
+ * consumer, e.g. at sample boundaries.
+ *
+ * @param [out] args  Arguments of the taken operations, indexed by
+ *                    ControlMailbox_Op_T.
+ *
+ * @return Taken operations, one CONTROL_MAILBOX_OP_BIT each.
+ */
+uint32_t ControlMailbox_Take(uint32_t args[CONTROL_MAILBOX_OP_MAX]);
+
+/**
+ * @brief Copies the counters collected since startup.
+ */
+void ControlMailbox_GetStats(ControlMailbox_Stats_T* stats);
+
+/**
+ * @brief Publishes the counters on the stats channel as "CTRL posted
+ * coalesced taken max-latency".
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T ControlMailbox_PublishStats(void);
+
+#endif /* XDKCONTROLMAILBOX_H_ */
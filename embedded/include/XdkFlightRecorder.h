@@ -0,0 +1,161 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKFLIGHTRECORDER_H_
+#define XDKFLIGHTRECORDER_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+/**
+ * @brief Samples kept in the RAM ring, about ten seconds at 50 Hz.
+ */
+#ifndef FLIGHT_RECORDER_SAMPLE_COUNT
+#define FLIGHT_RECORDER_SAMPLE_COUNT		(UINT32_C(512))
+#endif
+
+/**
+ * @brief Samples still recorded after a trigger, the rest of the ring shows
+ * what led up to it.
+ */
+#ifndef FLIGHT_RECORDER_POST_TRIGGER_SAMPLES
+#define FLIGHT_RECORDER_POST_TRIGGER_SAMPLES	(UINT32_C(128))
+#endif
+
+/**
+ * @brief Recordings are written in blocks of one SD card sector: the file
+ * header, then a FlightRecorder_BlockHeader_T and
+ * FLIGHT_RECORDER_SAMPLES_PER_BLOCK samples per block, zero padded.
+ */
+#define FLIGHT_RECORDER_BLOCK_SIZE			(UINT32_C(512))
+#define FLIGHT_RECORDER_SAMPLES_PER_BLOCK	\
+	((FLIGHT_RECORDER_BLOCK_SIZE - sizeof(FlightRecorder_BlockHeader_T)) \
+			/ sizeof(FlightRecorder_Sample_T))
+
+#define FLIGHT_RECORDER_FILE_MAGIC			"XHFR"
+#define FLIGHT_RECORDER_FORMAT_VERSION		(UINT8_C(1))
+
+#define FLIGHT_RECORDER_FLAG_CALIBRATION	(UINT8_C(0x01))
+/** Rotation_readQuaternionValue failed, the rotation is the previous one. */
+#define FLIGHT_RECORDER_FLAG_READ_FAILED	(UINT8_C(0x02))
+/** Acceleration and AngularRate hold values. */
+#define FLIGHT_RECORDER_FLAG_RAW_VALID		(UINT8_C(0x04))
+/** Bits of the component QuatPack dropped from Rotation. */
+#define FLIGHT_RECORDER_COMPONENT_SHIFT		(UINT8_C(4))
+#define FLIGHT_RECORDER_COMPONENT_MASK		(UINT8_C(0x03))
+
+enum FlightRecorder_Reason_E
+{
+	FLIGHT_RECORDER_REASON_BUTTON,
+	FLIGHT_RECORDER_REASON_COMMAND,
+	FLIGHT_RECORDER_REASON_READ_FAILURE,
+	/** Fused rotation jumped further than plausible between two samples. */
+	FLIGHT_RECORDER_REASON_GLITCH,
+
+	FLIGHT_RECORDER_REASON_MAX
+};
+typedef enum FlightRecorder_Reason_E FlightRecorder_Reason_T;
+
+/* All little endian, as written to the card. */
+#pragma pack(push, 1)
+struct FlightRecorder_Sample_S
+{
+	/** Device time, see TimeSync_GetDeviceTime. */
+	uint32_t Time;
+	/** Of the sample sent, a failed read repeats the next one. */
+	uint16_t Sequence;
+	uint8_t Flags;
+	/** Fused rotation, packed with QuatPack. */
+	int16_t Rotation[3];
+	/** Accelerometer in mg. */
+	int16_t Acceleration[3];
+	/** Gyroscope in 0.1 deg/s. */
+	int16_t AngularRate[3];
+};
+typedef struct FlightRecorder_Sample_S FlightRecorder_Sample_T;
+
+struct FlightRecorder_FileHeader_S
+{
+	char Magic[4];
+	uint8_t Version;
+	/** FlightRecorder_Reason_T */
+	uint8_t Reason;
+	uint16_t SampleSize;
+	uint16_t SamplesPerBlock;
+	uint16_t SampleCount;
+	/** Device time of the trigger. */
+	uint32_t TriggerTime;
+	/** Samples dropped while the previous recording was written, they may
+	 * have left the ring since. */
+	uint32_t MissedSamples;
+};
+typedef struct FlightRecorder_FileHeader_S FlightRecorder_FileHeader_T;
+
+struct FlightRecorder_BlockHeader_S
+{
+	uint16_t Index;
+	uint8_t Count;
+	uint8_t Reserved;
+	/** CRC-16/CCITT-FALSE of the Count samples. */
+	uint16_t Crc;
+};
+typedef struct FlightRecorder_BlockHeader_S FlightRecorder_BlockHeader_T;
+#pragma pack(pop)
+
+/**
+ * @brief Initializes the XdkFlightRecorder module and starts its writer
+ * task. The SD card is only mounted when the first recording is written.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T FlightRecorder_Initialize(void);
+
+/**
+ * @brief Adds a sample to the ring. Must be called by the sampling task
+ * only, it does not block. Samples are dropped and counted while a
+ * recording is being written.
+ */
+void FlightRecorder_Record(const FlightRecorder_Sample_T* sample);
+
+/**
+ * @brief Writes the ring to the SD card as "RECnnnnn.BIN" once the post
+ * trigger samples are recorded. Ignored while a recording is in progress.
+ * May be called from any task.
+ *
+ * @param [in] reason  Reason stored in the file header.
+ *
+ * @return RETCODE_OK, or RETCODE_INCONSITENT_STATE if ignored.
+ */
+Retcode_T FlightRecorder_Trigger(FlightRecorder_Reason_T reason);
+
+/**
+ * @brief Answers a "DUMP" command of the host with "DUMP OK" or "DUMP BUSY"
+ * on the response channel. The file name follows on the log channel once
+ * written.
+ *
+ * @param [in] args        Unused.
+ * @param [in] receivedAt  Unused.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T FlightRecorder_HandleDumpCommand(const char* args,
+		uint32_t receivedAt);
+
+#endif /* XDKFLIGHTRECORDER_H_ */
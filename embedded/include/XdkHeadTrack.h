@@ -31,6 +31,8 @@
 enum HeadTrack_CommunicationMode_E
 {
 	HEAD_TRACK_COMMUNICATION_MODE_SERIAL, HEAD_TRACK_COMMUNICATION_MODE_BLE,
+	/* Every sample over serial and, while connected, over BLE as well. */
+	HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT,
 
 	HEAD_TRACK_COMMUNICATION_MODE_MAX
 };
@@ -47,4 +49,13 @@ Retcode_T HeadTrack_Calibrate(void);
 Retcode_T HeadTrack_ChangeCommunicationMode(
 		HeadTrack_CommunicationMode_T commMode);
 
+Retcode_T HeadTrack_ChangeSamplePeriod(uint32_t periodMs);
+
+Retcode_T HeadTrack_NotifyBleConnectionChanged(bool isConnected);
+
+/* Answers "RATE <hz>" of the host with "RATE <hz> <period-ms>" once the new
+ * sampling period is posted, "ERR RATE" if the rate is malformed or out of
+ * range. */
+Retcode_T HeadTrack_HandleRateCommand(const char* args, uint32_t receivedAt);
+
 #endif /* XDKHEADTRACK_H_ */
@@ -0,0 +1,105 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKLINKHEALTH_H_
+#define XDKLINKHEALTH_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+/**
+ * @brief Highest level any transport can be stepped down to.
+ */
+#define LINK_HEALTH_MAX_LEVEL	(UINT32_C(7))
+
+/**
+ * @brief Links whose health is tracked separately.
+ */
+enum LinkHealth_Transport_E
+{
+	LINK_HEALTH_TRANSPORT_SERIAL,
+	LINK_HEALTH_TRANSPORT_BLE,
+
+	LINK_HEALTH_TRANSPORT_MAX
+};
+typedef enum LinkHealth_Transport_E LinkHealth_Transport_T;
+
+/**
+ * @brief Initializes the XdkLinkHealth module. Every transport starts at
+ * level 0, which stands for a healthy link. The caller decides what the
+ * levels mean, e.g. a more compact payload or a lower sample rate.
+ *
+ * @param [in] maxLevels  Highest level of each transport, indexed by
+ *                        LinkHealth_Transport_T, at most
+ *                        LINK_HEALTH_MAX_LEVEL. 0 disables adaptation.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T LinkHealth_Initialize(
+		const uint32_t maxLevels[LINK_HEALTH_TRANSPORT_MAX]);
+
+/**
+ * @brief Records one send. Must be called by the sampling task. Failures do
+ * not need to be raised by the caller: the first one of a storm is raised
+ * here, the following ones are counted and summarized on the stats channel
+ * once the transport had a window without failures.
+ *
+ * @param [in] transport     Transport the sample was sent over.
+ * @param [in] rc            Outcome of the send.
+ * @param [in] latencyUs     Time spent in the send.
+ * @param [in] fillPermille  Fill of the transport's queue before the send,
+ *                           0 if the send does not go through a queue.
+ */
+void LinkHealth_RecordSend(LinkHealth_Transport_T transport, Retcode_T rc,
+		uint32_t latencyUs, uint32_t fillPermille);
+
+/**
+ * @brief Records a send that failed after it was accepted, e.g. in the
+ * completion callback of a BLE notification. May be called from any task.
+ *
+ * @param [in] transport  Transport of the send.
+ * @param [in] rc         Outcome reported by the transport.
+ */
+void LinkHealth_RecordCompletion(LinkHealth_Transport_T transport,
+		Retcode_T rc);
+
+/**
+ * @brief Ends the current window once it is due and adapts the levels: a
+ * congested window steps a transport down by one level, a number of clean
+ * windows in a row step it back up. Transitions are published on the stats
+ * channel as "LINK transport level previous-level sends failures
+ * mean-latency max-latency mean-fill", the end of an error storm as
+ * "LINKERR transport failures duration-ms". Must be called by the sampling
+ * task once per sample.
+ *
+ * @param [in] now       Device time, see TimeSync_GetDeviceTime.
+ * @param [in] periodUs  Current sampling period, latencies are judged
+ *                       against it.
+ *
+ * @return true if a level changed.
+ */
+bool LinkHealth_Update(uint32_t now, uint32_t periodUs);
+
+/**
+ * @brief Current level of a transport, 0 while healthy.
+ */
+uint32_t LinkHealth_GetLevel(LinkHealth_Transport_T transport);
+
+#endif /* XDKLINKHEALTH_H_ */
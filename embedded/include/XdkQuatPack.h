@@ -0,0 +1,52 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKQUATPACK_H_
+#define XDKQUATPACK_H_
+
+#include "BCDS_Basics.h"
+
+/* Components other than the largest lie within +-1/sqrt(2). */
+#define QUAT_PACK_SCALE		(32767.0f * 1.41421356f)
+
+enum QuatPack_Component_E
+{
+	QUAT_PACK_COMPONENT_W,
+	QUAT_PACK_COMPONENT_X,
+	QUAT_PACK_COMPONENT_Y,
+	QUAT_PACK_COMPONENT_Z,
+
+	QUAT_PACK_COMPONENT_MAX
+};
+typedef enum QuatPack_Component_E QuatPack_Component_T;
+
+/**
+ * @brief Packs a unit quaternion into three int16 ("smallest three"). The
+ * largest component is dropped after flipping the sign of the quaternion so
+ * that it is positive, the receiver restores it from the unit length.
+ *
+ * @param [out] packed  The three remaining components in w, x, y, z order.
+ *
+ * @return The dropped component.
+ */
+QuatPack_Component_T QuatPack_Pack(float w, float x, float y, float z,
+		int16_t packed[3]);
+
+#endif /* XDKQUATPACK_H_ */
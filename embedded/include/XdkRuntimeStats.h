@@ -0,0 +1,148 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKRUNTIMESTATS_H_
+#define XDKRUNTIMESTATS_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_CmdProcessor.h"
+
+#include "FreeRTOS.h"
+
+/**
+ * @brief Tasks covered by one sample, further tasks are left out and
+ * RUNTIME_STATS_FLAG_TASKS_TRUNCATED is set.
+ */
+#define RUNTIME_STATS_MAX_TASKS				(UINT32_C(16))
+
+/**
+ * @brief Task name characters sent, longer names are cut.
+ */
+#define RUNTIME_STATS_TASK_NAME_LENGTH		(UINT32_C(8))
+
+/**
+ * @brief Task entries per task record, so a record fits one stats line.
+ */
+#define RUNTIME_STATS_TASKS_PER_RECORD		(UINT32_C(3))
+
+/**
+ * @brief CPU share sent when the run time counters are not available.
+ */
+#define RUNTIME_STATS_CPU_SHARE_UNKNOWN		(UINT16_C(0xFFFF))
+
+#define RUNTIME_STATS_RECORD_SYSTEM			(UINT8_C(1))
+#define RUNTIME_STATS_RECORD_TASKS			(UINT8_C(2))
+
+/** The CPU shares are valid, i.e. configGENERATE_RUN_TIME_STATS is set. */
+#define RUNTIME_STATS_FLAG_CPU_SHARE		(UINT8_C(0x01))
+/** More tasks exist than RUNTIME_STATS_MAX_TASKS or task records were lost. */
+#define RUNTIME_STATS_FLAG_TASKS_TRUNCATED	(UINT8_C(0x02))
+
+/* Records are sent little endian as "RTS <hex>" lines on the stats channel
+ * of XdkSerialMux: one system record followed by the task records of the
+ * same sample. */
+#pragma pack(push, 1)
+struct RuntimeStats_SystemRecord_S
+{
+	/** RUNTIME_STATS_RECORD_SYSTEM */
+	uint8_t Type;
+	/** Counts up per sample, wraps. */
+	uint8_t Sample;
+	uint8_t Flags;
+	/** Task entries following in the task records. */
+	uint8_t TaskCount;
+	uint32_t UptimeMs;
+	/** Time the CPU shares were measured over. */
+	uint32_t IntervalMs;
+	uint32_t FreeHeap;
+	uint32_t MinimumEverFreeHeap;
+	/** Commands waiting in the queue of the command processor. */
+	uint8_t CmdQueueDepth;
+	uint8_t CmdQueueLength;
+	/** Lines reserved or waiting for the writer task of XdkSerialMux. */
+	uint8_t SerialQueueDepth;
+	uint8_t SerialQueueLength;
+};
+typedef struct RuntimeStats_SystemRecord_S RuntimeStats_SystemRecord_T;
+
+struct RuntimeStats_TaskEntry_S
+{
+	uint8_t Number;
+	/** eTaskState */
+	uint8_t State;
+	uint8_t Priority;
+	/** Share of the CPU time since the previous sample, in permille. */
+	uint16_t CpuShare;
+	/** Stack never used since the task started, in words. */
+	uint16_t StackHighWaterMark;
+	/** Zero padded, not terminated if the name is long enough. */
+	char Name[RUNTIME_STATS_TASK_NAME_LENGTH];
+};
+typedef struct RuntimeStats_TaskEntry_S RuntimeStats_TaskEntry_T;
+
+struct RuntimeStats_TaskRecord_S
+{
+	/** RUNTIME_STATS_RECORD_TASKS */
+	uint8_t Type;
+	uint8_t Sample;
+	/** Index of the first entry within the sample. */
+	uint8_t FirstIndex;
+	/** Entries sent, only these are on the line. */
+	uint8_t Count;
+	RuntimeStats_TaskEntry_T Tasks[RUNTIME_STATS_TASKS_PER_RECORD];
+};
+typedef struct RuntimeStats_TaskRecord_S RuntimeStats_TaskRecord_T;
+#pragma pack(pop)
+
+/**
+ * @brief Initializes the XdkRuntimeStats module and starts publishing a
+ * sample every interval. Sampling runs on the command processor, whose
+ * queue depth is part of the sample.
+ *
+ * @param [in] cmdProcessor  Command processor to sample on.
+ * @param [in] interval      Interval of the samples in ticks, 0 for none.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T RuntimeStats_Initialize(const CmdProcessor_T* cmdProcessor,
+		TickType_t interval);
+
+/**
+ * @brief Takes a sample and publishes it on the stats channel. Must be
+ * called on the command processor.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T RuntimeStats_Publish(void);
+
+/**
+ * @brief Answers a "STATS" command of the host: publishes a sample right
+ * away and replies "STATS <sample>" on the response channel.
+ *
+ * @param [in] args        Unused.
+ * @param [in] receivedAt  Unused.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T RuntimeStats_HandleStatsCommand(const char* args,
+		uint32_t receivedAt);
+
+#endif /* XDKRUNTIMESTATS_H_ */
@@ -0,0 +1,131 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKSAMPLESCHEDULER_H_
+#define XDKSAMPLESCHEDULER_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#include "FreeRTOS.h"
+
+/**
+ * @brief Number of buckets of the jitter and execution time histograms.
+ * Bucket i counts values below SAMPLE_SCHEDULER_BUCKET_LIMITS_US[i], the
+ * last one everything above.
+ */
+#define SAMPLE_SCHEDULER_BUCKET_COUNT	(UINT32_C(8))
+
+/**
+ * @brief Upper bucket limits in microseconds, for host side decoding.
+ */
+#define SAMPLE_SCHEDULER_BUCKET_LIMITS_US	\
+	{ 50, 100, 200, 500, 1000, 2000, 5000, UINT32_MAX }
+
+/**
+ * @brief What to do with the periods that passed while a period overran.
+ */
+enum SampleScheduler_CatchUp_E
+{
+	/** Drop the missed periods and continue with the next one due. */
+	SAMPLE_SCHEDULER_CATCH_UP_SKIP,
+	/** Run the missed periods back to back, up to a limit, then skip. */
+	SAMPLE_SCHEDULER_CATCH_UP_BURST,
+
+	SAMPLE_SCHEDULER_CATCH_UP_MAX
+};
+typedef enum SampleScheduler_CatchUp_E SampleScheduler_CatchUp_T;
+
+struct SampleScheduler_Stats_S
+{
+	/** Periods run, including burst periods. */
+	uint32_t Periods;
+	/** Periods that ended with an error. */
+	uint32_t Failures;
+	/** Periods that ended after the next one was due. */
+	uint32_t Overruns;
+	/** Periods dropped by the catch-up policy. */
+	uint32_t Skipped;
+	/** Periods run back to back to catch up. */
+	uint32_t Bursts;
+	/** Wake-up time behind the start of the period. */
+	uint32_t JitterHistogram[SAMPLE_SCHEDULER_BUCKET_COUNT];
+	uint32_t MaxJitterUs;
+	/** Time from wake-up to the end of the period. */
+	uint32_t ExecutionHistogram[SAMPLE_SCHEDULER_BUCKET_COUNT];
+	uint32_t MaxExecutionUs;
+};
+typedef struct SampleScheduler_Stats_S SampleScheduler_Stats_T;
+
+/**
+ * @brief Initializes the XdkSampleScheduler module. Also starts publishing
+ * the stats every statsInterval on the stats channel of XdkSerialMux as three
+ * lines, since the histograms would not fit a single one:
+ * "SCHED periods failures overruns skipped bursts",
+ * "SCHED_JITTER max-jitter jitter-histogram..." and
+ * "SCHED_EXEC max-execution execution-histogram...".
+ *
+ * @param [in] period         Sampling period in ticks.
+ * @param [in] catchUp        Catch-up policy after overruns.
+ * @param [in] statsInterval  Interval of the stats lines in ticks, 0 for none.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T SampleScheduler_Initialize(TickType_t period,
+		SampleScheduler_CatchUp_T catchUp, TickType_t statsInterval);
+
+/**
+ * @brief Starts the first period now, e.g. when sampling (re)starts after a
+ * pause. The pause does not count as overrun.
+ */
+void SampleScheduler_Start(void);
+
+/**
+ * @brief Changes the sampling period, effective with the next
+ * SampleScheduler_Start. Must be called by the sampling task.
+ *
+ * @param [in] period  Sampling period in ticks.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T SampleScheduler_SetPeriod(TickType_t period);
+
+/**
+ * @brief Ends the current period and blocks until the next one is due.
+ * Must be called once per period, also if the period failed, so errors do
+ * not shift the schedule.
+ *
+ * @param [in] rc  Outcome of the period, failures are counted.
+ */
+void SampleScheduler_WaitForNextPeriod(Retcode_T rc);
+
+/**
+ * @brief Copies the stats collected since startup.
+ */
+void SampleScheduler_GetStats(SampleScheduler_Stats_T* stats);
+
+/**
+ * @brief Publishes the stats on the stats channel right away.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T SampleScheduler_PublishStats(void);
+
+#endif /* XDKSAMPLESCHEDULER_H_ */
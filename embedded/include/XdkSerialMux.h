@@ -0,0 +1,122 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKSERIALMUX_H_
+#define XDKSERIALMUX_H_
+
+#include <stdarg.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+/**
+ * @brief Maximum payload of a queued line, tag and line feed excluded.
+ */
+#define SERIAL_MUX_LINE_SIZE	(UINT32_C(128))
+
+/**
+ * @brief Line slots shared by all queued channels.
+ */
+#define SERIAL_MUX_SLOT_COUNT	(UINT32_C(8))
+
+/**
+ * @brief Logical channels sharing the serial link. Every line on the wire
+ * starts with the tag of its channel, see SerialMux_Write.
+ */
+enum SerialMux_Channel_E
+{
+	SERIAL_MUX_CHANNEL_TRACKING,
+	SERIAL_MUX_CHANNEL_LOG,
+	SERIAL_MUX_CHANNEL_STATS,
+	SERIAL_MUX_CHANNEL_RESPONSE,
+
+	SERIAL_MUX_CHANNEL_MAX
+};
+typedef enum SerialMux_Channel_E SerialMux_Channel_T;
+
+/**
+ * @brief A line slot handed out by SerialMux_Reserve.
+ */
+struct SerialMux_Line_S
+{
+	SerialMux_Channel_T Channel;
+	uint32_t Length;
+	char Text[SERIAL_MUX_LINE_SIZE];
+};
+typedef struct SerialMux_Line_S SerialMux_Line_T;
+
+/**
+ * @brief Initializes the XdkSerialMux module and starts its writer task.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T SerialMux_Initialize(void);
+
+/**
+ * @brief Writes a line to the given channel.
+ *
+ * Tracking lines are complete lines including their own ">>QUAT:" or
+ * ">>CALI:" tag and are written synchronously by the caller. They only ever
+ * wait for the line currently on the wire. All other channels are queued
+ * for the low priority writer task, which prefixes ">>LOG: ", ">>STAT: " or
+ * ">>RESP: " and appends the line feed. Log lines are dropped when the queue
+ * runs low, stats lines when it is full and responses wait briefly for a
+ * free slot.
+ *
+ * @param [in] channel  Channel to write to.
+ * @param [in] text     Line content, not necessarily zero terminated.
+ * @param [in] length   Number of characters in text. Queued lines are
+ *                      truncated to SERIAL_MUX_LINE_SIZE.
+ *
+ * @return RETCODE_OK, or RETCODE_OUT_OF_RESOURCES if the line was dropped.
+ */
+Retcode_T SerialMux_Write(SerialMux_Channel_T channel, const char* text,
+		uint32_t length);
+
+/**
+ * @brief printf style variant of SerialMux_Write for queued channels.
+ */
+Retcode_T SerialMux_Printf(SerialMux_Channel_T channel, const char* fmt, ...);
+
+/**
+ * @brief Reserves a free line slot for a queued channel, allowing the caller
+ * to format directly into it. Must be followed by SerialMux_Commit.
+ *
+ * @return The slot, or NULL if the line has to be dropped.
+ */
+SerialMux_Line_T* SerialMux_Reserve(SerialMux_Channel_T channel);
+
+/**
+ * @brief Hands a slot filled by the caller over to the writer task.
+ */
+void SerialMux_Commit(SerialMux_Line_T* line);
+
+/**
+ * @brief Number of lines dropped on the given channel since startup.
+ */
+uint32_t SerialMux_GetDroppedCount(SerialMux_Channel_T channel);
+
+/**
+ * @brief Number of line slots currently reserved or waiting for the writer
+ * task, out of SERIAL_MUX_SLOT_COUNT.
+ */
+uint32_t SerialMux_GetQueueDepth(void);
+
+#endif /* XDKSERIALMUX_H_ */
@@ -0,0 +1,88 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKTEXTFORMAT_H_
+#define XDKTEXTFORMAT_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+/**
+ * @brief Worst case length of a single formatted float, sign and the 39
+ * integer digits of FLT_MAX included.
+ */
+#define TEXT_FORMAT_FLOAT_MAX_LENGTH	(UINT32_C(47))
+
+/**
+ * @brief Buffer size sufficient for any line produced by
+ * TextFormat_FormatQuaternion with a tag of up to 15 characters.
+ */
+#define TEXT_FORMAT_LINE_BUFFER_SIZE	(UINT32_C(208))
+
+/**
+ * @brief Set to 1 to build TextFormat_RunBenchmark.
+ */
+#ifndef TEXT_FORMAT_ENABLE_BENCHMARK
+#define TEXT_FORMAT_ENABLE_BENCHMARK	(0)
+#endif
+
+/**
+ * @brief Formats a float exactly like printf("%f") does, i.e. six decimals
+ * rounded half to even, but without going through the libc float formatter.
+ *
+ * @param [out] buffer   Receives at least TEXT_FORMAT_FLOAT_MAX_LENGTH chars.
+ *                       No terminating zero is written.
+ * @param [in] value     The value to format.
+ *
+ * @return Number of characters written.
+ */
+uint32_t TextFormat_FormatFloat(char* buffer, float value);
+
+/**
+ * @brief Formats an unsigned integer in decimal.
+ *
+ * @param [out] buffer   Receives at least 10 chars. No terminating zero is
+ *                       written.
+ *
+ * @return Number of characters written.
+ */
+uint32_t TextFormat_FormatUnsigned(char* buffer, uint32_t value);
+
+/**
+ * @brief Formats a "<tag> w x y z\n" line, zero terminated.
+ *
+ * @param [out] buffer   Receives at least TEXT_FORMAT_LINE_BUFFER_SIZE chars.
+ * @param [in] tag       Line tag such as ">>QUAT:".
+ *
+ * @return Number of characters written, excluding the terminating zero.
+ */
+uint32_t TextFormat_FormatQuaternion(char* buffer, const char* tag, float w,
+		float x, float y, float z);
+
+#if TEXT_FORMAT_ENABLE_BENCHMARK
+/**
+ * @brief Compares TextFormat_FormatQuaternion against snprintf on the target
+ * and logs cycles per line and stack high water marks of both paths. Blocks
+ * the caller until done.
+ */
+Retcode_T TextFormat_RunBenchmark(void);
+#endif
+
+#endif /* XDKTEXTFORMAT_H_ */
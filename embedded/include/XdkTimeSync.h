@@ -0,0 +1,48 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKTIMESYNC_H_
+#define XDKTIMESYNC_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+/**
+ * @brief Returns the device time in microseconds since startup, derived
+ * from the FreeRTOS tick count and the SysTick counter. Wraps after about
+ * 71 minutes. May be called from interrupts.
+ */
+uint32_t TimeSync_GetDeviceTime(void);
+
+/**
+ * @brief Answers a "SYNC <host-time>" command of the host with
+ * "SYNC <host-time> <receive-time> <transmit-time>" on the response channel,
+ * both device times as returned by TimeSync_GetDeviceTime. From these and
+ * its own receive time the host estimates offset and drift of the device
+ * clock, NTP style.
+ *
+ * @param [in] args        The host time, echoed back unchanged.
+ * @param [in] receivedAt  Device time the command line was received at.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T TimeSync_HandleSyncCommand(const char* args, uint32_t receivedAt);
+
+#endif /* XDKTIMESYNC_H_ */
@@ -0,0 +1,50 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef XDKUSBUI_H_
+#define XDKUSBUI_H_
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_CmdProcessor.h"
+
+/**
+ * @brief Maximum length of a command line received from the host.
+ */
+#define USB_UI_COMMAND_LINE_SIZE	(UINT32_C(64))
+
+/**
+ * @brief Starts receiving ">>CMD: <name> <args>" lines from the host over
+ * the USB serial link. Commands are executed on the given command processor,
+ * one at a time, and answer on the response channel of XdkSerialMux.
+ *
+ * @param [in] cmdProcessor  Command processor to execute commands on.
+ *
+ * @return A Retcode_T noting the success of the action.
+ */
+Retcode_T UsbUi_Initialize(const CmdProcessor_T* cmdProcessor);
+
+/**
+ * @brief Number of command lines dropped because they were too long or
+ * arrived while the previous command was still executing.
+ */
+uint32_t UsbUi_GetDroppedCount(void);
+
+#endif /* XDKUSBUI_H_ */
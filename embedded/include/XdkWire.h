@@ -0,0 +1,99 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/* Generated by schema/wiregen.py from schema/XdkWire.json, do not edit. */
+#ifndef XDKWIRE_H_
+#define XDKWIRE_H_
+
+#include "BCDS_Basics.h"
+
+#include <stddef.h>
+
+#define XDK_WIRE_SCHEMA_VERSION	(UINT32_C(1))
+
+/* Fails to compile with a negative array size if condition is false. */
+#define XDK_WIRE_STATIC_ASSERT(name, condition) \
+	typedef char XdkWire_Assert_##name[(condition) ? 1 : -1]
+
+/* Rotation sample on the serial tracking channel. Fields: w x y z sequence time. */
+#define XDK_WIRE_ROTATION_LINE_TAG	">>QUAT:"
+/* Calibration sample on the serial tracking channel. Fields: w x y z sequence time. */
+#define XDK_WIRE_CALIBRATION_LINE_TAG	">>CALI:"
+
+/*
+ * BLE notification with the rotation as floats.
+ */
+#define BLE_UI_TRACKING_DATA_VERSION	(UINT8_C(2))
+#define BLE_UI_TRACKING_DATA_SIZE	(UINT32_C(19))
+#define BLE_UI_TRACKING_DATA_LAYOUT_HASH	(UINT32_C(0x442D63E4))
+
+#pragma pack(push, 1)
+struct BleUi_TrackingData_S
+{
+	float W;
+	float X;
+	float Y;
+	float Z;
+	bool UseForCalibration;
+	uint16_t Sequence;
+};
+#pragma pack(pop)
+typedef struct BleUi_TrackingData_S BleUi_TrackingData_T;
+
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_Size, sizeof(BleUi_TrackingData_T) == BLE_UI_TRACKING_DATA_SIZE);
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_W, offsetof(BleUi_TrackingData_T, W) == 0);
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_X, offsetof(BleUi_TrackingData_T, X) == 4);
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_Y, offsetof(BleUi_TrackingData_T, Y) == 8);
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_Z, offsetof(BleUi_TrackingData_T, Z) == 12);
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_UseForCalibration, offsetof(BleUi_TrackingData_T, UseForCalibration) == 16);
+XDK_WIRE_STATIC_ASSERT(BleUi_TrackingData_Sequence, offsetof(BleUi_TrackingData_T, Sequence) == 17);
+
+/*
+ * BLE notification with the current and previous sample packed with QuatPack,
+ * the flags hold the dropped components. Lets the host restore a single lost
+ * notification.
+ */
+#define BLE_UI_COMPACT_TRACKING_DATA_VERSION	(UINT8_C(3))
+#define BLE_UI_COMPACT_TRACKING_DATA_SIZE	(UINT32_C(15))
+#define BLE_UI_COMPACT_TRACKING_DATA_LAYOUT_HASH	(UINT32_C(0xEFB4F709))
+#define BLE_UI_COMPACT_FLAG_CALIBRATION	(UINT8_C(1))
+#define BLE_UI_COMPACT_FLAG_PREVIOUS_VALID	(UINT8_C(2))
+#define BLE_UI_COMPACT_CURRENT_COMPONENT_SHIFT	(UINT8_C(2))
+#define BLE_UI_COMPACT_PREVIOUS_COMPONENT_SHIFT	(UINT8_C(4))
+#define BLE_UI_COMPACT_COMPONENT_MASK	(UINT8_C(3))
+
+#pragma pack(push, 1)
+struct BleUi_CompactTrackingData_S
+{
+	uint8_t Flags;
+	uint16_t Sequence;
+	int16_t Current[3];
+	int16_t Previous[3];
+};
+#pragma pack(pop)
+typedef struct BleUi_CompactTrackingData_S BleUi_CompactTrackingData_T;
+
+XDK_WIRE_STATIC_ASSERT(BleUi_CompactTrackingData_Size, sizeof(BleUi_CompactTrackingData_T) == BLE_UI_COMPACT_TRACKING_DATA_SIZE);
+XDK_WIRE_STATIC_ASSERT(BleUi_CompactTrackingData_Flags, offsetof(BleUi_CompactTrackingData_T, Flags) == 0);
+XDK_WIRE_STATIC_ASSERT(BleUi_CompactTrackingData_Sequence, offsetof(BleUi_CompactTrackingData_T, Sequence) == 1);
+XDK_WIRE_STATIC_ASSERT(BleUi_CompactTrackingData_Current, offsetof(BleUi_CompactTrackingData_T, Current) == 3);
+XDK_WIRE_STATIC_ASSERT(BleUi_CompactTrackingData_Previous, offsetof(BleUi_CompactTrackingData_T, Previous) == 9);
+
+#endif /* XDKWIRE_H_ */
@@ -0,0 +1,248 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_BLECONNPARAMS
+
+#include "XdkBleConnParams.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_CmdProcessor.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+#include "XdkSerialMux.h"
+#include "XdkTextFormat.h"
+
+/* Time the central gets to answer and switch to the new parameters before
+ * they are read back. */
+#ifndef BLE_CONN_PARAMS_SETTLE_MS
+#define BLE_CONN_PARAMS_SETTLE_MS	(UINT32_C(2000))
+#endif
+
+static void HandleSettleTimer(TimerHandle_t timer);
+static void RunConnection(void* param1, uint32_t param2);
+static void RunSamplePeriod(void* param1, uint32_t param2);
+static void RunReadBack(void* param1, uint32_t param2);
+static void RequestIfChanged(void);
+static Retcode_T EnqueueToProcessor(CmdProcessor_Func_T func,
+		uint32_t param2);
+
+static const CmdProcessor_T* CmdProcessor = NULL;
+static const BleConnParams_Port_T* Port = NULL;
+static TimerHandle_t SettleTimer = NULL;
+#if APP_USE_STATIC_ALLOCATION
+static StaticTimer_t SettleTimerBuffer;
+#endif
+
+/* Only touched on the command processor. */
+static BleConnPolicy_T Policy;
+/* A timer that fired before it was restarted for the next request may
+ * still have its read-back queued, this tells it is early. */
+static TickType_t RequestedAt = 0;
+static BleConnParams_Stats_T Stats;
+
+static void HandleSettleTimer(TimerHandle_t timer)
+{
+	BCDS_UNUSED(timer);
+	if (RETCODE_OK != EnqueueToProcessor(RunReadBack, 0))
+	{
+		/* The command processor is busy, settling must end eventually. */
+		(void) xTimerStart(SettleTimer, 0);
+	}
+}
+
+static Retcode_T EnqueueToProcessor(CmdProcessor_Func_T func,
+		uint32_t param2)
+{
+	if (NULL == CmdProcessor)
+	{
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_UNINITIALIZED);
+	}
+	return CmdProcessor_Enqueue((CmdProcessor_T*) CmdProcessor, func, NULL,
+			param2);
+}
+
+static void RunConnection(void* param1, uint32_t param2)
+{
+	BCDS_UNUSED(param1);
+	BleConnPolicy_SetConnected(&Policy, 0 != param2);
+	RequestIfChanged();
+}
+
+static void RunSamplePeriod(void* param1, uint32_t param2)
+{
+	BCDS_UNUSED(param1);
+	BleConnPolicy_SetSamplePeriod(&Policy, param2);
+	RequestIfChanged();
+}
+
+static void RunReadBack(void* param1, uint32_t param2)
+{
+	BCDS_UNUSED(param1);
+	BCDS_UNUSED(param2);
+
+	if (pdMS_TO_TICKS(BLE_CONN_PARAMS_SETTLE_MS)
+			> xTaskGetTickCount() - RequestedAt
+			|| !BleConnPolicy_EndSettling(&Policy))
+	{
+		return;
+	}
+
+	BleConnParams_T negotiated;
+	if (RETCODE_OK == Port->Read(&negotiated))
+	{
+		Stats.Negotiated = negotiated;
+		if (BleConnPolicy_IsAccepted(&Policy.Requested, &negotiated))
+		{
+			Stats.Accepted++;
+		}
+		else
+		{
+			/* Not repeated before the next change, the central would most
+			 * likely reject it again. */
+			Stats.Rejected++;
+		}
+	}
+	else
+	{
+		Stats.Failed++;
+	}
+	(void) BleConnParams_PublishStats();
+
+	/* The period may have changed while the request settled. */
+	RequestIfChanged();
+}
+
+static void RequestIfChanged(void)
+{
+	BleConnParams_T params;
+
+	if (!BleConnPolicy_NextRequest(&Policy, &params))
+	{
+		return;
+	}
+
+	Stats.Requested = params;
+	Stats.Requests++;
+	RequestedAt = xTaskGetTickCount();
+	if (RETCODE_OK != Port->Request(&params)
+			|| pdPASS != xTimerStart(SettleTimer, 0))
+	{
+		BleConnPolicy_AbortRequest(&Policy);
+		Stats.Failed++;
+		(void) BleConnParams_PublishStats();
+	}
+}
+
+Retcode_T BleConnParams_Initialize(const CmdProcessor_T* cmdProcessor,
+		const BleConnParams_Port_T* port)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (NULL == cmdProcessor || NULL == port || NULL == port->Request
+			|| NULL == port->Read)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
+	}
+
+	if (RETCODE_OK == rc && NULL == SettleTimer)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		SettleTimer = xTimerCreateStatic("BLE_CONN_PARAMS",
+				pdMS_TO_TICKS(BLE_CONN_PARAMS_SETTLE_MS), pdFALSE, NULL,
+				HandleSettleTimer, &SettleTimerBuffer);
+#else
+		SettleTimer = xTimerCreate("BLE_CONN_PARAMS",
+				pdMS_TO_TICKS(BLE_CONN_PARAMS_SETTLE_MS), pdFALSE, NULL,
+				HandleSettleTimer);
+#endif
+		if (NULL == SettleTimer)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		CmdProcessor = cmdProcessor;
+		Port = port;
+		BleConnPolicy_Initialize(&Policy);
+		memset(&Stats, 0, sizeof(Stats));
+	}
+
+	return rc;
+}
+
+Retcode_T BleConnParams_NotifyConnection(bool isConnected)
+{
+	return EnqueueToProcessor(RunConnection, isConnected);
+}
+
+Retcode_T BleConnParams_NotifySamplePeriod(uint32_t periodMs)
+{
+	return EnqueueToProcessor(RunSamplePeriod, periodMs);
+}
+
+void BleConnParams_GetStats(BleConnParams_Stats_T* stats)
+{
+	assert(NULL != stats);
+	*stats = Stats;
+}
+
+Retcode_T BleConnParams_PublishStats(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	SerialMux_Line_T* line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		const uint32_t values[] =
+		{ Stats.Negotiated.MaxInterval * BLE_CONN_PARAMS_INTERVAL_UNIT_US,
+				Stats.Negotiated.SlaveLatency,
+				Stats.Negotiated.SupervisionTimeout
+						* BLE_CONN_PARAMS_TIMEOUT_UNIT_MS,
+				Stats.Requested.MinInterval * BLE_CONN_PARAMS_INTERVAL_UNIT_US,
+				Stats.Requested.MaxInterval * BLE_CONN_PARAMS_INTERVAL_UNIT_US,
+				Stats.Requests, Stats.Accepted, Stats.Rejected, Stats.Failed };
+		char* text = line->Text;
+		memcpy(text, "BLECP", 5);
+		text += 5;
+		for (uint32_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+		{
+			*text++ = ' ';
+			text += TextFormat_FormatUnsigned(text, values[i]);
+		}
+		line->Length = (uint32_t) (text - line->Text);
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
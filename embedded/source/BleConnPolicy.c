@@ -0,0 +1,120 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_BLECONNPOLICY
+
+#include "XdkBleConnPolicy.h"
+
+#include <string.h>
+
+/* Shortest interval the Core Specification allows, 7.5 ms. */
+#ifndef BLE_CONN_PARAMS_MIN_INTERVAL
+#define BLE_CONN_PARAMS_MIN_INTERVAL	(UINT16_C(6))
+#endif
+
+/* Longest interval requested at low sample rates, 50 ms. */
+#ifndef BLE_CONN_PARAMS_MAX_INTERVAL
+#define BLE_CONN_PARAMS_MAX_INTERVAL	(UINT16_C(40))
+#endif
+
+#ifndef BLE_CONN_PARAMS_SUPERVISION_TIMEOUT_MS
+#define BLE_CONN_PARAMS_SUPERVISION_TIMEOUT_MS	(UINT32_C(1000))
+#endif
+
+void BleConnPolicy_Compute(uint32_t samplePeriodMs, BleConnParams_T* params)
+{
+	uint32_t maxInterval = samplePeriodMs * UINT32_C(1000)
+			/ (2 * BLE_CONN_PARAMS_INTERVAL_UNIT_US);
+	if (BLE_CONN_PARAMS_MIN_INTERVAL > maxInterval)
+	{
+		maxInterval = BLE_CONN_PARAMS_MIN_INTERVAL;
+	}
+	else if (BLE_CONN_PARAMS_MAX_INTERVAL < maxInterval)
+	{
+		maxInterval = BLE_CONN_PARAMS_MAX_INTERVAL;
+	}
+
+	params->MinInterval = BLE_CONN_PARAMS_MIN_INTERVAL;
+	params->MaxInterval = (uint16_t) maxInterval;
+	params->SlaveLatency = 0;
+	params->SupervisionTimeout = (uint16_t) (BLE_CONN_PARAMS_SUPERVISION_TIMEOUT_MS
+			/ BLE_CONN_PARAMS_TIMEOUT_UNIT_MS);
+}
+
+void BleConnPolicy_Initialize(BleConnPolicy_T* policy)
+{
+	memset(policy, 0, sizeof(*policy));
+}
+
+void BleConnPolicy_SetConnected(BleConnPolicy_T* policy, bool isConnected)
+{
+	policy->IsConnected = isConnected;
+	policy->IsRequested = false;
+	policy->IsSettling = false;
+}
+
+void BleConnPolicy_SetSamplePeriod(BleConnPolicy_T* policy,
+		uint32_t periodMs)
+{
+	policy->SamplePeriodMs = periodMs;
+}
+
+bool BleConnPolicy_NextRequest(BleConnPolicy_T* policy,
+		BleConnParams_T* params)
+{
+	if (!policy->IsConnected || policy->IsSettling)
+	{
+		return false;
+	}
+
+	BleConnPolicy_Compute(policy->SamplePeriodMs, params);
+	if (policy->IsRequested
+			&& 0 == memcmp(params, &policy->Requested, sizeof(*params)))
+	{
+		return false;
+	}
+
+	policy->IsRequested = true;
+	policy->IsSettling = true;
+	policy->Requested = *params;
+	return true;
+}
+
+void BleConnPolicy_AbortRequest(BleConnPolicy_T* policy)
+{
+	policy->IsSettling = false;
+}
+
+bool BleConnPolicy_EndSettling(BleConnPolicy_T* policy)
+{
+	bool isDue = policy->IsConnected && policy->IsSettling;
+	policy->IsSettling = false;
+	return isDue;
+}
+
+bool BleConnPolicy_IsAccepted(const BleConnParams_T* requested,
+		const BleConnParams_T* negotiated)
+{
+	return negotiated->MaxInterval >= requested->MinInterval
+			&& negotiated->MaxInterval <= requested->MaxInterval
+			&& negotiated->SlaveLatency <= requested->SlaveLatency;
+}
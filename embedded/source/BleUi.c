@@ -24,7 +24,9 @@
 
 #include "XdkBleUi.h"
 
+#include "XdkBleConnParams.h"
 #include "XdkHeadTrack.h"
+#include "XdkLinkHealth.h"
 #include "XdkLogger.h"
 
 #include "BCDS_Basics.h"
@@ -33,8 +35,11 @@
 #include "BCDS_Ble.h"
 #include "BCDS_BlePeripheral.h"
 #include "BCDS_BidirectionalService.h"
+#include "BleGap.h"
 #include "BCDS_CmdProcessor.h"
 
+#include <string.h>
+
 #include "FreeRTOS.h"
 #include "semphr.h"
 
@@ -42,6 +47,8 @@
 #define BLE_UI_STARTUP_TIMEOUT	(pdMS_TO_TICKS(2000))
 #define BLE_UI_WAKEUP_TIMEOUT	(pdMS_TO_TICKS(1000))
 #define BLE_UI_SEND_TIMEOUT		(pdMS_TO_TICKS(500))
+#define BLE_UI_MAX_PAYLOAD_SIZE	(UINT32_C(20))
+#define BLE_UI_SIGNAL_COUNT		(UINT32_C(4))
 
 static const CmdProcessor_T* CmdProcessor;
 
@@ -50,26 +57,48 @@ static SemaphoreHandle_t PowerModeChangedSignal;
 static SemaphoreHandle_t SleepStateChangedSignal;
 static SemaphoreHandle_t ConnectionStateChangedSignal;
 
+#if APP_USE_STATIC_ALLOCATION
+/* One per signal above. */
+static StaticSemaphore_t SignalBuffers[BLE_UI_SIGNAL_COUNT];
+#endif
+
 static bool IsBleStarted;
 static bool IsBleAwake;
 static bool IsBleConnected;
 
+/* Notifications are sent from here so the caller need not wait for them. */
+static uint8_t PendingPayload[BLE_UI_MAX_PAYLOAD_SIZE];
+
 static Retcode_T SetupBle(void);
 static void HandleBlePeripheralEvent(BlePeripheral_Event_T event, void* data);
 static Retcode_T HandleServiceRegistryCallback(void);
 static void HandleBleSentCallback(Retcode_T sendStatus);
-static inline Retcode_T CreateSignal(SemaphoreHandle_t* signal);
+static inline Retcode_T CreateSignal(SemaphoreHandle_t* signal,
+		uint32_t index);
 static void HandleBleDataReceivedCallback(uint8_t* rxBuffer,
 		uint8_t rxDataLength);
 static inline Retcode_T WaitForSignal(SemaphoreHandle_t signal,
 		TickType_t timeout);
+static Retcode_T SendPayload(const void* payload, uint8_t size,
+		TickType_t timeout);
+static Retcode_T RequestConnectionParameters(const BleConnParams_T* params);
+static Retcode_T ReadConnectionParameters(BleConnParams_T* params);
+
+static const BleConnParams_Port_T ConnParamsPort =
+{ RequestConnectionParameters, ReadConnectionParameters };
 
-static inline Retcode_T CreateSignal(SemaphoreHandle_t* signal)
+static inline Retcode_T CreateSignal(SemaphoreHandle_t* signal,
+		uint32_t index)
 {
 	assert(NULL != signal);
 	if (NULL == *signal)
 	{
+#if APP_USE_STATIC_ALLOCATION
+		*signal = xSemaphoreCreateBinaryStatic(&SignalBuffers[index]);
+#else
+		BCDS_UNUSED(index);
 		*signal = xSemaphoreCreateBinary();
+#endif
 		if (NULL == *signal)
 		{
 			return RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
@@ -117,14 +146,18 @@ static void HandleBlePeripheralEvent(BlePeripheral_Event_T event, void* data)
 	case BLE_PERIPHERAL_CONNECTED:
 		LOG_DEBUG("BLE connected");
 		IsBleConnected = true;
+		/* A notification pending from an earlier connection never completes. */
+		(void) xSemaphoreGive(DataSentSignal);
 		(void) xSemaphoreGive(ConnectionStateChangedSignal);
-		HeadTrack_ChangeCommunicationMode(HEAD_TRACK_COMMUNICATION_MODE_BLE);
+		HeadTrack_NotifyBleConnectionChanged(true);
+		(void) BleConnParams_NotifyConnection(true);
 		break;
 	case BLE_PERIPHERAL_DISCONNECTED:
 		LOG_DEBUG("BLE disconnected");
 		IsBleConnected = false;
 		(void) xSemaphoreGive(ConnectionStateChangedSignal);
-		HeadTrack_ChangeCommunicationMode(HEAD_TRACK_COMMUNICATION_MODE_SERIAL);
+		HeadTrack_NotifyBleConnectionChanged(false);
+		(void) BleConnParams_NotifyConnection(false);
 		break;
 	case BLE_PERIPHERAL_ERROR:
 		LOG_ERROR("BLE Error");
@@ -142,10 +175,8 @@ static void HandleBlePeripheralEvent(BlePeripheral_Event_T event, void* data)
 static void HandleBleSentCallback(Retcode_T sendStatus)
 {
 	assert(NULL != DataSentSignal);
-	if (RETCODE_OK != sendStatus)
-	{
-		Retcode_RaiseError(sendStatus);
-	}
+	/* Raised by LinkHealth, once for a series of failed notifications. */
+	LinkHealth_RecordCompletion(LINK_HEALTH_TRANSPORT_BLE, sendStatus);
 	(void) xSemaphoreGive(DataSentSignal);
 }
 
@@ -156,6 +187,34 @@ static void HandleBleDataReceivedCallback(uint8_t* rxBuffer,
 	BCDS_UNUSED(rxDataLength);
 }
 
+/* BlePeripheral covers neither, both go to the Alpwise GAP below it. As
+ * peripheral the stack sends an L2CAP connection parameter update request
+ * and the central decides, BLEGAP_EVENT_CONNECTIONUPDATED only reaches
+ * BlePeripheral. Hence XdkBleConnParams reads the result back. */
+static Retcode_T RequestConnectionParameters(const BleConnParams_T* params)
+{
+	BleStatus status = BLEGAP_UpdateConnectionParameters(params->MinInterval,
+			params->MaxInterval, params->SlaveLatency,
+			params->SupervisionTimeout);
+	return (BLESTATUS_SUCCESS == status || BLESTATUS_PENDING == status) ?
+			RETCODE_OK : RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+}
+
+static Retcode_T ReadConnectionParameters(BleConnParams_T* params)
+{
+	BleGapConnectionParameters current;
+	BleStatus status = BLEGAP_GetConnectionParameters(&current);
+	if (BLESTATUS_SUCCESS != status)
+	{
+		return RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+	}
+	params->MinInterval = current.connectionInterval;
+	params->MaxInterval = current.connectionInterval;
+	params->SlaveLatency = current.slaveLatency;
+	params->SupervisionTimeout = current.supervisionTimeout;
+	return RETCODE_OK;
+}
+
 static Retcode_T HandleServiceRegistryCallback(void)
 {
 	Retcode_T rc = RETCODE_OK;
@@ -216,22 +275,33 @@ Retcode_T BleUi_Initialize(const CmdProcessor_T* cmdProcessor)
 
 	if (RETCODE_OK == rc)
 	{
-		rc = CreateSignal(&PowerModeChangedSignal);
+		rc = CreateSignal(&PowerModeChangedSignal, 0);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		rc = CreateSignal(&SleepStateChangedSignal, 1);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		rc = CreateSignal(&ConnectionStateChangedSignal, 2);
 	}
 
 	if (RETCODE_OK == rc)
 	{
-		rc = CreateSignal(&SleepStateChangedSignal);
+		rc = CreateSignal(&DataSentSignal, 3);
 	}
 
 	if (RETCODE_OK == rc)
 	{
-		rc = CreateSignal(&ConnectionStateChangedSignal);
+		/* No notification in flight yet. */
+		(void) xSemaphoreGive(DataSentSignal);
 	}
 
 	if (RETCODE_OK == rc)
 	{
-		rc = CreateSignal(&DataSentSignal);
+		rc = BleConnParams_Initialize(cmdProcessor, &ConnParamsPort);
 	}
 
 	if (RETCODE_OK == rc)
@@ -247,23 +317,65 @@ Retcode_T BleUi_Initialize(const CmdProcessor_T* cmdProcessor)
 	return rc;
 }
 
-Retcode_T BleUi_SendTrackingData(const BleUi_TrackingData_T* data)
+static Retcode_T SendPayload(const void* payload, uint8_t size,
+		TickType_t timeout)
 {
 	Retcode_T rc = RETCODE_OK;
 
-	if (IsBleConnected)
+	if (NULL == payload)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
+	}
+	else if (size > sizeof(PendingPayload))
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
+
+	if (RETCODE_OK == rc && IsBleConnected)
 	{
-		rc = BidirectionalService_SendData((uint8_t*) &data,
-				sizeof(BleUi_TrackingData_T));
+		rc = WaitForSignal(DataSentSignal, timeout);
 		if (RETCODE_OK == rc)
 		{
-			rc = WaitForSignal(DataSentSignal, BLE_UI_SEND_TIMEOUT);
+			memcpy(PendingPayload, payload, size);
+			rc = BidirectionalService_SendData(PendingPayload, size);
+			if (RETCODE_OK != rc)
+			{
+				(void) xSemaphoreGive(DataSentSignal);
+			}
 		}
 	}
 
 	return rc;
 }
 
+Retcode_T BleUi_SendTrackingData(const BleUi_TrackingData_T* data)
+{
+	return SendPayload(data, sizeof(BleUi_TrackingData_T), BLE_UI_SEND_TIMEOUT);
+}
+
+Retcode_T BleUi_TrySendTrackingData(const BleUi_TrackingData_T* data)
+{
+	return SendPayload(data, sizeof(BleUi_TrackingData_T), 0);
+}
+
+Retcode_T BleUi_SendCompactTrackingData(const BleUi_CompactTrackingData_T* data)
+{
+	return SendPayload(data, sizeof(BleUi_CompactTrackingData_T),
+			BLE_UI_SEND_TIMEOUT);
+}
+
+Retcode_T BleUi_TrySendCompactTrackingData(
+		const BleUi_CompactTrackingData_T* data)
+{
+	return SendPayload(data, sizeof(BleUi_CompactTrackingData_T), 0);
+}
+
+bool BleUi_IsSendPending(void)
+{
+	return IsBleConnected && NULL != DataSentSignal
+			&& 0 == uxSemaphoreGetCount(DataSentSignal);
+}
+
 Retcode_T BleUi_Deinitialize(void)
 {
 	Retcode_T rc = RETCODE_OK;
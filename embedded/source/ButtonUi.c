@@ -30,12 +30,15 @@
 #include "BCDS_BSP_Button.h"
 #include "BSP_BoardType.h"
 
+#include "XdkFlightRecorder.h"
 #include "XdkHeadTrack.h"
 
 static const CmdProcessor_T* CmdProcessor;
 
 static void HandleButton1Interrupt(uint32_t status);
 static void HandleButton1Event(void* param1, uint32_t status);
+static void HandleButton2Interrupt(uint32_t status);
+static void HandleButton2Event(void* param1, uint32_t status);
 
 static void HandleButton1Interrupt(uint32_t status)
 {
@@ -70,6 +73,44 @@ static void HandleButton1Event(void* param1, uint32_t status)
 	}
 }
 
+static void HandleButton2Interrupt(uint32_t status)
+{
+	Retcode_T rc = CmdProcessor_EnqueueFromIsr((CmdProcessor_T*) CmdProcessor,
+	HandleButton2Event, NULL, status);
+	if (RETCODE_OK != rc)
+	{
+		Retcode_RaiseErrorFromIsr(rc);
+	}
+}
+
+static void HandleButton2Event(void* param1, uint32_t status)
+{
+	BCDS_UNUSED(param1);
+
+	Retcode_T rc = RETCODE_OK;
+
+	switch (status)
+	{
+	case BSP_XDK_BUTTON_PRESS:
+		break;
+	case BSP_XDK_BUTTON_RELEASE:
+		rc = FlightRecorder_Trigger(FLIGHT_RECORDER_REASON_BUTTON);
+		/* Pressed again while the previous recording is written. */
+		if (RETCODE_INCONSITENT_STATE == Retcode_GetCode(rc))
+		{
+			rc = RETCODE_OK;
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (RETCODE_OK != rc)
+	{
+		Retcode_RaiseError(rc);
+	}
+}
+
 Retcode_T ButtonUi_Initialize(const CmdProcessor_T* cmdProcessor)
 {
 	Retcode_T rc = RETCODE_OK;
@@ -84,6 +125,12 @@ Retcode_T ButtonUi_Initialize(const CmdProcessor_T* cmdProcessor)
 				HandleButton1Interrupt);
 	}
 
+	if (RETCODE_OK == rc)
+	{
+		rc = BSP_Button_Enable((uint32_t) BSP_XDK_BUTTON_2,
+				HandleButton2Interrupt);
+	}
+
 	return rc;
 }
 
@@ -93,6 +140,11 @@ Retcode_T ButtonUi_Deinitialize(void)
 
 	rc = BSP_Button_Disable((uint32_t) BSP_XDK_BUTTON_1);
 
+	if (RETCODE_OK == rc)
+	{
+		rc = BSP_Button_Disable((uint32_t) BSP_XDK_BUTTON_2);
+	}
+
 	if (RETCODE_OK == rc)
 	{
 		rc = BSP_Button_Disconnect();
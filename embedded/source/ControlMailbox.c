@@ -0,0 +1,164 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_CONTROLMAILBOX
+
+#include "XdkControlMailbox.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#include "XdkSerialMux.h"
+#include "XdkTextFormat.h"
+#include "XdkTimeSync.h"
+
+/* All shared state is accessed with the atomic builtins, which compile to
+ * LDREX/STREX on the Cortex-M3. Posters store the argument before setting
+ * the bit with release order, the consumer clears all bits at once with
+ * acquire order, so it never sees a bit without its argument. */
+static uint32_t PendingOps = 0;
+static uint32_t Args[CONTROL_MAILBOX_OP_MAX];
+/* Device time of the oldest pending post, 0 while none is. */
+static uint32_t PendingSince = 0;
+
+static uint32_t PostedCount = 0;
+static uint32_t CoalescedCount = 0;
+static uint32_t TakenCount = 0;
+static uint32_t MaxLatencyUs = 0;
+
+Retcode_T ControlMailbox_Post(ControlMailbox_Op_T op, uint32_t arg)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (CONTROL_MAILBOX_OP_MAX <= op)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		uint32_t bit = CONTROL_MAILBOX_OP_BIT(op);
+		/* Never 0, that marks nothing pending. */
+		uint32_t now = TimeSync_GetDeviceTime() | UINT32_C(1);
+		uint32_t none = 0;
+
+		__atomic_store_n(&Args[op], arg, __ATOMIC_RELAXED);
+		(void) __atomic_compare_exchange_n(&PendingSince, &none, now, false,
+		__ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		uint32_t previous = __atomic_fetch_or(&PendingOps, bit,
+		__ATOMIC_RELEASE);
+
+		(void) __atomic_fetch_add(&PostedCount, 1, __ATOMIC_RELAXED);
+		if (0 != (previous & bit))
+		{
+			(void) __atomic_fetch_add(&CoalescedCount, 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	return rc;
+}
+
+uint32_t ControlMailbox_Take(uint32_t args[CONTROL_MAILBOX_OP_MAX])
+{
+	assert(NULL != args);
+
+	/* Ops first: posters set PendingSince before their bit, so a post
+	 * between both exchanges can only leave its bit without a time, never
+	 * a time without a bit that would age until the next post. The former
+	 * only understates the latency of that post. */
+	uint32_t ops = __atomic_exchange_n(&PendingOps, 0, __ATOMIC_ACQUIRE);
+	uint32_t since = __atomic_exchange_n(&PendingSince, 0, __ATOMIC_RELAXED);
+
+	if (0 == ops)
+	{
+		/* A post between both exchanges, its bit is not set yet. */
+		if (0 != since)
+		{
+			uint32_t none = 0;
+			(void) __atomic_compare_exchange_n(&PendingSince, &none, since,
+			false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		}
+	}
+	else
+	{
+		uint32_t taken = 0;
+		for (uint32_t op = 0; op < CONTROL_MAILBOX_OP_MAX; op++)
+		{
+			if (0 != (ops & CONTROL_MAILBOX_OP_BIT(op)))
+			{
+				args[op] = __atomic_load_n(&Args[op], __ATOMIC_RELAXED);
+				taken++;
+			}
+		}
+
+		uint32_t latencyUs = (0 != since) ?
+				(TimeSync_GetDeviceTime() | UINT32_C(1)) - since : 0;
+		__atomic_store_n(&TakenCount, TakenCount + taken, __ATOMIC_RELAXED);
+		if (latencyUs > MaxLatencyUs)
+		{
+			__atomic_store_n(&MaxLatencyUs, latencyUs, __ATOMIC_RELAXED);
+		}
+	}
+
+	return ops;
+}
+
+void ControlMailbox_GetStats(ControlMailbox_Stats_T* stats)
+{
+	assert(NULL != stats);
+	stats->Posted = __atomic_load_n(&PostedCount, __ATOMIC_RELAXED);
+	stats->Coalesced = __atomic_load_n(&CoalescedCount, __ATOMIC_RELAXED);
+	stats->Taken = __atomic_load_n(&TakenCount, __ATOMIC_RELAXED);
+	stats->MaxLatencyUs = __atomic_load_n(&MaxLatencyUs, __ATOMIC_RELAXED);
+}
+
+Retcode_T ControlMailbox_PublishStats(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	ControlMailbox_Stats_T stats;
+	SerialMux_Line_T* line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		ControlMailbox_GetStats(&stats);
+		char* text = line->Text;
+		memcpy(text, "CTRL ", 5);
+		text += 5;
+		text += TextFormat_FormatUnsigned(text, stats.Posted);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, stats.Coalesced);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, stats.Taken);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, stats.MaxLatencyUs);
+		line->Length = (uint32_t) (text - line->Text);
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
@@ -0,0 +1,406 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_FLIGHTRECORDER
+
+#include "XdkFlightRecorder.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_SDCard_Driver.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ff.h"
+
+#include "XdkLogger.h"
+#include "XdkSerialMux.h"
+
+#define FLIGHT_RECORDER_DRIVE					(UINT8_C(0))
+#define FLIGHT_RECORDER_LOGICAL_DRIVE			"0:"
+/* "0:RECnnnnn.BIN" */
+#define FLIGHT_RECORDER_FILE_PREFIX				FLIGHT_RECORDER_LOGICAL_DRIVE "REC"
+#define FLIGHT_RECORDER_FILE_SUFFIX				".BIN"
+#define FLIGHT_RECORDER_FILE_DIGITS				(UINT32_C(5))
+#define FLIGHT_RECORDER_MAX_FILES				(UINT32_C(100000))
+#define FLIGHT_RECORDER_FILE_NAME_SIZE			(UINT32_C(16))
+#define FLIGHT_RECORDER_CRC_INIT				(UINT16_C(0xFFFF))
+#define FLIGHT_RECORDER_CRC_POLYNOMIAL			(UINT16_C(0x1021))
+
+/* Below the poll task, writing to the card takes a while. */
+#define FLIGHT_RECORDER_WRITER_TASK_STACK_SIZE	(UINT32_C(512))
+#define FLIGHT_RECORDER_WRITER_TASK_PRIO		(UINT32_C(1))
+
+/* Held in State, the trigger reason above FLIGHT_RECORDER_REASON_SHIFT. */
+#define FLIGHT_RECORDER_STATE_RECORDING			(UINT32_C(0))
+#define FLIGHT_RECORDER_STATE_TRIGGERED			(UINT32_C(1))
+#define FLIGHT_RECORDER_STATE_WRITING			(UINT32_C(2))
+#define FLIGHT_RECORDER_STATE_MASK				(UINT32_C(0xFF))
+#define FLIGHT_RECORDER_REASON_SHIFT			(UINT32_C(8))
+
+static void RunWriterLoop(void* param1);
+static Retcode_T Mount(void);
+static Retcode_T OpenNextFile(char* fileName);
+static Retcode_T WriteRecording(char* fileName, uint32_t reason);
+static Retcode_T WriteBlock(void);
+static uint16_t Crc16(const uint8_t* data, uint32_t length);
+
+static FlightRecorder_Sample_T Ring[FLIGHT_RECORDER_SAMPLE_COUNT];
+static uint8_t Block[FLIGHT_RECORDER_BLOCK_SIZE];
+static FATFS FileSystem;
+static FIL File;
+static bool IsMounted = false;
+static uint32_t NextFileNumber = 0;
+static TaskHandle_t WriterTask = NULL;
+
+#if APP_USE_STATIC_ALLOCATION
+static StackType_t WriterTaskStack[FLIGHT_RECORDER_WRITER_TASK_STACK_SIZE];
+static StaticTask_t WriterTaskBuffer;
+#endif
+
+/* Owned by the sampling task until it sets WRITING, then by the writer
+ * task until that sets RECORDING again. */
+static uint32_t RingNext = 0;
+static uint32_t RingCount = 0;
+static uint32_t PostTriggerCount = 0;
+static uint32_t TriggerTime = 0;
+/* Samples dropped during the previous write, handed over once recording
+ * resumes. */
+static uint32_t MissedSamples = 0;
+
+/* Only touched by the sampling task. */
+static uint32_t DroppedSamples = 0;
+
+/* Accessed atomically. Only FlightRecorder_Trigger leaves RECORDING, only
+ * the sampling task leaves TRIGGERED and only the writer task WRITING. */
+static uint32_t State = FLIGHT_RECORDER_STATE_RECORDING;
+
+static uint16_t Crc16(const uint8_t* data, uint32_t length)
+{
+	uint16_t crc = FLIGHT_RECORDER_CRC_INIT;
+	for (uint32_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t) ((uint16_t) data[i] << 8);
+		for (uint32_t bit = 0; bit < 8; bit++)
+		{
+			crc = (0 != (crc & 0x8000)) ?
+					(uint16_t) ((crc << 1) ^ FLIGHT_RECORDER_CRC_POLYNOMIAL) :
+					(uint16_t) (crc << 1);
+		}
+	}
+	return crc;
+}
+
+static Retcode_T Mount(void)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (!IsMounted)
+	{
+		if (SDCARD_INSERTED != SDCardDriver_GetDetectStatus())
+		{
+			LOG_WARNING("No SD card for the flight recording");
+			rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_FAILURE);
+		}
+
+		if (RETCODE_OK == rc
+				&& 0 != (STA_NOINIT
+						& SDCardDriver_DiskInitialize(FLIGHT_RECORDER_DRIVE)))
+		{
+			rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+		}
+
+		if (RETCODE_OK == rc
+				&& FR_OK
+						!= f_mount(&FileSystem, FLIGHT_RECORDER_LOGICAL_DRIVE,
+								1))
+		{
+			rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+		}
+
+		IsMounted = (RETCODE_OK == rc);
+	}
+
+	return rc;
+}
+
+static Retcode_T OpenNextFile(char* fileName)
+{
+	Retcode_T rc = RETCODE_OK;
+	FRESULT result = FR_EXIST;
+	uint32_t prefixLength = sizeof(FLIGHT_RECORDER_FILE_PREFIX) - 1;
+
+	memcpy(fileName, FLIGHT_RECORDER_FILE_PREFIX, prefixLength);
+	memcpy(fileName + prefixLength + FLIGHT_RECORDER_FILE_DIGITS,
+			FLIGHT_RECORDER_FILE_SUFFIX, sizeof(FLIGHT_RECORDER_FILE_SUFFIX));
+
+	/* Numbers of earlier sessions are taken, the first free one is used. */
+	for (; FR_EXIST == result && NextFileNumber < FLIGHT_RECORDER_MAX_FILES;
+			NextFileNumber++)
+	{
+		uint32_t number = NextFileNumber;
+		for (uint32_t i = FLIGHT_RECORDER_FILE_DIGITS; i > 0; i--)
+		{
+			fileName[prefixLength + i - 1] = (char) ('0' + number % 10);
+			number /= 10;
+		}
+		result = f_open(&File, fileName, FA_CREATE_NEW | FA_WRITE);
+	}
+
+	if (FR_OK != result)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+	}
+
+	return rc;
+}
+
+static Retcode_T WriteBlock(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	UINT written = 0;
+
+	if (FR_OK != f_write(&File, Block, FLIGHT_RECORDER_BLOCK_SIZE, &written)
+			|| FLIGHT_RECORDER_BLOCK_SIZE != written)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+	}
+
+	return rc;
+}
+
+static Retcode_T WriteRecording(char* fileName, uint32_t reason)
+{
+	Retcode_T rc = Mount();
+	bool isOpen = false;
+
+	if (RETCODE_OK == rc)
+	{
+		rc = OpenNextFile(fileName);
+		isOpen = (RETCODE_OK == rc);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		FlightRecorder_FileHeader_T header;
+		memcpy(header.Magic, FLIGHT_RECORDER_FILE_MAGIC, sizeof(header.Magic));
+		header.Version = FLIGHT_RECORDER_FORMAT_VERSION;
+		header.Reason = (uint8_t) reason;
+		header.SampleSize = sizeof(FlightRecorder_Sample_T);
+		header.SamplesPerBlock = FLIGHT_RECORDER_SAMPLES_PER_BLOCK;
+		header.SampleCount = (uint16_t) RingCount;
+		header.TriggerTime = TriggerTime;
+		header.MissedSamples = MissedSamples;
+		MissedSamples = 0;
+
+		memset(Block, 0, sizeof(Block));
+		memcpy(Block, &header, sizeof(header));
+		rc = WriteBlock();
+	}
+
+	/* Oldest sample first. */
+	uint32_t oldest = (RingCount < FLIGHT_RECORDER_SAMPLE_COUNT) ? 0 : RingNext;
+	for (uint32_t written = 0, index = 0; RETCODE_OK == rc && written < RingCount;
+			index++)
+	{
+		FlightRecorder_BlockHeader_T blockHeader;
+		uint8_t* samples = Block + sizeof(blockHeader);
+		uint32_t count = RingCount - written;
+		if (count > FLIGHT_RECORDER_SAMPLES_PER_BLOCK)
+		{
+			count = FLIGHT_RECORDER_SAMPLES_PER_BLOCK;
+		}
+
+		memset(Block, 0, sizeof(Block));
+		for (uint32_t i = 0; i < count; i++)
+		{
+			memcpy(samples + i * sizeof(FlightRecorder_Sample_T),
+					&Ring[(oldest + written + i) % FLIGHT_RECORDER_SAMPLE_COUNT],
+					sizeof(FlightRecorder_Sample_T));
+		}
+		blockHeader.Index = (uint16_t) index;
+		blockHeader.Count = (uint8_t) count;
+		blockHeader.Reserved = 0;
+		blockHeader.Crc = Crc16(samples, count * sizeof(FlightRecorder_Sample_T));
+		memcpy(Block, &blockHeader, sizeof(blockHeader));
+
+		rc = WriteBlock();
+		written += count;
+	}
+
+	if (isOpen && FR_OK != f_close(&File) && RETCODE_OK == rc)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+	}
+
+	/* Remounted next time, e.g. after the card was swapped. */
+	if (RETCODE_OK != rc)
+	{
+		IsMounted = false;
+	}
+
+	return rc;
+}
+
+static void RunWriterLoop(void* param1)
+{
+	BCDS_UNUSED(param1);
+	char fileName[FLIGHT_RECORDER_FILE_NAME_SIZE];
+
+	while (1)
+	{
+		(void) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		uint32_t state = __atomic_load_n(&State, __ATOMIC_ACQUIRE);
+		if (FLIGHT_RECORDER_STATE_WRITING
+				== (state & FLIGHT_RECORDER_STATE_MASK))
+		{
+			Retcode_T rc = WriteRecording(fileName,
+					state >> FLIGHT_RECORDER_REASON_SHIFT);
+			if (RETCODE_OK == rc)
+			{
+				LOG_INFO("Flight recording %s written", fileName);
+			}
+			else
+			{
+				LOG_ERROR("Flight recording failed");
+				Retcode_RaiseError(rc);
+			}
+
+			__atomic_store_n(&State, FLIGHT_RECORDER_STATE_RECORDING,
+			__ATOMIC_RELEASE);
+		}
+	}
+}
+
+Retcode_T FlightRecorder_Initialize(void)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (NULL == WriterTask)
+	{
+		rc = SDCardDriver_Initialize();
+	}
+
+	if (RETCODE_OK == rc && NULL == WriterTask)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		WriterTask = xTaskCreateStatic(RunWriterLoop, "FLIGHT_RECORDER",
+				FLIGHT_RECORDER_WRITER_TASK_STACK_SIZE, NULL,
+				FLIGHT_RECORDER_WRITER_TASK_PRIO, WriterTaskStack,
+				&WriterTaskBuffer);
+		BaseType_t taskCreated = (NULL != WriterTask) ? pdTRUE : pdFALSE;
+#else
+		BaseType_t taskCreated = xTaskCreate(RunWriterLoop, "FLIGHT_RECORDER",
+				FLIGHT_RECORDER_WRITER_TASK_STACK_SIZE, NULL,
+				FLIGHT_RECORDER_WRITER_TASK_PRIO, &WriterTask);
+#endif
+		if (pdTRUE != taskCreated)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+	}
+
+	return rc;
+}
+
+void FlightRecorder_Record(const FlightRecorder_Sample_T* sample)
+{
+	assert(NULL != sample);
+
+	uint32_t state = __atomic_load_n(&State, __ATOMIC_ACQUIRE);
+	switch (state & FLIGHT_RECORDER_STATE_MASK)
+	{
+	case FLIGHT_RECORDER_STATE_WRITING:
+		DroppedSamples++;
+		break;
+	case FLIGHT_RECORDER_STATE_TRIGGERED:
+		if (0 == PostTriggerCount)
+		{
+			TriggerTime = sample->Time;
+		}
+		PostTriggerCount++;
+		/* No break, the sample is recorded. */
+	default:
+		if (0 != DroppedSamples)
+		{
+			MissedSamples += DroppedSamples;
+			DroppedSamples = 0;
+		}
+		Ring[RingNext] = *sample;
+		RingNext = (RingNext + 1) % FLIGHT_RECORDER_SAMPLE_COUNT;
+		if (RingCount < FLIGHT_RECORDER_SAMPLE_COUNT)
+		{
+			RingCount++;
+		}
+		break;
+	}
+
+	if (FLIGHT_RECORDER_STATE_TRIGGERED == (state & FLIGHT_RECORDER_STATE_MASK)
+			&& PostTriggerCount >= FLIGHT_RECORDER_POST_TRIGGER_SAMPLES)
+	{
+		PostTriggerCount = 0;
+		__atomic_store_n(&State,
+				(state & ~FLIGHT_RECORDER_STATE_MASK)
+						| FLIGHT_RECORDER_STATE_WRITING, __ATOMIC_RELEASE);
+		(void) xTaskNotifyGive(WriterTask);
+	}
+}
+
+Retcode_T FlightRecorder_Trigger(FlightRecorder_Reason_T reason)
+{
+	Retcode_T rc = RETCODE_OK;
+	uint32_t expected = FLIGHT_RECORDER_STATE_RECORDING;
+
+	if (FLIGHT_RECORDER_REASON_MAX <= reason)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
+	else if (NULL == WriterTask)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_UNINITIALIZED);
+	}
+	else if (!__atomic_compare_exchange_n(&State, &expected,
+			FLIGHT_RECORDER_STATE_TRIGGERED
+					| ((uint32_t) reason << FLIGHT_RECORDER_REASON_SHIFT),
+			false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_INCONSITENT_STATE);
+	}
+
+	return rc;
+}
+
+Retcode_T FlightRecorder_HandleDumpCommand(const char* args,
+		uint32_t receivedAt)
+{
+	BCDS_UNUSED(args);
+	BCDS_UNUSED(receivedAt);
+
+	Retcode_T rc = FlightRecorder_Trigger(FLIGHT_RECORDER_REASON_COMMAND);
+
+	return SerialMux_Printf(SERIAL_MUX_CHANNEL_RESPONSE,
+			(RETCODE_OK == rc) ? "DUMP OK" : "DUMP BUSY");
+}
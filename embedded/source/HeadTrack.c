@@ -24,11 +24,15 @@
 
 #include "XdkHeadTrack.h"
 
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "BCDS_Basics.h"
 #include "BCDS_Retcode.h"
 #include "BCDS_CmdProcessor.h"
+#include "BCDS_Accelerometer.h"
+#include "BCDS_Gyroscope.h"
 #include "BCDS_Rotation.h"
 
 #include "FreeRTOS.h"
@@ -37,15 +41,109 @@
 
 #include "XdkSensorHandle.h"
 
+#include "XdkBleConnParams.h"
 #include "XdkBleUi.h"
 #include "XdkButtonUi.h"
+#include "XdkControlMailbox.h"
+#include "XdkFlightRecorder.h"
 #include "XdkLedAnimator.h"
+#include "XdkLinkHealth.h"
 #include "XdkLogger.h"
-
-#define APP_POLL_ROTATION_TASK_STACK_SIZE	(UINT32_C(300))
+#include "XdkQuatPack.h"
+#include "XdkRuntimeStats.h"
+#include "XdkSampleScheduler.h"
+#include "XdkSerialMux.h"
+#include "XdkTextFormat.h"
+#include "XdkTimeSync.h"
+#include "XdkUsbUi.h"
+#include "XdkWire.h"
+
+/* In words. The deepest path of the application itself, formatting and
+ * sending a serial line, takes about 400 bytes (gcc -fstack-usage on the
+ * host). Most of the rest is for the SDK below: sensor fusion and I2C on
+ * every read, and printf run by the default error handler of
+ * Retcode_RaiseError, or by snprintf without HEAD_TRACK_USE_TEXT_FORMAT.
+ * Check the headroom on the device with "STATS". */
+#ifndef APP_POLL_ROTATION_TASK_STACK_SIZE
+#define APP_POLL_ROTATION_TASK_STACK_SIZE	(UINT32_C(512))
+#endif
 #define APP_POLL_ROTATION_TASK_PRIO			(UINT32_C(4))
-
-#define HEAD_TRACK_DEFAULT_COMMUNICATION_MODE	(HEAD_TRACK_COMMUNICATION_MODE_SERIAL)
+#define APP_POLL_ROTATION_PERIOD_MS			(UINT32_C(20))
+
+/* See SampleScheduler_CatchUp_T. */
+#ifndef HEAD_TRACK_SAMPLE_CATCH_UP
+#define HEAD_TRACK_SAMPLE_CATCH_UP	(SAMPLE_SCHEDULER_CATCH_UP_SKIP)
+#endif
+
+/* Interval of the sampling stats on the stats channel, 0 for none. */
+#ifndef HEAD_TRACK_STATS_INTERVAL_MS
+#define HEAD_TRACK_STATS_INTERVAL_MS	(UINT32_C(5000))
+#endif
+
+/* Interval of the task, heap and queue stats on the stats channel, 0 for
+ * none. The host can ask for them any time with "STATS". */
+#ifndef HEAD_TRACK_RUNTIME_STATS_INTERVAL_MS
+#define HEAD_TRACK_RUNTIME_STATS_INTERVAL_MS	(UINT32_C(10000))
+#endif
+
+#ifndef HEAD_TRACK_DEFAULT_COMMUNICATION_MODE
+#define HEAD_TRACK_DEFAULT_COMMUNICATION_MODE	(HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT)
+#endif
+
+/* Set to 0 to format serial lines with printf instead of TextFormat. */
+#ifndef HEAD_TRACK_USE_TEXT_FORMAT
+#define HEAD_TRACK_USE_TEXT_FORMAT	(1)
+#endif
+
+/* Set to 1 to always send the 15 byte compact BLE frames. Each one also
+ * carries the previous sample, so the host can restore a single lost
+ * notification. Otherwise they are only sent while the link health finds
+ * the BLE link congested. */
+#ifndef HEAD_TRACK_USE_COMPACT_BLE_FRAMES
+#define HEAD_TRACK_USE_COMPACT_BLE_FRAMES	(0)
+#endif
+
+/* Times the link health may halve the sample rate of a congested link, on
+ * top of the step to compact frames for BLE. Only the link carrying the
+ * samples adapts the rate, in the redundant mode that is the serial one. */
+#ifndef HEAD_TRACK_MAX_RATE_STEPS
+#define HEAD_TRACK_MAX_RATE_STEPS	(UINT32_C(3))
+#endif
+
+/* Set to 0 to leave accelerometer and gyroscope out of the flight recorder,
+ * which saves two sensor reads per sample. */
+#ifndef HEAD_TRACK_RECORD_RAW_SENSORS
+#define HEAD_TRACK_RECORD_RAW_SENSORS	(1)
+#endif
+
+/* A larger turn of the fused rotation from one sample to the next is taken
+ * as a glitch and triggers the flight recorder. */
+#ifndef HEAD_TRACK_GLITCH_ANGLE_DEG
+#define HEAD_TRACK_GLITCH_ANGLE_DEG	(30.0f)
+#endif
+
+/* The poll task logs a warning once if less of its stack, in words, was
+ * never used. Leaves room for the logging itself. */
+#ifndef HEAD_TRACK_STACK_WARNING_WORDS
+#define HEAD_TRACK_STACK_WARNING_WORDS	(UINT32_C(128))
+#endif
+
+/* The high-water mark is found by scanning the unused stack, so it is not
+ * looked at every sample. */
+#define HEAD_TRACK_STACK_CHECK_INTERVAL_US	(UINT32_C(1000000))
+
+/* " sequence time" after the quaternion, 5 and 10 digits. */
+#define HEAD_TRACK_SERIAL_SUFFIX_LENGTH	(UINT32_C(17))
+
+/* Sampling periods accepted by the "RATE" command. */
+#define HEAD_TRACK_MIN_RATE_HZ	(UINT32_C(1))
+#define HEAD_TRACK_MAX_RATE_HZ	(UINT32_C(200))
+
+enum HeadTrack_State_E
+{
+	HEAD_TRACK_STATE_STOPPED, HEAD_TRACK_STATE_RUNNING,
+};
+typedef enum HeadTrack_State_E HeadTrack_State_T;
 
 static const LedAnimator_Step_T InitializingSteps[] =
 {
@@ -69,6 +167,13 @@ static const LedAnimator_Step_T TrackingOverBleSteps[] =
 static const LedAnimator_Animation_T TrackingOverBleAnimation =
 { TrackingOverBleSteps, 1, LED_ANIMATOR_LOOP_HOLD_LAST };
 
+static const LedAnimator_Step_T TrackingRedundantSteps[] =
+{
+{ true, true, false, 1 } };
+
+static const LedAnimator_Animation_T TrackingRedundantAnimation =
+{ TrackingRedundantSteps, 1, LED_ANIMATOR_LOOP_HOLD_LAST };
+
 static const LedAnimator_Step_T IdleSteps[] =
 {
 { true, false, false, 500 },
@@ -80,20 +185,118 @@ static const LedAnimator_Animation_T IdleAnimation =
 static void RunPollRotationLoop(void* param1);
 static inline Retcode_T SendViaBle(const Rotation_QuaternionData_T* rawRotation,
 bool useForCalibration);
+static Retcode_T SendCompactViaBle(
+		const Rotation_QuaternionData_T* rawRotation, bool useForCalibration);
+static Retcode_T SendFullViaBle(const Rotation_QuaternionData_T* rawRotation,
+bool useForCalibration);
 static inline Retcode_T SendViaSerial(
 		const Rotation_QuaternionData_T* rawRotation, bool useForCalibration);
+static Retcode_T SendOverTransport(LinkHealth_Transport_T transport,
+		const Rotation_QuaternionData_T* rawRotation, bool useForCalibration);
+static Retcode_T SendSample(const Rotation_QuaternionData_T* rawRotation,
+bool useForCalibration);
+static Retcode_T ApplySamplePeriod(void);
 static Retcode_T UpdateLedAnimationToMode(void);
+static Retcode_T ApplyControlOps(void);
+static Retcode_T PostControlOp(ControlMailbox_Op_T op, uint32_t arg);
+static void RecordSample(const Rotation_QuaternionData_T* rawRotation,
+		Retcode_T readRc, bool useForCalibration);
+static void CheckPollRotationStack(void);
 
 static const CmdProcessor_T* AppCmdProcessor = NULL;
 static TaskHandle_t PollRotationTask = NULL;
 static SemaphoreHandle_t PollRotationRunSignal = NULL;
-static bool IsPollRotationEnabled = false;
-static bool IsCalibrationRequested = false;
+
+#if APP_USE_STATIC_ALLOCATION
+static StackType_t PollRotationTaskStack[APP_POLL_ROTATION_TASK_STACK_SIZE];
+static StaticTask_t PollRotationTaskBuffer;
+static StaticSemaphore_t PollRotationRunSignalBuffer;
+#endif
+
+/* Only touched by the poll task, others go through ControlMailbox. */
+static HeadTrack_State_T State = HEAD_TRACK_STATE_STOPPED;
+static bool IsCalibrationPending = false;
 static HeadTrack_CommunicationMode_T CommunicationMode =
 HEAD_TRACK_DEFAULT_COMMUNICATION_MODE;
+static bool IsBleConnected = false;
+/* Shared by both links so the host can drop the later copy of a sample. */
+static uint16_t SampleSequence = 0;
+/* Device time the current sample was read at, see TimeSync. */
+static uint32_t SampleTime = 0;
+static char SerialLine[TEXT_FORMAT_LINE_BUFFER_SIZE
+		+ HEAD_TRACK_SERIAL_SUFFIX_LENGTH];
+/* Last rotation read, recorded in place of failed reads. */
+static Rotation_QuaternionData_T PreviousRotation =
+{ .w = 1.0f, .x = 0.0f, .y = 0.0f, .z = 0.0f };
+static bool IsPreviousRotationValid = false;
+/* |dot| of two rotations HEAD_TRACK_GLITCH_ANGLE_DEG apart. */
+static float GlitchMinDot = 0.0f;
+/* Period set with the "RATE" command, the link health may lengthen it. */
+static TickType_t BasePeriod = 0;
+static TickType_t SamplePeriod = 0;
+static int16_t PreviousPacked[3];
+static QuatPack_Component_T PreviousDropped = QUAT_PACK_COMPONENT_W;
+static uint16_t PreviousSequence = 0;
+static bool IsPreviousValid = false;
+/* Device time of the next look at the stack of the poll task. */
+static uint32_t NextStackCheckTime = 0;
+static bool IsStackWarned = false;
 
 static inline Retcode_T SendViaBle(const Rotation_QuaternionData_T* rawRotation,
 bool useForCalibration)
+{
+	if (HEAD_TRACK_USE_COMPACT_BLE_FRAMES
+			|| 0 != LinkHealth_GetLevel(LINK_HEALTH_TRANSPORT_BLE))
+	{
+		return SendCompactViaBle(rawRotation, useForCalibration);
+	}
+	/* The next compact frame must not carry a sample from before. */
+	IsPreviousValid = false;
+	return SendFullViaBle(rawRotation, useForCalibration);
+}
+
+static Retcode_T SendCompactViaBle(
+		const Rotation_QuaternionData_T* rawRotation, bool useForCalibration)
+{
+	BleUi_CompactTrackingData_T bleData;
+	int16_t packed[3];
+	QuatPack_Component_T dropped = QuatPack_Pack(rawRotation->w,
+			rawRotation->x, rawRotation->y, rawRotation->z, packed);
+
+	bleData.Flags = (uint8_t) (dropped
+			<< BLE_UI_COMPACT_CURRENT_COMPONENT_SHIFT);
+	if (useForCalibration)
+	{
+		bleData.Flags |= BLE_UI_COMPACT_FLAG_CALIBRATION;
+	}
+	bleData.Sequence = SampleSequence;
+	memcpy(bleData.Current, packed, sizeof(packed));
+	memset(bleData.Previous, 0, sizeof(bleData.Previous));
+	if (IsPreviousValid && (uint16_t) (PreviousSequence + 1) == SampleSequence)
+	{
+		bleData.Flags |= BLE_UI_COMPACT_FLAG_PREVIOUS_VALID;
+		bleData.Flags |= (uint8_t) (PreviousDropped
+				<< BLE_UI_COMPACT_PREVIOUS_COMPONENT_SHIFT);
+		memcpy(bleData.Previous, PreviousPacked, sizeof(PreviousPacked));
+	}
+
+	if (!useForCalibration)
+	{
+		memcpy(PreviousPacked, packed, sizeof(packed));
+		PreviousDropped = dropped;
+		PreviousSequence = SampleSequence;
+		IsPreviousValid = true;
+	}
+
+	if (HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT == CommunicationMode)
+	{
+		return BleUi_TrySendCompactTrackingData(&bleData);
+	}
+	return BleUi_SendCompactTrackingData(&bleData);
+}
+
+static Retcode_T SendFullViaBle(const Rotation_QuaternionData_T* rawRotation,
+bool useForCalibration)
 {
 	BleUi_TrackingData_T bleData;
 	bleData.W = rawRotation->w;
@@ -101,6 +304,12 @@ bool useForCalibration)
 	bleData.Y = rawRotation->y;
 	bleData.Z = rawRotation->z;
 	bleData.UseForCalibration = useForCalibration;
+	bleData.Sequence = SampleSequence;
+	if (HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT == CommunicationMode)
+	{
+		/* Never hold back the serial copy of the next sample. */
+		return BleUi_TrySendTrackingData(&bleData);
+	}
 	return BleUi_SendTrackingData(&bleData);
 }
 
@@ -115,6 +324,12 @@ static Retcode_T UpdateLedAnimationToMode(void)
 	case HEAD_TRACK_COMMUNICATION_MODE_BLE:
 		rc = LedAnimator_PlayAnimation(&TrackingOverBleAnimation);
 		break;
+	case HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT:
+		rc = LedAnimator_PlayAnimation(
+				IsBleConnected ?
+						&TrackingRedundantAnimation :
+						&TrackingOverSerialAnimation);
+		break;
 	default:
 		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
 		break;
@@ -125,77 +340,412 @@ static Retcode_T UpdateLedAnimationToMode(void)
 static inline Retcode_T SendViaSerial(
 		const Rotation_QuaternionData_T* rawRotation, bool useForCalibration)
 {
+	const char* tag =
+			useForCalibration ?
+					XDK_WIRE_CALIBRATION_LINE_TAG : XDK_WIRE_ROTATION_LINE_TAG;
+#if HEAD_TRACK_USE_TEXT_FORMAT
+	/* "<tag> w x y z sequence time\n", older hosts ignore the trailing
+	 * fields. */
+	uint32_t length = TextFormat_FormatQuaternion(SerialLine, tag,
+			rawRotation->w, rawRotation->x, rawRotation->y, rawRotation->z);
+	SerialLine[length - 1] = ' ';
+	length += TextFormat_FormatUnsigned(SerialLine + length, SampleSequence);
+	SerialLine[length++] = ' ';
+	length += TextFormat_FormatUnsigned(SerialLine + length, SampleTime);
+	SerialLine[length++] = '\n';
+	if (length > sizeof(SerialLine) - 1)
+	{
+		length = sizeof(SerialLine) - 1;
+		SerialLine[length - 1] = '\n';
+	}
+#else
+	int printed = snprintf(SerialLine, sizeof(SerialLine),
+			"%s %f %f %f %f %u %lu\n", tag, rawRotation->w, rawRotation->x,
+			rawRotation->y, rawRotation->z, (unsigned int) SampleSequence,
+			(unsigned long) SampleTime);
+	/* snprintf returns the length the line would have had, a truncated line
+	 * still has to end with its line feed. */
+	uint32_t length = (printed > 0) ? (uint32_t) printed : 0;
+	if (length > sizeof(SerialLine) - 1)
+	{
+		length = sizeof(SerialLine) - 1;
+		SerialLine[length - 1] = '\n';
+	}
+#endif
+	return SerialMux_Write(SERIAL_MUX_CHANNEL_TRACKING, SerialLine, length);
+}
+
+static Retcode_T SendOverTransport(LinkHealth_Transport_T transport,
+		const Rotation_QuaternionData_T* rawRotation, bool useForCalibration)
+{
+	Retcode_T rc = RETCODE_OK;
+	uint32_t fillPermille = 0;
+	uint32_t start = 0;
+
+	if (LINK_HEALTH_TRANSPORT_BLE == transport)
+	{
+		fillPermille = BleUi_IsSendPending() ? UINT32_C(1000) : 0;
+		start = TimeSync_GetDeviceTime();
+		rc = SendViaBle(rawRotation, useForCalibration);
+	}
+	else
+	{
+		/* Tracking lines are written synchronously, bypassing the queue of
+		 * SerialMux, so a congested port shows in the latency only. */
+		start = TimeSync_GetDeviceTime();
+		rc = SendViaSerial(rawRotation, useForCalibration);
+	}
+	LinkHealth_RecordSend(transport, rc, TimeSync_GetDeviceTime() - start,
+			fillPermille);
+
+	return rc;
+}
+
+static Retcode_T SendSample(const Rotation_QuaternionData_T* rawRotation,
+bool useForCalibration)
+{
+	Retcode_T rc = RETCODE_OK;
+	switch (CommunicationMode)
+	{
+	case HEAD_TRACK_COMMUNICATION_MODE_SERIAL:
+		rc = SendOverTransport(LINK_HEALTH_TRANSPORT_SERIAL, rawRotation,
+				useForCalibration);
+		break;
+	case HEAD_TRACK_COMMUNICATION_MODE_BLE:
+		rc = SendOverTransport(LINK_HEALTH_TRANSPORT_BLE, rawRotation,
+				useForCalibration);
+		break;
+	case HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT:
+		rc = SendOverTransport(LINK_HEALTH_TRANSPORT_SERIAL, rawRotation,
+				useForCalibration);
+		if (IsBleConnected)
+		{
+			/* Losing the BLE copy is what the serial copy is there for. */
+			(void) SendOverTransport(LINK_HEALTH_TRANSPORT_BLE, rawRotation,
+					useForCalibration);
+		}
+		break;
+	default:
+		rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_INCONSITENT_STATE);
+		break;
+	}
+	return rc;
+}
+
+static Retcode_T ApplySamplePeriod(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	LinkHealth_Transport_T transport =
+			(HEAD_TRACK_COMMUNICATION_MODE_BLE == CommunicationMode) ?
+					LINK_HEALTH_TRANSPORT_BLE : LINK_HEALTH_TRANSPORT_SERIAL;
+	uint32_t steps = LinkHealth_GetLevel(transport);
+	TickType_t period = BasePeriod;
+	const TickType_t maxPeriod = pdMS_TO_TICKS(
+			UINT32_C(1000) / HEAD_TRACK_MIN_RATE_HZ);
+
+	/* BLE steps to compact frames first. */
+	if (LINK_HEALTH_TRANSPORT_BLE == transport)
+	{
+		steps = (0 != steps) ? steps - 1 : 0;
+	}
+	for (uint32_t i = 0; i < steps && period < maxPeriod; i++)
+	{
+		period *= 2;
+	}
+	/* Doubling may step past it, e.g. from 666 to 1332 ms at 3 Hz. */
+	if (period > maxPeriod)
+	{
+		period = maxPeriod;
+	}
+
+	if (period != SamplePeriod)
+	{
+		rc = SampleScheduler_SetPeriod(period);
+		if (RETCODE_OK == rc)
+		{
+			SamplePeriod = period;
+			if (HEAD_TRACK_STATE_RUNNING == State)
+			{
+				SampleScheduler_Start();
+			}
+			rc = BleConnParams_NotifySamplePeriod(
+					period * portTICK_PERIOD_MS);
+		}
+	}
+
+	return rc;
+}
+
+static Retcode_T ApplyControlOps(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	uint32_t args[CONTROL_MAILBOX_OP_MAX];
+	uint32_t ops = ControlMailbox_Take(args);
+	HeadTrack_State_T previousState = State;
+
+	if (0 != (ops & CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_BLE_CONNECTION)))
+	{
+		IsBleConnected = (0 != args[CONTROL_MAILBOX_OP_BLE_CONNECTION]);
+		/* Outside the redundant mode the link follows the connection. */
+		if (HEAD_TRACK_COMMUNICATION_MODE_REDUNDANT != CommunicationMode)
+		{
+			CommunicationMode =
+					IsBleConnected ?
+							HEAD_TRACK_COMMUNICATION_MODE_BLE :
+							HEAD_TRACK_COMMUNICATION_MODE_SERIAL;
+		}
+	}
+
+	/* After the connection, so an explicit mode wins. */
+	if (0 != (ops & CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_MODE)))
+	{
+		CommunicationMode =
+				(HeadTrack_CommunicationMode_T) args[CONTROL_MAILBOX_OP_MODE];
+	}
+
+	if (0 != (ops & CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_CALIBRATE)))
+	{
+		IsCalibrationPending = true;
+	}
+
+	if (0 != (ops & CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_PERIOD)))
+	{
+		BasePeriod = pdMS_TO_TICKS(args[CONTROL_MAILBOX_OP_PERIOD]);
+	}
+
+	/* The primary link, and with it the adapted period, may have changed. */
+	if (0 != (ops & (CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_PERIOD)
+					| CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_MODE)
+					| CONTROL_MAILBOX_OP_BIT(
+							CONTROL_MAILBOX_OP_BLE_CONNECTION))))
+	{
+		rc = ApplySamplePeriod();
+	}
+
+	if (0 != (ops & CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_RUN)))
+	{
+		State = (0 != args[CONTROL_MAILBOX_OP_RUN]) ?
+				HEAD_TRACK_STATE_RUNNING : HEAD_TRACK_STATE_STOPPED;
+	}
+
+	if (HEAD_TRACK_STATE_RUNNING == State)
+	{
+		if (HEAD_TRACK_STATE_STOPPED == previousState)
+		{
+			SampleScheduler_Start();
+			/* Turning while stopped is no glitch. */
+			IsPreviousRotationValid = false;
+		}
+		if (HEAD_TRACK_STATE_STOPPED == previousState
+				|| 0 != (ops & (CONTROL_MAILBOX_OP_BIT(CONTROL_MAILBOX_OP_MODE)
+								| CONTROL_MAILBOX_OP_BIT(
+										CONTROL_MAILBOX_OP_BLE_CONNECTION))))
+		{
+			Retcode_T ledRc = UpdateLedAnimationToMode();
+			rc = (RETCODE_OK == rc) ? ledRc : rc;
+		}
+	}
+	else if (HEAD_TRACK_STATE_RUNNING == previousState)
+	{
+		Retcode_T ledRc = LedAnimator_PlayAnimation(&IdleAnimation);
+		rc = (RETCODE_OK == rc) ? ledRc : rc;
+	}
+
+	if (0 != ops)
+	{
+		(void) ControlMailbox_PublishStats();
+	}
+
+	return rc;
+}
+
+static Retcode_T PostControlOp(ControlMailbox_Op_T op, uint32_t arg)
+{
+	Retcode_T rc = ControlMailbox_Post(op, arg);
+
+	/* A stopped poll task waits here, a running one takes the operation at
+	 * the end of the current sample. */
+	if (RETCODE_OK == rc && NULL != PollRotationRunSignal)
+	{
+		(void) xSemaphoreGive(PollRotationRunSignal);
+	}
+
+	return rc;
+}
+
+#if HEAD_TRACK_RECORD_RAW_SENSORS
+static inline int16_t ClampToInt16(int32_t value)
+{
+	if (INT16_MAX < value)
+	{
+		return INT16_MAX;
+	}
+	if (INT16_MIN > value)
+	{
+		return INT16_MIN;
+	}
+	return (int16_t) value;
+}
+#endif
+
+static void RecordSample(const Rotation_QuaternionData_T* rawRotation,
+		Retcode_T readRc, bool useForCalibration)
+{
+	FlightRecorder_Sample_T sample;
+	const Rotation_QuaternionData_T* rotation =
+			(RETCODE_OK == readRc) ? rawRotation : &PreviousRotation;
+
+	memset(&sample, 0, sizeof(sample));
+	sample.Time = SampleTime;
+	sample.Sequence = SampleSequence;
+	QuatPack_Component_T dropped = QuatPack_Pack(rotation->w, rotation->x,
+			rotation->y, rotation->z, sample.Rotation);
+	sample.Flags = (uint8_t) (dropped << FLIGHT_RECORDER_COMPONENT_SHIFT);
 	if (useForCalibration)
 	{
-		printf(">>CALI: %f %f %f %f\n", rawRotation->w, rawRotation->x,
-				rawRotation->y, rawRotation->z);
+		sample.Flags |= FLIGHT_RECORDER_FLAG_CALIBRATION;
+	}
+	if (RETCODE_OK != readRc)
+	{
+		sample.Flags |= FLIGHT_RECORDER_FLAG_READ_FAILED;
+	}
+
+#if HEAD_TRACK_RECORD_RAW_SENSORS
+	Accelerometer_XyzData_T acceleration;
+	Gyroscope_XyzData_T angularRate;
+	if (RETCODE_OK
+			== Accelerometer_readXyzGValue(xdkAccelerometers_BMA280_Handle,
+					&acceleration)
+			&& RETCODE_OK
+					== Gyroscope_readXyzDegreeValue(xdkGyroscope_BMG160_Handle,
+							&angularRate))
+	{
+		sample.Flags |= FLIGHT_RECORDER_FLAG_RAW_VALID;
+		sample.Acceleration[0] = ClampToInt16(acceleration.xAxisData);
+		sample.Acceleration[1] = ClampToInt16(acceleration.yAxisData);
+		sample.Acceleration[2] = ClampToInt16(acceleration.zAxisData);
+		/* mdeg/s to 0.1 deg/s */
+		sample.AngularRate[0] = ClampToInt16(angularRate.xAxisData / 100);
+		sample.AngularRate[1] = ClampToInt16(angularRate.yAxisData / 100);
+		sample.AngularRate[2] = ClampToInt16(angularRate.zAxisData / 100);
+	}
+#endif
+
+	FlightRecorder_Record(&sample);
+
+	/* Triggers while a recording is in progress are dropped. */
+	if (RETCODE_OK != readRc)
+	{
+		(void) FlightRecorder_Trigger(FLIGHT_RECORDER_REASON_READ_FAILURE);
 	}
 	else
 	{
-		printf(">>QUAT: %f %f %f %f\n", rawRotation->w, rawRotation->x,
-				rawRotation->y, rawRotation->z);
+		if (IsPreviousRotationValid
+				&& GlitchMinDot
+						> fabsf(
+								rawRotation->w * PreviousRotation.w
+										+ rawRotation->x * PreviousRotation.x
+										+ rawRotation->y * PreviousRotation.y
+										+ rawRotation->z * PreviousRotation.z))
+		{
+			(void) FlightRecorder_Trigger(FLIGHT_RECORDER_REASON_GLITCH);
+		}
+		PreviousRotation = *rawRotation;
+		IsPreviousRotationValid = true;
+	}
+}
+
+static void CheckPollRotationStack(void)
+{
+	if (IsStackWarned || 0 > (int32_t) (SampleTime - NextStackCheckTime))
+	{
+		return;
+	}
+
+	NextStackCheckTime = SampleTime + HEAD_TRACK_STACK_CHECK_INTERVAL_US;
+	UBaseType_t unused = uxTaskGetStackHighWaterMark(NULL);
+	if (HEAD_TRACK_STACK_WARNING_WORDS > unused)
+	{
+		IsStackWarned = true;
+		LOG_WARNING("POLL_ROTATION stack: %lu of %lu words never used",
+				(unsigned long) unused,
+				(unsigned long) APP_POLL_ROTATION_TASK_STACK_SIZE);
 	}
-	return RETCODE_OK;
 }
 
 static void RunPollRotationLoop(void* param1)
 {
 	BCDS_UNUSED(param1);
 	Retcode_T rc = RETCODE_OK;
+	Retcode_T readRc = RETCODE_OK;
 	Rotation_QuaternionData_T rawRotation;
-	TickType_t pxPreviousWakeTime = xTaskGetTickCount();
+	bool isCalibration = false;
 
 	while (1)
 	{
-		while (!IsPollRotationEnabled)
+		/* Between samples, so no sample sees half a change. */
+		rc = ApplyControlOps();
+		if (RETCODE_OK != rc)
+		{
+			Retcode_RaiseError(rc);
+		}
+
+		if (HEAD_TRACK_STATE_STOPPED == State)
 		{
 			(void) xSemaphoreTake(PollRotationRunSignal, portMAX_DELAY);
+			continue;
 		}
 
-		rc = Rotation_readQuaternionValue(&rawRotation);
+		readRc = Rotation_readQuaternionValue(&rawRotation);
+		SampleTime = TimeSync_GetDeviceTime();
+		rc = readRc;
 
-		if (IsCalibrationRequested)
+		isCalibration = (RETCODE_OK == rc && IsCalibrationPending);
+		if (isCalibration)
 		{
-			IsCalibrationRequested = false;
-			switch (CommunicationMode)
+			/* Kept pending until a link took it, so a failed send retries
+			 * with the next sample instead of losing the calibration. */
+			rc = SendSample(&rawRotation, true);
+			if (RETCODE_OK == rc)
 			{
-			case HEAD_TRACK_COMMUNICATION_MODE_SERIAL:
-				rc = SendViaSerial(&rawRotation, true);
-				break;
-			case HEAD_TRACK_COMMUNICATION_MODE_BLE:
-				rc = SendViaBle(&rawRotation, true);
-				break;
-			default:
-				Retcode_RaiseError(
-						RETCODE(RETCODE_SEVERITY_FATAL,
-								RETCODE_INCONSITENT_STATE));
-				break;
+				IsCalibrationPending = false;
 			}
 		}
 
 		if (RETCODE_OK == rc)
 		{
-			switch (CommunicationMode)
-			{
-			case HEAD_TRACK_COMMUNICATION_MODE_SERIAL:
-				SendViaSerial(&rawRotation, false);
-				break;
-			case HEAD_TRACK_COMMUNICATION_MODE_BLE:
-				rc = SendViaBle(&rawRotation, false);
-				break;
-			default:
-				Retcode_RaiseError(
-						RETCODE(RETCODE_SEVERITY_FATAL,
-								RETCODE_INCONSITENT_STATE));
-				break;
-			}
-			vTaskDelayUntil(&pxPreviousWakeTime, pdMS_TO_TICKS(20));
+			rc = SendSample(&rawRotation, false);
 		}
 
-		if (RETCODE_OK != rc)
+		/* After sending, so the raw sensor reads add no latency. */
+		RecordSample(&rawRotation, readRc, isCalibration);
+		CheckPollRotationStack();
+
+		/* Also if a link failed to take it, so the host sees the gap, and in
+		 * redundant mode the other link may have delivered it anyway. */
+		if (RETCODE_OK == readRc)
 		{
-			Retcode_RaiseError(rc);
+			SampleSequence++;
+		}
+
+		/* Send failures are raised by LinkHealth, once per series. */
+		if (RETCODE_OK != readRc)
+		{
+			Retcode_RaiseError(readRc);
+		}
+
+		if (LinkHealth_Update(SampleTime,
+				SamplePeriod * portTICK_PERIOD_MS * UINT32_C(1000)))
+		{
+			Retcode_T periodRc = ApplySamplePeriod();
+			if (RETCODE_OK != periodRc)
+			{
+				Retcode_RaiseError(periodRc);
+			}
 		}
+
+		/* Also after errors, so they do not shift the schedule. */
+		SampleScheduler_WaitForNextPeriod(rc);
 	}
 }
 
@@ -208,7 +758,19 @@ void HeadTrack_InitSystem(void* cmdProcessorHandle, uint32_t param2)
 
 	Retcode_T rc = RETCODE_OK;
 
-	rc = Logger_Initialize();
+	rc = SerialMux_Initialize();
+
+	if (RETCODE_OK == rc)
+	{
+		rc = Logger_Initialize();
+	}
+
+#if TEXT_FORMAT_ENABLE_BENCHMARK
+	if (RETCODE_OK == rc)
+	{
+		rc = TextFormat_RunBenchmark();
+	}
+#endif
 
 	if (RETCODE_OK == rc)
 	{
@@ -230,16 +792,74 @@ void HeadTrack_InitSystem(void* cmdProcessorHandle, uint32_t param2)
 		rc = BleUi_Initialize(AppCmdProcessor);
 	}
 
+	if (RETCODE_OK == rc)
+	{
+		rc = UsbUi_Initialize(AppCmdProcessor);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		rc = RuntimeStats_Initialize(AppCmdProcessor,
+				pdMS_TO_TICKS(HEAD_TRACK_RUNTIME_STATS_INTERVAL_MS));
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		rc = FlightRecorder_Initialize();
+	}
+
+#if HEAD_TRACK_RECORD_RAW_SENSORS
+	/* Before the rotation sensor, which configures them for its fusion. */
+	if (RETCODE_OK == rc)
+	{
+		rc = Accelerometer_init(xdkAccelerometers_BMA280_Handle);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		rc = Gyroscope_init(xdkGyroscope_BMG160_Handle);
+	}
+#endif
+
 	if (RETCODE_OK == rc)
 	{
 		rc = Rotation_init(xdkRotationSensor_Handle);
 	}
 
+	GlitchMinDot = cosf(HEAD_TRACK_GLITCH_ANGLE_DEG * (float) M_PI / 360.0f);
+
+	if (RETCODE_OK == rc)
+	{
+		BasePeriod = pdMS_TO_TICKS(APP_POLL_ROTATION_PERIOD_MS);
+		SamplePeriod = BasePeriod;
+		rc = SampleScheduler_Initialize(SamplePeriod,
+				HEAD_TRACK_SAMPLE_CATCH_UP,
+				pdMS_TO_TICKS(HEAD_TRACK_STATS_INTERVAL_MS));
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		rc = BleConnParams_NotifySamplePeriod(
+				SamplePeriod * portTICK_PERIOD_MS);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		const uint32_t maxLevels[LINK_HEALTH_TRANSPORT_MAX] =
+		{ HEAD_TRACK_MAX_RATE_STEPS, HEAD_TRACK_MAX_RATE_STEPS + 1 };
+		rc = LinkHealth_Initialize(maxLevels);
+	}
+
 	if (RETCODE_OK == rc)
 	{
 		if (NULL == PollRotationRunSignal)
 		{
+#if APP_USE_STATIC_ALLOCATION
+			PollRotationRunSignal = xSemaphoreCreateBinaryStatic(
+					&PollRotationRunSignalBuffer);
+#else
 			PollRotationRunSignal = xSemaphoreCreateBinary();
+#endif
 			if (NULL == PollRotationRunSignal)
 			{
 				rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
@@ -251,9 +871,17 @@ void HeadTrack_InitSystem(void* cmdProcessorHandle, uint32_t param2)
 	{
 		if (NULL == PollRotationTask)
 		{
+#if APP_USE_STATIC_ALLOCATION
+			PollRotationTask = xTaskCreateStatic(RunPollRotationLoop,
+					"POLL_ROTATION", APP_POLL_ROTATION_TASK_STACK_SIZE, NULL,
+					APP_POLL_ROTATION_TASK_PRIO, PollRotationTaskStack,
+					&PollRotationTaskBuffer);
+			BaseType_t taskCreated = (NULL != PollRotationTask) ? pdTRUE : pdFALSE;
+#else
 			BaseType_t taskCreated = xTaskCreate(RunPollRotationLoop,
 					"POLL_ROTATION", APP_POLL_ROTATION_TASK_STACK_SIZE, NULL,
-					APP_POLL_ROTATION_TASK_PRIO, PollRotationTask);
+					APP_POLL_ROTATION_TASK_PRIO, &PollRotationTask);
+#endif
 			if (pdTRUE != taskCreated)
 			{
 				rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
@@ -273,50 +901,92 @@ void HeadTrack_InitSystem(void* cmdProcessorHandle, uint32_t param2)
 }
 
 Retcode_T HeadTrack_Run(void)
+{
+	return PostControlOp(CONTROL_MAILBOX_OP_RUN, true);
+}
+
+Retcode_T HeadTrack_Stop(void)
+{
+	return PostControlOp(CONTROL_MAILBOX_OP_RUN, false);
+}
+
+Retcode_T HeadTrack_Calibrate(void)
+{
+	return PostControlOp(CONTROL_MAILBOX_OP_CALIBRATE, 0);
+}
+
+Retcode_T HeadTrack_ChangeCommunicationMode(
+		HeadTrack_CommunicationMode_T commMode)
 {
 	Retcode_T rc = RETCODE_OK;
 
-	IsPollRotationEnabled = true;
-	(void) xSemaphoreGive(PollRotationRunSignal);
+	if (HEAD_TRACK_COMMUNICATION_MODE_MAX <= commMode)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
 
 	if (RETCODE_OK == rc)
 	{
-		rc = UpdateLedAnimationToMode();
+		rc = PostControlOp(CONTROL_MAILBOX_OP_MODE, commMode);
 	}
 
 	return rc;
 }
 
-Retcode_T HeadTrack_Stop(void)
+Retcode_T HeadTrack_ChangeSamplePeriod(uint32_t periodMs)
 {
 	Retcode_T rc = RETCODE_OK;
 
-	IsPollRotationEnabled = false;
+	if (0 == pdMS_TO_TICKS(periodMs))
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
 
-	rc = LedAnimator_PlayAnimation(&IdleAnimation);
+	if (RETCODE_OK == rc)
+	{
+		rc = PostControlOp(CONTROL_MAILBOX_OP_PERIOD, periodMs);
+	}
 
 	return rc;
 }
 
-Retcode_T HeadTrack_Calibrate(void)
+Retcode_T HeadTrack_NotifyBleConnectionChanged(bool isConnected)
 {
-	Retcode_T rc = RETCODE_OK;
-
-	IsCalibrationRequested = true;
-
-	return rc;
+	return PostControlOp(CONTROL_MAILBOX_OP_BLE_CONNECTION, isConnected);
 }
 
-Retcode_T HeadTrack_ChangeCommunicationMode(
-		HeadTrack_CommunicationMode_T commMode)
+Retcode_T HeadTrack_HandleRateCommand(const char* args, uint32_t receivedAt)
 {
+	BCDS_UNUSED(receivedAt);
+
 	Retcode_T rc = RETCODE_OK;
+	uint32_t rateHz = 0;
+	uint32_t digits = 0;
 
-	CommunicationMode = commMode;
+	while (args[digits] >= '0' && args[digits] <= '9'
+			&& rateHz <= HEAD_TRACK_MAX_RATE_HZ)
+	{
+		rateHz = rateHz * 10 + (uint32_t) (args[digits] - '0');
+		digits++;
+	}
 
-	if (IsPollRotationEnabled)
+	/* The whole argument must be the number, "50abc" is no rate. */
+	if (0 == digits || '\0' != args[digits]
+			|| HEAD_TRACK_MIN_RATE_HZ > rateHz
+			|| HEAD_TRACK_MAX_RATE_HZ < rateHz)
+	{
+		rc = SerialMux_Printf(SERIAL_MUX_CHANNEL_RESPONSE, "ERR RATE");
+	}
+	else
 	{
-		rc = UpdateLedAnimationToMode();
+		/* Whole milliseconds, the reply tells the period actually used. */
+		uint32_t periodMs = UINT32_C(1000) / rateHz;
+		rc = HeadTrack_ChangeSamplePeriod(periodMs);
+		if (RETCODE_OK == rc)
+		{
+			rc = SerialMux_Printf(SERIAL_MUX_CHANNEL_RESPONSE, "RATE %lu %lu",
+					(unsigned long) rateHz, (unsigned long) periodMs);
+		}
 	}
 
 	return rc;
@@ -39,6 +39,9 @@ static void HandleAnimationTimer(TimerHandle_t timer);
 static Retcode_T HandleAnimationTick(void);
 
 static TimerHandle_t AnimationTimer = NULL;
+#if APP_USE_STATIC_ALLOCATION
+static StaticTimer_t AnimationTimerBuffer;
+#endif
 static const LedAnimator_Animation_T* Animation = NULL;
 static uint32_t CurrentStepIndex = 0;
 
@@ -154,8 +157,13 @@ Retcode_T LedAnimator_Initialize(void)
 	{
 		if (NULL == AnimationTimer)
 		{
+#if APP_USE_STATIC_ALLOCATION
+			AnimationTimer = xTimerCreateStatic("BLINK", pdMS_TO_TICKS(1),
+					pdTRUE, NULL, HandleAnimationTimer, &AnimationTimerBuffer);
+#else
 			AnimationTimer = xTimerCreate("BLINK", pdMS_TO_TICKS(1), pdTRUE,
 			NULL, HandleAnimationTimer);
+#endif
 			if (NULL == AnimationTimer)
 			{
 				rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
@@ -0,0 +1,354 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_LINKHEALTH
+
+#include "XdkLinkHealth.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#include "XdkSerialMux.h"
+#include "XdkTextFormat.h"
+#include "XdkTimeSync.h"
+
+/* Length of the windows the links are judged by. */
+#ifndef LINK_HEALTH_WINDOW_MS
+#define LINK_HEALTH_WINDOW_MS	(UINT32_C(1000))
+#endif
+
+/* A window is congested if at least this share of its sends failed, */
+#ifndef LINK_HEALTH_FAILURE_PERMILLE
+#define LINK_HEALTH_FAILURE_PERMILLE	(UINT32_C(50))
+#endif
+
+/* if its sends took longer than this share of the period on average, */
+#ifndef LINK_HEALTH_LATENCY_PERCENT
+#define LINK_HEALTH_LATENCY_PERCENT	(UINT32_C(50))
+#endif
+
+/* or if the queue was filled this far on average. */
+#ifndef LINK_HEALTH_FILL_PERMILLE
+#define LINK_HEALTH_FILL_PERMILLE	(UINT32_C(750))
+#endif
+
+/* Windows without failures in a row before a transport steps back up, more
+ * than one so a link at its limit does not flap between two levels. */
+#ifndef LINK_HEALTH_RECOVERY_WINDOWS
+#define LINK_HEALTH_RECOVERY_WINDOWS	(UINT32_C(3))
+#endif
+
+#define LINK_HEALTH_WINDOW_US	(LINK_HEALTH_WINDOW_MS * UINT32_C(1000))
+
+/* Sends of one transport during the current window. */
+struct LinkHealth_Window_S
+{
+	uint32_t Sends;
+	/* Sends that failed, timed out or completed with an error. */
+	uint32_t Failures;
+	/* Time spent in the send calls, including waiting for the link. */
+	uint32_t TotalLatencyUs;
+	uint32_t MaxLatencyUs;
+	/* Sum of the queue fill seen at each send, in permille. */
+	uint32_t TotalFillPermille;
+};
+typedef struct LinkHealth_Window_S LinkHealth_Window_T;
+
+struct LinkHealth_State_S
+{
+	LinkHealth_Window_T Window;
+	uint32_t Level;
+	uint32_t MaxLevel;
+	uint32_t CleanWindows;
+	/* Failures since the first one raised, 0 while there is no storm. */
+	uint32_t StormFailures;
+	uint32_t StormStart;
+};
+typedef struct LinkHealth_State_S LinkHealth_State_T;
+
+static const char* const TransportNames[LINK_HEALTH_TRANSPORT_MAX] =
+{ "SERIAL", "BLE" };
+
+/* Only touched by the sampling task. */
+static LinkHealth_State_T States[LINK_HEALTH_TRANSPORT_MAX];
+/* Device time the current window started at, 0 before the first sample. */
+static uint32_t WindowStart = 0;
+
+/* Written by the transports' callbacks with the atomic builtins, taken by
+ * the sampling task at the end of each window. */
+static uint32_t CompletionFailures[LINK_HEALTH_TRANSPORT_MAX];
+static Retcode_T CompletionErrors[LINK_HEALTH_TRANSPORT_MAX];
+
+static void CountFailures(LinkHealth_State_T* state, Retcode_T rc,
+		uint32_t count);
+static bool IsCongested(const LinkHealth_Window_T* window, uint32_t periodUs);
+static Retcode_T PublishLevel(LinkHealth_Transport_T transport,
+		uint32_t previousLevel);
+static Retcode_T PublishStorm(LinkHealth_Transport_T transport,
+		uint32_t now);
+
+static void CountFailures(LinkHealth_State_T* state, Retcode_T rc,
+		uint32_t count)
+{
+	state->Window.Failures += count;
+	if (0 == state->StormFailures)
+	{
+		/* Raising every failed sample would flood the error handler
+		 * exactly when the link is busy already. */
+		Retcode_RaiseError(rc);
+		state->StormStart = TimeSync_GetDeviceTime();
+	}
+	state->StormFailures += count;
+}
+
+static bool IsCongested(const LinkHealth_Window_T* window, uint32_t periodUs)
+{
+	if (0 == window->Sends)
+	{
+		return 0 != window->Failures;
+	}
+	return window->Failures * UINT32_C(1000)
+			>= window->Sends * LINK_HEALTH_FAILURE_PERMILLE
+			|| (uint64_t) window->TotalLatencyUs * UINT32_C(100)
+					> (uint64_t) window->Sends * periodUs
+							* LINK_HEALTH_LATENCY_PERCENT
+			|| window->TotalFillPermille
+					>= window->Sends * LINK_HEALTH_FILL_PERMILLE;
+}
+
+static Retcode_T PublishLevel(LinkHealth_Transport_T transport,
+		uint32_t previousLevel)
+{
+	Retcode_T rc = RETCODE_OK;
+	const LinkHealth_State_T* state = &States[transport];
+	const LinkHealth_Window_T* window = &state->Window;
+	SerialMux_Line_T* line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		uint32_t sends = (0 != window->Sends) ? window->Sends : 1;
+		uint32_t nameLength = strlen(TransportNames[transport]);
+		char* text = line->Text;
+		memcpy(text, "LINK ", 5);
+		text += 5;
+		memcpy(text, TransportNames[transport], nameLength);
+		text += nameLength;
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, state->Level);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, previousLevel);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, window->Sends);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, window->Failures);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, window->TotalLatencyUs / sends);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, window->MaxLatencyUs);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text,
+				window->TotalFillPermille / sends);
+		line->Length = (uint32_t) (text - line->Text);
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
+
+static Retcode_T PublishStorm(LinkHealth_Transport_T transport, uint32_t now)
+{
+	Retcode_T rc = RETCODE_OK;
+	const LinkHealth_State_T* state = &States[transport];
+	SerialMux_Line_T* line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		uint32_t nameLength = strlen(TransportNames[transport]);
+		char* text = line->Text;
+		memcpy(text, "LINKERR ", 8);
+		text += 8;
+		memcpy(text, TransportNames[transport], nameLength);
+		text += nameLength;
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, state->StormFailures);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text,
+				(now - state->StormStart) / UINT32_C(1000));
+		line->Length = (uint32_t) (text - line->Text);
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
+
+Retcode_T LinkHealth_Initialize(
+		const uint32_t maxLevels[LINK_HEALTH_TRANSPORT_MAX])
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (NULL == maxLevels)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
+	}
+
+	for (uint32_t i = 0; RETCODE_OK == rc && i < LINK_HEALTH_TRANSPORT_MAX;
+			i++)
+	{
+		if (LINK_HEALTH_MAX_LEVEL < maxLevels[i])
+		{
+			rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+		}
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		memset(States, 0, sizeof(States));
+		for (uint32_t i = 0; i < LINK_HEALTH_TRANSPORT_MAX; i++)
+		{
+			States[i].MaxLevel = maxLevels[i];
+			__atomic_store_n(&CompletionFailures[i], 0, __ATOMIC_RELAXED);
+		}
+		WindowStart = 0;
+	}
+
+	return rc;
+}
+
+void LinkHealth_RecordSend(LinkHealth_Transport_T transport, Retcode_T rc,
+		uint32_t latencyUs, uint32_t fillPermille)
+{
+	assert(LINK_HEALTH_TRANSPORT_MAX > transport);
+
+	LinkHealth_State_T* state = &States[transport];
+	state->Window.Sends++;
+	state->Window.TotalLatencyUs += latencyUs;
+	state->Window.TotalFillPermille += fillPermille;
+	if (latencyUs > state->Window.MaxLatencyUs)
+	{
+		state->Window.MaxLatencyUs = latencyUs;
+	}
+	if (RETCODE_OK != rc)
+	{
+		CountFailures(state, rc, 1);
+	}
+}
+
+void LinkHealth_RecordCompletion(LinkHealth_Transport_T transport,
+		Retcode_T rc)
+{
+	assert(LINK_HEALTH_TRANSPORT_MAX > transport);
+
+	if (RETCODE_OK != rc)
+	{
+		__atomic_store_n(&CompletionErrors[transport], rc, __ATOMIC_RELAXED);
+		(void) __atomic_fetch_add(&CompletionFailures[transport], 1,
+		__ATOMIC_RELAXED);
+	}
+}
+
+bool LinkHealth_Update(uint32_t now, uint32_t periodUs)
+{
+	bool isChanged = false;
+
+	if (0 == WindowStart)
+	{
+		/* Never 0, that marks no window started. */
+		WindowStart = now | UINT32_C(1);
+		return false;
+	}
+	if (now - WindowStart < LINK_HEALTH_WINDOW_US)
+	{
+		return false;
+	}
+	WindowStart = now | UINT32_C(1);
+
+	for (uint32_t i = 0; i < LINK_HEALTH_TRANSPORT_MAX; i++)
+	{
+		LinkHealth_State_T* state = &States[i];
+		uint32_t previousLevel = state->Level;
+		uint32_t completionFailures = __atomic_exchange_n(
+				&CompletionFailures[i], 0, __ATOMIC_RELAXED);
+
+		if (0 != completionFailures)
+		{
+			CountFailures(state,
+					__atomic_load_n(&CompletionErrors[i], __ATOMIC_RELAXED),
+					completionFailures);
+		}
+
+		if (IsCongested(&state->Window, periodUs))
+		{
+			state->CleanWindows = 0;
+			if (state->Level < state->MaxLevel)
+			{
+				state->Level++;
+			}
+		}
+		else if (0 == state->Window.Failures && 0 != state->Window.Sends)
+		{
+			state->CleanWindows++;
+			if (LINK_HEALTH_RECOVERY_WINDOWS <= state->CleanWindows
+					&& 0 != state->Level)
+			{
+				state->Level--;
+				state->CleanWindows = 0;
+			}
+		}
+		else
+		{
+			/* Idle or a few failures, neither worse nor better. */
+			state->CleanWindows = 0;
+		}
+
+		if (previousLevel != state->Level)
+		{
+			isChanged = true;
+			(void) PublishLevel((LinkHealth_Transport_T) i, previousLevel);
+		}
+
+		if (0 == state->Window.Failures && 0 != state->StormFailures)
+		{
+			(void) PublishStorm((LinkHealth_Transport_T) i, now);
+			state->StormFailures = 0;
+		}
+
+		memset(&state->Window, 0, sizeof(state->Window));
+	}
+
+	return isChanged;
+}
+
+uint32_t LinkHealth_GetLevel(LinkHealth_Transport_T transport)
+{
+	assert(LINK_HEALTH_TRANSPORT_MAX > transport);
+	return States[transport].Level;
+}
@@ -32,9 +32,10 @@
 #include "BCDS_Retcode.h"
 #include "BCDS_CmdProcessor.h"
 
-#define LOGGER_LOG_BUFFER_SIZE	(UINT32_C(1024))
+#include "XdkSerialMux.h"
 
-static char LogBuffer[LOGGER_LOG_BUFFER_SIZE];
+static const char* const LevelNames[LOG_LEVEL_COUNT] =
+{ NULL, "FATAL", "ERROR", "WARNING", "INFO", "DEBUG" };
 
 Retcode_T Logger_Initialize(void)
 {
@@ -49,34 +50,48 @@ void Logger_Log(LogLevel_T level, uint8_t package, uint8_t module,
 	BCDS_UNUSED(package);
 	BCDS_UNUSED(module);
 
-	va_list args;
-	va_start(args, fmt);
-	int len = vsnprintf(LogBuffer, sizeof(LogBuffer), fmt, args);
-	va_end(args);
+	if (LOG_LEVEL_COUNT <= level)
+	{
+		return;
+	}
 
-	switch (level)
+	/* Format straight into a log channel slot, dropped if none is free. */
+	SerialMux_Line_T* logLine = SerialMux_Reserve(SERIAL_MUX_CHANNEL_LOG);
+	if (NULL == logLine)
 	{
-	case LOG_LEVEL_NONE:
-		printf("%.*s", len, LogBuffer);
-		break;
-	case LOG_LEVEL_FATAL:
-		printf("FATAL: %.*s -> %s:%"PRIu32"\n", len, LogBuffer, file, line);
-		break;
-	case LOG_LEVEL_ERROR:
-		printf("ERROR: %.*s -> %s:%"PRIu32"\n", len, LogBuffer, file, line);
-		break;
-	case LOG_LEVEL_WARNING:
-		printf("WARNING: %.*s\n", len, LogBuffer);
-		break;
-	case LOG_LEVEL_INFO:
-		printf("INFO: %.*s\n", len, LogBuffer);
-		break;
-	case LOG_LEVEL_DEBUG:
-		printf("DEBUG: %.*s\n", len, LogBuffer);
-		break;
-	default:
-		break;
+		return;
 	}
+
+	char* text = logLine->Text;
+	size_t size = sizeof(logLine->Text);
+	size_t len = 0;
+	int written = 0;
+
+	if (NULL != LevelNames[level])
+	{
+		written = snprintf(text, size, "%s: ", LevelNames[level]);
+		len += (written > 0) ? (size_t) written : 0;
+	}
+
+	if (len < size)
+	{
+		va_list args;
+		va_start(args, fmt);
+		written = vsnprintf(text + len, size - len, fmt, args);
+		va_end(args);
+		len += (written > 0) ? (size_t) written : 0;
+	}
+
+	if (len < size
+			&& (LOG_LEVEL_FATAL == level || LOG_LEVEL_ERROR == level))
+	{
+		written = snprintf(text + len, size - len, " -> %s:%"PRIu32, file,
+				line);
+		len += (written > 0) ? (size_t) written : 0;
+	}
+
+	logLine->Length = (len < size) ? len : size - 1;
+	SerialMux_Commit(logLine);
 }
 
 Retcode_T Logger_Deinitialize(void)
@@ -62,6 +62,35 @@
 
 static CmdProcessor_T MainCmdProcessor;
 
+#if APP_USE_STATIC_ALLOCATION
+#if (1 != configSUPPORT_STATIC_ALLOCATION)
+#error "APP_USE_STATIC_ALLOCATION needs configSUPPORT_STATIC_ALLOCATION"
+#endif
+
+static StaticTask_t IdleTaskBuffer;
+static StackType_t IdleTaskStack[configMINIMAL_STACK_SIZE];
+static StaticTask_t TimerTaskBuffer;
+static StackType_t TimerTaskStack[configTIMER_TASK_STACK_DEPTH];
+
+/* With static allocation supported, FreeRTOS takes the memory of its own
+ * idle and timer tasks from the application. */
+void vApplicationGetIdleTaskMemory(StaticTask_t** taskBuffer,
+		StackType_t** stack, uint32_t* stackSize)
+{
+	*taskBuffer = &IdleTaskBuffer;
+	*stack = IdleTaskStack;
+	*stackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t** taskBuffer,
+		StackType_t** stack, uint32_t* stackSize)
+{
+	*taskBuffer = &TimerTaskBuffer;
+	*stack = TimerTaskStack;
+	*stackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
 int main(void)
 {
 	Retcode_T rc = Retcode_Initialize(DefaultErrorHandlingFunc);
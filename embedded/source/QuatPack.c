@@ -0,0 +1,75 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_QUATPACK
+
+#include "XdkQuatPack.h"
+
+#include "BCDS_Basics.h"
+
+static int16_t Quantize(float value);
+
+static int16_t Quantize(float value)
+{
+	float scaled = value * QUAT_PACK_SCALE;
+	if (scaled > INT16_MAX)
+	{
+		scaled = INT16_MAX;
+	}
+	else if (scaled < -INT16_MAX)
+	{
+		scaled = -INT16_MAX;
+	}
+	return (int16_t) (scaled + ((scaled >= 0.0f) ? 0.5f : -0.5f));
+}
+
+QuatPack_Component_T QuatPack_Pack(float w, float x, float y, float z,
+		int16_t packed[3])
+{
+	const float components[QUAT_PACK_COMPONENT_MAX] =
+	{ w, x, y, z };
+	uint32_t largest = QUAT_PACK_COMPONENT_W;
+	float largestMagnitude = (w >= 0.0f) ? w : -w;
+
+	for (uint32_t i = QUAT_PACK_COMPONENT_X; i < QUAT_PACK_COMPONENT_MAX; i++)
+	{
+		float magnitude =
+				(components[i] >= 0.0f) ? components[i] : -components[i];
+		if (magnitude > largestMagnitude)
+		{
+			largest = i;
+			largestMagnitude = magnitude;
+		}
+	}
+
+	float sign = (components[largest] >= 0.0f) ? 1.0f : -1.0f;
+	uint32_t j = 0;
+	for (uint32_t i = QUAT_PACK_COMPONENT_W; i < QUAT_PACK_COMPONENT_MAX; i++)
+	{
+		if (i != largest)
+		{
+			packed[j++] = Quantize(sign * components[i]);
+		}
+	}
+
+	return (QuatPack_Component_T) largest;
+}
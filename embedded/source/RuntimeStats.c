@@ -0,0 +1,299 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_RUNTIMESTATS
+
+#include "XdkRuntimeStats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_CmdProcessor.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+#include "timers.h"
+
+#include "XdkSerialMux.h"
+
+#define RUNTIME_STATS_LINE_PREFIX			"RTS "
+#define RUNTIME_STATS_LINE_PREFIX_LENGTH	(sizeof(RUNTIME_STATS_LINE_PREFIX) - 1)
+/* A sample takes several stats lines, which are dropped while the queue of
+ * the serial mux is full. Give the writer task a moment to catch up. */
+#define RUNTIME_STATS_RESERVE_RETRIES		(UINT32_C(10))
+#define RUNTIME_STATS_RESERVE_RETRY_MS		(UINT32_C(2))
+#define RUNTIME_STATS_PERMILLE				(UINT32_C(1000))
+
+static void HandleSampleTimer(TimerHandle_t timer);
+static void RunPublish(void* param1, uint32_t param2);
+static Retcode_T PublishRecord(const void* record, uint32_t size);
+static uint16_t GetCpuShare(const TaskStatus_t* task, uint32_t totalRunTime);
+
+static const char HexDigits[] = "0123456789ABCDEF";
+
+static const CmdProcessor_T* CmdProcessor = NULL;
+static TimerHandle_t SampleTimer = NULL;
+#if APP_USE_STATIC_ALLOCATION
+static StaticTimer_t SampleTimerBuffer;
+#endif
+
+/* Only touched on the command processor. */
+static uint8_t Sample = 0;
+static TaskStatus_t TaskStatus[RUNTIME_STATS_MAX_TASKS];
+static UBaseType_t PreviousTaskNumbers[RUNTIME_STATS_MAX_TASKS];
+static uint32_t PreviousRunTimes[RUNTIME_STATS_MAX_TASKS];
+static uint32_t PreviousTaskCount = 0;
+static uint32_t PreviousTotalRunTime = 0;
+static TickType_t PreviousSampleTime = 0;
+
+static void HandleSampleTimer(TimerHandle_t timer)
+{
+	BCDS_UNUSED(timer);
+	/* Skipped if the command processor is busy, the next one will do. */
+	(void) CmdProcessor_Enqueue((CmdProcessor_T*) CmdProcessor, RunPublish,
+			NULL, 0);
+}
+
+static void RunPublish(void* param1, uint32_t param2)
+{
+	BCDS_UNUSED(param1);
+	BCDS_UNUSED(param2);
+	(void) RuntimeStats_Publish();
+}
+
+static Retcode_T PublishRecord(const void* record, uint32_t size)
+{
+	Retcode_T rc = RETCODE_OK;
+	SerialMux_Line_T* line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+
+	for (uint32_t i = 0; NULL == line && i < RUNTIME_STATS_RESERVE_RETRIES;
+			i++)
+	{
+		vTaskDelay(pdMS_TO_TICKS(RUNTIME_STATS_RESERVE_RETRY_MS));
+		line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+	}
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		const uint8_t* bytes = record;
+		char* text = line->Text;
+		memcpy(text, RUNTIME_STATS_LINE_PREFIX,
+				RUNTIME_STATS_LINE_PREFIX_LENGTH);
+		text += RUNTIME_STATS_LINE_PREFIX_LENGTH;
+		for (uint32_t i = 0; i < size; i++)
+		{
+			*text++ = HexDigits[bytes[i] >> 4];
+			*text++ = HexDigits[bytes[i] & 0x0F];
+		}
+		line->Length = (uint32_t) (text - line->Text);
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
+
+static uint16_t GetCpuShare(const TaskStatus_t* task, uint32_t totalRunTime)
+{
+	uint16_t share = RUNTIME_STATS_CPU_SHARE_UNKNOWN;
+#if (1 == configGENERATE_RUN_TIME_STATS)
+	/* Tasks created since the previous sample count from zero. */
+	uint32_t previousRunTime = 0;
+	for (uint32_t i = 0; i < PreviousTaskCount; i++)
+	{
+		if (PreviousTaskNumbers[i] == task->xTaskNumber)
+		{
+			previousRunTime = PreviousRunTimes[i];
+			break;
+		}
+	}
+
+	uint32_t total = totalRunTime - PreviousTotalRunTime;
+	uint32_t used = task->ulRunTimeCounter - previousRunTime;
+	share = 0;
+	if (0 != total)
+	{
+		uint64_t permille = ((uint64_t) used * RUNTIME_STATS_PERMILLE) / total;
+		share = (uint16_t) (
+				(permille < RUNTIME_STATS_PERMILLE) ?
+						permille : RUNTIME_STATS_PERMILLE);
+	}
+#else
+	BCDS_UNUSED(task);
+	BCDS_UNUSED(totalRunTime);
+#endif
+	return share;
+}
+
+Retcode_T RuntimeStats_Initialize(const CmdProcessor_T* cmdProcessor,
+		TickType_t interval)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (NULL == cmdProcessor)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		CmdProcessor = cmdProcessor;
+		PreviousSampleTime = xTaskGetTickCount();
+	}
+
+	if (RETCODE_OK == rc && 0 != interval && NULL == SampleTimer)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		SampleTimer = xTimerCreateStatic("RUNTIME_STATS", interval, pdTRUE,
+				NULL, HandleSampleTimer, &SampleTimerBuffer);
+#else
+		SampleTimer = xTimerCreate("RUNTIME_STATS", interval, pdTRUE, NULL,
+				HandleSampleTimer);
+#endif
+		if (NULL == SampleTimer)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+		else if (pdPASS != xTimerStart(SampleTimer, portMAX_DELAY))
+		{
+			rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+		}
+	}
+
+	return rc;
+}
+
+Retcode_T RuntimeStats_Publish(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	RuntimeStats_SystemRecord_T system;
+	RuntimeStats_TaskRecord_T tasks;
+	uint32_t totalRunTime = 0;
+	uint32_t taskCount = 0;
+	TickType_t now = xTaskGetTickCount();
+
+	if (NULL == CmdProcessor)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_UNINITIALIZED);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+#if (1 == configUSE_TRACE_FACILITY)
+		/* Fails as a whole if there are more tasks than entries. */
+		taskCount = uxTaskGetSystemState(TaskStatus, RUNTIME_STATS_MAX_TASKS,
+				&totalRunTime);
+#endif
+		Sample++;
+
+		memset(&system, 0, sizeof(system));
+		system.Type = RUNTIME_STATS_RECORD_SYSTEM;
+		system.Sample = Sample;
+#if (1 == configGENERATE_RUN_TIME_STATS)
+		system.Flags |= RUNTIME_STATS_FLAG_CPU_SHARE;
+#endif
+		if (uxTaskGetNumberOfTasks() > taskCount)
+		{
+			system.Flags |= RUNTIME_STATS_FLAG_TASKS_TRUNCATED;
+		}
+		system.TaskCount = (uint8_t) taskCount;
+		system.UptimeMs = now * portTICK_PERIOD_MS;
+		system.IntervalMs = (now - PreviousSampleTime) * portTICK_PERIOD_MS;
+		system.FreeHeap = xPortGetFreeHeapSize();
+		system.MinimumEverFreeHeap = xPortGetMinimumEverFreeHeapSize();
+		system.CmdQueueDepth = (uint8_t) uxQueueMessagesWaiting(
+				CmdProcessor->queue);
+		system.CmdQueueLength = (uint8_t) (system.CmdQueueDepth
+				+ uxQueueSpacesAvailable(CmdProcessor->queue));
+		system.SerialQueueDepth = (uint8_t) SerialMux_GetQueueDepth();
+		system.SerialQueueLength = (uint8_t) SERIAL_MUX_SLOT_COUNT;
+
+		rc = PublishRecord(&system, sizeof(system));
+	}
+
+	for (uint32_t first = 0; RETCODE_OK == rc && first < taskCount;
+			first += RUNTIME_STATS_TASKS_PER_RECORD)
+	{
+		memset(&tasks, 0, sizeof(tasks));
+		tasks.Type = RUNTIME_STATS_RECORD_TASKS;
+		tasks.Sample = Sample;
+		tasks.FirstIndex = (uint8_t) first;
+		while (tasks.Count < RUNTIME_STATS_TASKS_PER_RECORD
+				&& first + tasks.Count < taskCount)
+		{
+			const TaskStatus_t* status = &TaskStatus[first + tasks.Count];
+			RuntimeStats_TaskEntry_T* entry = &tasks.Tasks[tasks.Count];
+			entry->Number = (uint8_t) status->xTaskNumber;
+			entry->State = (uint8_t) status->eCurrentState;
+			entry->Priority = (uint8_t) status->uxCurrentPriority;
+			entry->CpuShare = GetCpuShare(status, totalRunTime);
+			entry->StackHighWaterMark = status->usStackHighWaterMark;
+			strncpy(entry->Name, status->pcTaskName,
+					RUNTIME_STATS_TASK_NAME_LENGTH);
+			tasks.Count++;
+		}
+
+		rc = PublishRecord(&tasks,
+				offsetof(RuntimeStats_TaskRecord_T, Tasks)
+						+ tasks.Count * sizeof(RuntimeStats_TaskEntry_T));
+	}
+
+	/* Also if lines were dropped, the next shares are relative to this. */
+	if (NULL != CmdProcessor)
+	{
+		for (uint32_t i = 0; i < taskCount; i++)
+		{
+			PreviousTaskNumbers[i] = TaskStatus[i].xTaskNumber;
+			PreviousRunTimes[i] = TaskStatus[i].ulRunTimeCounter;
+		}
+		PreviousTaskCount = taskCount;
+		PreviousTotalRunTime = totalRunTime;
+		PreviousSampleTime = now;
+	}
+
+	return rc;
+}
+
+Retcode_T RuntimeStats_HandleStatsCommand(const char* args,
+		uint32_t receivedAt)
+{
+	BCDS_UNUSED(args);
+	BCDS_UNUSED(receivedAt);
+
+	Retcode_T rc = RuntimeStats_Publish();
+
+	/* Tells the host which sample to wait for, even if lines were lost. */
+	Retcode_T replyRc = SerialMux_Printf(SERIAL_MUX_CHANNEL_RESPONSE,
+			"STATS %u", (unsigned int) Sample);
+	if (RETCODE_OK == rc)
+	{
+		rc = replyRc;
+	}
+
+	return rc;
+}
@@ -0,0 +1,286 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_SAMPLESCHEDULER
+
+#include "XdkSampleScheduler.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+#include "XdkSerialMux.h"
+#include "XdkTextFormat.h"
+#include "XdkTimeSync.h"
+
+/* Burst periods in a row before the rest is skipped after all. */
+#define SAMPLE_SCHEDULER_MAX_BURST_LENGTH	(UINT32_C(5))
+#define SAMPLE_SCHEDULER_TICK_PERIOD_US		(UINT32_C(1000000) / configTICK_RATE_HZ)
+
+static void HandleStatsTimer(TimerHandle_t timer);
+static uint32_t ToBucket(uint32_t valueUs);
+static Retcode_T PublishLine(const char* name, const uint32_t* values,
+		uint32_t count);
+
+static const uint32_t BucketLimits[SAMPLE_SCHEDULER_BUCKET_COUNT] =
+SAMPLE_SCHEDULER_BUCKET_LIMITS_US;
+
+static TickType_t Period = 1;
+static SampleScheduler_CatchUp_T CatchUp = SAMPLE_SCHEDULER_CATCH_UP_SKIP;
+static TimerHandle_t StatsTimer = NULL;
+#if APP_USE_STATIC_ALLOCATION
+static StaticTimer_t StatsTimerBuffer;
+#endif
+
+/* Only touched by the sampling task. */
+static TickType_t NextRelease = 0;
+static uint32_t PeriodStartTime = 0;
+static uint32_t BurstLength = 0;
+
+/* Written by the sampling task, read by others in a critical section. */
+static SampleScheduler_Stats_T Stats;
+
+static uint32_t ToBucket(uint32_t valueUs)
+{
+	uint32_t bucket = 0;
+	while (bucket < SAMPLE_SCHEDULER_BUCKET_COUNT - 1
+			&& valueUs >= BucketLimits[bucket])
+	{
+		bucket++;
+	}
+	return bucket;
+}
+
+static void HandleStatsTimer(TimerHandle_t timer)
+{
+	BCDS_UNUSED(timer);
+	(void) SampleScheduler_PublishStats();
+}
+
+Retcode_T SampleScheduler_Initialize(TickType_t period,
+		SampleScheduler_CatchUp_T catchUp, TickType_t statsInterval)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (0 == period || SAMPLE_SCHEDULER_CATCH_UP_MAX <= catchUp)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		Period = period;
+		CatchUp = catchUp;
+		memset(&Stats, 0, sizeof(Stats));
+	}
+
+	if (RETCODE_OK == rc && 0 != statsInterval && NULL == StatsTimer)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		StatsTimer = xTimerCreateStatic("SCHED_STATS", statsInterval, pdTRUE,
+				NULL, HandleStatsTimer, &StatsTimerBuffer);
+#else
+		StatsTimer = xTimerCreate("SCHED_STATS", statsInterval, pdTRUE, NULL,
+				HandleStatsTimer);
+#endif
+		if (NULL == StatsTimer)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+		else if (pdPASS != xTimerStart(StatsTimer, portMAX_DELAY))
+		{
+			rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_FAILURE);
+		}
+	}
+
+	return rc;
+}
+
+void SampleScheduler_Start(void)
+{
+	PeriodStartTime = TimeSync_GetDeviceTime();
+	NextRelease = xTaskGetTickCount() + Period;
+	BurstLength = 0;
+}
+
+Retcode_T SampleScheduler_SetPeriod(TickType_t period)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (0 == period)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_INVALID_PARAM);
+	}
+	else
+	{
+		Period = period;
+	}
+
+	return rc;
+}
+
+void SampleScheduler_WaitForNextPeriod(Retcode_T rc)
+{
+	uint32_t executionUs = TimeSync_GetDeviceTime() - PeriodStartTime;
+	TickType_t late = xTaskGetTickCount() - NextRelease;
+	bool isOverrun = ((int32_t) late > 0);
+	bool isBurst = false;
+	uint32_t skipped = 0;
+
+	if (!isOverrun)
+	{
+		BurstLength = 0;
+	}
+	else if (SAMPLE_SCHEDULER_CATCH_UP_BURST == CatchUp
+			&& BurstLength < SAMPLE_SCHEDULER_MAX_BURST_LENGTH)
+	{
+		/* Run the period that is due right away. */
+		BurstLength++;
+		isBurst = true;
+	}
+	else
+	{
+		/* Continue with the first period that is not due yet. */
+		skipped = late / Period + 1;
+		NextRelease += skipped * Period;
+		BurstLength = 0;
+	}
+
+	if (!isBurst)
+	{
+		TickType_t previousRelease = NextRelease - Period;
+		vTaskDelayUntil(&previousRelease, Period);
+	}
+
+	uint32_t wakeTime = TimeSync_GetDeviceTime();
+	uint32_t jitterUs = wakeTime - NextRelease * SAMPLE_SCHEDULER_TICK_PERIOD_US;
+	if ((int32_t) jitterUs < 0)
+	{
+		jitterUs = 0;
+	}
+
+	taskENTER_CRITICAL();
+	Stats.Periods++;
+	if (RETCODE_OK != rc)
+	{
+		Stats.Failures++;
+	}
+	if (isOverrun)
+	{
+		Stats.Overruns++;
+	}
+	if (isBurst)
+	{
+		Stats.Bursts++;
+	}
+	Stats.Skipped += skipped;
+	Stats.ExecutionHistogram[ToBucket(executionUs)]++;
+	if (executionUs > Stats.MaxExecutionUs)
+	{
+		Stats.MaxExecutionUs = executionUs;
+	}
+	Stats.JitterHistogram[ToBucket(jitterUs)]++;
+	if (jitterUs > Stats.MaxJitterUs)
+	{
+		Stats.MaxJitterUs = jitterUs;
+	}
+	taskEXIT_CRITICAL();
+
+	PeriodStartTime = wakeTime;
+	NextRelease += Period;
+}
+
+void SampleScheduler_GetStats(SampleScheduler_Stats_T* stats)
+{
+	assert(NULL != stats);
+	taskENTER_CRITICAL();
+	*stats = Stats;
+	taskEXIT_CRITICAL();
+}
+
+static Retcode_T PublishLine(const char* name, const uint32_t* values,
+		uint32_t count)
+{
+	Retcode_T rc = RETCODE_OK;
+	SerialMux_Line_T* line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_STATS);
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		uint32_t length = strlen(name);
+		memcpy(line->Text, name, length);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			line->Text[length++] = ' ';
+			length += TextFormat_FormatUnsigned(line->Text + length, values[i]);
+		}
+		line->Length = length;
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
+
+Retcode_T SampleScheduler_PublishStats(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	SampleScheduler_Stats_T stats;
+	uint32_t values[SAMPLE_SCHEDULER_BUCKET_COUNT + 1];
+
+	SampleScheduler_GetStats(&stats);
+
+	/* One line each, the histograms would not fit a single one. */
+	values[0] = stats.Periods;
+	values[1] = stats.Failures;
+	values[2] = stats.Overruns;
+	values[3] = stats.Skipped;
+	values[4] = stats.Bursts;
+	rc = PublishLine("SCHED", values, 5);
+
+	if (RETCODE_OK == rc)
+	{
+		values[0] = stats.MaxJitterUs;
+		memcpy(&values[1], stats.JitterHistogram,
+				sizeof(stats.JitterHistogram));
+		rc = PublishLine("SCHED_JITTER", values,
+		SAMPLE_SCHEDULER_BUCKET_COUNT + 1);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		values[0] = stats.MaxExecutionUs;
+		memcpy(&values[1], stats.ExecutionHistogram,
+				sizeof(stats.ExecutionHistogram));
+		rc = PublishLine("SCHED_EXEC", values,
+		SAMPLE_SCHEDULER_BUCKET_COUNT + 1);
+	}
+
+	return rc;
+}
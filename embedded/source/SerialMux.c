@@ -0,0 +1,331 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_SERIALMUX
+
+#include "XdkSerialMux.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+/* Free slots log lines may not take, kept for stats and responses. */
+#define SERIAL_MUX_LOG_RESERVED_SLOTS		(UINT32_C(2))
+#define SERIAL_MUX_RESPONSE_TIMEOUT_MS		(UINT32_C(100))
+
+/* Below the poll task, so tracking lines always go first. */
+#define SERIAL_MUX_WRITER_TASK_STACK_SIZE	(UINT32_C(256))
+#define SERIAL_MUX_WRITER_TASK_PRIO			(UINT32_C(1))
+
+static void RunWriterLoop(void* param1);
+static void WriteLine(const char* tag, const char* text, uint32_t length);
+static void CountDropped(SerialMux_Channel_T channel);
+
+static const char* const ChannelTags[SERIAL_MUX_CHANNEL_MAX] =
+{ NULL, ">>LOG: ", ">>STAT: ", ">>RESP: " };
+
+static SerialMux_Line_T Lines[SERIAL_MUX_SLOT_COUNT];
+static uint32_t DroppedCounts[SERIAL_MUX_CHANNEL_MAX];
+static SemaphoreHandle_t WriteLock = NULL;
+static QueueHandle_t FreeSlots = NULL;
+static QueueHandle_t PendingSlots = NULL;
+static TaskHandle_t WriterTask = NULL;
+
+#if APP_USE_STATIC_ALLOCATION
+static StaticSemaphore_t WriteLockBuffer;
+static uint8_t FreeSlotsStorage[SERIAL_MUX_SLOT_COUNT];
+static StaticQueue_t FreeSlotsBuffer;
+static uint8_t PendingSlotsStorage[SERIAL_MUX_SLOT_COUNT];
+static StaticQueue_t PendingSlotsBuffer;
+static StackType_t WriterTaskStack[SERIAL_MUX_WRITER_TASK_STACK_SIZE];
+static StaticTask_t WriterTaskBuffer;
+#endif
+
+static void WriteLine(const char* tag, const char* text, uint32_t length)
+{
+	if (NULL != WriteLock)
+	{
+		(void) xSemaphoreTake(WriteLock, portMAX_DELAY);
+	}
+
+	if (NULL != tag)
+	{
+		(void) fputs(tag, stdout);
+	}
+	(void) fwrite(text, sizeof(char), length, stdout);
+	if (NULL != tag)
+	{
+		(void) fputc('\n', stdout);
+	}
+	(void) fflush(stdout);
+
+	if (NULL != WriteLock)
+	{
+		(void) xSemaphoreGive(WriteLock);
+	}
+}
+
+static void CountDropped(SerialMux_Channel_T channel)
+{
+	taskENTER_CRITICAL();
+	DroppedCounts[channel]++;
+	taskEXIT_CRITICAL();
+}
+
+static void RunWriterLoop(void* param1)
+{
+	BCDS_UNUSED(param1);
+	uint8_t index;
+
+	while (1)
+	{
+		if (pdTRUE == xQueueReceive(PendingSlots, &index, portMAX_DELAY))
+		{
+			SerialMux_Line_T* line = &Lines[index];
+			WriteLine(ChannelTags[line->Channel], line->Text, line->Length);
+			(void) xQueueSend(FreeSlots, &index, 0);
+		}
+	}
+}
+
+Retcode_T SerialMux_Initialize(void)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (NULL == WriteLock)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		WriteLock = xSemaphoreCreateMutexStatic(&WriteLockBuffer);
+#else
+		WriteLock = xSemaphoreCreateMutex();
+#endif
+		if (NULL == WriteLock)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+	}
+
+	if (RETCODE_OK == rc && NULL == FreeSlots)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		FreeSlots = xQueueCreateStatic(SERIAL_MUX_SLOT_COUNT, sizeof(uint8_t),
+				FreeSlotsStorage, &FreeSlotsBuffer);
+#else
+		FreeSlots = xQueueCreate(SERIAL_MUX_SLOT_COUNT, sizeof(uint8_t));
+#endif
+		if (NULL == FreeSlots)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+		for (uint8_t i = 0; RETCODE_OK == rc && i < SERIAL_MUX_SLOT_COUNT;
+				i++)
+		{
+			(void) xQueueSend(FreeSlots, &i, 0);
+		}
+	}
+
+	if (RETCODE_OK == rc && NULL == PendingSlots)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		PendingSlots = xQueueCreateStatic(SERIAL_MUX_SLOT_COUNT,
+				sizeof(uint8_t), PendingSlotsStorage, &PendingSlotsBuffer);
+#else
+		PendingSlots = xQueueCreate(SERIAL_MUX_SLOT_COUNT, sizeof(uint8_t));
+#endif
+		if (NULL == PendingSlots)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+	}
+
+	if (RETCODE_OK == rc && NULL == WriterTask)
+	{
+#if APP_USE_STATIC_ALLOCATION
+		WriterTask = xTaskCreateStatic(RunWriterLoop, "SERIAL_MUX",
+				SERIAL_MUX_WRITER_TASK_STACK_SIZE, NULL,
+				SERIAL_MUX_WRITER_TASK_PRIO, WriterTaskStack, &WriterTaskBuffer);
+		BaseType_t taskCreated = (NULL != WriterTask) ? pdTRUE : pdFALSE;
+#else
+		BaseType_t taskCreated = xTaskCreate(RunWriterLoop, "SERIAL_MUX",
+				SERIAL_MUX_WRITER_TASK_STACK_SIZE, NULL,
+				SERIAL_MUX_WRITER_TASK_PRIO, &WriterTask);
+#endif
+		if (pdTRUE != taskCreated)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_FATAL, RETCODE_OUT_OF_RESOURCES);
+		}
+	}
+
+	return rc;
+}
+
+Retcode_T SerialMux_Write(SerialMux_Channel_T channel, const char* text,
+		uint32_t length)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (SERIAL_MUX_CHANNEL_TRACKING == channel)
+	{
+		WriteLine(NULL, text, length);
+	}
+	else
+	{
+		SerialMux_Line_T* line = SerialMux_Reserve(channel);
+		if (NULL == line)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+		}
+		else
+		{
+			line->Length = (length < SERIAL_MUX_LINE_SIZE) ?
+					length : SERIAL_MUX_LINE_SIZE;
+			memcpy(line->Text, text, line->Length);
+			SerialMux_Commit(line);
+		}
+	}
+
+	return rc;
+}
+
+Retcode_T SerialMux_Printf(SerialMux_Channel_T channel, const char* fmt, ...)
+{
+	Retcode_T rc = RETCODE_OK;
+	SerialMux_Line_T* line = SerialMux_Reserve(channel);
+
+	if (NULL == line)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+	}
+	else
+	{
+		va_list args;
+		va_start(args, fmt);
+		int len = vsnprintf(line->Text, sizeof(line->Text), fmt, args);
+		va_end(args);
+		/* On truncation len is the length the line would have had and the
+		 * last char is the terminating zero. Drop it, the writer task ends
+		 * the line with '\n'. */
+		line->Length = (len > 0) ? (uint32_t) len : 0;
+		if (line->Length > sizeof(line->Text) - 1)
+		{
+			line->Length = sizeof(line->Text) - 1;
+		}
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
+
+SerialMux_Line_T* SerialMux_Reserve(SerialMux_Channel_T channel)
+{
+	SerialMux_Line_T* line = NULL;
+	uint8_t index;
+	TickType_t timeout = 0;
+	bool mayTakeSlot = true;
+
+	if (SERIAL_MUX_CHANNEL_TRACKING == channel
+			|| SERIAL_MUX_CHANNEL_MAX <= channel)
+	{
+		return NULL;
+	}
+
+	if (NULL == FreeSlots)
+	{
+		mayTakeSlot = false;
+	}
+	else if (SERIAL_MUX_CHANNEL_LOG == channel)
+	{
+		mayTakeSlot = uxQueueMessagesWaiting(FreeSlots)
+				> SERIAL_MUX_LOG_RESERVED_SLOTS;
+	}
+	else if (SERIAL_MUX_CHANNEL_RESPONSE == channel)
+	{
+		timeout = pdMS_TO_TICKS(SERIAL_MUX_RESPONSE_TIMEOUT_MS);
+	}
+
+	if (mayTakeSlot && pdTRUE == xQueueReceive(FreeSlots, &index, timeout))
+	{
+		line = &Lines[index];
+		line->Channel = channel;
+		line->Length = 0;
+	}
+	else
+	{
+		CountDropped(channel);
+	}
+
+	return line;
+}
+
+void SerialMux_Commit(SerialMux_Line_T* line)
+{
+	assert(NULL != line);
+	uint8_t index = (uint8_t) (line - Lines);
+
+	if (line->Length > SERIAL_MUX_LINE_SIZE)
+	{
+		line->Length = SERIAL_MUX_LINE_SIZE;
+	}
+	/* One record per line, the writer adds the line feed. */
+	while (line->Length > 0
+			&& ('\n' == line->Text[line->Length - 1]
+					|| '\r' == line->Text[line->Length - 1]))
+	{
+		line->Length--;
+	}
+	for (uint32_t i = 0; i < line->Length; i++)
+	{
+		if ('\n' == line->Text[i] || '\r' == line->Text[i])
+		{
+			line->Text[i] = ' ';
+		}
+	}
+
+	(void) xQueueSend(PendingSlots, &index, 0);
+}
+
+uint32_t SerialMux_GetDroppedCount(SerialMux_Channel_T channel)
+{
+	uint32_t count = 0;
+	if (SERIAL_MUX_CHANNEL_MAX > channel)
+	{
+		count = DroppedCounts[channel];
+	}
+	return count;
+}
+
+uint32_t SerialMux_GetQueueDepth(void)
+{
+	uint32_t depth = 0;
+	if (NULL != FreeSlots)
+	{
+		depth = SERIAL_MUX_SLOT_COUNT - uxQueueMessagesWaiting(FreeSlots);
+	}
+	return depth;
+}
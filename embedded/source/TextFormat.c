@@ -0,0 +1,340 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_TEXTFORMAT
+
+#include "XdkTextFormat.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#if TEXT_FORMAT_ENABLE_BENCHMARK
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "em_device.h"
+
+#include "XdkLogger.h"
+#endif
+
+#define FLOAT_SIGN_MASK			(UINT32_C(0x80000000))
+#define FLOAT_EXPONENT_SHIFT	(UINT32_C(23))
+#define FLOAT_EXPONENT_MASK		(UINT32_C(0xFF))
+#define FLOAT_MANTISSA_MASK		(UINT32_C(0x7FFFFF))
+#define FLOAT_IMPLICIT_BIT		(UINT32_C(0x800000))
+#define FLOAT_EXPONENT_BIAS		(INT32_C(150))
+#define FLOAT_DENORMAL_SHIFT	(INT32_C(-149))
+
+/* mantissa << 40 still fits into 64 bit, fractions below 2^-44 round to 0 */
+#define MAX_INTEGER_SHIFT		(INT32_C(40))
+#define MIN_FRACTION_SHIFT		(INT32_C(-44))
+
+#define FRACTION_DIGITS			(UINT32_C(6))
+#define FRACTION_SCALE			(UINT32_C(1000000))
+
+#define LARGE_MAX_DIGITS		(UINT32_C(39))
+
+static uint32_t WriteUnsigned(char* buffer, uint64_t value);
+static uint32_t WriteFraction(char* buffer, uint32_t fraction);
+static uint32_t WriteLarge(char* buffer, uint32_t mantissa, int32_t shift);
+
+static uint32_t WriteUnsigned(char* buffer, uint64_t value)
+{
+	char digits[20];
+	uint32_t count = 0;
+	uint32_t low = (uint32_t) value;
+
+	/* 64 bit division is a library call on the Cortex-M3, avoid it if possible */
+	while (value > UINT32_MAX)
+	{
+		digits[count++] = (char) ('0' + value % 10);
+		value /= 10;
+		low = (uint32_t) value;
+	}
+	do
+	{
+		digits[count++] = (char) ('0' + low % 10);
+		low /= 10;
+	} while (0 != low);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		buffer[i] = digits[count - 1 - i];
+	}
+	return count;
+}
+
+static uint32_t WriteFraction(char* buffer, uint32_t fraction)
+{
+	buffer[0] = '.';
+	for (uint32_t i = FRACTION_DIGITS; i > 0; i--)
+	{
+		buffer[i] = (char) ('0' + fraction % 10);
+		fraction /= 10;
+	}
+	return FRACTION_DIGITS + 1;
+}
+
+static uint32_t WriteLarge(char* buffer, uint32_t mantissa, int32_t shift)
+{
+	/* Integral values >= 2^64, only reachable for values far outside of any
+	 * quaternion. Doubles a little endian decimal number shift times. */
+	uint8_t digits[LARGE_MAX_DIGITS];
+	uint32_t count = 0;
+
+	while (0 != mantissa)
+	{
+		digits[count++] = (uint8_t) (mantissa % 10);
+		mantissa /= 10;
+	}
+	while (shift-- > 0)
+	{
+		uint8_t carry = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint8_t doubled = (uint8_t) (digits[i] * 2 + carry);
+			carry = (doubled >= 10) ? 1 : 0;
+			digits[i] = (uint8_t) (doubled - carry * 10);
+		}
+		if (0 != carry)
+		{
+			digits[count++] = carry;
+		}
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		buffer[i] = (char) ('0' + digits[count - 1 - i]);
+	}
+	return count + WriteFraction(buffer + count, 0);
+}
+
+uint32_t TextFormat_FormatFloat(char* buffer, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t exponent = (bits >> FLOAT_EXPONENT_SHIFT) & FLOAT_EXPONENT_MASK;
+	uint32_t mantissa = bits & FLOAT_MANTISSA_MASK;
+	char* cursor = buffer;
+
+	if (FLOAT_EXPONENT_MASK == exponent && 0 != mantissa)
+	{
+		/* newlib drops the sign of NaNs */
+		memcpy(cursor, "nan", 3);
+		return 3;
+	}
+
+	if (0 != (bits & FLOAT_SIGN_MASK))
+	{
+		*cursor++ = '-';
+	}
+
+	if (FLOAT_EXPONENT_MASK == exponent)
+	{
+		memcpy(cursor, "inf", 3);
+		return (uint32_t) (cursor - buffer) + 3;
+	}
+
+	/* value = mantissa * 2^shift */
+	int32_t shift = FLOAT_DENORMAL_SHIFT;
+	if (0 != exponent)
+	{
+		mantissa |= FLOAT_IMPLICIT_BIT;
+		shift = (int32_t) exponent - FLOAT_EXPONENT_BIAS;
+	}
+
+	uint64_t integer = 0;
+	uint32_t fraction = 0;
+	if (shift > MAX_INTEGER_SHIFT)
+	{
+		return (uint32_t) (cursor - buffer)
+				+ WriteLarge(cursor, mantissa, shift);
+	}
+	else if (shift >= 0)
+	{
+		integer = (uint64_t) mantissa << shift;
+	}
+	else if (shift >= MIN_FRACTION_SHIFT)
+	{
+		/* Scale the binary fraction by 10^6 and round half to even, exact
+		 * since mantissa * 10^6 < 2^44. */
+		uint32_t fractionBits = (uint32_t) -shift;
+		uint64_t fractionMask = ((uint64_t) 1 << fractionBits) - 1;
+		uint64_t half = (uint64_t) 1 << (fractionBits - 1);
+		uint64_t scaled = (mantissa & fractionMask) * (uint64_t) FRACTION_SCALE;
+		uint64_t remainder = scaled & fractionMask;
+
+		integer = (uint64_t) mantissa >> fractionBits;
+		fraction = (uint32_t) (scaled >> fractionBits);
+		if (remainder > half || (remainder == half && 0 != (fraction & 1)))
+		{
+			fraction++;
+		}
+		if (FRACTION_SCALE == fraction)
+		{
+			fraction = 0;
+			integer++;
+		}
+	}
+
+	cursor += WriteUnsigned(cursor, integer);
+	cursor += WriteFraction(cursor, fraction);
+	return (uint32_t) (cursor - buffer);
+}
+
+uint32_t TextFormat_FormatUnsigned(char* buffer, uint32_t value)
+{
+	return WriteUnsigned(buffer, value);
+}
+
+uint32_t TextFormat_FormatQuaternion(char* buffer, const char* tag, float w,
+		float x, float y, float z)
+{
+	const float values[] =
+	{ w, x, y, z };
+	char* cursor = buffer;
+
+	while ('\0' != *tag)
+	{
+		*cursor++ = *tag++;
+	}
+	for (uint32_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		*cursor++ = ' ';
+		cursor += TextFormat_FormatFloat(cursor, values[i]);
+	}
+	*cursor++ = '\n';
+	*cursor = '\0';
+
+	return (uint32_t) (cursor - buffer);
+}
+
+#if TEXT_FORMAT_ENABLE_BENCHMARK
+
+#define TEXT_FORMAT_BENCHMARK_LINES			(UINT32_C(500))
+#define TEXT_FORMAT_BENCHMARK_TASK_STACK_SIZE	(UINT32_C(600))
+#define TEXT_FORMAT_BENCHMARK_TASK_PRIO		(UINT32_C(4))
+
+struct TextFormat_BenchmarkRun_S
+{
+	const char* Name;
+	bool UseSnprintf;
+	TaskHandle_t Caller;
+	uint32_t CyclesPerLine;
+	UBaseType_t StackHighWaterMark;
+};
+typedef struct TextFormat_BenchmarkRun_S TextFormat_BenchmarkRun_T;
+
+static void RunBenchmarkTask(void* param1);
+static Retcode_T RunBenchmark(TextFormat_BenchmarkRun_T* run);
+
+/* Kept off the task stacks so only the formatters themselves are measured. */
+static char BenchmarkLine[TEXT_FORMAT_LINE_BUFFER_SIZE];
+
+static void RunBenchmarkTask(void* param1)
+{
+	TextFormat_BenchmarkRun_T* run = param1;
+	uint32_t length = 0;
+	uint32_t start = DWT->CYCCNT;
+
+	for (uint32_t i = 0; i < TEXT_FORMAT_BENCHMARK_LINES; i++)
+	{
+		float w = (float) (i % 2001) / 1000.0f - 1.0f;
+		float x = (float) (i * 7 % 2001) / 1000.0f - 1.0f;
+		float y = (float) (i * 13 % 2001) / 1000.0f - 1.0f;
+		float z = (float) (i * 31 % 2001) / 1000.0f - 1.0f;
+		if (run->UseSnprintf)
+		{
+			length += (uint32_t) snprintf(BenchmarkLine, sizeof(BenchmarkLine),
+					">>QUAT: %f %f %f %f\n", w, x, y, z);
+		}
+		else
+		{
+			length += TextFormat_FormatQuaternion(BenchmarkLine, ">>QUAT:", w,
+					x, y, z);
+		}
+	}
+
+	run->CyclesPerLine = (DWT->CYCCNT - start) / TEXT_FORMAT_BENCHMARK_LINES;
+	run->StackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
+	BCDS_UNUSED(length);
+
+	xTaskNotifyGive(run->Caller);
+	vTaskDelete(NULL);
+}
+
+static Retcode_T RunBenchmark(TextFormat_BenchmarkRun_T* run)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	run->Caller = xTaskGetCurrentTaskHandle();
+	/* Stays on the heap also with APP_USE_STATIC_ALLOCATION: the task deletes
+	 * itself and a static buffer could be reused before the idle task is done
+	 * with it. Only built for benchmarking anyway. */
+	BaseType_t taskCreated = xTaskCreate(RunBenchmarkTask, "TEXT_BENCH",
+			TEXT_FORMAT_BENCHMARK_TASK_STACK_SIZE, run,
+			TEXT_FORMAT_BENCHMARK_TASK_PRIO, NULL);
+	if (pdTRUE != taskCreated)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_OUT_OF_RESOURCES);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		(void) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		LOG_INFO("%s: %lu cycles/line, %lu bytes stack", run->Name,
+				(unsigned long) run->CyclesPerLine,
+				(unsigned long) ((TEXT_FORMAT_BENCHMARK_TASK_STACK_SIZE
+						- run->StackHighWaterMark) * sizeof(StackType_t)));
+	}
+
+	return rc;
+}
+
+Retcode_T TextFormat_RunBenchmark(void)
+{
+	Retcode_T rc = RETCODE_OK;
+	TextFormat_BenchmarkRun_T snprintfRun =
+	{ "snprintf", true, NULL, 0, 0 };
+	TextFormat_BenchmarkRun_T textFormatRun =
+	{ "TextFormat", false, NULL, 0, 0 };
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	rc = RunBenchmark(&snprintfRun);
+
+	if (RETCODE_OK == rc)
+	{
+		rc = RunBenchmark(&textFormatRun);
+	}
+
+	return rc;
+}
+
+#endif /* TEXT_FORMAT_ENABLE_BENCHMARK */
@@ -0,0 +1,110 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_TIMESYNC
+
+#include "XdkTimeSync.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "em_device.h"
+
+#include "XdkSerialMux.h"
+#include "XdkTextFormat.h"
+
+#define TIME_SYNC_TICK_PERIOD_US	(UINT32_C(1000000) / configTICK_RATE_HZ)
+/* The host time is echoed as is, it only has to fit the response line. */
+#define TIME_SYNC_MAX_HOST_TIME_LENGTH	(UINT32_C(20))
+
+uint32_t TimeSync_GetDeviceTime(void)
+{
+	TickType_t ticks;
+	uint32_t elapsed;
+	bool isTickPending;
+
+	do
+	{
+		ticks = xTaskGetTickCountFromISR();
+		elapsed = SysTick->LOAD - SysTick->VAL;
+		isTickPending = (0 != (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk));
+	} while (ticks != xTaskGetTickCountFromISR());
+
+	/* The counter wrapped, but the tick interrupt did not run yet. */
+	if (isTickPending && elapsed < SysTick->LOAD / 2)
+	{
+		ticks++;
+	}
+
+	return (uint32_t) ticks * TIME_SYNC_TICK_PERIOD_US
+			+ (uint32_t) (((uint64_t) elapsed * TIME_SYNC_TICK_PERIOD_US)
+					/ (SysTick->LOAD + 1));
+}
+
+Retcode_T TimeSync_HandleSyncCommand(const char* args, uint32_t receivedAt)
+{
+	Retcode_T rc = RETCODE_OK;
+	uint32_t hostTimeLength = 0;
+
+	while (hostTimeLength < TIME_SYNC_MAX_HOST_TIME_LENGTH
+			&& args[hostTimeLength] >= '0' && args[hostTimeLength] <= '9')
+	{
+		hostTimeLength++;
+	}
+
+	if (0 == hostTimeLength)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_INVALID_PARAM);
+	}
+
+	SerialMux_Line_T* line = NULL;
+	if (RETCODE_OK == rc)
+	{
+		line = SerialMux_Reserve(SERIAL_MUX_CHANNEL_RESPONSE);
+		if (NULL == line)
+		{
+			rc = RETCODE(RETCODE_SEVERITY_WARNING, RETCODE_OUT_OF_RESOURCES);
+		}
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		char* text = line->Text;
+		memcpy(text, "SYNC ", 5);
+		text += 5;
+		memcpy(text, args, hostTimeLength);
+		text += hostTimeLength;
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, receivedAt);
+		*text++ = ' ';
+		text += TextFormat_FormatUnsigned(text, TimeSync_GetDeviceTime());
+		line->Length = (uint32_t) (text - line->Text);
+		SerialMux_Commit(line);
+	}
+
+	return rc;
+}
@@ -0,0 +1,200 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "XdkApp.h"
+#undef BCDS_MODULE_ID
+#define BCDS_MODULE_ID	APP_MODULE_USBUI
+
+#include "XdkUsbUi.h"
+
+#include <string.h>
+
+#include "BCDS_Basics.h"
+#include "BCDS_Retcode.h"
+#include "BCDS_CmdProcessor.h"
+
+#include "USB_ih.h"
+
+#include "XdkFlightRecorder.h"
+#include "XdkHeadTrack.h"
+#include "XdkRuntimeStats.h"
+#include "XdkSerialMux.h"
+#include "XdkTimeSync.h"
+
+#define USB_UI_COMMAND_TAG			">>CMD:"
+#define USB_UI_COMMAND_TAG_LENGTH	(sizeof(USB_UI_COMMAND_TAG) - 1)
+
+typedef Retcode_T (*UsbUi_CommandHandler_T)(const char* args,
+		uint32_t receivedAt);
+
+struct UsbUi_Command_S
+{
+	const char* Name;
+	UsbUi_CommandHandler_T Handler;
+};
+typedef struct UsbUi_Command_S UsbUi_Command_T;
+
+static const UsbUi_Command_T Commands[] =
+{
+{ "SYNC", TimeSync_HandleSyncCommand },
+{ "STATS", RuntimeStats_HandleStatsCommand },
+{ "RATE", HeadTrack_HandleRateCommand },
+{ "DUMP", FlightRecorder_HandleDumpCommand } };
+
+static const CmdProcessor_T* CmdProcessor;
+
+/* Filled by the USB interrupt. */
+static char ReceiveLine[USB_UI_COMMAND_LINE_SIZE];
+static uint32_t ReceiveLength = 0;
+static bool IsReceiveLineTooLong = false;
+
+/* Handed over to the command processor, one command at a time. */
+static char PendingLine[USB_UI_COMMAND_LINE_SIZE];
+static volatile bool IsCommandPending = false;
+static volatile uint32_t DroppedCount = 0;
+
+static void HandleUsbDataReceived(uint8_t* buffer, uint16_t count);
+static void CompleteReceiveLine(void);
+static void ExecuteCommand(void* param1, uint32_t receivedAt);
+
+static void HandleUsbDataReceived(uint8_t* buffer, uint16_t count)
+{
+	for (uint16_t i = 0; i < count; i++)
+	{
+		char c = (char) buffer[i];
+		if ('\n' == c || '\r' == c)
+		{
+			if (ReceiveLength > 0)
+			{
+				CompleteReceiveLine();
+			}
+			ReceiveLength = 0;
+			IsReceiveLineTooLong = false;
+		}
+		else if (ReceiveLength < USB_UI_COMMAND_LINE_SIZE - 1)
+		{
+			ReceiveLine[ReceiveLength++] = c;
+		}
+		else
+		{
+			IsReceiveLineTooLong = true;
+		}
+	}
+}
+
+static void CompleteReceiveLine(void)
+{
+	/* Taken as close to the wire as possible, see TimeSync. */
+	uint32_t receivedAt = TimeSync_GetDeviceTime();
+
+	if (IsReceiveLineTooLong || IsCommandPending)
+	{
+		DroppedCount++;
+		return;
+	}
+
+	memcpy(PendingLine, ReceiveLine, ReceiveLength);
+	PendingLine[ReceiveLength] = '\0';
+	IsCommandPending = true;
+
+	Retcode_T rc = CmdProcessor_EnqueueFromIsr((CmdProcessor_T*) CmdProcessor,
+			ExecuteCommand, NULL, receivedAt);
+	if (RETCODE_OK != rc)
+	{
+		IsCommandPending = false;
+		Retcode_RaiseErrorFromIsr(rc);
+	}
+}
+
+static void ExecuteCommand(void* param1, uint32_t receivedAt)
+{
+	BCDS_UNUSED(param1);
+
+	Retcode_T rc = RETCODE_OK;
+	const char* name = PendingLine;
+
+	/* Anything else on the line is not meant for us. */
+	if (0 == strncmp(name, USB_UI_COMMAND_TAG, USB_UI_COMMAND_TAG_LENGTH))
+	{
+		name += USB_UI_COMMAND_TAG_LENGTH;
+		while (' ' == *name)
+		{
+			name++;
+		}
+
+		size_t nameLength = strcspn(name, " ");
+		const char* args = name + nameLength;
+		while (' ' == *args)
+		{
+			args++;
+		}
+
+		const UsbUi_Command_T* command = NULL;
+		for (uint32_t i = 0; i < sizeof(Commands) / sizeof(Commands[0]); i++)
+		{
+			if (strlen(Commands[i].Name) == nameLength
+					&& 0 == strncmp(Commands[i].Name, name, nameLength))
+			{
+				command = &Commands[i];
+				break;
+			}
+		}
+
+		if (NULL != command)
+		{
+			rc = command->Handler(args, receivedAt);
+		}
+		else
+		{
+			rc = SerialMux_Printf(SERIAL_MUX_CHANNEL_RESPONSE, "ERR %.*s",
+					(int) nameLength, name);
+		}
+	}
+
+	IsCommandPending = false;
+
+	if (RETCODE_OK != rc)
+	{
+		Retcode_RaiseError(rc);
+	}
+}
+
+Retcode_T UsbUi_Initialize(const CmdProcessor_T* cmdProcessor)
+{
+	Retcode_T rc = RETCODE_OK;
+
+	if (NULL == cmdProcessor)
+	{
+		rc = RETCODE(RETCODE_SEVERITY_ERROR, RETCODE_NULL_POINTER);
+	}
+
+	if (RETCODE_OK == rc)
+	{
+		CmdProcessor = cmdProcessor;
+		USB_callBackMapping(HandleUsbDataReceived);
+	}
+
+	return rc;
+}
+
+uint32_t UsbUi_GetDroppedCount(void)
+{
+	return DroppedCount;
+}
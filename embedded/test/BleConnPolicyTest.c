@@ -0,0 +1,318 @@
+/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Host test of XdkBleConnPolicy, see Makefile. StubBlePeripheral stands in
+ * for BlePeripheral and the GAP below it: it takes requests the way the
+ * port of BleUi does and answers them as a central would. The test drives
+ * the policy the way XdkBleConnParams does on the command processor. */
+#include "XdkBleConnPolicy.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK(condition)	Check((condition), #condition, __FILE__, __LINE__)
+
+struct StubBlePeripheral_S
+{
+	/* Whether the central applies requests or keeps its parameters. */
+	bool IsAccepting;
+	BleConnParams_T Current;
+	uint32_t Requests;
+	BleConnParams_T LastRequest;
+};
+typedef struct StubBlePeripheral_S StubBlePeripheral_T;
+
+static uint32_t Failures = 0;
+
+static void Check(bool condition, const char* text, const char* file,
+		int line)
+{
+	if (!condition)
+	{
+		printf("%s:%d: CHECK(%s) failed\n", file, line, text);
+		Failures++;
+	}
+}
+
+/* A central's default of 30 ms. */
+static void StubBlePeripheral_Connect(StubBlePeripheral_T* stub,
+		bool isAccepting)
+{
+	memset(stub, 0, sizeof(*stub));
+	stub->IsAccepting = isAccepting;
+	stub->Current.MinInterval = 24;
+	stub->Current.MaxInterval = 24;
+	stub->Current.SupervisionTimeout = 400;
+}
+
+static void StubBlePeripheral_Request(StubBlePeripheral_T* stub,
+		const BleConnParams_T* params)
+{
+	stub->Requests++;
+	stub->LastRequest = *params;
+	if (stub->IsAccepting)
+	{
+		/* Centrals pick the longest interval allowed. */
+		stub->Current.MinInterval = params->MaxInterval;
+		stub->Current.MaxInterval = params->MaxInterval;
+		stub->Current.SlaveLatency = params->SlaveLatency;
+		stub->Current.SupervisionTimeout = params->SupervisionTimeout;
+	}
+}
+
+static bool RequestIfChanged(BleConnPolicy_T* policy,
+		StubBlePeripheral_T* stub)
+{
+	BleConnParams_T params;
+	bool isRequested = BleConnPolicy_NextRequest(policy, &params);
+	if (isRequested)
+	{
+		StubBlePeripheral_Request(stub, &params);
+	}
+	return isRequested;
+}
+
+/* The settle timer expired: false if nothing was read back. */
+static bool ReadBack(BleConnPolicy_T* policy, StubBlePeripheral_T* stub,
+		bool* isAccepted)
+{
+	if (!BleConnPolicy_EndSettling(policy))
+	{
+		return false;
+	}
+	*isAccepted = BleConnPolicy_IsAccepted(&policy->Requested,
+			&stub->Current);
+	return true;
+}
+
+static void TestCompute(void)
+{
+	BleConnParams_T params;
+
+	BleConnPolicy_Compute(0, &params);
+	CHECK(6 == params.MinInterval);
+	CHECK(6 == params.MaxInterval);
+	CHECK(0 == params.SlaveLatency);
+	CHECK(100 == params.SupervisionTimeout);
+
+	/* Half of 10 ms is below 7.5 ms. */
+	BleConnPolicy_Compute(10, &params);
+	CHECK(6 == params.MaxInterval);
+
+	BleConnPolicy_Compute(40, &params);
+	CHECK(6 == params.MinInterval);
+	CHECK(16 == params.MaxInterval);
+
+	BleConnPolicy_Compute(1000, &params);
+	CHECK(40 == params.MaxInterval);
+}
+
+static void TestIsAccepted(void)
+{
+	BleConnParams_T requested =
+	{ .MinInterval = 6, .MaxInterval = 16, .SlaveLatency = 0,
+			.SupervisionTimeout = 100 };
+	BleConnParams_T negotiated = requested;
+
+	negotiated.MinInterval = negotiated.MaxInterval = 6;
+	CHECK(BleConnPolicy_IsAccepted(&requested, &negotiated));
+	negotiated.MinInterval = negotiated.MaxInterval = 16;
+	CHECK(BleConnPolicy_IsAccepted(&requested, &negotiated));
+	negotiated.MinInterval = negotiated.MaxInterval = 24;
+	CHECK(!BleConnPolicy_IsAccepted(&requested, &negotiated));
+	negotiated.MinInterval = negotiated.MaxInterval = 16;
+	negotiated.SlaveLatency = 4;
+	CHECK(!BleConnPolicy_IsAccepted(&requested, &negotiated));
+}
+
+static void TestRequestsOncePerConnection(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = false;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 40);
+	CHECK(!RequestIfChanged(&policy, &stub));
+
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(16 == stub.LastRequest.MaxInterval);
+	CHECK(ReadBack(&policy, &stub, &isAccepted));
+	CHECK(isAccepted);
+	CHECK(16 == stub.Current.MaxInterval);
+
+	/* Same period, same parameters. */
+	BleConnPolicy_SetSamplePeriod(&policy, 40);
+	CHECK(!RequestIfChanged(&policy, &stub));
+	CHECK(1 == stub.Requests);
+	/* A read-back needs a request. */
+	CHECK(!ReadBack(&policy, &stub, &isAccepted));
+}
+
+static void TestChangeWaitsWhileSettling(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = false;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 40);
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+
+	BleConnPolicy_SetSamplePeriod(&policy, 100);
+	CHECK(!RequestIfChanged(&policy, &stub));
+	CHECK(1 == stub.Requests);
+
+	CHECK(ReadBack(&policy, &stub, &isAccepted));
+	CHECK(isAccepted);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(40 == stub.LastRequest.MaxInterval);
+}
+
+static void TestRejectedIsNotRepeated(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = true;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 20);
+	StubBlePeripheral_Connect(&stub, false);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(ReadBack(&policy, &stub, &isAccepted));
+	CHECK(!isAccepted);
+
+	BleConnPolicy_SetSamplePeriod(&policy, 20);
+	CHECK(!RequestIfChanged(&policy, &stub));
+	BleConnPolicy_SetSamplePeriod(&policy, 100);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(2 == stub.Requests);
+}
+
+static void TestAbortedIsNotRepeated(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = false;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 20);
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	BleConnPolicy_AbortRequest(&policy);
+	CHECK(!ReadBack(&policy, &stub, &isAccepted));
+
+	CHECK(!RequestIfChanged(&policy, &stub));
+	BleConnPolicy_SetSamplePeriod(&policy, 100);
+	CHECK(RequestIfChanged(&policy, &stub));
+}
+
+static void TestReconnectWhileSettling(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = false;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 20);
+	StubBlePeripheral_Connect(&stub, false);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(8 == policy.Requested.MaxInterval);
+
+	/* Back within the settle time of the first request, which must not
+	 * hold back the request of the new connection. */
+	BleConnPolicy_SetConnected(&policy, false);
+	BleConnPolicy_SetSamplePeriod(&policy, 100);
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(40 == stub.LastRequest.MaxInterval);
+	CHECK(ReadBack(&policy, &stub, &isAccepted));
+	CHECK(isAccepted);
+}
+
+static void TestDisconnectDropsReadBack(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = false;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 20);
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+
+	BleConnPolicy_SetConnected(&policy, false);
+	CHECK(!policy.IsSettling);
+	CHECK(!ReadBack(&policy, &stub, &isAccepted));
+	CHECK(!RequestIfChanged(&policy, &stub));
+}
+
+static void TestReconnectRequestsAgain(void)
+{
+	BleConnPolicy_T policy;
+	StubBlePeripheral_T stub;
+	bool isAccepted = false;
+
+	BleConnPolicy_Initialize(&policy);
+	BleConnPolicy_SetSamplePeriod(&policy, 40);
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(ReadBack(&policy, &stub, &isAccepted));
+
+	/* The central's defaults again, so the same parameters. */
+	BleConnPolicy_SetConnected(&policy, false);
+	StubBlePeripheral_Connect(&stub, true);
+	BleConnPolicy_SetConnected(&policy, true);
+	CHECK(RequestIfChanged(&policy, &stub));
+	CHECK(16 == stub.LastRequest.MaxInterval);
+}
+
+int main(void)
+{
+	TestCompute();
+	TestIsAccepted();
+	TestRequestsOncePerConnection();
+	TestChangeWaitsWhileSettling();
+	TestRejectedIsNotRepeated();
+	TestAbortedIsNotRepeated();
+	TestReconnectWhileSettling();
+	TestDisconnectDropsReadBack();
+	TestReconnectRequestsAgain();
+
+	if (0 != Failures)
+	{
+		printf("BleConnPolicyTest: %lu checks failed\n",
+				(unsigned long) Failures);
+		return 1;
+	}
+	printf("BleConnPolicyTest: passed\n");
+	return 0;
+}
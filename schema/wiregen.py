@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+"""Generates the wire codecs of firmware and host from XdkWire.json.
+
+Writes embedded/include/XdkWire.h (packed structs with compile time size and
+offset checks) and client/XdkHeadTrack.Core/Model/XdkWire.cs (decoders and
+encoders). Run it after every change of the schema and commit the results;
+--check only reports whether the generated files are up to date.
+
+Rules enforced on the schema:
+ * BLE messages are told apart by their size, so no two may have the same
+   one, and each has to fit into the 20 byte payload of a notification.
+ * Versions are unique per channel, a new format gets a new version.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+import textwrap
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SCHEMA = os.path.join(ROOT, "schema", "XdkWire.json")
+C_OUTPUT = os.path.join(ROOT, "embedded", "include", "XdkWire.h")
+CS_OUTPUT = os.path.join(ROOT, "client", "XdkHeadTrack.Core", "Model", "XdkWire.cs")
+
+BLE_MAX_PAYLOAD = 20
+
+C_LICENSE = """/* Copyright 2018 Andreas Baulig
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+"""
+
+# Schema type: (size, C type, C# type, C# read expression, C# write statement)
+TYPES = {
+    "bool": (1, "bool", "bool", "buffer[{o}] != 0", "buffer[{o}] = (byte)({v} ? 1 : 0);"),
+    "uint8": (1, "uint8_t", "byte", "buffer[{o}]", "buffer[{o}] = {v};"),
+    "int8": (1, "int8_t", "sbyte", "(sbyte)buffer[{o}]", "buffer[{o}] = (byte){v};"),
+    "uint16": (2, "uint16_t", "ushort", "ReadUInt16(buffer, {o})", "WriteUInt16({v}, buffer, {o});"),
+    "int16": (2, "int16_t", "short", "(short)ReadUInt16(buffer, {o})", "WriteUInt16((ushort){v}, buffer, {o});"),
+    "uint32": (4, "uint32_t", "uint", "ReadUInt32(buffer, {o})", "WriteUInt32({v}, buffer, {o});"),
+    "int32": (4, "int32_t", "int", "(int)ReadUInt32(buffer, {o})", "WriteUInt32((uint){v}, buffer, {o});"),
+    "float32": (4, "float", "float", "BitConverter.ToSingle(buffer, {o})", "WriteSingle({v}, buffer, {o});"),
+    "float64": (8, "double", "double", "BitConverter.ToDouble(buffer, {o})", "WriteDouble({v}, buffer, {o});"),
+}
+
+CS_CONSTANT_TYPES = {"uint8": "byte", "uint16": "ushort", "uint32": "uint"}
+C_LITERALS = {"uint8": "UINT8_C", "uint16": "UINT16_C", "uint32": "UINT32_C"}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def macro_name(name):
+    """BleUi_TrackingData -> BLE_UI_TRACKING_DATA"""
+    parts = []
+    for part in name.split("_"):
+        parts.extend(re.findall(r"[A-Z]+[a-z0-9]*|[a-z0-9]+", part))
+    return "_".join(p.upper() for p in parts)
+
+
+def wrap(text, prefix, width=80):
+    return "".join(prefix + line + "\n" for line in textwrap.wrap(text, width - len(prefix.expandtabs(4))))
+
+
+def layout(message):
+    """Field offsets and total size, also validates the field types."""
+    offset = 0
+    fields = []
+    for field in message["fields"]:
+        if field["type"] not in TYPES:
+            raise SchemaError("%s.%s: unknown type %s" % (message["name"], field["name"], field["type"]))
+        count = field.get("count", 1)
+        fields.append((field, offset, count))
+        offset += TYPES[field["type"]][0] * count
+    return fields, offset
+
+
+def layout_hash(message):
+    """FNV-1a of the field list, changes with every layout change."""
+    text = ";".join("%s:%s:%d" % (f["name"], f["type"], f.get("count", 1)) for f in message["fields"])
+    value = 0x811C9DC5
+    for byte in text.encode("ascii"):
+        value = ((value ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return value
+
+
+def validate(schema):
+    versions = {}
+    ble_sizes = {}
+    for message in schema["messages"]:
+        _, size = layout(message)
+        version = (message.get("channel", "ble"), message["version"])
+        if version in versions:
+            raise SchemaError("%s and %s share version %d" % (versions[version], message["name"], version[1]))
+        versions[version] = message["name"]
+        if message.get("channel", "ble") == "ble":
+            if size > BLE_MAX_PAYLOAD:
+                raise SchemaError("%s: %d bytes do not fit into a notification" % (message["name"], size))
+            if size in ble_sizes:
+                raise SchemaError("%s and %s are both %d bytes" % (ble_sizes[size], message["name"], size))
+            ble_sizes[size] = message["name"]
+        if "device" in message["targets"] and "cName" not in message:
+            raise SchemaError("%s: device messages need a cName" % message["name"])
+
+
+def generate_c(schema):
+    out = [C_LICENSE]
+    out.append("/* Generated by schema/wiregen.py from schema/XdkWire.json, do not edit. */\n")
+    out.append("#ifndef XDKWIRE_H_\n#define XDKWIRE_H_\n\n")
+    out.append("#include \"BCDS_Basics.h\"\n\n#include <stddef.h>\n\n")
+    out.append("#define XDK_WIRE_SCHEMA_VERSION\t(UINT32_C(%d))\n\n" % schema["schemaVersion"])
+    out.append("/* Fails to compile with a negative array size if condition is false. */\n")
+    out.append("#define XDK_WIRE_STATIC_ASSERT(name, condition) \\\n"
+               "\ttypedef char XdkWire_Assert_##name[(condition) ? 1 : -1]\n\n")
+    for line in schema["lines"]:
+        out.append("/* %s Fields: %s. */\n" % (line["doc"], " ".join(line["fields"])))
+        out.append("#define XDK_WIRE_%s_LINE_TAG\t\"%s\"\n" % (macro_name(line["name"]), line["tag"]))
+    for message in schema["messages"]:
+        if "device" not in message["targets"]:
+            continue
+        fields, size = layout(message)
+        name = message["cName"]
+        macro = macro_name(name)
+        out.append("\n/*\n%s */\n" % wrap(message["doc"], " * "))
+        out.append("#define %s_VERSION\t(UINT8_C(%d))\n" % (macro, message["version"]))
+        out.append("#define %s_SIZE\t(UINT32_C(%d))\n" % (macro, size))
+        out.append("#define %s_LAYOUT_HASH\t(UINT32_C(0x%08X))\n" % (macro, layout_hash(message)))
+        for constant in message.get("constants", []):
+            out.append("#define %s\t(%s(%d))\n" % (constant["cName"], C_LITERALS[constant["type"]], constant["value"]))
+        out.append("\n#pragma pack(push, 1)\nstruct %s_S\n{\n" % name)
+        for field, _, count in fields:
+            suffix = "[%d]" % count if "count" in field else ""
+            out.append("\t%s %s%s;\n" % (TYPES[field["type"]][1], field["name"], suffix))
+        out.append("};\n#pragma pack(pop)\ntypedef struct %s_S %s_T;\n\n" % (name, name))
+        out.append("XDK_WIRE_STATIC_ASSERT(%s_Size, sizeof(%s_T) == %s_SIZE);\n" % (name, name, macro))
+        for field, offset, _ in fields:
+            out.append("XDK_WIRE_STATIC_ASSERT(%s_%s, offsetof(%s_T, %s) == %d);\n"
+                       % (name, field["name"], name, field["name"], offset))
+    out.append("\n#endif /* XDKWIRE_H_ */\n")
+    return "".join(out)
+
+
+def generate_cs(schema):
+    out = ["﻿// Generated by schema/wiregen.py from schema/XdkWire.json, do not edit.\n"]
+    out.append("using System;\nusing System.Runtime.InteropServices;\n\nnamespace XdkHeadTrack.Model\n{\n")
+    out.append("\t/// <summary>\n\t/// Wire formats shared with the firmware, see schema/XdkWire.json. All\n"
+               "\t/// values are little endian.\n\t/// </summary>\n")
+    out.append("\tpublic static class XdkWire\n\t{\n")
+    out.append("\t\tpublic const int SchemaVersion = %d;\n" % schema["schemaVersion"])
+    for line in schema["lines"]:
+        out.append("\t\t/// <summary>%s Fields: %s.</summary>\n" % (line["doc"], " ".join(line["fields"])))
+        out.append("\t\tpublic const string %sLineTag = \"%s\";\n" % (line["name"], line["tag"]))
+    for message in schema["messages"]:
+        if "host" not in message["targets"]:
+            continue
+        fields, size = layout(message)
+        out.append("\n\t\t/// <summary>\n%s\t\t/// </summary>\n" % wrap(message["doc"], "\t\t/// "))
+        out.append("\t\tpublic struct %s\n\t\t{\n" % message["name"])
+        out.append("\t\t\tpublic const int Version = %d;\n" % message["version"])
+        out.append("\t\t\tpublic const int Size = %d;\n" % size)
+        out.append("\t\t\tpublic const uint LayoutHash = 0x%08X;\n" % layout_hash(message))
+        for constant in message.get("constants", []):
+            out.append("\t\t\tpublic const %s %s = %d;\n" % (CS_CONSTANT_TYPES[constant["type"]], constant["name"], constant["value"]))
+        for field, offset, _ in fields:
+            out.append("\t\t\tpublic const int %sOffset = %d;\n" % (field["name"], offset))
+        out.append("\n")
+        members = []
+        for field, offset, count in fields:
+            element = TYPES[field["type"]][0]
+            for i in range(count):
+                member = field["name"] + (str(i) if "count" in field else "")
+                members.append((member, field["type"], offset + i * element))
+                out.append("\t\t\tpublic %s %s;\n" % (TYPES[field["type"]][2], member))
+        out.append("\n\t\t\tpublic static %s Decode(byte[] buffer, int offset)\n\t\t\t{\n" % message["name"])
+        out.append("\t\t\t\treturn new %s\n\t\t\t\t{\n" % message["name"])
+        for member, type_name, offset in members:
+            out.append("\t\t\t\t\t%s = %s,\n" % (member, TYPES[type_name][3].format(o="offset + %d" % offset if offset else "offset")))
+        out.append("\t\t\t\t};\n\t\t\t}\n")
+        out.append("\n\t\t\tpublic void Encode(byte[] buffer, int offset)\n\t\t\t{\n")
+        for member, type_name, offset in members:
+            out.append("\t\t\t\t%s\n" % TYPES[type_name][4].format(o="offset + %d" % offset if offset else "offset", v=member))
+        out.append("\t\t\t}\n\t\t}\n")
+    out.append(CS_HELPERS)
+    out.append("\t}\n}\n")
+    return "".join(out)
+
+
+CS_HELPERS = """
+		private static ushort ReadUInt16(byte[] buffer, int offset)
+		{
+			return (ushort)(buffer[offset] | buffer[offset + 1] << 8);
+		}
+
+		private static uint ReadUInt32(byte[] buffer, int offset)
+		{
+			return (uint)(buffer[offset] | buffer[offset + 1] << 8 | buffer[offset + 2] << 16 | buffer[offset + 3] << 24);
+		}
+
+		private static void WriteUInt16(ushort value, byte[] buffer, int offset)
+		{
+			buffer[offset] = (byte)value;
+			buffer[offset + 1] = (byte)(value >> 8);
+		}
+
+		private static void WriteUInt32(uint value, byte[] buffer, int offset)
+		{
+			buffer[offset] = (byte)value;
+			buffer[offset + 1] = (byte)(value >> 8);
+			buffer[offset + 2] = (byte)(value >> 16);
+			buffer[offset + 3] = (byte)(value >> 24);
+		}
+
+		private static void WriteSingle(float value, byte[] buffer, int offset)
+		{
+			WriteUInt32(new SingleBits { Single = value }.Bits, buffer, offset);
+		}
+
+		private static void WriteDouble(double value, byte[] buffer, int offset)
+		{
+			long bits = BitConverter.DoubleToInt64Bits(value);
+			WriteUInt32((uint)bits, buffer, offset);
+			WriteUInt32((uint)(bits >> 32), buffer, offset + 4);
+		}
+
+		[StructLayout(LayoutKind.Explicit)]
+		private struct SingleBits
+		{
+			[FieldOffset(0)] public float Single;
+			[FieldOffset(0)] public uint Bits;
+		}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--check", action="store_true", help="fail if the generated files are out of date")
+    args = parser.parse_args()
+
+    with open(SCHEMA) as f:
+        schema = json.load(f)
+    try:
+        validate(schema)
+    except SchemaError as e:
+        print("XdkWire.json: %s" % e, file=sys.stderr)
+        return 1
+
+    stale = []
+    for path, content in ((C_OUTPUT, generate_c(schema)), (CS_OUTPUT, generate_cs(schema))):
+        current = None
+        if os.path.exists(path):
+            with open(path, encoding="utf-8", newline="") as f:
+                current = f.read()
+        # Checkouts with core.autocrlf have CRLF line ends.
+        if current is not None and current.replace("\r\n", "\n") == content:
+            continue
+        if args.check:
+            stale.append(os.path.relpath(path, ROOT))
+        else:
+            with open(path, "w", encoding="utf-8", newline="") as f:
+                f.write(content)
+            print("Wrote %s" % os.path.relpath(path, ROOT))
+    if stale:
+        print("Out of date, run schema/wiregen.py: %s" % ", ".join(stale), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())